@@ -15,99 +15,17 @@
  */
 
 #include <assert.h>
-#include <bitset>
-#include <stdexcept>
 #include <stdint.h>
 
 #include "../log.hpp"
 #include "../state.hpp"
 #include "../math/matrix.hpp"
 #include "anim.hpp"
+#include "sampler.hpp"
 
 using namespace Mortar::Animation;
 
-struct KeyframeLookupKey {
-  // Floating point frame position
-  float position;
-
-  // Animations are divided into intervals of 32 frames
-  unsigned interval;
-
-  // Integer position of current frame after current interval
-  unsigned char subinterval;
-
-  uint8_t intervalMask;
-};
-
-float inline squared(float f) {
-  return f * f;
-}
-
-float inline cubed(float f) {
-  return f * f * f;
-}
-
-float inline calculateHermite(float position, float tStart, float tEnd, float inverseDuration, float blendStart, float blendEnd, float rateStart, float rateEnd) {
-  float u = (position - tStart) * inverseDuration;
-  float duration = tEnd - tStart;
-
-  float durationAdjustedStartRate = duration * rateStart;
-  float durationAdjustedEndRate = duration * rateEnd;
-
-  return (2 * cubed(u) - 3 * squared(u) + 1) * blendStart + (-2 * cubed(u) + 3 * squared(u)) * blendEnd + (cubed(u) - 2 * squared(u) + u) * durationAdjustedStartRate + (cubed(u) - squared(u)) * durationAdjustedEndRate;
-}
-
-float calculateChannelValue(const Mortar::Resource::Animation::Channel *channel, const struct KeyframeLookupKey *key) {
-  Mortar::Resource::Animation::KeyframeType keyframeType = channel->getKeyframeType();
-
-  if (keyframeType == Mortar::Resource::Animation::KeyframeType::NONE) {
-    return channel->getFloatData();
-  } else if (keyframeType == Mortar::Resource::Animation::KeyframeType::BOOLEAN) {
-    throw std::runtime_error("boolean keyframes unimplemented");
-  }
-
-  const uint8_t *mask = channel->getKeyframeMask(key->interval);
-
-  unsigned keyframe = 0;
-  for (int i = 0; i < key->subinterval; i++) {
-    // Relies on subinterval to be zero-indexed so we can mask against the
-    // current subinterval after the loop
-    keyframe += std::bitset<8>(mask[i]).count();
-  }
-  keyframe += std::bitset<8>(mask[key->subinterval] & key->intervalMask).count();
-
-  if (Mortar::State::printNextFrame) {
-    DEBUG("mask 0x%x, 0x%x, 0x%x, 0x%x; interval mask 0x%x", mask[0], mask[1], mask[2], mask[3], key->intervalMask);
-  }
-
-  unsigned intervalOffset = channel->getIntervalOffset(key->interval);
-
-  if (Mortar::State::printNextFrame) {
-    DEBUG("keyframe %d, interval offset %d", keyframe, intervalOffset);
-  }
-
-  if (channel->getKeyframeType() == Mortar::Resource::Animation::KeyframeType::FLOAT) {
-    unsigned offset = (intervalOffset + keyframe - 1) * 4;
-    float *startData = (float *)channel->getData() + offset;
-    float *endData = startData + 4;
-
-    if (Mortar::State::printNextFrame) {
-      DEBUG("t start %f, t end %f, invDur %f, p %f, q %f, v %f, w %f", startData[0], endData[0], startData[1], startData[2], endData[2], startData[3], endData[3]);
-    }
-
-    switch (Mortar::State::interpolate) {
-      case Mortar::State::InterpolateType::NONE:
-        return startData[2];
-      case Mortar::State::InterpolateType::HERMITE:
-        return calculateHermite(key->position, startData[0], endData[0], startData[1], startData[2], endData[2], startData[3], endData[3]);
-    }
-  } else {
-    DEBUG("keyframe type %d", keyframeType);
-    throw std::runtime_error("unimplemented keyframe type");
-  }
-}
-
-struct KeyframeLookupKey createKeyframeLookup(unsigned intervalCount, float position) {
+struct KeyframeLookupKey Mortar::Animation::createKeyframeLookup(unsigned intervalCount, float position) {
   struct KeyframeLookupKey key;
 
   key.position = position;
@@ -125,79 +43,87 @@ struct KeyframeLookupKey createKeyframeLookup(unsigned intervalCount, float posi
 
   key.subinterval = (unsigned char)intPositionAfterInterval >> 3;
 
-  if (key.subinterval < 0 || key.subinterval >= 4 || Mortar::State::printNextFrame) {
+  if (key.subinterval < 0 || key.subinterval >= 4) {
     DEBUG("position %f, interval %u, position after interval %f, subinterval %d", key.position, key.interval, positionAfterInterval, key.subinterval);
   }
   assert(key.subinterval >= 0 && key.subinterval < 4);
 
   key.intervalMask = (1 << (((intPositionAfterInterval & 0x7) + 1) & 0x1f)) - 1;
 
+  key.slot = key.interval * 4 + key.subinterval;
+
   return key;
 }
 
-std::vector<Mortar::Math::Matrix> Mortar::Animation::runSkeletalAnimation(const Mortar::Resource::Animation *animation, const std::vector<Mortar::Resource::Joint *>& joints, float position) {
+float Mortar::Animation::clampPosition(const Mortar::Resource::Animation *animation, float position) {
   if (position >= animation->getLength()) {
-    position = animation->getLength() - 0.01;
+    return animation->getLength() - 0.01;
   }
 
-  struct KeyframeLookupKey key = createKeyframeLookup(animation->getIntervalCount(), position);
+  return position;
+}
 
-  std::vector<Mortar::Math::Matrix> transforms;
-  transforms.reserve(joints.size());
+void Mortar::Animation::sampleChannels(const Mortar::Resource::Animation *animation, float position, float *values) {
+  ClipSampler(animation, Mortar::State::interpolate != Mortar::State::InterpolateType::NONE).sample(position, values);
+}
 
-  for (int i = 0; i < joints.size(); i++) {
-    if (i >= animation->getElementCount()) {
-      transforms[i] = Math::Matrix();
-      continue;
-    }
+Mortar::Math::Matrix Mortar::Animation::composeJointTransform(const Mortar::Resource::Animation::Element *element, const Mortar::Resource::Skeleton& skeleton, unsigned jointIdx, const Mortar::Math::Matrix& rotation, const float *translation, const float *scale) {
+  Mortar::Math::Matrix transform = rotation;
 
-    const Mortar::Resource::Animation::Element *element = animation->getElement(i);
-    const Mortar::Resource::Joint *joint = joints.at(i);
+  if (element->getIsRelativeToJoint()) {
+    transform = transform * skeleton.getJointTransforms()[jointIdx];
+  }
 
-    if (element->getHasRotation()) {
-      float yaw = calculateChannelValue(element->getChannel(3), &key);
-      float pitch = calculateChannelValue(element->getChannel(4), &key);
-      float roll = calculateChannelValue(element->getChannel(5), &key);
-
-      transforms.push_back(Mortar::Math::Matrix::rotationZYX(pitch, yaw, roll));
-      transforms[i].transpose();
-    } else {
-      transforms.push_back(Mortar::Math::Matrix());
-    }
+  if (element->getHasScale()) {
+    transform.scale(scale[0], scale[1], scale[2]);
+  }
 
-    if (element->getIsRelativeToJoint()) {
-      transforms[i] = transforms[i] * joint->getTransform();
-    }
+  transform.translate(translation[0], translation[1], translation[2]);
 
-    if (element->getHasScale()) {
-      float scaleX = calculateChannelValue(element->getChannel(6), &key);
-      float scaleY = calculateChannelValue(element->getChannel(7), &key);
-      float scaleZ = calculateChannelValue(element->getChannel(8), &key);
+  if (skeleton.hasJointFlag(jointIdx, Mortar::Resource::Skeleton::IS_RELATIVE_TO_ATTACHMENT)) {
+    Mortar::Math::Vector attachmentPoint = skeleton.getAttachmentPoints()[jointIdx];
 
-      transforms[i].scale(scaleX, scaleY, scaleZ);
-    }
+    Mortar::Math::Vector transformedAttachment = attachmentPoint * transform;
+    transform.setTranslation(transformedAttachment);
+
+    transform.translate(-attachmentPoint);
+  }
 
-    float transX = calculateChannelValue(element->getChannel(0), &key);
-    float transY = calculateChannelValue(element->getChannel(1), &key);
-    float transZ = calculateChannelValue(element->getChannel(2), &key);
+  return transform;
+}
 
-    transforms[i].translate(transX, transY, transZ);
+std::vector<Mortar::Math::Matrix> Mortar::Animation::buildPose(const Mortar::Resource::Animation *animation, const Mortar::Resource::Skeleton& skeleton, const float *values) {
+  std::vector<Mortar::Math::Matrix> transforms;
+  transforms.reserve(skeleton.getJointCount());
+
+  for (unsigned i = 0; i < skeleton.getJointCount(); i++) {
+    if (i >= animation->getElementCount()) {
+      transforms.push_back(Math::Matrix());
+      continue;
+    }
 
-    if (joint->getIsRelativeToAttachment()) {
-      Mortar::Math::Vector attachmentPoint = joint->getAttachmentPoint();
+    const Mortar::Resource::Animation::Element *element = animation->getElement(i);
+    const float *elementValues = values + i * POSE_CHANNEL_COUNT;
 
-      Mortar::Math::Vector transformedAttachment = attachmentPoint * transforms[i];
-      transforms[i].setTranslation(transformedAttachment);
+    Mortar::Math::Matrix rotation;
+    if (element->getHasRotation()) {
+      float yaw = elementValues[3];
+      float pitch = elementValues[4];
+      float roll = elementValues[5];
 
-      transforms[i].translate(-attachmentPoint);
+      rotation = Mortar::Math::Matrix::rotationZYX(pitch, yaw, roll);
+      rotation.transpose();
     }
 
-    transforms[i]._13 = -transforms[i]._13;
-    transforms[i]._23 = -transforms[i]._23;
-    transforms[i]._31 = -transforms[i]._31;
-    transforms[i]._32 = -transforms[i]._32;
-    transforms[i]._43 = -transforms[i]._43;
+    transforms.push_back(composeJointTransform(element, skeleton, i, rotation, elementValues, elementValues + 6));
   }
 
   return transforms;
 }
+
+std::vector<Mortar::Math::Matrix> Mortar::Animation::runSkeletalAnimation(const Mortar::Resource::Animation *animation, const Mortar::Resource::Skeleton& skeleton, float position) {
+  std::vector<float> values (animation->getElementCount() * POSE_CHANNEL_COUNT);
+  sampleChannels(animation, position, values.data());
+
+  return buildPose(animation, skeleton, values.data());
+}
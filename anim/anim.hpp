@@ -17,14 +17,59 @@
 #ifndef MORTAR_ANIM_H
 #define MORTAR_ANIM_H
 
+#include <stdint.h>
 #include <vector>
 
 #include "../math/matrix.hpp"
 #include "../resource/types/anim.hpp"
-#include "../resource/types/joint.hpp"
+#include "../resource/types/skeleton.hpp"
 
 namespace Mortar::Animation {
-  std::vector<Mortar::Math::Matrix> runSkeletalAnimation(const Mortar::Resource::Animation *animation, const std::vector<Mortar::Resource::Joint *>& joints, float position);
+  // Skeletal animations drive each joint with nine channels: translation,
+  // then rotation as yaw, pitch and roll, then scale
+  static const unsigned POSE_CHANNEL_COUNT = 9;
+
+  // Animation positions are measured in frames at this rate
+  static const float NATIVE_FRAME_RATE = 30.0f;
+
+  struct KeyframeLookupKey {
+    // Floating point frame position
+    float position;
+
+    // Animations are divided into intervals of 32 frames
+    unsigned interval;
+
+    // Integer position of current frame after current interval
+    unsigned char subinterval;
+
+    // Index of the current subinterval across all intervals, shared by every
+    // channel's keyframe lookup
+    unsigned slot;
+
+    uint8_t intervalMask;
+  };
+
+  struct KeyframeLookupKey createKeyframeLookup(unsigned intervalCount, float position);
+
+  // Clamps a position to just short of the end of an animation
+  float clampPosition(const Mortar::Resource::Animation *animation, float position);
+
+  // Samples the pose channels of every element, writing POSE_CHANNEL_COUNT
+  // values per element; channels an element doesn't use are left as zero.
+  // This prepares a ClipSampler on each call, so callers sampling a clip
+  // repeatedly should keep one instead.
+  void sampleChannels(const Mortar::Resource::Animation *animation, float position, float *values);
+
+  // Completes a joint's transform given its rotation and its element's
+  // translation and scale, the latter ignored unless the element has scale.
+  // Transforms are in our handedness rather than the game's; the conversion
+  // is folded into the skin transforms and rest pose on load.
+  Mortar::Math::Matrix composeJointTransform(const Mortar::Resource::Animation::Element *element, const Mortar::Resource::Skeleton& skeleton, unsigned jointIdx, const Mortar::Math::Matrix& rotation, const float *translation, const float *scale);
+
+  // Builds joint transforms from sampled channel values
+  std::vector<Mortar::Math::Matrix> buildPose(const Mortar::Resource::Animation *animation, const Mortar::Resource::Skeleton& skeleton, const float *values);
+
+  std::vector<Mortar::Math::Matrix> runSkeletalAnimation(const Mortar::Resource::Animation *animation, const Mortar::Resource::Skeleton& skeleton, float position);
 }
 
 #endif
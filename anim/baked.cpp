@@ -0,0 +1,199 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <math.h>
+#include <stdexcept>
+
+#include "../math/quaternion.hpp"
+#include "anim.hpp"
+#include "baked.hpp"
+#include "pose.hpp"
+#include "sampler.hpp"
+
+using namespace Mortar::Animation;
+
+Mortar::Resource::Animation::BakedTracks Mortar::Animation::bakeTracks(const Mortar::Resource::Animation *animation, float sampleRate) {
+  if (sampleRate <= 0.0f) {
+    throw std::runtime_error("bake rate must be positive");
+  }
+
+  Mortar::Resource::Animation::BakedTracks tracks;
+  tracks.sampleRate = sampleRate;
+  tracks.frameStep = NATIVE_FRAME_RATE / sampleRate;
+
+  // Positions start at frame 1; take enough samples to reach the end
+  float span = fmax(animation->getLength() - 1.0f, 0.0f);
+  tracks.sampleCount = (unsigned)ceilf(span / tracks.frameStep) + 1;
+
+  tracks.elementOffsets.resize(animation->getElementCount());
+  for (unsigned i = 0; i < animation->getElementCount(); i++) {
+    const Mortar::Resource::Animation::Element *element = animation->getElement(i);
+
+    tracks.elementOffsets[i] = tracks.sampleStride;
+    tracks.sampleStride += 3 + (element->getHasRotation() ? 4 : 0) + (element->getHasScale() ? 3 : 0);
+  }
+
+  tracks.samples.resize(tracks.sampleCount * tracks.sampleStride);
+
+  std::vector<float> values (animation->getElementCount() * POSE_CHANNEL_COUNT);
+  std::vector<Mortar::Math::Quaternion> previousRotations (animation->getElementCount());
+
+  // Tracks resample the curves and are interpolated between samples, so
+  // they're always taken from the interpolated curves; stepped sampling
+  // would fix them to whatever interpolation was set at load time
+  ClipSampler sampler (animation, true);
+
+  for (unsigned i = 0; i < tracks.sampleCount; i++) {
+    sampler.sample(1.0f + i * tracks.frameStep, values.data());
+
+    for (unsigned j = 0; j < animation->getElementCount(); j++) {
+      const Mortar::Resource::Animation::Element *element = animation->getElement(j);
+      const float *elementValues = &values[j * POSE_CHANNEL_COUNT];
+      float *sample = &tracks.samples[i * tracks.sampleStride + tracks.elementOffsets[j]];
+
+      sample[0] = elementValues[0];
+      sample[1] = elementValues[1];
+      sample[2] = elementValues[2];
+      sample += 3;
+
+      if (element->getHasRotation()) {
+        Mortar::Math::Matrix rotation = Mortar::Math::Matrix::rotationZYX(elementValues[4], elementValues[3], elementValues[5]);
+        rotation.transpose();
+
+        // Keep consecutive samples in the same hemisphere so that
+        // interpolation never has to pick a direction at runtime
+        Mortar::Math::Quaternion q = Mortar::Math::Quaternion::fromMatrix(rotation);
+        if (i > 0 && Mortar::Math::Quaternion::dot(q, previousRotations[j]) < 0.0f) {
+          q = Mortar::Math::Quaternion(-q.x, -q.y, -q.z, -q.w);
+        }
+        previousRotations[j] = q;
+
+        sample[0] = q.x;
+        sample[1] = q.y;
+        sample[2] = q.z;
+        sample[3] = q.w;
+        sample += 4;
+      }
+
+      if (element->getHasScale()) {
+        sample[0] = elementValues[6];
+        sample[1] = elementValues[7];
+        sample[2] = elementValues[8];
+      }
+    }
+  }
+
+  return tracks;
+}
+
+// Finds the pair of samples surrounding a position and how far between them
+// it lies
+const Mortar::Resource::Animation::BakedTracks *locateSamples(const Mortar::Resource::Animation *animation, float position, unsigned *first, unsigned *second, float *t) {
+  const Mortar::Resource::Animation::BakedTracks *tracks = animation->getBakedTracks();
+  if (!tracks) {
+    throw std::runtime_error("animation has no baked tracks");
+  }
+
+  float sampleIdx = (fmax(clampPosition(animation, position), 1.0f) - 1.0f) / tracks->frameStep;
+
+  *first = (unsigned)sampleIdx;
+  if (*first >= tracks->sampleCount - 1) {
+    *first = tracks->sampleCount - 1;
+  }
+  *second = *first + 1 < tracks->sampleCount ? *first + 1 : *first;
+  *t = fmin(sampleIdx - *first, 1.0f);
+
+  return tracks;
+}
+
+void interpolateElement(const Mortar::Resource::Animation::BakedTracks *tracks, const Mortar::Resource::Animation::Element *element, unsigned elementIdx, unsigned first, unsigned second, float t, bool skipScale, float *translation, Mortar::Math::Quaternion& rotation, float *scale) {
+  const float *a = &tracks->samples[first * tracks->sampleStride + tracks->elementOffsets[elementIdx]];
+  const float *b = &tracks->samples[second * tracks->sampleStride + tracks->elementOffsets[elementIdx]];
+
+  for (int j = 0; j < 3; j++) {
+    translation[j] = a[j] + (b[j] - a[j]) * t;
+  }
+  a += 3;
+  b += 3;
+
+  rotation = Mortar::Math::Quaternion();
+  if (element->getHasRotation()) {
+    Mortar::Math::Quaternion qa (a[0], a[1], a[2], a[3]);
+    Mortar::Math::Quaternion qb (b[0], b[1], b[2], b[3]);
+
+    rotation = Mortar::Math::Quaternion::nlerp(qa, qb, t);
+    a += 4;
+    b += 4;
+  }
+
+  if (element->getHasScale()) {
+    for (int j = 0; j < 3; j++) {
+      scale[j] = skipScale ? 1.0f : a[j] + (b[j] - a[j]) * t;
+    }
+  }
+}
+
+std::vector<Mortar::Math::Matrix> Mortar::Animation::runBakedAnimation(const Mortar::Resource::Animation *animation, const Mortar::Resource::Skeleton& skeleton, float position, unsigned reductions) {
+  unsigned first, second;
+  float t;
+  const Mortar::Resource::Animation::BakedTracks *tracks = locateSamples(animation, position, &first, &second, &t);
+
+  std::vector<Mortar::Math::Matrix> transforms;
+  transforms.reserve(skeleton.getJointCount());
+
+  for (unsigned i = 0; i < skeleton.getJointCount(); i++) {
+    if (i >= animation->getElementCount()) {
+      transforms.push_back(Math::Matrix());
+      continue;
+    }
+
+    const Mortar::Resource::Animation::Element *element = animation->getElement(i);
+
+    float translation[3];
+    float scale[3];
+    Mortar::Math::Quaternion rotation;
+    interpolateElement(tracks, element, i, first, second, t, reductions & SKIP_SCALE, translation, rotation, scale);
+
+    transforms.push_back(composeJointTransform(element, skeleton, i, rotation.toMatrix(), translation, scale));
+  }
+
+  return transforms;
+}
+
+void Mortar::Animation::buildBakedLocalTransforms(const Mortar::Resource::Animation *animation, const Mortar::Resource::Skeleton& skeleton, float position, std::vector<Mortar::Math::Transform>& locals, unsigned reductions) {
+  unsigned first, second;
+  float t;
+  const Mortar::Resource::Animation::BakedTracks *tracks = locateSamples(animation, position, &first, &second, &t);
+
+  locals.resize(skeleton.getJointCount());
+
+  for (unsigned i = 0; i < skeleton.getJointCount(); i++) {
+    if (i >= animation->getElementCount()) {
+      locals[i] = Mortar::Math::Transform();
+      continue;
+    }
+
+    const Mortar::Resource::Animation::Element *element = animation->getElement(i);
+
+    float translation[3];
+    float scale[3];
+    Mortar::Math::Quaternion rotation;
+    interpolateElement(tracks, element, i, first, second, t, reductions & SKIP_SCALE, translation, rotation, scale);
+
+    locals[i] = composeLocalTransform(element, skeleton, i, rotation, translation, scale);
+  }
+}
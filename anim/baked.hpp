@@ -0,0 +1,42 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MORTAR_ANIM_BAKED_H
+#define MORTAR_ANIM_BAKED_H
+
+#include <vector>
+
+#include "../math/matrix.hpp"
+#include "../math/transform.hpp"
+#include "../resource/types/anim.hpp"
+#include "../resource/types/skeleton.hpp"
+
+namespace Mortar::Animation {
+  // Samples an animation's interpolated curves at a fixed rate in samples
+  // per second
+  Mortar::Resource::Animation::BakedTracks bakeTracks(const Mortar::Resource::Animation *animation, float sampleRate);
+
+  // Builds joint transforms from an animation's baked tracks, interpolating
+  // linearly between samples and with nlerp for rotations. Of the
+  // PoseReduction flags, only SKIP_SCALE applies to baked tracks.
+  std::vector<Mortar::Math::Matrix> runBakedAnimation(const Mortar::Resource::Animation *animation, const Mortar::Resource::Skeleton& skeleton, float position, unsigned reductions = 0);
+
+  // As above, producing local transforms for skeletons which support them
+  void buildBakedLocalTransforms(const Mortar::Resource::Animation *animation, const Mortar::Resource::Skeleton& skeleton, float position, std::vector<Mortar::Math::Transform>& locals, unsigned reductions = 0);
+}
+
+#endif
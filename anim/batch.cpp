@@ -0,0 +1,196 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "../state.hpp"
+#include "anim.hpp"
+#include "batch.hpp"
+
+using namespace Mortar::Animation;
+
+ChannelBatch::ChannelBatch(const Mortar::Resource::Animation *animation)
+  : animation { animation } {
+  unsigned slotCount = animation->getIntervalCount() * 4;
+
+  this->channelCount = animation->getElementCount() * POSE_CHANNEL_COUNT;
+  this->paddedChannelCount = (this->channelCount + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+
+  this->slotBases.resize(slotCount * this->paddedChannelCount);
+  this->slotMasks.resize(slotCount * this->paddedChannelCount, 0);
+
+  auto addSegment = [this](float start, float cubic, float quadratic, float linear, float constant) {
+    this->segmentStarts.push_back(start);
+    this->cubics.push_back(cubic);
+    this->quadratics.push_back(quadratic);
+    this->linears.push_back(linear);
+    this->constants.push_back(constant);
+  };
+
+  // Segment 0 is shared by every unused channel and by the padding
+  addSegment(0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+
+  for (unsigned i = 0; i < animation->getElementCount(); i++) {
+    const Mortar::Resource::Animation::Element *element = animation->getElement(i);
+
+    for (unsigned j = 0; j < POSE_CHANNEL_COUNT; j++) {
+      unsigned channelIdx = i * POSE_CHANNEL_COUNT + j;
+
+      bool isUsed = j < 3
+        || (j < 6 && element->getHasRotation())
+        || (j >= 6 && element->getHasScale());
+
+      if (!isUsed) {
+        continue;
+      }
+
+      const Mortar::Resource::Animation::Channel *channel = element->getChannel(j);
+
+      switch (channel->getKeyframeType()) {
+        case Mortar::Resource::Animation::KeyframeType::NONE: {
+          uint32_t segment = this->constants.size();
+          addSegment(0.0f, 0.0f, 0.0f, 0.0f, channel->getFloatData());
+
+          for (unsigned slot = 0; slot < slotCount; slot++) {
+            this->slotBases[slot * this->paddedChannelCount + channelIdx] = segment;
+          }
+
+          break;
+        }
+        case Mortar::Resource::Animation::KeyframeType::FLOAT: {
+          uint32_t firstSegment = this->constants.size();
+          for (size_t k = 0; k < channel->getSegmentCount(); k++) {
+            float start[4];
+            float end[4];
+            channel->getRecord(k, start);
+            channel->getRecord(k + 1, end);
+
+            float coefficients[5];
+            Mortar::Resource::Animation::Channel::calculateCubicCoefficients(start, end, coefficients);
+
+            addSegment(coefficients[0], coefficients[1], coefficients[2], coefficients[3], coefficients[4]);
+          }
+
+          for (unsigned slot = 0; slot < slotCount; slot++) {
+            uint32_t mask = channel->getKeyframeMask(slot / 4);
+
+            // Segment indices wrap at 16 bits, so a slot before the channel's
+            // first keyframe has a base of 0xffff; it must wrap to one before
+            // the channel's first segment instead
+            uint16_t base = channel->getSegmentIndex(slot, 0);
+
+            this->slotBases[slot * this->paddedChannelCount + channelIdx] = firstSegment + (uint16_t)(base + 1) - 1;
+            this->slotMasks[slot * this->paddedChannelCount + channelIdx] = (uint8_t)(mask >> (slot % 4 * 8));
+          }
+
+          break;
+        }
+        default:
+          throw std::runtime_error("unsupported keyframe type in batched animation");
+      }
+    }
+  }
+}
+
+const Mortar::Resource::Animation *ChannelBatch::getAnimation() const {
+  return this->animation;
+}
+
+unsigned ChannelBatch::getChannelCount() const {
+  return this->channelCount;
+}
+
+void ChannelBatch::evaluate(const float *positions, unsigned positionCount, float *values) const {
+  bool interpolate = Mortar::State::interpolate != Mortar::State::InterpolateType::NONE;
+
+  for (unsigned i = 0; i < positionCount; i++) {
+    struct KeyframeLookupKey key = createKeyframeLookup(this->animation->getIntervalCount(), clampPosition(this->animation, positions[i]));
+
+    const uint32_t *bases = &this->slotBases[key.slot * this->paddedChannelCount];
+    const uint8_t *masks = &this->slotMasks[key.slot * this->paddedChannelCount];
+    float *positionValues = values + i * this->channelCount;
+
+    for (unsigned j = 0; j < this->channelCount; j += BLOCK_SIZE) {
+      uint32_t segments[BLOCK_SIZE];
+
+      for (unsigned k = 0; k < BLOCK_SIZE; k++) {
+        segments[k] = bases[j + k] + std::popcount((uint8_t)(masks[j + k] & key.intervalMask));
+      }
+
+      if (j + BLOCK_SIZE <= this->channelCount) {
+        this->evaluateBlock(segments, key.position, interpolate, positionValues + j);
+      } else {
+        float blockValues[BLOCK_SIZE];
+        this->evaluateBlock(segments, key.position, interpolate, blockValues);
+
+        memcpy(positionValues + j, blockValues, (this->channelCount - j) * sizeof(float));
+      }
+    }
+  }
+}
+
+void ChannelBatch::evaluateBlock(const uint32_t *segments, float position, bool interpolate, float *values) const {
+#if defined(__AVX512F__)
+  __m512i indices = _mm512_loadu_si512(segments);
+  __m512 constant = _mm512_i32gather_ps(indices, this->constants.data(), 4);
+
+  if (interpolate) {
+    __m512 dt = _mm512_sub_ps(_mm512_set1_ps(position), _mm512_i32gather_ps(indices, this->segmentStarts.data(), 4));
+
+    __m512 value = _mm512_i32gather_ps(indices, this->cubics.data(), 4);
+    value = _mm512_fmadd_ps(value, dt, _mm512_i32gather_ps(indices, this->quadratics.data(), 4));
+    value = _mm512_fmadd_ps(value, dt, _mm512_i32gather_ps(indices, this->linears.data(), 4));
+    constant = _mm512_fmadd_ps(value, dt, constant);
+  }
+
+  _mm512_storeu_ps(values, constant);
+#elif defined(__AVX2__)
+  for (unsigned i = 0; i < BLOCK_SIZE; i += 8) {
+    __m256i indices = _mm256_loadu_si256((const __m256i *)(segments + i));
+    __m256 constant = _mm256_i32gather_ps(this->constants.data(), indices, 4);
+
+    if (interpolate) {
+      __m256 dt = _mm256_sub_ps(_mm256_set1_ps(position), _mm256_i32gather_ps(this->segmentStarts.data(), indices, 4));
+
+      __m256 value = _mm256_i32gather_ps(this->cubics.data(), indices, 4);
+      value = _mm256_add_ps(_mm256_mul_ps(value, dt), _mm256_i32gather_ps(this->quadratics.data(), indices, 4));
+      value = _mm256_add_ps(_mm256_mul_ps(value, dt), _mm256_i32gather_ps(this->linears.data(), indices, 4));
+      constant = _mm256_add_ps(_mm256_mul_ps(value, dt), constant);
+    }
+
+    _mm256_storeu_ps(values + i, constant);
+  }
+#else
+  for (unsigned i = 0; i < BLOCK_SIZE; i++) {
+    uint32_t segment = segments[i];
+
+    if (interpolate) {
+      float dt = position - this->segmentStarts[segment];
+      values[i] = ((this->cubics[segment] * dt + this->quadratics[segment]) * dt + this->linears[segment]) * dt + this->constants[segment];
+    } else {
+      values[i] = this->constants[segment];
+    }
+  }
+#endif
+}
@@ -0,0 +1,69 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MORTAR_ANIM_BATCH_H
+#define MORTAR_ANIM_BATCH_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "../resource/types/anim.hpp"
+
+namespace Mortar::Animation {
+  // Evaluates every pose channel of a clip at once. Keyframe lookup tables and
+  // cubic segment coefficients for all channels are laid out structure-of-
+  // arrays, so that a whole block of channels can be evaluated with a single
+  // gather and Horner step per coefficient. Constant and unused channels are
+  // folded in as single flat segments, so no channel needs special handling.
+  class ChannelBatch {
+    public:
+      ChannelBatch(const Mortar::Resource::Animation *animation);
+
+      const Mortar::Resource::Animation *getAnimation() const;
+
+      // Equal to the animation's element count times POSE_CHANNEL_COUNT
+      unsigned getChannelCount() const;
+
+      // Evaluates all channels at each position, writing getChannelCount()
+      // values per position in the same layout as sampleChannels()
+      void evaluate(const float *positions, unsigned positionCount, float *values) const;
+
+    private:
+      // Channels are processed in blocks as wide as the widest available
+      // vector unit; the tables are padded to a whole number of blocks
+      static const unsigned BLOCK_SIZE = 16;
+
+      void evaluateBlock(const uint32_t *segments, float position, bool interpolate, float *values) const;
+
+      const Mortar::Resource::Animation *animation;
+      unsigned channelCount;
+      unsigned paddedChannelCount;
+
+      // Indexed by subinterval slot * paddedChannelCount + channel
+      std::vector<uint32_t> slotBases;
+      std::vector<uint8_t> slotMasks;
+
+      // Indexed by segment across all channels
+      std::vector<float> segmentStarts;
+      std::vector<float> cubics;
+      std::vector<float> quadratics;
+      std::vector<float> linears;
+      std::vector<float> constants;
+  };
+}
+
+#endif
@@ -0,0 +1,324 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <bit>
+#include <math.h>
+
+#include "anim.hpp"
+#include "compress.hpp"
+
+using namespace Mortar::Animation;
+
+// Curves are checked against the original at this spacing, in frames
+static const float ERROR_SAMPLE_STEP = 0.25f;
+
+// Keyframe records decoded from a FLOAT channel, along with the frame each
+// keyframe's mask bit marks
+struct ChannelCurve {
+  std::vector<float> records;
+  std::vector<unsigned> keyFrames;
+};
+
+inline float evaluateSegment(const float *start, const float *end, float position) {
+  float coefficients[5];
+  Mortar::Resource::Animation::Channel::calculateCubicCoefficients(start, end, coefficients);
+
+  float dt = position - coefficients[0];
+
+  return ((coefficients[1] * dt + coefficients[2]) * dt + coefficients[3]) * dt + coefficients[4];
+}
+
+// Finds the segment sampled at a position the same way keyframe lookup does,
+// returning -1 for positions before the first keyframe
+int findSegment(const struct ChannelCurve& curve, float position) {
+  unsigned frame = (unsigned)(fmax(position, 1.0f) - 1.0f);
+
+  return (int)(std::upper_bound(curve.keyFrames.begin(), curve.keyFrames.end(), frame) - curve.keyFrames.begin()) - 1;
+}
+
+float evaluateCurve(const struct ChannelCurve& curve, float position, bool *isValid) {
+  int segment = findSegment(curve, position);
+
+  *isValid = segment >= 0;
+  if (!*isValid) {
+    return 0.0f;
+  }
+
+  return evaluateSegment(&curve.records[segment * 4], &curve.records[(segment + 1) * 4], position);
+}
+
+// Decodes a channel's curve, returning false if its keyframe index isn't laid
+// out as a running count of mask bits and so can't safely be rebuilt
+bool decodeCurve(const Mortar::Resource::Animation *animation, const Mortar::Resource::Animation::Channel *channel, struct ChannelCurve& curve) {
+  size_t keyCount = 0;
+
+  for (unsigned interval = 0; interval < animation->getIntervalCount(); interval++) {
+    if (channel->getIntervalOffset(interval) != keyCount) {
+      return false;
+    }
+
+    uint32_t mask = channel->getKeyframeMask(interval);
+    for (unsigned frame = 0; frame < 32; frame++) {
+      if (mask & (1u << frame)) {
+        curve.keyFrames.push_back(interval * 32 + frame);
+        keyCount++;
+      }
+    }
+  }
+
+  if (keyCount != channel->getSegmentCount()) {
+    return false;
+  }
+
+  curve.records.resize((keyCount + 1) * 4);
+  for (size_t i = 0; i <= keyCount; i++) {
+    channel->getRecord(i, &curve.records[i * 4]);
+  }
+
+  return true;
+}
+
+// Removes keys one at a time, checking each merged segment against the
+// original curve; returns which keys remain
+std::vector<bool> reduceKeys(const Mortar::Resource::Animation *animation, const struct ChannelCurve& original, struct ChannelCurve& curve, float tolerance) {
+  size_t keyCount = original.keyFrames.size();
+  std::vector<bool> isKept (keyCount, true);
+
+  size_t previous = 0;
+  for (size_t i = 1; i < keyCount; i++) {
+    // The segment from the previous kept key would end at the next key, or at
+    // the terminating record for the last one
+    size_t next = i + 1;
+    float spanEnd = next < keyCount ? original.keyFrames[next] + 1.0f : animation->getLength();
+
+    float start[4];
+    std::copy_n(&original.records[previous * 4], 4, start);
+    start[1] = 1.0f / (original.records[next * 4] - start[0]);
+
+    bool isWithinTolerance = true;
+    for (float position = original.keyFrames[previous] + 1.0f; position < spanEnd; position += ERROR_SAMPLE_STEP) {
+      bool isValid;
+      float expected = evaluateCurve(original, position, &isValid);
+
+      if (isValid && fabs(evaluateSegment(start, &original.records[next * 4], position) - expected) > tolerance) {
+        isWithinTolerance = false;
+        break;
+      }
+    }
+
+    if (isWithinTolerance) {
+      isKept[i] = false;
+    } else {
+      previous = i;
+    }
+  }
+
+  // Rebuild the records from the survivors, fixing the inverse durations of
+  // any segments which now span removed keys
+  curve.records.clear();
+  curve.keyFrames.clear();
+
+  for (size_t i = 0; i <= keyCount; i++) {
+    if (i == keyCount || isKept[i]) {
+      curve.records.insert(curve.records.end(), &original.records[i * 4], &original.records[i * 4 + 4]);
+
+      if (i < keyCount) {
+        curve.keyFrames.push_back(original.keyFrames[i]);
+      }
+    }
+  }
+
+  for (size_t i = 0; i < curve.keyFrames.size(); i++) {
+    float *record = &curve.records[i * 4];
+    record[1] = 1.0f / (record[4] - record[0]);
+  }
+
+  return isKept;
+}
+
+void rebuildKeyframeIndex(const Mortar::Resource::Animation *animation, Mortar::Resource::Animation::Channel *channel, const struct ChannelCurve& curve) {
+  std::vector<uint32_t> masks (animation->getIntervalCount(), 0);
+  for (auto frame : curve.keyFrames) {
+    masks[frame / 32] |= 1u << (frame % 32);
+  }
+
+  // Keys are only ever removed, so the running count fits as it did before
+  std::vector<uint16_t> intervalOffsets (animation->getIntervalCount());
+
+  size_t keyCount = 0;
+  for (unsigned interval = 0; interval < animation->getIntervalCount(); interval++) {
+    intervalOffsets[interval] = keyCount;
+    keyCount += std::popcount(masks[interval]);
+  }
+
+  channel->setKeyframeIndex(masks.data(), intervalOffsets.data());
+}
+
+Mortar::Resource::Animation::Channel::QuantizedKeys quantizeCurve(const struct ChannelCurve& curve) {
+  Mortar::Resource::Animation::Channel::QuantizedKeys keys;
+  size_t recordCount = curve.records.size() / 4;
+
+  float valueMax = -INFINITY;
+  float rateMax = -INFINITY;
+  keys.valueMin = INFINITY;
+  keys.rateMin = INFINITY;
+
+  for (size_t i = 0; i < recordCount; i++) {
+    keys.valueMin = fmin(keys.valueMin, curve.records[i * 4 + 2]);
+    valueMax = fmax(valueMax, curve.records[i * 4 + 2]);
+    keys.rateMin = fmin(keys.rateMin, curve.records[i * 4 + 3]);
+    rateMax = fmax(rateMax, curve.records[i * 4 + 3]);
+  }
+
+  keys.valueStep = (valueMax - keys.valueMin) / UINT16_MAX;
+  keys.rateStep = (rateMax - keys.rateMin) / UINT16_MAX;
+
+  auto quantize = [](float value, float min, float step) -> uint16_t {
+    return step > 0.0f ? (uint16_t)lroundf((value - min) / step) : 0;
+  };
+
+  for (size_t i = 0; i < recordCount; i++) {
+    keys.times.push_back(curve.records[i * 4]);
+    keys.values.push_back(quantize(curve.records[i * 4 + 2], keys.valueMin, keys.valueStep));
+    keys.rates.push_back(quantize(curve.records[i * 4 + 3], keys.rateMin, keys.rateStep));
+  }
+
+  return keys;
+}
+
+// Poses the skeleton at every sample position, storing each joint's model
+// space position
+std::vector<float> calculateJointPositions(const Mortar::Resource::Animation *animation, const Mortar::Resource::Skeleton& skeleton) {
+  std::vector<float> positions;
+  std::vector<Mortar::Math::Matrix> modelTransforms (skeleton.getJointCount());
+  const std::vector<int>& parentIndices = skeleton.getParentIndices();
+
+  for (float position = 1.0f; position < animation->getLength(); position += ERROR_SAMPLE_STEP) {
+    std::vector<Mortar::Math::Matrix> pose = runSkeletalAnimation(animation, skeleton, position);
+
+    for (unsigned i = 0; i < skeleton.getJointCount(); i++) {
+      int parentIdx = parentIndices[i];
+      modelTransforms[i] = parentIdx != -1 ? pose[i] * modelTransforms[parentIdx] : pose[i];
+
+      positions.push_back(modelTransforms[i]._41);
+      positions.push_back(modelTransforms[i]._42);
+      positions.push_back(modelTransforms[i]._43);
+    }
+  }
+
+  return positions;
+}
+
+float CompressionReport::getRatio() const {
+  return this->compressedSize ? (float)this->originalSize / this->compressedSize : 0.0f;
+}
+
+CompressionReport Mortar::Animation::compressAnimation(Mortar::Resource::Animation *animation, const Mortar::Resource::Skeleton& skeleton, const CompressionSettings& settings) {
+  CompressionReport report {};
+  report.originalSize = animation->getMemoryUsage();
+
+  std::vector<float> originalPositions = calculateJointPositions(animation, skeleton);
+
+  for (unsigned i = 0; i < animation->getElementCount(); i++) {
+    Mortar::Resource::Animation::Element *element = animation->getElement(i);
+
+    for (unsigned j = 0; j < POSE_CHANNEL_COUNT && j < element->getChannelCount(); j++) {
+      Mortar::Resource::Animation::Channel *channel = element->getChannel(j);
+
+      if (channel->getKeyframeType() != Mortar::Resource::Animation::KeyframeType::FLOAT || channel->getIsQuantized()) {
+        continue;
+      }
+
+      float tolerance = j < 3 ? settings.translationTolerance : j < 6 ? settings.rotationTolerance : settings.scaleTolerance;
+
+      struct ChannelCurve original;
+      bool canRebuildIndex = decodeCurve(animation, channel, original);
+
+      report.originalKeyCount += channel->getSegmentCount();
+
+      if (canRebuildIndex && settings.stripConstantChannels) {
+        float min = INFINITY;
+        float max = -INFINITY;
+
+        for (float position = 1.0f; position < animation->getLength(); position += ERROR_SAMPLE_STEP) {
+          bool isValid;
+          float value = evaluateCurve(original, position, &isValid);
+
+          if (isValid) {
+            min = fmin(min, value);
+            max = fmax(max, value);
+          }
+        }
+
+        if (min <= max && (max - min) * 0.5f <= tolerance) {
+          channel->clearKeyframeIndex();
+          channel->setKeyframeType(Mortar::Resource::Animation::KeyframeType::NONE);
+          channel->setData((min + max) * 0.5f);
+
+          report.strippedChannels++;
+          continue;
+        }
+      }
+
+      struct ChannelCurve curve = original;
+
+      if (canRebuildIndex && settings.reduceKeys) {
+        reduceKeys(animation, original, curve, tolerance);
+
+        if (curve.keyFrames.size() != original.keyFrames.size()) {
+          rebuildKeyframeIndex(animation, channel, curve);
+        }
+      } else if (!canRebuildIndex) {
+        curve.records.resize((channel->getSegmentCount() + 1) * 4);
+        for (size_t k = 0; k <= channel->getSegmentCount(); k++) {
+          channel->getRecord(k, &curve.records[k * 4]);
+        }
+      }
+
+      report.keyCount += curve.records.size() / 4 - 1;
+
+      bool hadCubics = channel->getCubicCoefficients() != nullptr;
+
+      if (settings.quantizeKeys) {
+        channel->setQuantizedKeys(quantizeCurve(curve));
+      } else if (curve.records.size() != original.records.size()) {
+        channel->setRecords(curve.records.data(), curve.records.size() / 4);
+
+        if (hadCubics) {
+          channel->buildCubicCoefficients();
+        }
+      }
+    }
+  }
+
+  // Replaced records are left in the animation's tables until it's compacted
+  animation->compact();
+
+  report.compressedSize = animation->getMemoryUsage();
+
+  std::vector<float> compressedPositions = calculateJointPositions(animation, skeleton);
+  for (size_t i = 0; i < originalPositions.size(); i += 3) {
+    float dx = compressedPositions[i] - originalPositions[i];
+    float dy = compressedPositions[i + 1] - originalPositions[i + 1];
+    float dz = compressedPositions[i + 2] - originalPositions[i + 2];
+
+    report.maxJointError = fmax(report.maxJointError, sqrtf(dx * dx + dy * dy + dz * dz));
+  }
+
+  return report;
+}
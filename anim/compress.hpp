@@ -0,0 +1,76 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MORTAR_ANIM_COMPRESS_H
+#define MORTAR_ANIM_COMPRESS_H
+
+#include <stddef.h>
+#include <vector>
+
+#include "../resource/types/anim.hpp"
+#include "../resource/types/skeleton.hpp"
+
+namespace Mortar::Animation {
+  class CompressionSettings {
+    public:
+      CompressionSettings()
+        : translationTolerance { 0.001f },
+          rotationTolerance { 0.001f },
+          scaleTolerance { 0.001f },
+          stripConstantChannels { true },
+          reduceKeys { true },
+          quantizeKeys { true } {};
+
+      // Largest deviation from the original curve, in the channel's own
+      // units, allowed when stripping a channel or removing keys
+      float translationTolerance;
+      float rotationTolerance;
+      float scaleTolerance;
+
+      // Replaces channels which stay within tolerance of a single value with
+      // that value
+      bool stripConstantChannels;
+
+      // Greedily removes keys whose absence keeps the curve within tolerance
+      bool reduceKeys;
+
+      // Stores key values and rates as 16-bit steps across their range
+      bool quantizeKeys;
+  };
+
+  class CompressionReport {
+    public:
+      float getRatio() const;
+
+      size_t originalSize;
+      size_t compressedSize;
+
+      unsigned strippedChannels;
+      unsigned originalKeyCount;
+      unsigned keyCount;
+
+      // Largest distance between a joint's model space position before and
+      // after compression, across the whole animation
+      float maxJointError;
+  };
+
+  // Compresses an animation's pose channels in place, measuring the effect
+  // on the given skeleton
+  CompressionReport compressAnimation(Mortar::Resource::Animation *animation, const Mortar::Resource::Skeleton& skeleton, const CompressionSettings& settings = CompressionSettings());
+}
+
+#endif
@@ -0,0 +1,181 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+
+#include "../math/trig.hpp"
+#include "anim.hpp"
+#include "pose.hpp"
+
+using namespace Mortar::Animation;
+
+Mortar::Math::Transform Mortar::Animation::composeLocalTransform(const Mortar::Resource::Animation::Element *element, const Mortar::Resource::Skeleton& skeleton, unsigned jointIdx, const Mortar::Math::Quaternion& rotation, const float *translation, const float *scale) {
+  Mortar::Math::Transform local;
+  local.rotation = rotation;
+
+  float jointScale = 1.0f;
+
+  if (element->getIsRelativeToJoint()) {
+    const Mortar::Math::Transform& jointTransform = skeleton.getDecomposedTransforms()[jointIdx];
+
+    local.rotation = local.rotation * jointTransform.rotation;
+    local.translation = jointTransform.translation;
+    jointScale = jointTransform.scale.x;
+  }
+
+  if (element->getHasScale()) {
+    local.scale = Mortar::Math::Vector(scale[0] * jointScale, scale[1] * jointScale, scale[2] * jointScale, 0.0f);
+  } else {
+    local.scale = Mortar::Math::Vector(jointScale, jointScale, jointScale, 0.0f);
+  }
+
+  local.translation.x += translation[0];
+  local.translation.y += translation[1];
+  local.translation.z += translation[2];
+
+  if (skeleton.hasJointFlag(jointIdx, Mortar::Resource::Skeleton::IS_RELATIVE_TO_ATTACHMENT)) {
+    // Pivot about the attachment point rather than the joint's origin
+    const Mortar::Math::Vector& attachmentPoint = skeleton.getAttachmentPoints()[jointIdx];
+
+    Mortar::Math::Vector scaledAttachment (attachmentPoint.x * local.scale.x, attachmentPoint.y * local.scale.y, attachmentPoint.z * local.scale.z, 0.0f);
+    Mortar::Math::Vector offset = local.rotation.rotate(scaledAttachment) - attachmentPoint;
+
+    local.translation.x += offset.x;
+    local.translation.y += offset.y;
+    local.translation.z += offset.z;
+  }
+
+  return local;
+}
+
+void Mortar::Animation::buildLocalTransforms(const Mortar::Resource::Animation *animation, const Mortar::Resource::Skeleton& skeleton, const float *values, std::vector<Mortar::Math::Transform>& locals, unsigned reductions) {
+  static const float unitScale[3] = { 1.0f, 1.0f, 1.0f };
+
+  unsigned jointCount = skeleton.getJointCount();
+  unsigned elementCount = std::min(jointCount, animation->getElementCount());
+
+  std::vector<bool> isFrozen;
+  if (reductions & FREEZE_LEAVES) {
+    isFrozen = skeleton.getLeafJoints();
+  } else {
+    isFrozen.resize(jointCount);
+  }
+
+  // Gather the half angles of every rotation, in x, y, z order per element
+  std::vector<float> halfAngles;
+  halfAngles.reserve(elementCount * 3);
+
+  for (unsigned i = 0; i < elementCount; i++) {
+    if (isFrozen[i] || !animation->getElement(i)->getHasRotation()) {
+      continue;
+    }
+
+    const float *elementValues = values + i * POSE_CHANNEL_COUNT;
+
+    // Channels hold yaw, pitch and roll, which rotate about x, y and z
+    halfAngles.push_back(elementValues[3] * 0.5f);
+    halfAngles.push_back(elementValues[4] * 0.5f);
+    halfAngles.push_back(elementValues[5] * 0.5f);
+  }
+
+  std::vector<float> sines (halfAngles.size());
+  std::vector<float> cosines (halfAngles.size());
+  Mortar::Math::sinCos(halfAngles.data(), sines.data(), cosines.data(), halfAngles.size());
+
+  locals.resize(jointCount);
+
+  unsigned rotationIdx = 0;
+  for (unsigned i = 0; i < jointCount; i++) {
+    if (i >= elementCount || isFrozen[i]) {
+      locals[i] = Mortar::Math::Transform();
+      continue;
+    }
+
+    const Mortar::Resource::Animation::Element *element = animation->getElement(i);
+    const float *elementValues = values + i * POSE_CHANNEL_COUNT;
+
+    // Equivalent to the transpose of Matrix::rotationZYX(pitch, yaw, roll)
+    Mortar::Math::Quaternion rotation;
+    if (element->getHasRotation()) {
+      const float *s = &sines[rotationIdx * 3];
+      const float *c = &cosines[rotationIdx * 3];
+      rotationIdx++;
+
+      rotation.x = c[2] * c[1] * s[0] - s[2] * s[1] * c[0];
+      rotation.y = c[2] * s[1] * c[0] + s[2] * c[1] * s[0];
+      rotation.z = s[2] * c[1] * c[0] - c[2] * s[1] * s[0];
+      rotation.w = c[2] * c[1] * c[0] + s[2] * s[1] * s[0];
+    }
+
+    const float *scale = reductions & SKIP_SCALE ? unitScale : elementValues + 6;
+    locals[i] = composeLocalTransform(element, skeleton, i, rotation, elementValues, scale);
+  }
+}
+
+void Mortar::Animation::calculateModelTransforms(const Mortar::Resource::Skeleton& skeleton, const std::vector<Mortar::Math::Transform>& locals, std::vector<Mortar::Math::AffineTransform>& models) {
+  unsigned jointCount = skeleton.getJointCount();
+
+  std::vector<Mortar::Math::AffineTransform> affineLocals (jointCount);
+  for (unsigned i = 0; i < jointCount; i++) {
+    affineLocals[i] = locals[i].toAffine();
+  }
+
+  models.resize(jointCount);
+  Mortar::Math::composeHierarchy(affineLocals.data(), skeleton.getParentIndices().data(), jointCount, 1, models.data());
+}
+
+void Mortar::Animation::calculateModelTransforms(const Mortar::Resource::Skeleton& skeleton, const std::vector<Mortar::Math::Matrix>& locals, std::vector<Mortar::Math::AffineTransform>& models) {
+  unsigned jointCount = skeleton.getJointCount();
+
+  std::vector<Mortar::Math::AffineTransform> affineLocals (jointCount);
+  for (unsigned i = 0; i < jointCount; i++) {
+    affineLocals[i] = Mortar::Math::AffineTransform::fromMatrix(locals.at(i));
+  }
+
+  models.resize(jointCount);
+  Mortar::Math::composeHierarchy(affineLocals.data(), skeleton.getParentIndices().data(), jointCount, 1, models.data());
+}
+
+void Mortar::Animation::freezeLeafJoints(const Mortar::Resource::Skeleton& skeleton, std::vector<Mortar::Math::AffineTransform>& models) {
+  const std::vector<bool>& isLeaf = skeleton.getLeafJoints();
+  const std::vector<int>& parentIndices = skeleton.getParentIndices();
+  const std::vector<Mortar::Math::Matrix>& restPose = skeleton.getRestPose();
+
+  // Nothing depends on a leaf, so each can be replaced in place
+  for (unsigned i = 0; i < skeleton.getJointCount(); i++) {
+    if (!isLeaf[i]) {
+      continue;
+    }
+
+    int parentIdx = parentIndices[i];
+    Mortar::Math::AffineTransform rest = Mortar::Math::AffineTransform::fromMatrix(restPose.at(i));
+
+    models[i] = parentIdx == -1 ? rest : rest * models[parentIdx];
+  }
+}
+
+void Mortar::Animation::blendModelTransforms(const std::vector<Mortar::Math::AffineTransform>& from, const std::vector<Mortar::Math::AffineTransform>& to, float t, std::vector<Mortar::Math::AffineTransform>& models) {
+  models.resize(from.size());
+
+  for (unsigned i = 0; i < from.size(); i++) {
+    for (unsigned j = 0; j < 3; j++) {
+      for (unsigned k = 0; k < 4; k++) {
+        models[i].rows[j][k] = from[i].rows[j][k] + (to[i].rows[j][k] - from[i].rows[j][k]) * t;
+      }
+    }
+  }
+}
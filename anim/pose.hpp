@@ -0,0 +1,67 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MORTAR_ANIM_POSE_H
+#define MORTAR_ANIM_POSE_H
+
+#include <vector>
+
+#include "../math/affine.hpp"
+#include "../math/matrix.hpp"
+#include "../math/quaternion.hpp"
+#include "../math/transform.hpp"
+#include "../resource/types/anim.hpp"
+#include "../resource/types/skeleton.hpp"
+
+namespace Mortar::Animation {
+  // Detail that may be dropped when posing distant actors
+  enum PoseReduction {
+    // Animated scale is ignored
+    SKIP_SCALE = 1 << 0,
+
+    // Joints without children are left unanimated; see freezeLeafJoints()
+    FREEZE_LEAVES = 1 << 1,
+  };
+
+  // Local transforms can only be built for skeletons whose joint transforms
+  // all decompose; see Skeleton::getIsDecomposable(). Others must be posed
+  // with matrices instead.
+
+  // The equivalent of composeJointTransform() for an element's animated
+  // rotation, translation and scale
+  Mortar::Math::Transform composeLocalTransform(const Mortar::Resource::Animation::Element *element, const Mortar::Resource::Skeleton& skeleton, unsigned jointIdx, const Mortar::Math::Quaternion& rotation, const float *translation, const float *scale);
+
+  // Builds local joint transforms from sampled channel values, converting
+  // every Euler rotation to a quaternion in a single batch. Reductions are a
+  // combination of PoseReduction flags.
+  void buildLocalTransforms(const Mortar::Resource::Animation *animation, const Mortar::Resource::Skeleton& skeleton, const float *values, std::vector<Mortar::Math::Transform>& locals, unsigned reductions = 0);
+
+  // Composes local transforms down the hierarchy into model space with
+  // Math::composeHierarchy(), after converting each to an affine transform
+  void calculateModelTransforms(const Mortar::Resource::Skeleton& skeleton, const std::vector<Mortar::Math::Transform>& locals, std::vector<Mortar::Math::AffineTransform>& models);
+  void calculateModelTransforms(const Mortar::Resource::Skeleton& skeleton, const std::vector<Mortar::Math::Matrix>& locals, std::vector<Mortar::Math::AffineTransform>& models);
+
+  // Poses leaf joints in their rest pose relative to their parents, for
+  // poses built with FREEZE_LEAVES
+  void freezeLeafJoints(const Mortar::Resource::Skeleton& skeleton, std::vector<Mortar::Math::AffineTransform>& models);
+
+  // Interpolates two poses joint by joint. Transforms are blended linearly,
+  // so this is only suitable for poses close together in time.
+  void blendModelTransforms(const std::vector<Mortar::Math::AffineTransform>& from, const std::vector<Mortar::Math::AffineTransform>& to, float t, std::vector<Mortar::Math::AffineTransform>& models);
+}
+
+#endif
@@ -0,0 +1,120 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <bit>
+#include <functional>
+#include <math.h>
+#include <stdint.h>
+
+#include "posecache.hpp"
+
+using namespace Mortar::Animation;
+
+float PoseCache::Stats::getHitRate() const {
+  return this->lookups ? (float)this->hits / this->lookups : 0.0f;
+}
+
+bool PoseCache::Key::operator==(const Key& other) const {
+  return this->animation == other.animation && this->skeleton == other.skeleton && this->position == other.position && this->variant == other.variant;
+}
+
+size_t PoseCache::KeyHash::operator()(const Key& key) const {
+  size_t hash = std::hash<const void *>()(key.animation);
+  hash = hash * 31 + std::hash<const void *>()(key.skeleton);
+  hash = hash * 31 + std::bit_cast<uint32_t>(key.position);
+  hash = hash * 31 + key.variant;
+
+  return hash;
+}
+
+float PoseCache::getQuantum() const {
+  return this->quantum;
+}
+
+void PoseCache::setQuantum(float quantum) {
+  this->quantum = quantum;
+  this->clear();
+}
+
+float PoseCache::quantize(float position) const {
+  if (this->quantum <= 0.0f) {
+    return position;
+  }
+
+  return roundf(position / this->quantum) * this->quantum;
+}
+
+void PoseCache::beginFrame() {
+  for (auto it = this->poseIndex.begin(); it != this->poseIndex.end();) {
+    if (it->second->lastUsedFrame != this->frame) {
+      this->freeEntries.push_back(it->second);
+      it = this->poseIndex.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  this->frame++;
+
+  this->stats.lookups = 0;
+  this->stats.hits = 0;
+  this->stats.retained = this->poseIndex.size();
+}
+
+std::vector<Mortar::Math::AffineTransform> *PoseCache::acquire(const Key& key, bool& isCached) {
+  this->stats.lookups++;
+
+  auto it = this->poseIndex.find(key);
+  if (it != this->poseIndex.end()) {
+    this->stats.hits++;
+    isCached = true;
+
+    it->second->lastUsedFrame = this->frame;
+    return &it->second->pose;
+  }
+
+  Entry *entry;
+  if (this->freeEntries.empty()) {
+    entry = &this->entries.emplace_back();
+  } else {
+    entry = this->freeEntries.back();
+    this->freeEntries.pop_back();
+  }
+
+  entry->pose.clear();
+  entry->lastUsedFrame = this->frame;
+
+  this->poseIndex.emplace(key, entry);
+  isCached = false;
+
+  return &entry->pose;
+}
+
+unsigned PoseCache::getPoseCount() const {
+  return this->poseIndex.size();
+}
+
+void PoseCache::clear() {
+  for (auto& entry : this->poseIndex) {
+    this->freeEntries.push_back(entry.second);
+  }
+
+  this->poseIndex.clear();
+}
+
+const PoseCache::Stats& PoseCache::getStats() const {
+  return this->stats;
+}
@@ -0,0 +1,119 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MORTAR_ANIM_POSECACHE_H
+#define MORTAR_ANIM_POSECACHE_H
+
+#include <deque>
+#include <stddef.h>
+#include <vector>
+
+#include <tsl/sparse_map.h>
+
+#include "../math/affine.hpp"
+#include "../resource/types/anim.hpp"
+#include "../resource/types/skeleton.hpp"
+
+namespace Mortar::Animation {
+  // Shares model space poses between actors playing the same clip on the same
+  // skeleton, whether or not they're the same character. Positions of clips
+  // played by more than one actor are snapped to a fixed quantum before
+  // lookup, so actors that are close enough in time are posed once and
+  // differ only in their world transforms. Poses are kept for as long as
+  // they're used every frame, so that those sampled at a reduced rate are
+  // only computed once.
+  class PoseCache {
+    public:
+      class Stats {
+        public:
+          unsigned lookups;
+          unsigned hits;
+
+          // Poses kept from a previous frame
+          unsigned retained;
+
+          float getHitRate() const;
+      };
+
+      class Key {
+        public:
+          // Null for the rest pose
+          const Mortar::Resource::Animation *animation;
+          const Mortar::Resource::Skeleton *skeleton;
+
+          // Quantized animation position
+          float position;
+
+          // Distinguishes poses built differently at the same position, such
+          // as at reduced detail
+          unsigned variant;
+
+          bool operator==(const Key& other) const;
+      };
+
+      struct KeyHash {
+        size_t operator()(const Key& key) const;
+      };
+
+      PoseCache()
+        : quantum { 0.5f },
+          frame { 0 },
+          stats {} {};
+
+      // Snapping interval in frames, or zero to share only poses at exactly
+      // the same position
+      float getQuantum() const;
+      void setQuantum(float quantum);
+
+      float quantize(float position) const;
+
+      // Drops poses that weren't used in the previous frame, keeping their
+      // storage for reuse
+      void beginFrame();
+
+      // Returns the pose for a key, which must be computed by the caller if
+      // isCached is false; poses remain valid until the next frame begins
+      std::vector<Mortar::Math::AffineTransform> *acquire(const Key& key, bool& isCached);
+
+      // Number of poses currently held
+      unsigned getPoseCount() const;
+
+      // Drops every pose, for when the way poses are computed has changed
+      void clear();
+
+      const Stats& getStats() const;
+
+    private:
+      struct Entry {
+        std::vector<Mortar::Math::AffineTransform> pose;
+        unsigned lastUsedFrame;
+      };
+
+      float quantum;
+      unsigned frame;
+
+      tsl::sparse_map<Key, Entry *, KeyHash> poseIndex;
+
+      // References into a deque survive appending, and dropped entries are
+      // reused to avoid reallocating their poses
+      std::deque<Entry> entries;
+      std::vector<Entry *> freeEntries;
+
+      Stats stats;
+  };
+}
+
+#endif
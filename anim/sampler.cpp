@@ -0,0 +1,232 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include <stdint.h>
+
+#include "../log.hpp"
+#include "../state.hpp"
+#include "anim.hpp"
+#include "sampler.hpp"
+
+using namespace Mortar::Animation;
+
+float inline squared(float f) {
+  return f * f;
+}
+
+float inline cubed(float f) {
+  return f * f * f;
+}
+
+float inline calculateHermite(float position, float tStart, float tEnd, float inverseDuration, float blendStart, float blendEnd, float rateStart, float rateEnd) {
+  float u = (position - tStart) * inverseDuration;
+  float duration = tEnd - tStart;
+
+  float durationAdjustedStartRate = duration * rateStart;
+  float durationAdjustedEndRate = duration * rateEnd;
+
+  return (2 * cubed(u) - 3 * squared(u) + 1) * blendStart + (-2 * cubed(u) + 3 * squared(u)) * blendEnd + (cubed(u) - 2 * squared(u) + u) * durationAdjustedStartRate + (cubed(u) - squared(u)) * durationAdjustedEndRate;
+}
+
+// Instrumentation for traced sampling, kept out of line so that none of it is
+// pulled into the untraced instantiations
+[[gnu::noinline, gnu::cold]] static void traceLookup(const struct KeyframeLookupKey& key) {
+  DEBUG("position %f, interval %u, subinterval %d", key.position, key.interval, key.subinterval);
+}
+
+[[gnu::noinline, gnu::cold]] static void traceSegment(const Mortar::Resource::Animation::Channel *channel, const struct KeyframeLookupKey& key, unsigned segment) {
+  DEBUG("mask 0x%08x; interval mask 0x%x", channel->getKeyframeMask(key.interval), key.intervalMask);
+  DEBUG("segment %u, interval offset %u", segment, channel->getIntervalOffset(key.interval));
+}
+
+[[gnu::noinline, gnu::cold]] static void traceCubic(const float *coefficients) {
+  DEBUG("t start %f, a %f, b %f, c %f, d %f", coefficients[0], coefficients[1], coefficients[2], coefficients[3], coefficients[4]);
+}
+
+[[gnu::noinline, gnu::cold]] static void traceRecords(const float *startData, const float *endData) {
+  DEBUG("t start %f, t end %f, invDur %f, p %f, q %f, v %f, w %f", startData[0], endData[0], startData[1], startData[2], endData[2], startData[3], endData[3]);
+}
+
+ClipSampler::ClipSampler(const Mortar::Resource::Animation *animation, bool interpolate)
+  : animation { animation }, interpolate { interpolate } {
+  this->elements.resize(animation->getElementCount());
+
+  for (unsigned i = 0; i < animation->getElementCount(); i++) {
+    const Mortar::Resource::Animation::Element *element = animation->getElement(i);
+    ElementProgram& program = this->elements[i];
+
+    bool hasRotation = element->getHasRotation();
+    bool hasScale = element->getHasScale();
+
+    if (hasRotation) {
+      program.function = hasScale ? sampleElement<true, true> : sampleElement<true, false>;
+    } else {
+      program.function = hasScale ? sampleElement<false, true> : sampleElement<false, false>;
+    }
+
+    for (unsigned j = 0; j < POSE_CHANNEL_COUNT; j++) {
+      bool isUsed = j < 3 || (j < 6 && hasRotation) || (j >= 6 && hasScale);
+
+      if (!isUsed) {
+        program.channels[j] = nullptr;
+        program.channelFunctions[j] = nullptr;
+        program.channelForms[j] = ChannelForm::CONSTANT;
+
+        continue;
+      }
+
+      program.channels[j] = element->getChannel(j);
+      program.channelForms[j] = this->resolveChannelForm(program.channels[j]);
+      program.channelFunctions[j] = selectChannelFunction<false>(program.channelForms[j]);
+    }
+  }
+}
+
+const Mortar::Resource::Animation *ClipSampler::getAnimation() const {
+  return this->animation;
+}
+
+bool ClipSampler::getInterpolate() const {
+  return this->interpolate;
+}
+
+ClipSampler::ChannelForm ClipSampler::resolveChannelForm(const Mortar::Resource::Animation::Channel *channel) const {
+  switch (channel->getKeyframeType()) {
+    case Mortar::Resource::Animation::KeyframeType::NONE:
+      return ChannelForm::CONSTANT;
+    case Mortar::Resource::Animation::KeyframeType::FLOAT:
+      if (!this->interpolate) {
+        return ChannelForm::STEP;
+      }
+
+      return channel->getCubicCoefficients() ? ChannelForm::CUBIC : ChannelForm::HERMITE;
+    case Mortar::Resource::Animation::KeyframeType::BOOLEAN:
+      throw std::runtime_error("boolean keyframes unimplemented");
+    default:
+      DEBUG("keyframe type %d", channel->getKeyframeType());
+      throw std::runtime_error("unimplemented keyframe type");
+  }
+}
+
+template <ClipSampler::ChannelForm Form, bool Traced>
+float ClipSampler::sampleChannel(const Mortar::Resource::Animation::Channel *channel, const struct KeyframeLookupKey& key) {
+  if constexpr (Form == ChannelForm::CONSTANT) {
+    return channel->getFloatData();
+  }
+
+  unsigned segment = channel->getSegmentIndex(key.slot, key.intervalMask);
+
+  if constexpr (Traced) {
+    traceSegment(channel, key, segment);
+  }
+
+  if constexpr (Form == ChannelForm::CUBIC) {
+    const float *coefficients = channel->getCubicCoefficients() + segment * 5;
+    float dt = key.position - coefficients[0];
+
+    if constexpr (Traced) {
+      traceCubic(coefficients);
+    }
+
+    return ((coefficients[1] * dt + coefficients[2]) * dt + coefficients[3]) * dt + coefficients[4];
+  }
+
+  // Quantized keys are decoded straight into these
+  float startData[4];
+  float endData[4];
+
+  channel->getRecord(segment, startData);
+
+  if constexpr (Form == ChannelForm::STEP && !Traced) {
+    return startData[2];
+  }
+
+  channel->getRecord(segment + 1, endData);
+
+  if constexpr (Traced) {
+    traceRecords(startData, endData);
+  }
+
+  if constexpr (Form == ChannelForm::STEP) {
+    return startData[2];
+  }
+
+  return calculateHermite(key.position, startData[0], endData[0], startData[1], startData[2], endData[2], startData[3], endData[3]);
+}
+
+template <bool Traced>
+ClipSampler::ChannelFunction ClipSampler::selectChannelFunction(ChannelForm form) {
+  switch (form) {
+    case ChannelForm::CONSTANT:
+      return sampleChannel<ChannelForm::CONSTANT, Traced>;
+    case ChannelForm::STEP:
+      return sampleChannel<ChannelForm::STEP, Traced>;
+    case ChannelForm::HERMITE:
+      return sampleChannel<ChannelForm::HERMITE, Traced>;
+    case ChannelForm::CUBIC:
+      return sampleChannel<ChannelForm::CUBIC, Traced>;
+  }
+
+  throw std::runtime_error("unknown channel form");
+}
+
+template <bool HasRotation, bool HasScale>
+void ClipSampler::sampleElement(const ElementProgram& program, const struct KeyframeLookupKey& key, float *values) {
+  for (unsigned j = 0; j < 3; j++) {
+    values[j] = program.channelFunctions[j](program.channels[j], key);
+  }
+
+  for (unsigned j = 3; j < 6; j++) {
+    values[j] = HasRotation ? program.channelFunctions[j](program.channels[j], key) : 0.0f;
+  }
+
+  for (unsigned j = 6; j < 9; j++) {
+    values[j] = HasScale ? program.channelFunctions[j](program.channels[j], key) : 0.0f;
+  }
+}
+
+void ClipSampler::sample(float position, float *values) const {
+  struct KeyframeLookupKey key = createKeyframeLookup(this->animation->getIntervalCount(), clampPosition(this->animation, position));
+
+  if (Mortar::State::printNextFrame) {
+    this->sampleTraced(key, values);
+    return;
+  }
+
+  for (unsigned i = 0; i < this->elements.size(); i++) {
+    const ElementProgram& program = this->elements[i];
+    program.function(program, key, values + i * POSE_CHANNEL_COUNT);
+  }
+}
+
+void ClipSampler::sampleTraced(const struct KeyframeLookupKey& key, float *values) const {
+  traceLookup(key);
+
+  for (unsigned i = 0; i < this->elements.size(); i++) {
+    const ElementProgram& program = this->elements[i];
+    float *elementValues = values + i * POSE_CHANNEL_COUNT;
+
+    for (unsigned j = 0; j < POSE_CHANNEL_COUNT; j++) {
+      if (!program.channels[j]) {
+        elementValues[j] = 0.0f;
+        continue;
+      }
+
+      elementValues[j] = selectChannelFunction<true>(program.channelForms[j])(program.channels[j], key);
+    }
+  }
+}
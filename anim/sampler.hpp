@@ -0,0 +1,90 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MORTAR_ANIM_SAMPLER_H
+#define MORTAR_ANIM_SAMPLER_H
+
+#include <vector>
+
+#include "../resource/types/anim.hpp"
+#include "anim.hpp"
+
+namespace Mortar::Animation {
+  // Samples the pose channels of a single clip. How each channel is evaluated
+  // depends on the interpolation mode, its keyframe type and whether cubic
+  // coefficients have been built, and which channels an element uses depends
+  // on whether it has rotation and scale; all of that is resolved once, when
+  // the sampler is created, to one of a set of specialized sampling functions
+  // so that nothing is tested per channel while sampling.
+  //
+  // A sampler refers to the clip's channels, so it must be recreated if they
+  // are modified, as when compressing.
+  class ClipSampler {
+    public:
+      // Channels are sampled at their keyframes alone unless interpolating
+      ClipSampler(const Mortar::Resource::Animation *animation, bool interpolate);
+
+      const Mortar::Resource::Animation *getAnimation() const;
+      bool getInterpolate() const;
+
+      // Writes POSE_CHANNEL_COUNT values per element, as sampleChannels()
+      void sample(float position, float *values) const;
+
+    private:
+      // How a channel is evaluated, after taking interpolation into account
+      enum class ChannelForm {
+        CONSTANT,
+        STEP,
+        HERMITE,
+        CUBIC,
+      };
+
+      typedef float (*ChannelFunction)(const Mortar::Resource::Animation::Channel *channel, const struct KeyframeLookupKey& key);
+
+      struct ElementProgram;
+      typedef void (*ElementFunction)(const ElementProgram& program, const struct KeyframeLookupKey& key, float *values);
+
+      struct ElementProgram {
+        ElementFunction function;
+
+        const Mortar::Resource::Animation::Channel *channels[POSE_CHANNEL_COUNT];
+        ChannelFunction channelFunctions[POSE_CHANNEL_COUNT];
+        ChannelForm channelForms[POSE_CHANNEL_COUNT];
+      };
+
+      template <ChannelForm Form, bool Traced>
+      static float sampleChannel(const Mortar::Resource::Animation::Channel *channel, const struct KeyframeLookupKey& key);
+
+      template <bool Traced>
+      static ChannelFunction selectChannelFunction(ChannelForm form);
+
+      template <bool HasRotation, bool HasScale>
+      static void sampleElement(const ElementProgram& program, const struct KeyframeLookupKey& key, float *values);
+
+      ChannelForm resolveChannelForm(const Mortar::Resource::Animation::Channel *channel) const;
+
+      // Samples with every channel reporting its lookup as it goes; only used
+      // when the next frame is being printed
+      void sampleTraced(const struct KeyframeLookupKey& key, float *values) const;
+
+      const Mortar::Resource::Animation *animation;
+      bool interpolate;
+
+      std::vector<ElementProgram> elements;
+  };
+}
+
+#endif
@@ -17,6 +17,9 @@
 #include <filesystem>
 #include <tsl/sparse_map.h>
 
+#include "../../../anim/compress.hpp"
+#include "../../../log.hpp"
+#include "../../../render/optimize.hpp"
 #include "../../../state.hpp"
 #include "../../../streams/filestream.hpp"
 #include "loaders.hpp"
@@ -71,13 +74,28 @@ Mortar::Resource::Character *CharacterLoader::operator()(const std::string &name
 
   Readers::HGPReader::read(resource, stream);
 
+  if (State::meshOptimizationEnabled) {
+    for (auto& report : Mortar::Render::optimizeModel(resource->getModel())) {
+      DEBUG("optimized %s mesh %u: %u triangles, ACMR %.3f to %.3f, %u strips converted", name.c_str(), report.meshIdx, report.triangleCount, report.originalAcmr, report.optimizedAcmr, report.convertedStrips);
+    }
+  }
+
+  Readers::AnimReader::Options animOptions;
+  animOptions.bakeRate = State::animBakeRate;
+
   for (auto& animation : desc.animations) {
     auto animPrefix = std::filesystem::path(desc.path).append(animation.second);
 
     auto aniPath = std::filesystem::path(animPrefix).concat(".ani");
     FileStream stream = FileStream(aniPath.c_str(), "rb");
 
-    Mortar::Resource::Animation *ani = Readers::AnimReader::read(stream);
+    Mortar::Resource::Animation *ani = Readers::AnimReader::read(stream, animOptions);
+
+    if (State::animCompressionEnabled) {
+      Mortar::Animation::CompressionReport report = Mortar::Animation::compressAnimation(ani, *resource->getSkeleton());
+
+      DEBUG("compressed %s %s: %lu to %lu bytes (%.2fx), %u of %u keys kept, %u channels stripped, max joint error %f", name.c_str(), animation.second.c_str(), report.originalSize, report.compressedSize, report.getRatio(), report.keyCount, report.originalKeyCount, report.strippedChannels, report.maxJointError);
+    }
     resource->addSkeletalAnimation(animation.first, ani);
   }
 
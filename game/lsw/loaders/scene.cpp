@@ -19,6 +19,8 @@
 #include <string>
 #include <tsl/sparse_map.h>
 
+#include "../../../log.hpp"
+#include "../../../render/optimize.hpp"
 #include "../../../state.hpp"
 #include "../../../streams/filestream.hpp"
 #include "loaders.hpp"
@@ -61,6 +63,12 @@ Mortar::Resource::Scene *SceneLoader::operator()(const std::string &name) {
 
   Readers::NUPReader::read(resource, stream);
 
+  if (State::meshOptimizationEnabled) {
+    for (auto& report : Mortar::Render::optimizeModel(resource->getModel())) {
+      DEBUG("optimized %s mesh %u: %u triangles, ACMR %.3f to %.3f, %u strips converted", name.c_str(), report.meshIdx, report.triangleCount, report.originalAcmr, report.optimizedAcmr, report.convertedStrips);
+    }
+  }
+
   for (auto& charName : desc.playerCharacters) {
     Resource::Character *pc = State::getResourceManager().getResource<Resource::Character>(charName);
     resource->addPlayerCharacter(pc);
@@ -15,10 +15,11 @@
  */
 
 #include <assert.h>
-#include <bitset>
+#include <bit>
 #include <cstdio>
 #include <stdexcept>
 
+#include "../../../anim/baked.hpp"
 #include "../../../log.hpp"
 #include "../../../state.hpp"
 #include "anim.hpp"
@@ -64,7 +65,7 @@ inline Mortar::Resource::Animation::KeyframeType translateKeyframeType(uint8_t t
   }
 }
 
-Mortar::Resource::Animation *AnimReader::read(Stream& stream) {
+Mortar::Resource::Animation *AnimReader::read(Stream& stream, const Options& options) {
   Mortar::Resource::ResourceManager resourceManager = Mortar::State::getResourceManager();
   Mortar::Resource::Animation *animation = resourceManager.createResource<Mortar::Resource::Animation>();
 
@@ -138,9 +139,14 @@ Mortar::Resource::Animation *AnimReader::read(Stream& stream) {
     assert(lswChannels[i].dataOffset != 0);
   }
 
+  animation->setLayout(dataHeader.elementCount, dataHeader.channelsPerElementCount);
+
+  std::vector<uint32_t> keyframeMasks (dataHeader.intervalCount);
+  std::vector<uint16_t> intervalOffsets (dataHeader.intervalCount);
+  std::vector<float> records;
+
   for (int i = 0; i < dataHeader.elementCount; i++) {
-    Mortar::Resource::Animation::Element *element = resourceManager.createResource<Mortar::Resource::Animation::Element>();
-    animation->addElement(element);
+    Mortar::Resource::Animation::Element *element = animation->getElement(i);
 
     uint32_t flags = elementFlags.at(i);
 
@@ -151,8 +157,7 @@ Mortar::Resource::Animation *AnimReader::read(Stream& stream) {
     for (int j = 0; j < dataHeader.channelsPerElementCount; j++) {
       unsigned channelIdx = i * dataHeader.channelsPerElementCount + j;
 
-      Mortar::Resource::Animation::Channel *channel = resourceManager.createResource<Mortar::Resource::Animation::Channel>();
-      element->addChannel(channel);
+      Mortar::Resource::Animation::Channel *channel = element->getChannel(j);
 
       Mortar::Resource::Animation::KeyframeType keyframeType = translateKeyframeType(keyframeTypes[channelIdx]);
       channel->setKeyframeType(keyframeType);
@@ -168,37 +173,33 @@ Mortar::Resource::Animation *AnimReader::read(Stream& stream) {
 
       stream.seek(lswChannel.keyframeMasksOffset - fileHeader.globalAdjust, SEEK_SET);
       for (int k = 0; k < dataHeader.intervalCount; k++) {
-        uint8_t keyframeMask[4];
-
-        keyframeMask[0] = stream.readUint8();
-        keyframeMask[1] = stream.readUint8();
-        keyframeMask[2] = stream.readUint8();
-        keyframeMask[3] = stream.readUint8();
-
-        channel->addKeyframeMask(keyframeMask[0], keyframeMask[1], keyframeMask[2], keyframeMask[3]);
-
-        keyframeCount += std::bitset<8>(keyframeMask[0]).count();
-        keyframeCount += std::bitset<8>(keyframeMask[1]).count();
-        keyframeCount += std::bitset<8>(keyframeMask[2]).count();
-        keyframeCount += std::bitset<8>(keyframeMask[3]).count();
+        // Each subinterval's mask byte follows the last, so reading them as a
+        // little-endian word puts the first in the lowest bits
+        keyframeMasks[k] = stream.readUint32();
+        keyframeCount += std::popcount(keyframeMasks[k]);
       }
 
       stream.seek(lswChannel.intervalOffsetsOffset - fileHeader.globalAdjust, SEEK_SET);
       for (int k = 0; k < dataHeader.intervalCount; k++) {
-        uint16_t offset = stream.readUint16();
-        channel->addIntervalOffset(offset);
+        intervalOffsets[k] = stream.readUint16();
       }
 
+      channel->setKeyframeIndex(keyframeMasks.data(), intervalOffsets.data());
+
       stream.seek(lswChannel.dataOffset - fileHeader.globalAdjust, SEEK_SET);
       if (keyframeType == Mortar::Resource::Animation::KeyframeType::FLOAT) {
-        unsigned floatCount = (keyframeCount + 1) * 4;
+        unsigned recordCount = keyframeCount + 1;
 
-        float *data = (float *)calloc(floatCount, sizeof(float));
-        for (int k = 0; k < floatCount; k++) {
-          data[k] = stream.readFloat();
+        records.resize(recordCount * 4);
+        for (int k = 0; k < records.size(); k++) {
+          records[k] = stream.readFloat();
         }
 
-        channel->setData(data, floatCount * sizeof(float));
+        channel->setRecords(records.data(), recordCount);
+
+        if (options.precomputeCubics) {
+          channel->buildCubicCoefficients();
+        }
       } else {
         DEBUG("unimplemented keyframe type %d", keyframeType);
         throw std::runtime_error("unimplemented keyframe type");
@@ -206,5 +207,15 @@ Mortar::Resource::Animation *AnimReader::read(Stream& stream) {
     }
   }
 
+  // Channels were appended to the tables one after another, so this only
+  // trims their spare capacity
+  animation->compact();
+
+  if (options.bakeRate > 0.0f) {
+    animation->setBakedTracks(Mortar::Animation::bakeTracks(animation, options.bakeRate));
+
+    DEBUG("baked %u samples at %.0f Hz: %lu bytes, curves %lu bytes", animation->getBakedTracks()->sampleCount, options.bakeRate, animation->getBakedTracks()->getMemoryUsage(), animation->getMemoryUsage());
+  }
+
   return animation;
 }
@@ -23,7 +23,22 @@
 namespace Mortar::Game::LSW::Readers {
   class AnimReader {
     public:
-      static Resource::Animation *read(Stream& stream);
+      class Options {
+        public:
+          Options()
+            : precomputeCubics { true },
+              bakeRate { 0.0f } {};
+
+          // Converts Hermite curve data into per-segment cubic coefficients
+          // for faster sampling; the raw curves remain available either way
+          bool precomputeCubics;
+
+          // If nonzero, additionally bakes the curves into tracks sampled at
+          // this many samples per second
+          float bakeRate;
+      };
+
+      static Resource::Animation *read(Stream& stream, const Options& options = Options());
   };
 }
 
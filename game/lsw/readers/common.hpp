@@ -23,6 +23,7 @@
 #include "../../../streams/stream.hpp"
 #include "../../../resource/types/material.hpp"
 #include "../../../resource/types/mesh.hpp"
+#include "../../../resource/types/model.hpp"
 #include "../../../resource/types/texture.hpp"
 #include "../../../resource/types/vertex.hpp"
 
@@ -37,14 +38,24 @@ namespace Mortar::Game::LSW::Readers {
       static void read(std::vector<Resource::Texture *>& textures, Stream& stream, uint32_t texturesOffset);
   };
 
+  // Where one of a file's vertex blocks was placed in the model's vertex
+  // data
+  class VertexBlock {
+    public:
+      size_t offset;
+      size_t size;
+  };
+
   class VertexBufferReader {
     public:
-      static void read(std::vector<Resource::VertexBuffer *>& vertexBuffers, Stream& stream, uint32_t bodyOffset);
+      static void read(Resource::Model *model, std::vector<VertexBlock>& vertexBlocks, Stream& stream, uint32_t bodyOffset);
   };
 
   class MeshesReader {
     public:
-      static void read(std::vector<Resource::Mesh *>& meshes, Stream& stream, uint32_t bodyOffset, const std::vector<Resource::Material *>& materials, const std::vector<Resource::VertexBuffer *>& vertexBuffers);
+      // Adds each mesh read to the model, along with its surfaces and
+      // indices, and appends its index to meshIndices
+      static void read(Resource::Model *model, std::vector<unsigned>& meshIndices, Stream& stream, uint32_t bodyOffset, const std::vector<Resource::Material *>& materials, const std::vector<VertexBlock>& vertexBlocks);
   };
 }
 
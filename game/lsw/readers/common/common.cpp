@@ -221,7 +221,7 @@ void TexturesReader::read(std::vector<Resource::Texture *>& textures, Stream &st
   delete[] texture_header.texture_block_headers;
 }
 
-void VertexBufferReader::read(std::vector<Resource::VertexBuffer *>& vertexBuffers, Stream &stream, uint32_t vertexHeaderOffset) {
+void VertexBufferReader::read(Resource::Model *model, std::vector<VertexBlock>& vertexBlocks, Stream &stream, uint32_t vertexHeaderOffset) {
   struct LSWVertexHeader vertex_header;
 
   vertex_header.num_vertex_blocks = stream.readUint32();
@@ -240,19 +240,19 @@ void VertexBufferReader::read(std::vector<Resource::VertexBuffer *>& vertexBuffe
     vertex_header.blocks[i].offset = stream.readUint32();
   }
 
-  /* Read vertex blocks into individual, indexed buffers. */
-   for (int i = 0; i < vertex_header.num_vertex_blocks; i++) {
-    Resource::VertexBuffer *vertexBuffer = State::getResourceManager().createResource<Resource::VertexBuffer>();
-    vertexBuffers.push_back(vertexBuffer);
-
-    vertexBuffer->setSize(vertex_header.blocks[i].size);
+  /* Read vertex blocks one after another into the model's vertex data. */
+  std::vector<uint8_t> data;
+  for (int i = 0; i < vertex_header.num_vertex_blocks; i++) {
+    data.resize(vertex_header.blocks[i].size);
 
     stream.seek(vertexHeaderOffset + vertex_header.blocks[i].offset, SEEK_SET);
+    stream.read(data.data(), sizeof(uint8_t), vertex_header.blocks[i].size);
 
-    auto data = new uint8_t[vertex_header.blocks[i].size];
-    stream.read(data, sizeof(uint8_t), vertex_header.blocks[i].size);
+    VertexBlock block;
+    block.offset = model->addVertexData(data.data(), data.size());
+    block.size = data.size();
 
-    vertexBuffer->setData(data);
+    vertexBlocks.push_back(block);
   }
 
   delete[] vertex_header.blocks;
@@ -14,6 +14,7 @@
  * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <stdexcept>
 #include <tsl/sparse_map.h>
 
@@ -186,41 +187,41 @@ tsl::sparse_map<uint32_t, Mortar::Resource::PrimitiveType> primitiveTypes {
   { 6, Mortar::Resource::PrimitiveType::TRIANGLE_STRIP },
 };
 
-void processSurfaces(Stream &stream, const uint32_t bodyOffset, uint32_t surfacesOffset, Mortar::Resource::Mesh *mesh) {
-  Mortar::Resource::ResourceManager resourceManager = Mortar::State::getResourceManager();
+void processSurfaces(Stream &stream, const uint32_t bodyOffset, uint32_t surfacesOffset, Mortar::Resource::Model *model, Mortar::Resource::Mesh *mesh) {
+  std::vector<uint16_t> elementData;
 
+  uint32_t firstSurface = model->getSurfaces().size();
   uint32_t nextOffset = surfacesOffset;
-  unsigned i = 0;
   do {
-    Mortar::Resource::Surface *surface = resourceManager.createResource<Mortar::Resource::Surface>();
-    mesh->addSurface(surface);
-
     struct LSWSurface lswSurface = readSurfaceInfo(stream, bodyOffset, nextOffset);
 
     stream.seek(bodyOffset + lswSurface.elementsOffset, SEEK_SET);
 
-    uint16_t *elementData = new uint16_t[lswSurface.elementCount];
+    elementData.resize(lswSurface.elementCount);
     for (int i = 0; i < lswSurface.elementCount; i++) {
       elementData[i] = stream.readUint16();
     }
 
-    Mortar::Resource::IndexBuffer *indexBuffer = resourceManager.createResource<Mortar::Resource::IndexBuffer>();
+    if (lswSurface.num_skin_matrices > Mortar::Resource::Surface::MAX_SKIN_TRANSFORMS) {
+      throw std::runtime_error("too many skin transforms in surface");
+    }
 
-    indexBuffer->setCount(lswSurface.elementCount);
-    indexBuffer->setData(elementData);
+    Mortar::Resource::Surface surface;
 
-    surface->setIndexBuffer(indexBuffer);
+    surface.primitiveType = primitiveTypes.at(lswSurface.primitiveType);
 
-    surface->setPrimitiveType(primitiveTypes.at(lswSurface.primitiveType));
+    surface.firstIndex = model->addIndices(elementData.data(), elementData.size());
+    surface.indexCount = elementData.size();
 
-    surface->setSkinTransformCount(lswSurface.num_skin_matrices);
+    surface.skinTransformCount = lswSurface.num_skin_matrices;
+    std::copy(std::begin(lswSurface.skin_matrix_indices), std::end(lswSurface.skin_matrix_indices), surface.skinTransformIndices);
 
-    std::vector<ushort> indices(std::begin(lswSurface.skin_matrix_indices), std::end(lswSurface.skin_matrix_indices));
-    surface->setSkinTransformIndices(indices);
+    model->addSurface(surface);
 
     nextOffset = lswSurface.next_offset;
-    i++;
   } while (nextOffset);
+
+  mesh->setSurfaces(firstSurface, model->getSurfaces().size() - firstSurface);
 }
 
 const struct LSWMesh readMeshInfo(Stream &stream, const uint32_t body_offset, uint32_t mesh_offset) {
@@ -254,9 +255,7 @@ const struct LSWMesh readMeshInfo(Stream &stream, const uint32_t body_offset, ui
   return mesh;
 }
 
-void MeshesReader::read(std::vector<Resource::Mesh *>& meshes, Stream &stream, uint32_t bodyOffset, const std::vector<Resource::Material *>& materials, const std::vector<Resource::VertexBuffer *>& vertexBuffers) {
-  Resource::ResourceManager resourceManager = State::getResourceManager();
-
+void MeshesReader::read(Resource::Model *model, std::vector<unsigned>& meshIndices, Stream &stream, uint32_t bodyOffset, const std::vector<Resource::Material *>& materials, const std::vector<VertexBlock>& vertexBlocks) {
   struct LSWMeshHeader mesh_header;
 
   stream.seek(3 * sizeof(uint32_t), SEEK_CUR);
@@ -271,8 +270,10 @@ void MeshesReader::read(std::vector<Resource::Mesh *>& meshes, Stream &stream, u
   do {
     struct LSWMesh lswMesh = readMeshInfo(stream, bodyOffset, nextOffset);
 
-    Resource::Mesh *mesh = resourceManager.createResource<Resource::Mesh>();
-    meshes.push_back(mesh);
+    unsigned meshIdx = model->addMesh();
+    meshIndices.push_back(meshIdx);
+
+    Resource::Mesh *mesh = model->getMesh(meshIdx);
 
     Resource::Material *material = materials.at(lswMesh.materialIdx);
     mesh->setMaterial(material);
@@ -283,10 +284,12 @@ void MeshesReader::read(std::vector<Resource::Mesh *>& meshes, Stream &stream, u
     const Resource::VertexLayout& vertexLayout = getVertexLayoutFromMesh(lswMesh);
     mesh->setVertexLayout(vertexLayout);
 
-    Resource::VertexBuffer *vertexBuffer = vertexBuffers.at(lswMesh.vertexBlockIdx - 1);
-    mesh->setVertexBuffer(vertexBuffer);
+    const VertexBlock& vertexBlock = vertexBlocks.at(lswMesh.vertexBlockIdx - 1);
+    mesh->setVertexData(vertexBlock.offset, vertexBlock.size);
+
+    processSurfaces(stream, bodyOffset, lswMesh.surfacesOffset, model, mesh);
 
-    processSurfaces(stream, bodyOffset, lswMesh.surfacesOffset, mesh);
+    mesh->calculateBounds();
 
     nextOffset = lswMesh.next_offset;
   } while (nextOffset);
@@ -20,13 +20,14 @@
 
 #include "../../../log.hpp"
 #include "../../../state.hpp"
+#include "../../../math/affine.hpp"
 #include "../../../math/matrix.hpp"
 #include "../../../streams/filestream.hpp"
 #include "../../../streams/memorystream.hpp"
-#include "../../../resource/types/joint.hpp"
 #include "../../../resource/types/layer.hpp"
 #include "../../../resource/types/mesh.hpp"
 #include "../../../resource/types/shader.hpp"
+#include "../../../resource/types/skeleton.hpp"
 #include "dds.hpp"
 #include "hgp.hpp"
 #include "common.hpp"
@@ -118,8 +119,16 @@ struct HGPLocator {
 
 const uint32_t BODY_OFFSET = 0x30;
 
+// Converts a joint-local transform between the game's handedness and ours by
+// mirroring it in z on both sides
+inline Mortar::Math::Matrix flipZ(const Mortar::Math::Matrix& M) {
+  Mortar::Math::Matrix flip = Mortar::Math::Matrix::diagonal(1.0f, 1.0f, -1.0f);
+
+  return flip * M * flip;
+}
+
 void HGPReader::read(Resource::Character *character, Stream& stream) {
-  Resource::ResourceManager resourceManager = State::getResourceManager();
+  Resource::ResourceManager& resourceManager = State::getResourceManager();
   Resource::Model *model = resourceManager.createResource<Resource::Model>();
   character->setModel(model);
 
@@ -182,11 +191,8 @@ void HGPReader::read(Resource::Character *character, Stream& stream) {
 
   /* Read vertex data. */
   stream.seek(BODY_OFFSET + file_header.vertex_header_offset, SEEK_SET);
-  std::vector<Resource::VertexBuffer *> vertexBuffers;
-  VertexBufferReader::read(vertexBuffers, stream, BODY_OFFSET + file_header.vertex_header_offset);
-  for (auto vertexBuffer : vertexBuffers) {
-    model->addVertexBuffer(vertexBuffer);
-  }
+  std::vector<VertexBlock> vertexBlocks;
+  VertexBufferReader::read(model, vertexBlocks, stream, BODY_OFFSET + file_header.vertex_header_offset);
 
   /* Read skeleton. */
   std::vector<HGPJoint> hgpJoints (model_header.num_joints);
@@ -205,14 +211,16 @@ void HGPReader::read(Resource::Character *character, Stream& stream) {
     stream.seek(3 * sizeof(uint32_t), SEEK_CUR);
   }
 
+  Resource::Skeleton *skeleton = resourceManager.createResource<Resource::Skeleton>();
+
   std::vector<Math::Matrix> restPose (model_header.num_joints);
 
   stream.seek(BODY_OFFSET + model_header.rest_pose_offset, SEEK_SET);
   for (int i = 0; i < model_header.num_joints; i++) {
-    restPose[i] = Math::Matrix::fromStream(stream);
+    restPose[i] = flipZ(Math::Matrix::fromStream(stream));
   }
 
-  character->setRestPose(restPose);
+  skeleton->setRestPose(restPose);
 
   for (int i = 0; i < model_header.num_joints; i++) {
     HGPJoint& hgpJoint = hgpJoints[i];
@@ -220,26 +228,23 @@ void HGPReader::read(Resource::Character *character, Stream& stream) {
     stream.seek(BODY_OFFSET + file_header.strings_offset + file_header.strings_offset - model_header.string_table_adjust - model_header.skeleton_offset + hgpJoint.name_offset, SEEK_SET);
     char *jointName = stream.readString();
 
-    Resource::Joint *joint = resourceManager.createResource<Resource::Joint>();
-    character->addJoint(joint);
-
-    joint->setName(jointName);
-
-    joint->setParentIdx(hgpJoint.parent_idx);
-    joint->setTransform(hgpJoint.transformation_mtx);
-
-    joint->setAttachmentPoint(hgpJoint.attachment);
-
-    joint->setIsRelativeToAttachment((hgpJoint.flags & 8) != 0);
+    skeleton->addJoint(jointName, hgpJoint.parent_idx, hgpJoint.transformation_mtx, hgpJoint.attachment, (hgpJoint.flags & 8) != 0);
   }
 
   /* Read in information necessary for processing layers and meshes. */
+  std::vector<Math::AffineTransform> skinTransforms (model_header.num_joints);
+
   stream.seek(BODY_OFFSET + model_header.skin_transforms_offset, SEEK_SET);
   for (int i = 0; i < model_header.num_joints; i++) {
-    auto mtx = Math::Matrix::fromStream(stream);
-    character->addSkinTransform(mtx);
+    // Composing flipped poses down the hierarchy cancels every flip but the
+    // outermost pair, which is folded into the skin transform here and into
+    // the actor's world transform when posing
+    skinTransforms[i] = Math::AffineTransform::fromMatrix(Math::Matrix::fromStream(stream) * Math::Matrix::diagonal(1.0f, 1.0f, -1.0f));
   }
 
+  skeleton->setSkinTransforms(skinTransforms);
+  character->setSkeleton(resourceManager.shareSkeleton(skeleton));
+
   stream.seek(BODY_OFFSET + model_header.layer_header_offset, SEEK_SET);
   std::vector<HGPLayerHeader> layer_headers (model_header.num_layers);
 
@@ -278,40 +283,34 @@ void HGPReader::read(Resource::Character *character, Stream& stream) {
             continue;
           }
 
-          const char *jointName = character->getJoint(k)->getName();
+          const char *jointName = character->getSkeleton()->getJointName(k);
 
           stream.seek(BODY_OFFSET + mesh_header_offsets[k], SEEK_SET);
-          std::vector<Resource::Mesh *> meshes;
-          MeshesReader::read(meshes, stream, BODY_OFFSET, materials, vertexBuffers);
-          for (auto mesh : meshes) {
-            auto kinematic = resourceManager.createResource<Resource::KinematicMesh>();
-
-            model->addMesh(mesh);
-
-            kinematic->setJointIdx(k);
-            kinematic->setMesh(mesh);
-            layer->addKinematicMesh(kinematic);
+          std::vector<unsigned> meshes;
+          MeshesReader::read(model, meshes, stream, BODY_OFFSET, materials, vertexBlocks);
+          for (auto meshIdx : meshes) {
+            layer->addKinematicMesh({ meshIdx, k });
           }
         }
       } else if (j == 1) {
-        std::vector<Resource::Mesh *> skinMeshes;
-        MeshesReader::read(skinMeshes, stream, BODY_OFFSET, materials, vertexBuffers);
-        for (auto mesh : skinMeshes) {
-          model->addMesh(mesh);
-          layer->addSkinMesh(mesh);
+        std::vector<unsigned> skinMeshes;
+        MeshesReader::read(model, skinMeshes, stream, BODY_OFFSET, materials, vertexBlocks);
+        for (auto meshIdx : skinMeshes) {
+          layer->addSkinMesh(meshIdx);
         }
       }
       else if (j == 3) {
-        std::vector<Resource::Mesh *> deformableSkinMeshes;
-        MeshesReader::read(deformableSkinMeshes, stream, BODY_OFFSET, materials, vertexBuffers);
-        for (auto mesh : deformableSkinMeshes) {
-          model->addMesh(mesh);
-          layer->addDeformableSkinMesh(mesh);
+        std::vector<unsigned> deformableSkinMeshes;
+        MeshesReader::read(model, deformableSkinMeshes, stream, BODY_OFFSET, materials, vertexBlocks);
+        for (auto meshIdx : deformableSkinMeshes) {
+          layer->addDeformableSkinMesh(meshIdx);
         }
       }
     }
   }
 
+  character->calculateJointBounds();
+
   stream.seek(BODY_OFFSET + model_header.locators_offset, SEEK_SET);
   for (int i = 0; i < model_header.num_locators; i++) {
     HGPLocator hgpLocator;
@@ -14,10 +14,12 @@
  * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <forward_list>
+#include <algorithm>
+#include <tsl/sparse_map.h>
 #include <vector>
 
 #include "../../../log.hpp"
+#include "../../../math/affine.hpp"
 #include "../../../math/matrix.hpp"
 #include "dds.hpp"
 #include "nup.hpp"
@@ -141,11 +143,8 @@ void NUPReader::read(Mortar::Resource::Scene *scene, Stream &stream) {
 
   /* Read vertex data. */
   stream.seek(BODY_OFFSET + file_header.vertex_header_offset, SEEK_SET);
-  std::vector<Resource::VertexBuffer *> vertexBuffers;
-  VertexBufferReader::read(vertexBuffers, stream, BODY_OFFSET + file_header.vertex_header_offset);
-  for (auto vertexBuffer : vertexBuffers) {
-    model->addVertexBuffer(vertexBuffer);
-  }
+  std::vector<VertexBlock> vertexBlocks;
+  VertexBufferReader::read(model, vertexBlocks, stream, BODY_OFFSET + file_header.vertex_header_offset);
 
   /* Break the layers down into meshes and add those to the model's list. */
   stream.seek(BODY_OFFSET + model_header.mesh_header_list_offset, SEEK_SET);
@@ -155,19 +154,20 @@ void NUPReader::read(Mortar::Resource::Scene *scene, Stream &stream) {
     mesh_header_offsets[i] = stream.readUint32();
   }
 
-  std::vector<std::forward_list<Resource::Mesh *>> meshes;
+  std::vector<std::vector<unsigned>> blockMeshes (model_header.num_mesh_blocks);
   for (int i = 0; i < model_header.num_mesh_blocks; i++) {
     stream.seek(BODY_OFFSET + mesh_header_offsets[i], SEEK_SET);
+    MeshesReader::read(model, blockMeshes[i], stream, BODY_OFFSET, materials, vertexBlocks);
+  }
 
-    std::vector<Resource::Mesh *> blockMeshes;
-    MeshesReader::read(blockMeshes, stream, BODY_OFFSET, materials, vertexBuffers);
-
-    std::forward_list<Resource::Mesh *> meshList;
-    for (auto mesh : blockMeshes) {
-      model->addMesh(mesh);
-      meshList.push_front(mesh);
+  // Every mesh has been added, so pointers into the model's table are now
+  // stable
+  for (auto& indices : blockMeshes) {
+    std::vector<const Resource::Mesh *> meshes;
+    for (auto meshIdx : indices) {
+      meshes.push_back(model->getMesh(meshIdx));
     }
-    meshes.push_back(meshList);
+    scene->addMeshBlock(meshes);
   }
 
   delete [] mesh_header_offsets;
@@ -187,23 +187,37 @@ void NUPReader::read(Mortar::Resource::Scene *scene, Stream &stream) {
     stream.seek(sizeof(uint32_t), SEEK_CUR);
   }
 
+  /* Instances with a matrix offset use the matrix found there in place of
+   * their own. Those are often shared, so each is read once, in file order. */
+  std::vector<uint32_t> matrixOffsets;
   for (int i = 0; i < model_header.num_instances; i++) {
-    Resource::Instance *instance = resourceManager.createResource<Resource::Instance>();
-    scene->addInstance(instance);
+    if (instances_data[i].matrix_offset) {
+      matrixOffsets.push_back(instances_data[i].matrix_offset);
+    }
+  }
 
+  std::sort(matrixOffsets.begin(), matrixOffsets.end());
+  matrixOffsets.erase(std::unique(matrixOffsets.begin(), matrixOffsets.end()), matrixOffsets.end());
+
+  tsl::sparse_map<uint32_t, Math::AffineTransform> offsetTransforms;
+  for (auto offset : matrixOffsets) {
+    stream.seek(BODY_OFFSET + offset, SEEK_SET);
+    offsetTransforms[offset] = Math::AffineTransform::fromMatrix(Math::Matrix::fromStream(stream));
+  }
+
+  for (int i = 0; i < model_header.num_instances; i++) {
     if (instances_data[i].matrix_offset) {
-      stream.seek(BODY_OFFSET + instances_data[i].matrix_offset, SEEK_SET);
-      Math::Matrix transform = Math::Matrix::fromStream(stream);
-      instance->setWorldTransform(transform);
+      scene->addInstance(instances_data[i].mesh_idx, offsetTransforms.at(instances_data[i].matrix_offset));
     } else {
-      instance->setWorldTransform(instances_data[i].transformation);
+      scene->addInstance(instances_data[i].mesh_idx, Math::AffineTransform::fromMatrix(instances_data[i].transformation));
     }
-
-    instance->setMeshes(meshes.at(instances_data[i].mesh_idx));
   }
 
   delete [] instances_data;
 
+  // Instances are static, so their spatial hierarchy can be built up front
+  scene->buildInstanceHierarchy();
+
   std::vector<NUPSpline> nupSplines (model_header.num_splines);
 
   stream.seek(BODY_OFFSET + model_header.splines_offset, SEEK_SET);
@@ -41,6 +41,7 @@ int main(int argc, char **argv) {
   }
 
   State::getResourceManager().initialize();
+  State::getWorkerPool().initialize();
 
   State::getDisplayManager().initialize(Mortar::DisplayManager::GraphicsAPI::OPENGL, WIDTH, HEIGHT);
 
@@ -66,8 +67,16 @@ int main(int argc, char **argv) {
           shouldClose = true;
         } else if (event.key.keysym.sym == SDLK_a) {
           State::animEnabled = !State::animEnabled;
+        } else if (event.key.keysym.sym == SDLK_b) {
+          State::bakedAnimEnabled = !State::bakedAnimEnabled;
+        } else if (event.key.keysym.sym == SDLK_l) {
+          State::animLodEnabled = !State::animLodEnabled;
         } else if (event.key.keysym.sym == SDLK_r) {
           State::animRate = State::animRate == 30.0f ? 1.0f : 30.0f;
+        } else if (event.key.keysym.sym == SDLK_c) {
+          State::cullingEnabled = !State::cullingEnabled;
+        } else if (event.key.keysym.sym == SDLK_o) {
+          State::occlusionCullingEnabled = !State::occlusionCullingEnabled;
         } else if (event.key.keysym.sym == SDLK_p) {
           State::printNextFrame = true;
         } else if (event.key.keysym.sym == SDLK_i) {
@@ -88,6 +97,7 @@ int main(int argc, char **argv) {
 
   State::getResourceManager().shutDown();
   State::getSceneManager().shutDown();
+  State::getWorkerPool().shutDown();
 
   SDL_Quit();
 
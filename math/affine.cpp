@@ -0,0 +1,237 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <memory>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "affine.hpp"
+
+using namespace Mortar::Math;
+
+AffineTransform AffineTransform::fromMatrix(const Matrix& M) {
+  AffineTransform out;
+
+  for (unsigned j = 0; j < 3; j++) {
+    for (unsigned i = 0; i < 4; i++) {
+      out.rows[j][i] = M.m[i][j];
+    }
+  }
+
+  return out;
+}
+
+Matrix AffineTransform::toMatrix() const {
+  Matrix out;
+
+  for (unsigned i = 0; i < 4; i++) {
+    for (unsigned j = 0; j < 3; j++) {
+      out.m[i][j] = this->rows[j][i];
+    }
+
+    out.m[i][3] = i == 3 ? 1.0f : 0.0f;
+  }
+
+  return out;
+}
+
+Vector AffineTransform::getTranslation() const {
+  return Vector { this->rows[0][3], this->rows[1][3], this->rows[2][3], 1.0f };
+}
+
+void AffineTransform::setTranslation(const Vector& translation) {
+  this->rows[0][3] = translation.x;
+  this->rows[1][3] = translation.y;
+  this->rows[2][3] = translation.z;
+}
+
+AffineTransform AffineTransform::inverse() const {
+  AffineTransform out;
+
+  // The linear part is stored transposed, so invert it as such; the inverse
+  // of the transpose is the transpose of the inverse
+  const float (*L)[4] = this->rows;
+
+  float c00 = L[1][1] * L[2][2] - L[1][2] * L[2][1];
+  float c01 = L[1][2] * L[2][0] - L[1][0] * L[2][2];
+  float c02 = L[1][0] * L[2][1] - L[1][1] * L[2][0];
+
+  float invDeterminant = 1.0f / (L[0][0] * c00 + L[0][1] * c01 + L[0][2] * c02);
+
+  out.rows[0][0] = c00 * invDeterminant;
+  out.rows[1][0] = c01 * invDeterminant;
+  out.rows[2][0] = c02 * invDeterminant;
+
+  out.rows[0][1] = (L[0][2] * L[2][1] - L[0][1] * L[2][2]) * invDeterminant;
+  out.rows[1][1] = (L[0][0] * L[2][2] - L[0][2] * L[2][0]) * invDeterminant;
+  out.rows[2][1] = (L[0][1] * L[2][0] - L[0][0] * L[2][1]) * invDeterminant;
+
+  out.rows[0][2] = (L[0][1] * L[1][2] - L[0][2] * L[1][1]) * invDeterminant;
+  out.rows[1][2] = (L[0][2] * L[1][0] - L[0][0] * L[1][2]) * invDeterminant;
+  out.rows[2][2] = (L[0][0] * L[1][1] - L[0][1] * L[1][0]) * invDeterminant;
+
+  // Undo the translation after the inverted linear part
+  for (unsigned j = 0; j < 3; j++) {
+    out.rows[j][3] = -(out.rows[j][0] * L[0][3] + out.rows[j][1] * L[1][3] + out.rows[j][2] * L[2][3]);
+  }
+
+  return out;
+}
+
+// Shared by the product and the batch kernels, so that each kernel inlines
+// it rather than calling out per transform
+static inline void compose(const AffineTransform& A, const AffineTransform& B, AffineTransform& out) {
+#if defined(__SSE2__)
+  // Each stored row of the result is a combination of the stored rows of A
+  // weighted by a stored row of B, with B's translation added to the last
+  // element
+  __m128 a0 = _mm_load_ps(A.rows[0]);
+  __m128 a1 = _mm_load_ps(A.rows[1]);
+  __m128 a2 = _mm_load_ps(A.rows[2]);
+  __m128 a3 = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+
+  for (unsigned j = 0; j < 3; j++) {
+    __m128 b = _mm_load_ps(B.rows[j]);
+
+    __m128 row = _mm_mul_ps(_mm_shuffle_ps(b, b, 0x00), a0);
+    row = _mm_add_ps(row, _mm_mul_ps(_mm_shuffle_ps(b, b, 0x55), a1));
+    row = _mm_add_ps(row, _mm_mul_ps(_mm_shuffle_ps(b, b, 0xaa), a2));
+    row = _mm_add_ps(row, _mm_mul_ps(_mm_shuffle_ps(b, b, 0xff), a3));
+
+    _mm_store_ps(out.rows[j], row);
+  }
+#else
+  for (unsigned j = 0; j < 3; j++) {
+    for (unsigned i = 0; i < 4; i++) {
+      out.rows[j][i] = B.rows[j][0] * A.rows[0][i] + B.rows[j][1] * A.rows[1][i] + B.rows[j][2] * A.rows[2][i];
+    }
+
+    out.rows[j][3] += B.rows[j][3];
+  }
+#endif
+}
+
+AffineTransform AffineTransform::operator*(const AffineTransform& B) const {
+  AffineTransform out;
+  compose(*this, B, out);
+
+  return out;
+}
+
+Vector AffineTransform::transformPoint(const Vector& p) const {
+  Vector out;
+
+#if defined(__SSE2__)
+  // Multiply the point into each stored row and sum across them by
+  // transposing, leaving the fourth lane zero
+  __m128 point = _mm_set_ps(1.0f, p.z, p.y, p.x);
+
+  __m128 r0 = _mm_mul_ps(point, _mm_load_ps(this->rows[0]));
+  __m128 r1 = _mm_mul_ps(point, _mm_load_ps(this->rows[1]));
+  __m128 r2 = _mm_mul_ps(point, _mm_load_ps(this->rows[2]));
+  __m128 r3 = _mm_setzero_ps();
+
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+  _mm_store_ps(&out.x, _mm_add_ps(_mm_add_ps(r0, r1), _mm_add_ps(r2, r3)));
+#else
+  out.x = p.x * this->rows[0][0] + p.y * this->rows[0][1] + p.z * this->rows[0][2] + this->rows[0][3];
+  out.y = p.x * this->rows[1][0] + p.y * this->rows[1][1] + p.z * this->rows[1][2] + this->rows[1][3];
+  out.z = p.x * this->rows[2][0] + p.y * this->rows[2][1] + p.z * this->rows[2][2] + this->rows[2][3];
+#endif
+
+  out.w = 1.0f;
+
+  return out;
+}
+
+Vector AffineTransform::transformVector(const Vector& v) const {
+  Vector out;
+
+  out.x = v.x * this->rows[0][0] + v.y * this->rows[0][1] + v.z * this->rows[0][2];
+  out.y = v.x * this->rows[1][0] + v.y * this->rows[1][1] + v.z * this->rows[1][2];
+  out.z = v.x * this->rows[2][0] + v.y * this->rows[2][1] + v.z * this->rows[2][2];
+  out.w = 0.0f;
+
+  return out;
+}
+
+std::string AffineTransform::toString() const {
+  return this->toMatrix().toString();
+}
+
+void Mortar::Math::composeHierarchy(const AffineTransform *locals, const int *parentIndices, unsigned jointCount, unsigned poseCount, AffineTransform *models) {
+  for (unsigned pose = 0; pose < poseCount; pose++) {
+    const AffineTransform *poseLocals = locals + pose * jointCount;
+    AffineTransform *poseModels = models + pose * jointCount;
+
+    // Parents precede their children, so each parent is final by the time
+    // it's read
+    for (unsigned i = 0; i < jointCount; i++) {
+      int parentIdx = parentIndices[i];
+
+      if (parentIdx == -1) {
+        poseModels[i] = poseLocals[i];
+      } else {
+        compose(poseLocals[i], poseModels[parentIdx], poseModels[i]);
+      }
+    }
+  }
+}
+
+void Mortar::Math::multiplyArrays(const AffineTransform *a, const AffineTransform *b, unsigned count, AffineTransform *out) {
+  for (unsigned i = 0; i < count; i++) {
+    compose(a[i], b[i], out[i]);
+  }
+}
+
+void Mortar::Math::multiplyArray(const AffineTransform *a, const AffineTransform& b, unsigned count, AffineTransform *out) {
+#if defined(__SSE2__)
+  // B is the same throughout, so its weights are broadcast once and only the
+  // rows of each A are loaded per transform
+  __m128 weights[3][4];
+  for (unsigned j = 0; j < 3; j++) {
+    for (unsigned k = 0; k < 4; k++) {
+      weights[j][k] = _mm_set1_ps(b.rows[j][k]);
+    }
+  }
+
+  __m128 a3 = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+
+  for (unsigned i = 0; i < count; i++) {
+    __m128 a0 = _mm_load_ps(a[i].rows[0]);
+    __m128 a1 = _mm_load_ps(a[i].rows[1]);
+    __m128 a2 = _mm_load_ps(a[i].rows[2]);
+
+    for (unsigned j = 0; j < 3; j++) {
+      __m128 row = _mm_mul_ps(weights[j][0], a0);
+      row = _mm_add_ps(row, _mm_mul_ps(weights[j][1], a1));
+      row = _mm_add_ps(row, _mm_mul_ps(weights[j][2], a2));
+      row = _mm_add_ps(row, _mm_mul_ps(weights[j][3], a3));
+
+      _mm_store_ps(out[i].rows[j], row);
+    }
+  }
+#else
+  for (unsigned i = 0; i < count; i++) {
+    compose(a[i], b, out[i]);
+  }
+#endif
+}
@@ -0,0 +1,83 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MORTAR_MATH_AFFINE_H
+#define MORTAR_MATH_AFFINE_H
+
+#include <string>
+
+#include "matrix.hpp"
+
+namespace Mortar::Math {
+  // An affine transformation stored as three columns of the equivalent
+  // matrix, dropping the last, which is always (0, 0, 0, 1). Each column is
+  // laid out as a row of four floats so that the storage can be uploaded
+  // directly as a GLSL mat3x4, under which v * M matches Vector * Matrix.
+  //
+  // Products follow Matrix, so a * b applies a and then b.
+  class alignas(16) AffineTransform {
+    public:
+      AffineTransform()
+        : rows {
+            { 1.0f, 0.0f, 0.0f, 0.0f },
+            { 0.0f, 1.0f, 0.0f, 0.0f },
+            { 0.0f, 0.0f, 1.0f, 0.0f }
+          } {};
+
+      // Drops the last column, which must be (0, 0, 0, 1)
+      static AffineTransform fromMatrix(const Matrix& M);
+
+      Matrix toMatrix() const;
+
+      Vector getTranslation() const;
+      void setTranslation(const Vector& translation);
+
+      // The transform must be invertible
+      AffineTransform inverse() const;
+
+      AffineTransform operator*(const AffineTransform& B) const;
+
+      // Transforms a point, including translation; the result has w of 1
+      Vector transformPoint(const Vector& p) const;
+
+      // Transforms a direction, ignoring translation; the result has w of 0
+      Vector transformVector(const Vector& v) const;
+
+      std::string toString() const;
+
+      // rows[j][i] is element (i, j) of the equivalent matrix
+      float rows[3][4];
+  };
+
+  // Batch kernels over contiguous arrays of transforms, as used for posing
+  // and skinning. Arrays of several actors may be passed back to back, and
+  // outputs must not overlap inputs.
+
+  // Composes local transforms down a hierarchy into model space, for
+  // poseCount poses of jointCount transforms each stored back to back. Every
+  // joint's parent index must be less than its own, or -1 for roots; the
+  // indices are shared by every pose.
+  void composeHierarchy(const AffineTransform *locals, const int *parentIndices, unsigned jointCount, unsigned poseCount, AffineTransform *models);
+
+  // out[i] = a[i] * b[i]
+  void multiplyArrays(const AffineTransform *a, const AffineTransform *b, unsigned count, AffineTransform *out);
+
+  // out[i] = a[i] * b
+  void multiplyArray(const AffineTransform *a, const AffineTransform& b, unsigned count, AffineTransform *out);
+}
+
+#endif
@@ -0,0 +1,206 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <math.h>
+#include <memory>
+#include <string.h>
+
+#include "bounds.hpp"
+
+using namespace Mortar::Math;
+
+Bounds Bounds::fromPoints(const std::vector<Vector>& points) {
+  Bounds out;
+
+  if (points.empty()) {
+    return out;
+  }
+
+  for (auto& point : points) {
+    out.minima.x = fmin(out.minima.x, point.x);
+    out.minima.y = fmin(out.minima.y, point.y);
+    out.minima.z = fmin(out.minima.z, point.z);
+
+    out.maxima.x = fmax(out.maxima.x, point.x);
+    out.maxima.y = fmax(out.maxima.y, point.y);
+    out.maxima.z = fmax(out.maxima.z, point.z);
+  }
+
+  out.center = (out.minima + out.maxima) * 0.5f;
+  out.center.w = 1.0f;
+
+  // Centering the sphere on the box and measuring the farthest point gives a
+  // tighter sphere than circumscribing the box
+  float radiusSquared = 0.0f;
+  for (auto& point : points) {
+    Vector offset = point - out.center;
+    offset.w = 0.0f;
+
+    radiusSquared = fmax(radiusSquared, Vector::dot(offset, offset));
+  }
+
+  out.radius = sqrt(radiusSquared);
+
+  return out;
+}
+
+bool Bounds::isEmpty() const {
+  return this->radius < 0.0f;
+}
+
+void Bounds::merge(const Bounds& other) {
+  if (other.isEmpty()) {
+    return;
+  }
+
+  if (this->isEmpty()) {
+    *this = other;
+    return;
+  }
+
+  this->minima.x = fmin(this->minima.x, other.minima.x);
+  this->minima.y = fmin(this->minima.y, other.minima.y);
+  this->minima.z = fmin(this->minima.z, other.minima.z);
+
+  this->maxima.x = fmax(this->maxima.x, other.maxima.x);
+  this->maxima.y = fmax(this->maxima.y, other.maxima.y);
+  this->maxima.z = fmax(this->maxima.z, other.maxima.z);
+
+  Vector offset = other.center - this->center;
+  offset.w = 0.0f;
+
+  float distance = offset.getMagnitude();
+
+  if (distance + other.radius <= this->radius) {
+    // Other sphere is already enclosed
+    return;
+  }
+
+  if (distance + this->radius <= other.radius) {
+    this->center = other.center;
+    this->radius = other.radius;
+    return;
+  }
+
+  float newRadius = (distance + this->radius + other.radius) * 0.5f;
+
+  this->center = this->center + offset * ((newRadius - this->radius) / distance);
+  this->center.w = 1.0f;
+  this->radius = newRadius;
+}
+
+// Returns an upper bound on how far a linear transformation can stretch any
+// vector. Its largest singular value is the square root of the largest
+// eigenvalue of L * L^T, which no absolute row sum of that product can fall
+// below. Row norms alone would only bound it from below, and shrink spheres
+// under rotations followed by non-uniform scales; this bound is exact for
+// rotations with uniform scale, where the product is diagonal.
+static float getMaxScale(const float linear[3][3]) {
+  float maxRowSum = 0.0f;
+
+  for (int i = 0; i < 3; i++) {
+    float rowSum = 0.0f;
+
+    for (int j = 0; j < 3; j++) {
+      rowSum += fabs(linear[i][0] * linear[j][0] + linear[i][1] * linear[j][1] + linear[i][2] * linear[j][2]);
+    }
+
+    maxRowSum = fmax(maxRowSum, rowSum);
+  }
+
+  return sqrt(maxRowSum);
+}
+
+Bounds Bounds::transform(const Matrix& M) const {
+  Bounds out;
+
+  if (this->isEmpty()) {
+    return out;
+  }
+
+  // Transform the box center and project its half-extents onto each new axis
+  Vector boxCenter = (this->minima + this->maxima) * 0.5f;
+  boxCenter.w = 1.0f;
+
+  Vector extents = (this->maxima - this->minima) * 0.5f;
+
+  Vector newCenter = boxCenter * M;
+
+  float newExtents[3];
+  for (int i = 0; i < 3; i++) {
+    newExtents[i] = fabs(M.m[0][i]) * extents.x + fabs(M.m[1][i]) * extents.y + fabs(M.m[2][i]) * extents.z;
+  }
+
+  out.minima = Vector { newCenter.x - newExtents[0], newCenter.y - newExtents[1], newCenter.z - newExtents[2], 1.0f };
+  out.maxima = Vector { newCenter.x + newExtents[0], newCenter.y + newExtents[1], newCenter.z + newExtents[2], 1.0f };
+
+  float linear[3][3];
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      linear[i][j] = M.m[i][j];
+    }
+  }
+
+  out.center = this->center * M;
+  out.center.w = 1.0f;
+  out.radius = this->radius * getMaxScale(linear);
+
+  return out;
+}
+
+Bounds Bounds::transform(const AffineTransform& A) const {
+  Bounds out;
+
+  if (this->isEmpty()) {
+    return out;
+  }
+
+  // As above, with each stored row of the transform holding one new axis
+  Vector boxCenter = (this->minima + this->maxima) * 0.5f;
+  Vector extents = (this->maxima - this->minima) * 0.5f;
+
+  Vector newCenter = A.transformPoint(boxCenter);
+
+  float newExtents[3];
+  for (int j = 0; j < 3; j++) {
+    newExtents[j] = fabs(A.rows[j][0]) * extents.x + fabs(A.rows[j][1]) * extents.y + fabs(A.rows[j][2]) * extents.z;
+  }
+
+  out.minima = Vector { newCenter.x - newExtents[0], newCenter.y - newExtents[1], newCenter.z - newExtents[2], 1.0f };
+  out.maxima = Vector { newCenter.x + newExtents[0], newCenter.y + newExtents[1], newCenter.z + newExtents[2], 1.0f };
+
+  // The stored rows are the transpose of the linear part, which stretches
+  // vectors by the same amounts
+  float linear[3][3];
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      linear[i][j] = A.rows[i][j];
+    }
+  }
+
+  out.center = A.transformPoint(this->center);
+  out.radius = this->radius * getMaxScale(linear);
+
+  return out;
+}
+
+std::string Bounds::toString() const {
+  std::unique_ptr<char []> buf(new char[512]);
+  sprintf(buf.get(), "min %s, max %s, center %s, radius %.4f", this->minima.toString().c_str(), this->maxima.toString().c_str(), this->center.toString().c_str(), this->radius);
+  size_t length = strlen(buf.get());
+  return std::string(buf.get(), buf.get() + length);
+}
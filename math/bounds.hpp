@@ -0,0 +1,59 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MORTAR_MATH_BOUNDS_H
+#define MORTAR_MATH_BOUNDS_H
+
+#include <string>
+#include <vector>
+
+#include "affine.hpp"
+#include "matrix.hpp"
+
+namespace Mortar::Math {
+  // Bounds track both an axis-aligned box and a bounding sphere, as the
+  // sphere is cheaper to test but the box is usually tighter
+  class Bounds {
+    public:
+      Bounds()
+        : minima { INFINITY, INFINITY, INFINITY, 1.0f },
+          maxima { -INFINITY, -INFINITY, -INFINITY, 1.0f },
+          center { 0.0f, 0.0f, 0.0f, 1.0f },
+          radius { -1.0f } {};
+
+      static Bounds fromPoints(const std::vector<Vector>& points);
+
+      bool isEmpty() const;
+
+      // Grows these bounds to enclose another set of bounds
+      void merge(const Bounds& other);
+
+      // Returns conservative bounds enclosing these bounds under an affine
+      // transformation
+      Bounds transform(const Matrix& M) const;
+      Bounds transform(const AffineTransform& A) const;
+
+      std::string toString() const;
+
+      Vector minima;
+      Vector maxima;
+
+      Vector center;
+      float radius;
+  };
+}
+
+#endif
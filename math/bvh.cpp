@@ -0,0 +1,200 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+
+#include "bvh.hpp"
+
+using namespace Mortar::Math;
+
+static const uint32_t MAX_LEAF_ITEMS = 4;
+
+// Squared distance from a point to the nearest point on a box, zero if the
+// point is inside
+static inline float getDistanceSquared(const Vector& point, const Vector& minima, const Vector& maxima) {
+  float dx = fmax(fmax(minima.x - point.x, point.x - maxima.x), 0.0f);
+  float dy = fmax(fmax(minima.y - point.y, point.y - maxima.y), 0.0f);
+  float dz = fmax(fmax(minima.z - point.z, point.z - maxima.z), 0.0f);
+
+  return dx * dx + dy * dy + dz * dz;
+}
+
+void BoundingVolumeHierarchy::build(const std::vector<Bounds>& itemBounds) {
+  this->nodes.clear();
+
+  std::vector<HierarchyItem> buildItems;
+  buildItems.reserve(itemBounds.size());
+
+  // Empty bounds can never be visible, so leave them out entirely
+  for (unsigned i = 0; i < itemBounds.size(); i++) {
+    if (!itemBounds[i].isEmpty()) {
+      HierarchyItem item;
+      item.setBounds(itemBounds[i].minima, itemBounds[i].maxima);
+      item.index = i;
+
+      buildItems.push_back(item);
+    }
+  }
+
+  if (!buildItems.empty()) {
+    this->nodes.reserve(2 * buildItems.size() / MAX_LEAF_ITEMS + 1);
+    this->buildNode(buildItems, 0, buildItems.size());
+  }
+
+  size_t itemCount = buildItems.size();
+
+  this->items.resize(itemCount);
+  this->sphereX.resize(itemCount);
+  this->sphereY.resize(itemCount);
+  this->sphereZ.resize(itemCount);
+  this->sphereRadius.resize(itemCount);
+  this->itemBounds.resize(itemCount);
+
+  for (size_t i = 0; i < itemCount; i++) {
+    const Bounds& bounds = itemBounds[buildItems[i].index];
+
+    this->items[i] = buildItems[i].index;
+    this->sphereX[i] = bounds.center.x;
+    this->sphereY[i] = bounds.center.y;
+    this->sphereZ[i] = bounds.center.z;
+    this->sphereRadius[i] = bounds.radius;
+    this->itemBounds[i] = bounds;
+  }
+}
+
+uint32_t BoundingVolumeHierarchy::buildNode(std::vector<HierarchyItem>& buildItems, uint32_t firstItem, uint32_t itemCount) {
+  uint32_t nodeIdx = this->nodes.size();
+  this->nodes.emplace_back();
+
+  Node node;
+  boundHierarchyItems(&buildItems[firstItem], itemCount, node.minima, node.maxima);
+  node.firstItem = firstItem;
+  node.itemCount = itemCount;
+  node.rightChild = 0;
+
+  this->nodes[nodeIdx] = node;
+
+  uint32_t leftCount = splitHierarchyItems(&buildItems[firstItem], itemCount, node.minima, node.maxima, MAX_LEAF_ITEMS);
+  if (leftCount == 0) {
+    return nodeIdx;
+  }
+
+  this->buildNode(buildItems, firstItem, leftCount);
+  uint32_t rightChild = this->buildNode(buildItems, firstItem + leftCount, itemCount - leftCount);
+
+  this->nodes[nodeIdx].rightChild = rightChild;
+
+  return nodeIdx;
+}
+
+bool BoundingVolumeHierarchy::isEmpty() const {
+  return this->nodes.empty();
+}
+
+void BoundingVolumeHierarchy::queryFrustum(const Frustum& frustum, std::vector<unsigned>& items) const {
+  if (this->nodes.empty()) {
+    return;
+  }
+
+  // Leaves may exceed the target size when no split could be found
+  uint8_t visible[MAX_LEAF_ITEMS * 4];
+
+  std::vector<uint32_t> stack { 0 };
+
+  while (!stack.empty()) {
+    uint32_t nodeIdx = stack.back();
+    stack.pop_back();
+
+    const Node& node = this->nodes[nodeIdx];
+
+    Vector minima { node.minima[0], node.minima[1], node.minima[2], 1.0f };
+    Vector maxima { node.maxima[0], node.maxima[1], node.maxima[2], 1.0f };
+
+    Frustum::Containment containment = frustum.containsBox(minima, maxima);
+
+    if (containment == Frustum::Containment::OUTSIDE) {
+      continue;
+    }
+
+    // Nothing below a node entirely inside the frustum needs testing
+    if (containment == Frustum::Containment::INSIDE) {
+      items.insert(items.end(), this->items.begin() + node.firstItem, this->items.begin() + node.firstItem + node.itemCount);
+      continue;
+    }
+
+    if (node.rightChild == 0) {
+      uint32_t first = node.firstItem;
+
+      frustum.intersectsSpheres(&this->sphereX[first], &this->sphereY[first], &this->sphereZ[first], &this->sphereRadius[first], node.itemCount, visible);
+
+      for (uint32_t i = 0; i < node.itemCount; i++) {
+        const Bounds& bounds = this->itemBounds[first + i];
+
+        if (visible[i] && frustum.intersectsBox(bounds.minima, bounds.maxima)) {
+          items.push_back(this->items[first + i]);
+        }
+      }
+
+      continue;
+    }
+
+    stack.push_back(node.rightChild);
+    stack.push_back(nodeIdx + 1);
+  }
+}
+
+void BoundingVolumeHierarchy::querySphere(const Vector& center, float radius, std::vector<unsigned>& items) const {
+  if (this->nodes.empty()) {
+    return;
+  }
+
+  float radiusSq = radius * radius;
+
+  std::vector<uint32_t> stack { 0 };
+
+  while (!stack.empty()) {
+    uint32_t nodeIdx = stack.back();
+    stack.pop_back();
+
+    const Node& node = this->nodes[nodeIdx];
+
+    Vector minima { node.minima[0], node.minima[1], node.minima[2], 1.0f };
+    Vector maxima { node.maxima[0], node.maxima[1], node.maxima[2], 1.0f };
+
+    if (getDistanceSquared(center, minima, maxima) > radiusSq) {
+      continue;
+    }
+
+    if (node.rightChild == 0) {
+      for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+        const Bounds& bounds = this->itemBounds[i];
+
+        if (getDistanceSquared(center, bounds.minima, bounds.maxima) <= radiusSq) {
+          items.push_back(this->items[i]);
+        }
+      }
+
+      continue;
+    }
+
+    stack.push_back(node.rightChild);
+    stack.push_back(nodeIdx + 1);
+  }
+}
+
+const std::vector<BoundingVolumeHierarchy::Node>& BoundingVolumeHierarchy::getNodes() const {
+  return this->nodes;
+}
@@ -0,0 +1,75 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MORTAR_MATH_BVH_H
+#define MORTAR_MATH_BVH_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "bounds.hpp"
+#include "frustum.hpp"
+#include "matrix.hpp"
+#include "sah.hpp"
+
+namespace Mortar::Math {
+  // A bounding volume hierarchy over a fixed set of items, each identified by
+  // its index in the bounds it was built from
+  class BoundingVolumeHierarchy {
+    public:
+      // Nodes are stored depth-first, so a node's left child immediately
+      // follows it; since items are reordered to match, every node also
+      // covers a contiguous range of items
+      class Node {
+        public:
+          float minima[3];
+          float maxima[3];
+
+          uint32_t firstItem;
+          uint32_t itemCount;
+
+          // Zero for leaves
+          uint32_t rightChild;
+      };
+
+      void build(const std::vector<Bounds>& itemBounds);
+
+      bool isEmpty() const;
+
+      // Appends the indices of items which may be visible; output order is
+      // not meaningful
+      void queryFrustum(const Frustum& frustum, std::vector<unsigned>& items) const;
+      void querySphere(const Vector& center, float radius, std::vector<unsigned>& items) const;
+
+      const std::vector<Node>& getNodes() const;
+
+    private:
+      uint32_t buildNode(std::vector<HierarchyItem>& buildItems, uint32_t firstItem, uint32_t itemCount);
+
+      std::vector<Node> nodes;
+      std::vector<unsigned> items;
+
+      // Item spheres in hierarchy order, stored component-wise so leaves can
+      // be tested in batches
+      std::vector<float> sphereX;
+      std::vector<float> sphereY;
+      std::vector<float> sphereZ;
+      std::vector<float> sphereRadius;
+      std::vector<Bounds> itemBounds;
+  };
+}
+
+#endif
@@ -0,0 +1,139 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#include "frustum.hpp"
+
+using namespace Mortar::Math;
+
+Frustum::Frustum(const Matrix& projView) {
+  // With row vectors, clip coordinates are the dot products of the position
+  // with each column; a point is inside when -w <= x, y, z <= w
+  for (unsigned i = 0; i < 3; i++) {
+    for (unsigned j = 0; j < 2; j++) {
+      unsigned plane = i * 2 + j;
+      float sign = j == 0 ? 1.0f : -1.0f;
+
+      this->a[plane] = projView.m[0][3] + sign * projView.m[0][i];
+      this->b[plane] = projView.m[1][3] + sign * projView.m[1][i];
+      this->c[plane] = projView.m[2][3] + sign * projView.m[2][i];
+      this->d[plane] = projView.m[3][3] + sign * projView.m[3][i];
+
+      float invMagnitude = 1.0f / sqrt(this->a[plane] * this->a[plane] + this->b[plane] * this->b[plane] + this->c[plane] * this->c[plane]);
+
+      this->a[plane] *= invMagnitude;
+      this->b[plane] *= invMagnitude;
+      this->c[plane] *= invMagnitude;
+      this->d[plane] *= invMagnitude;
+    }
+  }
+}
+
+bool Frustum::intersectsSphere(const Vector& center, float radius) const {
+  for (unsigned i = 0; i < PLANE_COUNT; i++) {
+    float distance = this->a[i] * center.x + this->b[i] * center.y + this->c[i] * center.z + this->d[i];
+    if (distance < -radius) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool Frustum::intersectsBox(const Vector& minima, const Vector& maxima) const {
+  for (unsigned i = 0; i < PLANE_COUNT; i++) {
+    // Test the corner farthest along the plane normal
+    float x = this->a[i] >= 0.0f ? maxima.x : minima.x;
+    float y = this->b[i] >= 0.0f ? maxima.y : minima.y;
+    float z = this->c[i] >= 0.0f ? maxima.z : minima.z;
+
+    if (this->a[i] * x + this->b[i] * y + this->c[i] * z + this->d[i] < 0.0f) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+Frustum::Containment Frustum::containsBox(const Vector& minima, const Vector& maxima) const {
+  Containment containment = Containment::INSIDE;
+
+  for (unsigned i = 0; i < PLANE_COUNT; i++) {
+    // The corner farthest along the plane normal determines whether the box
+    // is outside, the nearest whether it is entirely inside
+    float farX = this->a[i] >= 0.0f ? maxima.x : minima.x;
+    float farY = this->b[i] >= 0.0f ? maxima.y : minima.y;
+    float farZ = this->c[i] >= 0.0f ? maxima.z : minima.z;
+
+    if (this->a[i] * farX + this->b[i] * farY + this->c[i] * farZ + this->d[i] < 0.0f) {
+      return Containment::OUTSIDE;
+    }
+
+    float nearX = this->a[i] >= 0.0f ? minima.x : maxima.x;
+    float nearY = this->b[i] >= 0.0f ? minima.y : maxima.y;
+    float nearZ = this->c[i] >= 0.0f ? minima.z : maxima.z;
+
+    if (this->a[i] * nearX + this->b[i] * nearY + this->c[i] * nearZ + this->d[i] < 0.0f) {
+      containment = Containment::INTERSECTING;
+    }
+  }
+
+  return containment;
+}
+
+bool Frustum::intersects(const Bounds& bounds) const {
+  if (bounds.isEmpty()) {
+    return false;
+  }
+
+  return this->intersectsSphere(bounds.center, bounds.radius) && this->intersectsBox(bounds.minima, bounds.maxima);
+}
+
+void Frustum::intersectsSpheres(const float *x, const float *y, const float *z, const float *radius, size_t count, uint8_t *visible) const {
+  size_t i = 0;
+
+#if defined(__SSE__)
+  for (; i + 4 <= count; i += 4) {
+    __m128 sphereX = _mm_loadu_ps(x + i);
+    __m128 sphereY = _mm_loadu_ps(y + i);
+    __m128 sphereZ = _mm_loadu_ps(z + i);
+    __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+
+    __m128 outside = _mm_setzero_ps();
+    for (unsigned j = 0; j < PLANE_COUNT; j++) {
+      __m128 distance = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(this->a[j]), sphereX), _mm_mul_ps(_mm_set1_ps(this->b[j]), sphereY)),
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(this->c[j]), sphereZ), _mm_set1_ps(this->d[j])));
+
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negRadius));
+    }
+
+    int outsideMask = _mm_movemask_ps(outside);
+    for (unsigned j = 0; j < 4; j++) {
+      visible[i + j] = !(outsideMask & (1 << j));
+    }
+  }
+#endif
+
+  for (; i < count; i++) {
+    visible[i] = this->intersectsSphere(Vector { x[i], y[i], z[i], 1.0f }, radius[i]);
+  }
+}
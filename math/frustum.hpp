@@ -0,0 +1,64 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MORTAR_MATH_FRUSTUM_H
+#define MORTAR_MATH_FRUSTUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bounds.hpp"
+#include "matrix.hpp"
+
+namespace Mortar::Math {
+  class Frustum {
+    public:
+      enum class Containment {
+        OUTSIDE,
+        INTERSECTING,
+        INSIDE,
+      };
+
+      // Extracts the clipping planes from a combined view and projection
+      // transform, expecting OpenGL clip space conventions
+      Frustum(const Matrix& projView);
+
+      bool intersectsSphere(const Vector& center, float radius) const;
+      bool intersectsBox(const Vector& minima, const Vector& maxima) const;
+      bool intersects(const Bounds& bounds) const;
+
+      // Distinguishes boxes entirely inside the frustum from those crossing
+      // its boundary, allowing hierarchical tests to stop early
+      Containment containsBox(const Vector& minima, const Vector& maxima) const;
+
+      // Tests a batch of spheres laid out as separate coordinate arrays,
+      // writing a nonzero value to visible for each sphere at least partially
+      // inside the frustum
+      void intersectsSpheres(const float *x, const float *y, const float *z, const float *radius, size_t count, uint8_t *visible) const;
+
+    private:
+      static const unsigned PLANE_COUNT = 6;
+
+      // Planes are stored component-wise so that one plane's worth of a
+      // batch test can be done per instruction
+      float a[PLANE_COUNT];
+      float b[PLANE_COUNT];
+      float c[PLANE_COUNT];
+      float d[PLANE_COUNT];
+  };
+}
+
+#endif
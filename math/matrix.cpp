@@ -18,6 +18,10 @@
 #include <memory>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 #include "matrix.hpp"
 
 using namespace Mortar::Math;
@@ -29,6 +33,39 @@ Matrix::Matrix(std::array<float, 16> list)  {
 Matrix Matrix::operator*(const Matrix& B) const {
   Matrix out;
 
+#if defined(__AVX__)
+  // Each row of the result is a combination of the rows of B weighted by a
+  // row of A; two rows are produced at once, one per 128-bit lane
+  __m256 b0 = _mm256_broadcast_ps((const __m128 *)B.m[0]);
+  __m256 b1 = _mm256_broadcast_ps((const __m128 *)B.m[1]);
+  __m256 b2 = _mm256_broadcast_ps((const __m128 *)B.m[2]);
+  __m256 b3 = _mm256_broadcast_ps((const __m128 *)B.m[3]);
+
+  for (unsigned i = 0; i < 4; i += 2) {
+    __m256 a = _mm256_loadu_ps(this->m[i]);
+
+    __m256 row = _mm256_mul_ps(_mm256_permute_ps(a, 0x00), b0);
+    row = _mm256_add_ps(row, _mm256_mul_ps(_mm256_permute_ps(a, 0x55), b1));
+    row = _mm256_add_ps(row, _mm256_mul_ps(_mm256_permute_ps(a, 0xaa), b2));
+    row = _mm256_add_ps(row, _mm256_mul_ps(_mm256_permute_ps(a, 0xff), b3));
+
+    _mm256_storeu_ps(out.m[i], row);
+  }
+#elif defined(__SSE2__)
+  __m128 b0 = _mm_load_ps(B.m[0]);
+  __m128 b1 = _mm_load_ps(B.m[1]);
+  __m128 b2 = _mm_load_ps(B.m[2]);
+  __m128 b3 = _mm_load_ps(B.m[3]);
+
+  for (unsigned i = 0; i < 4; i++) {
+    __m128 row = _mm_mul_ps(_mm_set1_ps(this->m[i][0]), b0);
+    row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(this->m[i][1]), b1));
+    row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(this->m[i][2]), b2));
+    row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(this->m[i][3]), b3));
+
+    _mm_store_ps(out.m[i], row);
+  }
+#else
   out._11 = this->_11 * B._11 + this->_12 * B._21 + this->_13 * B._31 + this->_14 * B._41;
   out._12 = this->_11 * B._12 + this->_12 * B._22 + this->_13 * B._32 + this->_14 * B._42;
   out._13 = this->_11 * B._13 + this->_12 * B._23 + this->_13 * B._33 + this->_14 * B._43;
@@ -48,6 +85,7 @@ Matrix Matrix::operator*(const Matrix& B) const {
   out._42 = this->_41 * B._12 + this->_42 * B._22 + this->_43 * B._32 + this->_44 * B._42;
   out._43 = this->_41 * B._13 + this->_42 * B._23 + this->_43 * B._33 + this->_44 * B._43;
   out._44 = this->_41 * B._14 + this->_42 * B._24 + this->_43 * B._34 + this->_44 * B._44;
+#endif
 
   return out;
 }
@@ -177,6 +215,19 @@ void Matrix::translate(Vector translation) {
 }
 
 void Matrix::transpose() {
+#if defined(__SSE2__)
+  __m128 row0 = _mm_load_ps(this->m[0]);
+  __m128 row1 = _mm_load_ps(this->m[1]);
+  __m128 row2 = _mm_load_ps(this->m[2]);
+  __m128 row3 = _mm_load_ps(this->m[3]);
+
+  _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+
+  _mm_store_ps(this->m[0], row0);
+  _mm_store_ps(this->m[1], row1);
+  _mm_store_ps(this->m[2], row2);
+  _mm_store_ps(this->m[3], row3);
+#else
   float tmp;
 
   tmp = this->_12;
@@ -202,6 +253,126 @@ void Matrix::transpose() {
   tmp = this->_34;
   this->_34 = this->_43;
   this->_43 = tmp;
+#endif
+}
+
+#if defined(__SSE2__)
+// Helpers for treating each register as a row-major 2x2 matrix (a b; c d)
+#define SHUFFLE_MASK(x, y, z, w) ((x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
+#define SWIZZLE(v, x, y, z, w) _mm_shuffle_ps(v, v, SHUFFLE_MASK(x, y, z, w))
+
+// A * B
+static inline __m128 multiply2x2(__m128 A, __m128 B) {
+  return _mm_add_ps(_mm_mul_ps(A, SWIZZLE(B, 0, 3, 0, 3)), _mm_mul_ps(SWIZZLE(A, 1, 0, 3, 2), SWIZZLE(B, 2, 1, 2, 1)));
+}
+
+// adj(A) * B
+static inline __m128 adjugateMultiply2x2(__m128 A, __m128 B) {
+  return _mm_sub_ps(_mm_mul_ps(SWIZZLE(A, 3, 3, 0, 0), B), _mm_mul_ps(SWIZZLE(A, 1, 1, 2, 2), SWIZZLE(B, 2, 3, 0, 1)));
+}
+
+// A * adj(B)
+static inline __m128 multiplyAdjugate2x2(__m128 A, __m128 B) {
+  return _mm_sub_ps(_mm_mul_ps(A, SWIZZLE(B, 3, 0, 3, 0)), _mm_mul_ps(SWIZZLE(A, 1, 0, 3, 2), SWIZZLE(B, 2, 1, 2, 1)));
+}
+#endif
+
+Matrix Matrix::inverse() const {
+  Matrix out;
+
+#if defined(__SSE2__)
+  // Inverts blockwise, treating the matrix as 2x2 blocks (A B; C D) and
+  // building the blocks of the inverse from their adjugates
+  __m128 row0 = _mm_load_ps(this->m[0]);
+  __m128 row1 = _mm_load_ps(this->m[1]);
+  __m128 row2 = _mm_load_ps(this->m[2]);
+  __m128 row3 = _mm_load_ps(this->m[3]);
+
+  __m128 A = _mm_movelh_ps(row0, row1);
+  __m128 B = _mm_movehl_ps(row1, row0);
+  __m128 C = _mm_movelh_ps(row2, row3);
+  __m128 D = _mm_movehl_ps(row3, row2);
+
+  // Determinants of A, B, C and D
+  __m128 blockDeterminants = _mm_sub_ps(
+    _mm_mul_ps(_mm_shuffle_ps(row0, row2, SHUFFLE_MASK(0, 2, 0, 2)), _mm_shuffle_ps(row1, row3, SHUFFLE_MASK(1, 3, 1, 3))),
+    _mm_mul_ps(_mm_shuffle_ps(row0, row2, SHUFFLE_MASK(1, 3, 1, 3)), _mm_shuffle_ps(row1, row3, SHUFFLE_MASK(0, 2, 0, 2)))
+  );
+
+  __m128 detA = SWIZZLE(blockDeterminants, 0, 0, 0, 0);
+  __m128 detB = SWIZZLE(blockDeterminants, 1, 1, 1, 1);
+  __m128 detC = SWIZZLE(blockDeterminants, 2, 2, 2, 2);
+  __m128 detD = SWIZZLE(blockDeterminants, 3, 3, 3, 3);
+
+  __m128 adjDC = adjugateMultiply2x2(D, C);
+  __m128 adjAB = adjugateMultiply2x2(A, B);
+
+  // Adjugates of the inverse's blocks, before scaling by the determinant
+  __m128 X = _mm_sub_ps(_mm_mul_ps(detD, A), multiply2x2(B, adjDC));
+  __m128 W = _mm_sub_ps(_mm_mul_ps(detA, D), multiply2x2(C, adjAB));
+  __m128 Y = _mm_sub_ps(_mm_mul_ps(detB, C), multiplyAdjugate2x2(D, adjAB));
+  __m128 Z = _mm_sub_ps(_mm_mul_ps(detC, B), multiplyAdjugate2x2(A, adjDC));
+
+  // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+  __m128 trace = _mm_mul_ps(adjAB, SWIZZLE(adjDC, 0, 2, 1, 3));
+  trace = _mm_add_ps(trace, SWIZZLE(trace, 2, 3, 0, 1));
+  trace = _mm_add_ps(trace, SWIZZLE(trace, 1, 0, 3, 2));
+
+  __m128 det = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), trace);
+
+  // Taking the adjugate of each block negates its off-diagonal
+  __m128 invDet = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+
+  X = _mm_mul_ps(X, invDet);
+  Y = _mm_mul_ps(Y, invDet);
+  Z = _mm_mul_ps(Z, invDet);
+  W = _mm_mul_ps(W, invDet);
+
+  // Swapping each block's diagonal completes the adjugates
+  _mm_store_ps(out.m[0], _mm_shuffle_ps(X, Y, SHUFFLE_MASK(3, 1, 3, 1)));
+  _mm_store_ps(out.m[1], _mm_shuffle_ps(X, Y, SHUFFLE_MASK(2, 0, 2, 0)));
+  _mm_store_ps(out.m[2], _mm_shuffle_ps(Z, W, SHUFFLE_MASK(3, 1, 3, 1)));
+  _mm_store_ps(out.m[3], _mm_shuffle_ps(Z, W, SHUFFLE_MASK(2, 0, 2, 0)));
+#else
+  // Cofactors from the 2x2 minors of the top and bottom pairs of rows
+  float s0 = this->_11 * this->_22 - this->_21 * this->_12;
+  float s1 = this->_11 * this->_23 - this->_21 * this->_13;
+  float s2 = this->_11 * this->_24 - this->_21 * this->_14;
+  float s3 = this->_12 * this->_23 - this->_22 * this->_13;
+  float s4 = this->_12 * this->_24 - this->_22 * this->_14;
+  float s5 = this->_13 * this->_24 - this->_23 * this->_14;
+
+  float c5 = this->_33 * this->_44 - this->_43 * this->_34;
+  float c4 = this->_32 * this->_44 - this->_42 * this->_34;
+  float c3 = this->_32 * this->_43 - this->_42 * this->_33;
+  float c2 = this->_31 * this->_44 - this->_41 * this->_34;
+  float c1 = this->_31 * this->_43 - this->_41 * this->_33;
+  float c0 = this->_31 * this->_42 - this->_41 * this->_32;
+
+  float invDet = 1.0f / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+
+  out._11 = (this->_22 * c5 - this->_23 * c4 + this->_24 * c3) * invDet;
+  out._12 = (-this->_12 * c5 + this->_13 * c4 - this->_14 * c3) * invDet;
+  out._13 = (this->_42 * s5 - this->_43 * s4 + this->_44 * s3) * invDet;
+  out._14 = (-this->_32 * s5 + this->_33 * s4 - this->_34 * s3) * invDet;
+
+  out._21 = (-this->_21 * c5 + this->_23 * c2 - this->_24 * c1) * invDet;
+  out._22 = (this->_11 * c5 - this->_13 * c2 + this->_14 * c1) * invDet;
+  out._23 = (-this->_41 * s5 + this->_43 * s2 - this->_44 * s1) * invDet;
+  out._24 = (this->_31 * s5 - this->_33 * s2 + this->_34 * s1) * invDet;
+
+  out._31 = (this->_21 * c4 - this->_22 * c2 + this->_24 * c0) * invDet;
+  out._32 = (-this->_11 * c4 + this->_12 * c2 - this->_14 * c0) * invDet;
+  out._33 = (this->_41 * s4 - this->_42 * s2 + this->_44 * s0) * invDet;
+  out._34 = (-this->_31 * s4 + this->_32 * s2 - this->_34 * s0) * invDet;
+
+  out._41 = (-this->_21 * c3 + this->_22 * c1 - this->_23 * c0) * invDet;
+  out._42 = (this->_11 * c3 - this->_12 * c1 + this->_13 * c0) * invDet;
+  out._43 = (-this->_41 * s3 + this->_42 * s1 - this->_43 * s0) * invDet;
+  out._44 = (this->_31 * s3 - this->_32 * s1 + this->_33 * s0) * invDet;
+#endif
+
+  return out;
 }
 
 std::string Matrix::toString() {
@@ -247,10 +418,19 @@ Vector Vector::operator+(const Vector &b) const {
 Vector Vector::operator*(const Matrix &M) const {
   Vector out;
 
+#if defined(__SSE2__)
+  __m128 result = _mm_mul_ps(_mm_set1_ps(this->x), _mm_load_ps(M.m[0]));
+  result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(this->y), _mm_load_ps(M.m[1])));
+  result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(this->z), _mm_load_ps(M.m[2])));
+  result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(this->w), _mm_load_ps(M.m[3])));
+
+  _mm_store_ps(&out.x, result);
+#else
   out.x = this->x * M._11 + this->y * M._21 + this->z * M._31 + this->w * M._41;
   out.y = this->x * M._12 + this->y * M._22 + this->z * M._32 + this->w * M._42;
   out.z = this->x * M._13 + this->y * M._23 + this->z * M._33 + this->w * M._43;
   out.w = this->x * M._14 + this->y * M._24 + this->z * M._34 + this->w * M._44;
+#endif
 
   return out;
 }
@@ -27,7 +27,9 @@
 namespace Mortar::Math {
   class Matrix;
 
-  class Vector {
+  // Vectors and matrices are aligned so that rows can be loaded whole into
+  // vector registers
+  class alignas(16) Vector {
     public:
       Vector(float x, float y, float z, float w)
         : x { x }, y { y }, z { z }, w { w } {};
@@ -96,7 +98,7 @@ namespace Mortar::Math {
       float w;
   };
 
-  class Matrix {
+  class alignas(16) Matrix {
     public:
       Matrix()
         : Matrix {
@@ -142,6 +144,9 @@ namespace Mortar::Math {
 
       void transpose();
 
+      // General inverse by cofactors; the matrix must be invertible
+      Matrix inverse() const;
+
       Matrix operator*(const Matrix& B) const;
 
       const float *operator[](unsigned i) const;
@@ -0,0 +1,138 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <math.h>
+
+#include "quaternion.hpp"
+
+using namespace Mortar::Math;
+
+Quaternion Quaternion::fromMatrix(const Matrix& M) {
+  Quaternion out;
+
+  // Matrices transform row vectors, so the usual element pairs are swapped;
+  // pick whichever component is largest to avoid dividing by a small value
+  float trace = M._11 + M._22 + M._33;
+
+  if (trace > 0.0f) {
+    float s = sqrtf(trace + 1.0f) * 2.0f;
+
+    out.w = 0.25f * s;
+    out.x = (M._23 - M._32) / s;
+    out.y = (M._31 - M._13) / s;
+    out.z = (M._12 - M._21) / s;
+  } else if (M._11 > M._22 && M._11 > M._33) {
+    float s = sqrtf(1.0f + M._11 - M._22 - M._33) * 2.0f;
+
+    out.w = (M._23 - M._32) / s;
+    out.x = 0.25f * s;
+    out.y = (M._21 + M._12) / s;
+    out.z = (M._31 + M._13) / s;
+  } else if (M._22 > M._33) {
+    float s = sqrtf(1.0f + M._22 - M._11 - M._33) * 2.0f;
+
+    out.w = (M._31 - M._13) / s;
+    out.x = (M._21 + M._12) / s;
+    out.y = 0.25f * s;
+    out.z = (M._32 + M._23) / s;
+  } else {
+    float s = sqrtf(1.0f + M._33 - M._11 - M._22) * 2.0f;
+
+    out.w = (M._12 - M._21) / s;
+    out.x = (M._31 + M._13) / s;
+    out.y = (M._32 + M._23) / s;
+    out.z = 0.25f * s;
+  }
+
+  out.normalize();
+
+  return out;
+}
+
+Quaternion Quaternion::nlerp(const Quaternion& a, const Quaternion& b, float t) {
+  // q and -q are the same rotation; flip b if needed to take the short way
+  float sign = dot(a, b) < 0.0f ? -1.0f : 1.0f;
+
+  Quaternion out;
+  out.x = a.x + (sign * b.x - a.x) * t;
+  out.y = a.y + (sign * b.y - a.y) * t;
+  out.z = a.z + (sign * b.z - a.z) * t;
+  out.w = a.w + (sign * b.w - a.w) * t;
+
+  out.normalize();
+
+  return out;
+}
+
+void Quaternion::normalize() {
+  float invMagnitude = 1.0f / sqrtf(dot(*this, *this));
+
+  this->x *= invMagnitude;
+  this->y *= invMagnitude;
+  this->z *= invMagnitude;
+  this->w *= invMagnitude;
+}
+
+Quaternion Quaternion::operator*(const Quaternion& b) const {
+  // The Hamilton product b * a, which rotates by a and then by b
+  const Quaternion& a = *this;
+
+  return Quaternion(
+    b.w * a.x + b.x * a.w + b.y * a.z - b.z * a.y,
+    b.w * a.y - b.x * a.z + b.y * a.w + b.z * a.x,
+    b.w * a.z + b.x * a.y - b.y * a.x + b.z * a.w,
+    b.w * a.w - b.x * a.x - b.y * a.y - b.z * a.z);
+}
+
+Vector Quaternion::rotate(const Vector& v) const {
+  // v + 2w(q x v) + 2q x (q x v), with q the vector part
+  Vector axis (this->x, this->y, this->z, 0.0f);
+
+  Vector t = Vector::cross(axis, v) * 2.0f;
+  Vector out = v + t * this->w + Vector::cross(axis, t);
+  out.w = v.w;
+
+  return out;
+}
+
+Matrix Quaternion::toMatrix() const {
+  Matrix out;
+
+  float xx = this->x * this->x;
+  float yy = this->y * this->y;
+  float zz = this->z * this->z;
+  float xy = this->x * this->y;
+  float xz = this->x * this->z;
+  float yz = this->y * this->z;
+  float wx = this->w * this->x;
+  float wy = this->w * this->y;
+  float wz = this->w * this->z;
+
+  out._11 = 1.0f - 2.0f * (yy + zz);
+  out._12 = 2.0f * (xy + wz);
+  out._13 = 2.0f * (xz - wy);
+
+  out._21 = 2.0f * (xy - wz);
+  out._22 = 1.0f - 2.0f * (xx + zz);
+  out._23 = 2.0f * (yz + wx);
+
+  out._31 = 2.0f * (xz + wy);
+  out._32 = 2.0f * (yz - wx);
+  out._33 = 1.0f - 2.0f * (xx + yy);
+
+  return out;
+}
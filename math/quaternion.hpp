@@ -0,0 +1,62 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MORTAR_MATH_QUATERNION_H
+#define MORTAR_MATH_QUATERNION_H
+
+#include "matrix.hpp"
+
+namespace Mortar::Math {
+  // Unit quaternion representing a rotation, following the same row vector
+  // convention as Matrix
+  class Quaternion {
+    public:
+      Quaternion(float x, float y, float z, float w)
+        : x { x }, y { y }, z { z }, w { w } {};
+
+      Quaternion()
+        : Quaternion { 0.0f, 0.0f, 0.0f, 1.0f } {};
+
+      // Extracts the rotation from the upper 3x3 of a matrix, which must be
+      // orthonormal
+      static Quaternion fromMatrix(const Matrix& M);
+
+      static inline float dot(const Quaternion& a, const Quaternion& b) {
+        return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+      }
+
+      // Normalized linear interpolation along the shorter arc
+      static Quaternion nlerp(const Quaternion& a, const Quaternion& b, float t);
+
+      void normalize();
+
+      // As with matrices, a * b applies a's rotation first and then b's
+      Quaternion operator*(const Quaternion& b) const;
+
+      // Rotates a row vector, as multiplying it by toMatrix() would
+      Vector rotate(const Vector& v) const;
+
+      Matrix toMatrix() const;
+
+      float x;
+      float y;
+      float z;
+      float w;
+  };
+}
+
+#endif
@@ -0,0 +1,201 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <math.h>
+
+#include "sah.hpp"
+
+using namespace Mortar::Math;
+
+static const unsigned SAH_BIN_COUNT = 12;
+
+// Relative costs of descending into a node versus testing a single item
+static const float TRAVERSAL_COST = 1.0f;
+static const float INTERSECTION_COST = 1.0f;
+
+static inline float getSurfaceArea(const float *minima, const float *maxima) {
+  float dx = maxima[0] - minima[0];
+  float dy = maxima[1] - minima[1];
+  float dz = maxima[2] - minima[2];
+
+  return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+static inline void growBox(float *minima, float *maxima, const float *otherMinima, const float *otherMaxima) {
+  for (unsigned axis = 0; axis < 3; axis++) {
+    minima[axis] = fmin(minima[axis], otherMinima[axis]);
+    maxima[axis] = fmax(maxima[axis], otherMaxima[axis]);
+  }
+}
+
+static inline void resetBox(float *minima, float *maxima) {
+  for (unsigned axis = 0; axis < 3; axis++) {
+    minima[axis] = INFINITY;
+    maxima[axis] = -INFINITY;
+  }
+}
+
+static inline unsigned getBin(float value, float axisMin, float binScale) {
+  return std::min((unsigned)((value - axisMin) * binScale), SAH_BIN_COUNT - 1);
+}
+
+void HierarchyItem::setBounds(const Vector& minima, const Vector& maxima) {
+  this->minima[0] = minima.x;
+  this->minima[1] = minima.y;
+  this->minima[2] = minima.z;
+  this->maxima[0] = maxima.x;
+  this->maxima[1] = maxima.y;
+  this->maxima[2] = maxima.z;
+
+  for (unsigned axis = 0; axis < 3; axis++) {
+    this->centroid[axis] = (this->minima[axis] + this->maxima[axis]) * 0.5f;
+  }
+}
+
+void Mortar::Math::boundHierarchyItems(const HierarchyItem *items, uint32_t count, float *minima, float *maxima) {
+  resetBox(minima, maxima);
+
+  for (uint32_t i = 0; i < count; i++) {
+    growBox(minima, maxima, items[i].minima, items[i].maxima);
+  }
+}
+
+uint32_t Mortar::Math::splitHierarchyItems(HierarchyItem *items, uint32_t count, const float *minima, const float *maxima, uint32_t maxLeafItems) {
+  if (count <= maxLeafItems) {
+    return 0;
+  }
+
+  HierarchyItem *first = items;
+  HierarchyItem *last = items + count;
+
+  float centroidMinima[3];
+  float centroidMaxima[3];
+
+  resetBox(centroidMinima, centroidMaxima);
+
+  for (HierarchyItem *item = first; item != last; item++) {
+    growBox(centroidMinima, centroidMaxima, item->centroid, item->centroid);
+  }
+
+  float bestCost = INFINITY;
+  unsigned bestAxis = 0;
+  unsigned bestBin = 0;
+
+  for (unsigned axis = 0; axis < 3; axis++) {
+    float axisMin = centroidMinima[axis];
+    float axisMax = centroidMaxima[axis];
+
+    if (axisMax <= axisMin) {
+      continue;
+    }
+
+    float binScale = SAH_BIN_COUNT / (axisMax - axisMin);
+
+    float binMinima[SAH_BIN_COUNT][3];
+    float binMaxima[SAH_BIN_COUNT][3];
+    uint32_t binCounts[SAH_BIN_COUNT] = {};
+
+    for (unsigned bin = 0; bin < SAH_BIN_COUNT; bin++) {
+      resetBox(binMinima[bin], binMaxima[bin]);
+    }
+
+    for (HierarchyItem *item = first; item != last; item++) {
+      unsigned bin = getBin(item->centroid[axis], axisMin, binScale);
+
+      binCounts[bin]++;
+      growBox(binMinima[bin], binMaxima[bin], item->minima, item->maxima);
+    }
+
+    // Sweep from the right to accumulate the cost of each right-hand side,
+    // then from the left to combine with each left-hand side
+    float rightAreas[SAH_BIN_COUNT];
+    uint32_t rightCounts[SAH_BIN_COUNT];
+
+    float sweepMinima[3];
+    float sweepMaxima[3];
+    uint32_t sweepCount = 0;
+
+    resetBox(sweepMinima, sweepMaxima);
+
+    for (unsigned bin = SAH_BIN_COUNT - 1; bin > 0; bin--) {
+      growBox(sweepMinima, sweepMaxima, binMinima[bin], binMaxima[bin]);
+      sweepCount += binCounts[bin];
+
+      rightAreas[bin] = sweepCount ? getSurfaceArea(sweepMinima, sweepMaxima) : 0.0f;
+      rightCounts[bin] = sweepCount;
+    }
+
+    resetBox(sweepMinima, sweepMaxima);
+    sweepCount = 0;
+
+    for (unsigned bin = 0; bin < SAH_BIN_COUNT - 1; bin++) {
+      growBox(sweepMinima, sweepMaxima, binMinima[bin], binMaxima[bin]);
+      sweepCount += binCounts[bin];
+
+      if (sweepCount == 0 || rightCounts[bin + 1] == 0) {
+        continue;
+      }
+
+      float cost = sweepCount * getSurfaceArea(sweepMinima, sweepMaxima) + rightCounts[bin + 1] * rightAreas[bin + 1];
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestAxis = axis;
+        bestBin = bin;
+      }
+    }
+  }
+
+  float parentArea = getSurfaceArea(minima, maxima);
+
+  // Costs above are unnormalized, so scale by the parent's area before
+  // comparing against leaving the run as a leaf
+  float leafCost = count * INTERSECTION_COST;
+  float splitCost = parentArea > 0.0f ? TRAVERSAL_COST + INTERSECTION_COST * bestCost / parentArea : INFINITY;
+
+  if (bestCost < INFINITY && splitCost < leafCost) {
+    float axisMin = centroidMinima[bestAxis];
+    float binScale = SAH_BIN_COUNT / (centroidMaxima[bestAxis] - axisMin);
+
+    HierarchyItem *middle = std::partition(first, last, [&] (const HierarchyItem& item) {
+      return getBin(item.centroid[bestAxis], axisMin, binScale) <= bestBin;
+    });
+
+    return middle - first;
+  }
+
+  if (count > maxLeafItems * 4) {
+    // Splitting looks no better than a leaf, but a huge leaf would defeat the
+    // hierarchy, so fall back to a median split along the widest axis
+    unsigned axis = 0;
+    float widest = -1.0f;
+    for (unsigned i = 0; i < 3; i++) {
+      if (maxima[i] - minima[i] > widest) {
+        widest = maxima[i] - minima[i];
+        axis = i;
+      }
+    }
+
+    HierarchyItem *middle = first + count / 2;
+    std::nth_element(first, middle, last, [&] (const HierarchyItem& a, const HierarchyItem& b) {
+      return a.centroid[axis] < b.centroid[axis];
+    });
+
+    return middle - first;
+  }
+
+  return 0;
+}
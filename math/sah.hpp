@@ -0,0 +1,51 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MORTAR_MATH_SAH_H
+#define MORTAR_MATH_SAH_H
+
+#include <stdint.h>
+
+#include "matrix.hpp"
+
+namespace Mortar::Math {
+  // An item being sorted into a bounding volume hierarchy, known only by its
+  // box and its index in whatever the hierarchy is built from
+  class HierarchyItem {
+    public:
+      // Sets the box, placing the centroid at its center
+      void setBounds(const Vector& minima, const Vector& maxima);
+
+      float minima[3];
+      float maxima[3];
+      float centroid[3];
+
+      uint32_t index;
+  };
+
+  // Finds the box enclosing a run of items
+  void boundHierarchyItems(const HierarchyItem *items, uint32_t count, float *minima, float *maxima);
+
+  // Partitions a run of items bounded by minima and maxima in place for
+  // splitting into two children, choosing the split by binning centroids
+  // along each axis and evaluating the surface area heuristic at each bin
+  // boundary. Returns the number of items in the left child, or zero if the
+  // run is better left as a leaf; runs of more than four times maxLeafItems
+  // are always split, so no leaf grows beyond that.
+  uint32_t splitHierarchyItems(HierarchyItem *items, uint32_t count, const float *minima, const float *maxima, uint32_t maxLeafItems);
+}
+
+#endif
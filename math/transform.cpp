@@ -0,0 +1,145 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <math.h>
+
+#include "transform.hpp"
+
+using namespace Mortar::Math;
+
+// Relative tolerance for treating rows as orthogonal or scales as equal
+static const float DECOMPOSE_EPSILON = 1e-4f;
+
+bool Transform::canDecompose(const Matrix& M, bool requireUniformScale) {
+  if (M._14 != 0.0f || M._24 != 0.0f || M._34 != 0.0f || M._44 != 1.0f) {
+    return false;
+  }
+
+  Vector rows[3] {
+    Vector(M._11, M._12, M._13, 0.0f),
+    Vector(M._21, M._22, M._23, 0.0f),
+    Vector(M._31, M._32, M._33, 0.0f),
+  };
+
+  float lengths[3];
+  for (int i = 0; i < 3; i++) {
+    lengths[i] = rows[i].getMagnitude();
+
+    if (lengths[i] == 0.0f) {
+      return false;
+    }
+  }
+
+  // A uniformly scaled reflection still can't be moved past a rotation
+  if (requireUniformScale && Vector::dot(Vector::cross(rows[0], rows[1]), rows[2]) < 0.0f) {
+    return false;
+  }
+
+  for (int i = 0; i < 3; i++) {
+    int j = (i + 1) % 3;
+
+    if (fabs(Vector::dot(rows[i], rows[j])) > DECOMPOSE_EPSILON * lengths[i] * lengths[j]) {
+      return false;
+    }
+
+    if (requireUniformScale && fabs(lengths[i] - lengths[j]) > DECOMPOSE_EPSILON * fmax(lengths[i], lengths[j])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+Transform Transform::fromMatrix(const Matrix& M) {
+  Transform out;
+
+  out.scale.x = sqrtf(M._11 * M._11 + M._12 * M._12 + M._13 * M._13);
+  out.scale.y = sqrtf(M._21 * M._21 + M._22 * M._22 + M._23 * M._23);
+  out.scale.z = sqrtf(M._31 * M._31 + M._32 * M._32 + M._33 * M._33);
+
+  Matrix rotation;
+  for (int i = 0; i < 3; i++) {
+    float invScale = 1.0f / (&out.scale.x)[i];
+
+    for (int j = 0; j < 3; j++) {
+      rotation.m[i][j] = M.m[i][j] * invScale;
+    }
+  }
+
+  // A reflection can't be expressed as a rotation, so carry it in the scale
+  Vector xAxis (rotation._11, rotation._12, rotation._13, 0.0f);
+  Vector yAxis (rotation._21, rotation._22, rotation._23, 0.0f);
+  Vector zAxis (rotation._31, rotation._32, rotation._33, 0.0f);
+  if (Vector::dot(Vector::cross(xAxis, yAxis), zAxis) < 0.0f) {
+    out.scale.z = -out.scale.z;
+
+    rotation._31 = -rotation._31;
+    rotation._32 = -rotation._32;
+    rotation._33 = -rotation._33;
+  }
+
+  out.rotation = Quaternion::fromMatrix(rotation);
+  out.translation = Vector(M._41, M._42, M._43, 1.0f);
+
+  return out;
+}
+
+bool Transform::hasUniformScale() const {
+  float largest = fmax(fabs(this->scale.x), fmax(fabs(this->scale.y), fabs(this->scale.z)));
+  float tolerance = DECOMPOSE_EPSILON * largest;
+
+  return fabs(this->scale.x - this->scale.y) <= tolerance && fabs(this->scale.y - this->scale.z) <= tolerance;
+}
+
+Transform Transform::operator*(const Transform& parent) const {
+  Transform out;
+
+  out.rotation = this->rotation * parent.rotation;
+  out.scale = Vector(this->scale.x * parent.scale.x, this->scale.y * parent.scale.x, this->scale.z * parent.scale.x, 0.0f);
+
+  Vector scaledTranslation (this->translation.x * parent.scale.x, this->translation.y * parent.scale.y, this->translation.z * parent.scale.z, 1.0f);
+  out.translation = parent.rotation.rotate(scaledTranslation) + parent.translation;
+  out.translation.w = 1.0f;
+
+  return out;
+}
+
+Matrix Transform::toMatrix() const {
+  Matrix out = this->rotation.toMatrix();
+
+  out.scale(this->scale.x, this->scale.y, this->scale.z);
+  out.setTranslation(this->translation);
+
+  return out;
+}
+
+AffineTransform Transform::toAffine() const {
+  AffineTransform out;
+  Matrix rotation = this->rotation.toMatrix();
+
+  const float scale[3] = { this->scale.x, this->scale.y, this->scale.z };
+
+  for (unsigned j = 0; j < 3; j++) {
+    for (unsigned i = 0; i < 3; i++) {
+      out.rows[j][i] = rotation.m[i][j] * scale[i];
+    }
+  }
+
+  out.setTranslation(this->translation);
+
+  return out;
+}
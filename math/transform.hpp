@@ -0,0 +1,57 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MORTAR_MATH_TRANSFORM_H
+#define MORTAR_MATH_TRANSFORM_H
+
+#include "affine.hpp"
+#include "matrix.hpp"
+#include "quaternion.hpp"
+
+namespace Mortar::Math {
+  // Scale, then rotation, then translation; equivalent to an affine matrix
+  // whose rows are orthogonal
+  class Transform {
+    public:
+      Transform()
+        : translation { 0.0f, 0.0f, 0.0f, 1.0f },
+          scale { 1.0f, 1.0f, 1.0f, 0.0f } {};
+
+      // Whether a matrix is affine with orthogonal rows, and so can be
+      // represented exactly; if requireUniformScale is set, the rows must
+      // also be of equal length
+      static bool canDecompose(const Matrix& M, bool requireUniformScale);
+
+      static Transform fromMatrix(const Matrix& M);
+
+      bool hasUniformScale() const;
+
+      // Applies this transform and then the parent's, matching the matrix
+      // product; exact only when the parent's scale is uniform
+      Transform operator*(const Transform& parent) const;
+
+      // Produces an affine matrix, leaving the last column as (0, 0, 0, 1)
+      Matrix toMatrix() const;
+      AffineTransform toAffine() const;
+
+      Quaternion rotation;
+      Vector translation;
+      Vector scale;
+  };
+}
+
+#endif
@@ -0,0 +1,880 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <math.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#include "trianglebvh.hpp"
+
+using namespace Mortar::Math;
+
+static const uint32_t MAX_LEAF_TRIANGLES = 4;
+
+// Nodes this deep are left as leaves whatever their size, which bounds the
+// stack queries need
+static const unsigned MAX_DEPTH = 64;
+
+// Subtrees smaller than this are never worth handing to another thread
+static const uint32_t MIN_PARALLEL_TRIANGLES = 4096;
+
+static const uint32_t NO_SUBTREE = UINT32_MAX;
+
+// Triangles whose determinant against a ray is smaller than this are treated
+// as parallel to it
+static const float DETERMINANT_EPSILON = 1e-12f;
+
+// A part of the hierarchy built separately, to be spliced in place of a leaf
+// of the top of the hierarchy once complete
+struct Subtree {
+  uint32_t nodeIdx;
+  uint32_t firstTriangle;
+  uint32_t triangleCount;
+  unsigned depth;
+
+  std::vector<TriangleHierarchy::Node> nodes;
+};
+
+// Queries keep the distance at which each deferred node was reached, so that
+// nodes beyond a hit found in the meantime can be skipped
+struct StackEntry {
+  uint32_t nodeIdx;
+  float distance;
+};
+
+static inline float dot3(const Vector& a, const Vector& b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static uint32_t buildNode(std::vector<TriangleHierarchy::Node>& nodes, HierarchyItem *triangles, uint32_t firstTriangle, uint32_t triangleCount, unsigned depth, uint32_t parallelThreshold, std::vector<Subtree> *subtrees) {
+  uint32_t nodeIdx = nodes.size();
+  nodes.emplace_back();
+
+  TriangleHierarchy::Node& node = nodes[nodeIdx];
+  boundHierarchyItems(triangles + firstTriangle, triangleCount, node.minima, node.maxima);
+  node.firstTriangle = firstTriangle;
+  node.triangleCount = triangleCount;
+  node.rightChild = 0;
+
+  if (triangleCount <= MAX_LEAF_TRIANGLES || depth + 1 >= MAX_DEPTH) {
+    return nodeIdx;
+  }
+
+  if (subtrees && triangleCount <= parallelThreshold) {
+    subtrees->push_back(Subtree { nodeIdx, firstTriangle, triangleCount, depth, {} });
+    return nodeIdx;
+  }
+
+  uint32_t leftCount = splitHierarchyItems(triangles + firstTriangle, triangleCount, node.minima, node.maxima, MAX_LEAF_TRIANGLES);
+  if (leftCount == 0) {
+    return nodeIdx;
+  }
+
+  buildNode(nodes, triangles, firstTriangle, leftCount, depth + 1, parallelThreshold, subtrees);
+  uint32_t rightChild = buildNode(nodes, triangles, firstTriangle + leftCount, triangleCount - leftCount, depth + 1, parallelThreshold, subtrees);
+
+  nodes[nodeIdx].rightChild = rightChild;
+
+  return nodeIdx;
+}
+
+// Copies the top of the hierarchy depth-first, replacing each leaf that was
+// deferred with its separately built subtree
+static void appendNodes(std::vector<TriangleHierarchy::Node>& nodes, const std::vector<TriangleHierarchy::Node>& topNodes, uint32_t topIdx, const std::vector<uint32_t>& nodeSubtrees, const std::vector<Subtree>& subtrees) {
+  if (nodeSubtrees[topIdx] != NO_SUBTREE) {
+    uint32_t base = nodes.size();
+
+    for (auto node : subtrees[nodeSubtrees[topIdx]].nodes) {
+      if (node.rightChild != 0) {
+        node.rightChild += base;
+      }
+
+      nodes.push_back(node);
+    }
+
+    return;
+  }
+
+  uint32_t nodeIdx = nodes.size();
+  nodes.push_back(topNodes[topIdx]);
+
+  if (topNodes[topIdx].rightChild == 0) {
+    return;
+  }
+
+  appendNodes(nodes, topNodes, topIdx + 1, nodeSubtrees, subtrees);
+  nodes[nodeIdx].rightChild = nodes.size();
+  appendNodes(nodes, topNodes, topNodes[topIdx].rightChild, nodeSubtrees, subtrees);
+}
+
+void TriangleHierarchy::build(const std::vector<Vector>& positions, const std::vector<uint32_t>& indices, WorkerPool& workers) {
+  this->nodes.clear();
+
+  std::vector<HierarchyItem> buildTriangles;
+  buildTriangles.reserve(indices.size() / 3);
+
+  for (unsigned i = 0; i + 2 < indices.size(); i += 3) {
+    const Vector& a = positions[indices[i]];
+    const Vector& b = positions[indices[i + 1]];
+    const Vector& c = positions[indices[i + 2]];
+
+    Vector minima { fminf(fminf(a.x, b.x), c.x), fminf(fminf(a.y, b.y), c.y), fminf(fminf(a.z, b.z), c.z), 1.0f };
+    Vector maxima { fmaxf(fmaxf(a.x, b.x), c.x), fmaxf(fmaxf(a.y, b.y), c.y), fmaxf(fmaxf(a.z, b.z), c.z), 1.0f };
+
+    HierarchyItem triangle;
+    triangle.setBounds(minima, maxima);
+    triangle.index = i / 3;
+
+    buildTriangles.push_back(triangle);
+  }
+
+  if (!buildTriangles.empty()) {
+    // Aim for several subtrees per thread, as they're rarely of equal cost
+    uint32_t parallelThreshold = 0;
+    if (workers.getConcurrency() > 1) {
+      parallelThreshold = std::max<uint32_t>(buildTriangles.size() / (workers.getConcurrency() * 4), MIN_PARALLEL_TRIANGLES);
+    }
+
+    std::vector<Node> topNodes;
+    std::vector<Subtree> subtrees;
+
+    buildNode(topNodes, buildTriangles.data(), 0, buildTriangles.size(), 0, parallelThreshold, parallelThreshold ? &subtrees : nullptr);
+
+    // Subtrees cover disjoint ranges of triangles, so they can be built and
+    // partitioned in place concurrently
+    workers.run(subtrees.size(), [&] (unsigned i) {
+      Subtree& subtree = subtrees[i];
+      buildNode(subtree.nodes, buildTriangles.data(), subtree.firstTriangle, subtree.triangleCount, subtree.depth, 0, nullptr);
+    });
+
+    if (subtrees.empty()) {
+      this->nodes = std::move(topNodes);
+    } else {
+      std::vector<uint32_t> nodeSubtrees (topNodes.size(), NO_SUBTREE);
+      size_t nodeCount = topNodes.size();
+
+      for (unsigned i = 0; i < subtrees.size(); i++) {
+        nodeSubtrees[subtrees[i].nodeIdx] = i;
+        nodeCount += subtrees[i].nodes.size() - 1;
+      }
+
+      this->nodes.reserve(nodeCount);
+      appendNodes(this->nodes, topNodes, 0, nodeSubtrees, subtrees);
+    }
+  }
+
+  size_t triangleCount = buildTriangles.size();
+
+  this->v0X.resize(triangleCount);
+  this->v0Y.resize(triangleCount);
+  this->v0Z.resize(triangleCount);
+  this->e1X.resize(triangleCount);
+  this->e1Y.resize(triangleCount);
+  this->e1Z.resize(triangleCount);
+  this->e2X.resize(triangleCount);
+  this->e2Y.resize(triangleCount);
+  this->e2Z.resize(triangleCount);
+  this->triangles.resize(triangleCount);
+
+  for (size_t i = 0; i < triangleCount; i++) {
+    uint32_t index = buildTriangles[i].index;
+
+    const Vector& a = positions[indices[index * 3]];
+    const Vector& b = positions[indices[index * 3 + 1]];
+    const Vector& c = positions[indices[index * 3 + 2]];
+
+    this->v0X[i] = a.x;
+    this->v0Y[i] = a.y;
+    this->v0Z[i] = a.z;
+    this->e1X[i] = b.x - a.x;
+    this->e1Y[i] = b.y - a.y;
+    this->e1Z[i] = b.z - a.z;
+    this->e2X[i] = c.x - a.x;
+    this->e2Y[i] = c.y - a.y;
+    this->e2Z[i] = c.z - a.z;
+
+    this->triangles[i] = index;
+  }
+}
+
+bool TriangleHierarchy::isEmpty() const {
+  return this->nodes.empty();
+}
+
+unsigned TriangleHierarchy::getTriangleCount() const {
+  return this->triangles.size();
+}
+
+const std::vector<TriangleHierarchy::Node>& TriangleHierarchy::getNodes() const {
+  return this->nodes;
+}
+
+void TriangleHierarchy::getVertices(uint32_t idx, Vector& a, Vector& b, Vector& c) const {
+  a = Vector { this->v0X[idx], this->v0Y[idx], this->v0Z[idx], 1.0f };
+  b = Vector { a.x + this->e1X[idx], a.y + this->e1Y[idx], a.z + this->e1Z[idx], 1.0f };
+  c = Vector { a.x + this->e2X[idx], a.y + this->e2Y[idx], a.z + this->e2Z[idx], 1.0f };
+}
+
+Vector TriangleHierarchy::getNormal(uint32_t idx) const {
+  Vector e1 { this->e1X[idx], this->e1Y[idx], this->e1Z[idx], 0.0f };
+  Vector e2 { this->e2X[idx], this->e2Y[idx], this->e2Z[idx], 0.0f };
+
+  return Vector::normalize(Vector::cross(e1, e2));
+}
+
+// Returns the distance at which a ray enters a node's box grown by padding,
+// or INFINITY if it doesn't within maxDistance
+static inline float intersectBox(const TriangleHierarchy::Node& node, const float *origin, const float *invDirection, float padding, float maxDistance) {
+  float tMin = 0.0f;
+  float tMax = maxDistance;
+
+  for (unsigned axis = 0; axis < 3; axis++) {
+    float t0 = (node.minima[axis] - padding - origin[axis]) * invDirection[axis];
+    float t1 = (node.maxima[axis] + padding - origin[axis]) * invDirection[axis];
+
+    if (invDirection[axis] < 0.0f) {
+      std::swap(t0, t1);
+    }
+
+    // Rays lying exactly on a slab produce NaN, which fmaxf and fminf ignore
+    tMin = fmaxf(t0, tMin);
+    tMax = fminf(t1, tMax);
+  }
+
+  return tMin <= tMax ? tMin : INFINITY;
+}
+
+// Squared distance from a point to the nearest point on a node's box, zero
+// if the point is inside
+static inline float getDistanceSquared(const TriangleHierarchy::Node& node, const float *point) {
+  float distanceSq = 0.0f;
+
+  for (unsigned axis = 0; axis < 3; axis++) {
+    float d = fmax(fmax(node.minima[axis] - point[axis], point[axis] - node.maxima[axis]), 0.0f);
+    distanceSq += d * d;
+  }
+
+  return distanceSq;
+}
+
+static inline bool intersectTriangle(const Vector& origin, const Vector& direction, const float *v0, const float *e1, const float *e2, float& t) {
+  float px = direction.y * e2[2] - direction.z * e2[1];
+  float py = direction.z * e2[0] - direction.x * e2[2];
+  float pz = direction.x * e2[1] - direction.y * e2[0];
+
+  float det = e1[0] * px + e1[1] * py + e1[2] * pz;
+  if (fabsf(det) <= DETERMINANT_EPSILON) {
+    return false;
+  }
+
+  float invDet = 1.0f / det;
+
+  float tx = origin.x - v0[0];
+  float ty = origin.y - v0[1];
+  float tz = origin.z - v0[2];
+
+  float u = (tx * px + ty * py + tz * pz) * invDet;
+  if (u < 0.0f || u > 1.0f) {
+    return false;
+  }
+
+  float qx = ty * e1[2] - tz * e1[1];
+  float qy = tz * e1[0] - tx * e1[2];
+  float qz = tx * e1[1] - ty * e1[0];
+
+  float v = (direction.x * qx + direction.y * qy + direction.z * qz) * invDet;
+  if (v < 0.0f || u + v > 1.0f) {
+    return false;
+  }
+
+  t = (e2[0] * qx + e2[1] * qy + e2[2] * qz) * invDet;
+
+  return t >= 0.0f;
+}
+
+bool TriangleHierarchy::intersectTriangles(uint32_t first, uint32_t count, const Vector& origin, const Vector& direction, float& distance, uint32_t& hitIdx) const {
+  bool isHit = false;
+
+  uint32_t i = first;
+  uint32_t last = first + count;
+
+#if defined(__SSE__)
+  // Tests four triangles at once, following the scalar test below
+  __m128 ox = _mm_set1_ps(origin.x);
+  __m128 oy = _mm_set1_ps(origin.y);
+  __m128 oz = _mm_set1_ps(origin.z);
+  __m128 dx = _mm_set1_ps(direction.x);
+  __m128 dy = _mm_set1_ps(direction.y);
+  __m128 dz = _mm_set1_ps(direction.z);
+
+  __m128 zero = _mm_setzero_ps();
+  __m128 one = _mm_set1_ps(1.0f);
+  __m128 epsilon = _mm_set1_ps(DETERMINANT_EPSILON);
+  __m128 signMask = _mm_set1_ps(-0.0f);
+
+  for (; i + 4 <= last; i += 4) {
+    __m128 e1x = _mm_loadu_ps(&this->e1X[i]);
+    __m128 e1y = _mm_loadu_ps(&this->e1Y[i]);
+    __m128 e1z = _mm_loadu_ps(&this->e1Z[i]);
+    __m128 e2x = _mm_loadu_ps(&this->e2X[i]);
+    __m128 e2y = _mm_loadu_ps(&this->e2Y[i]);
+    __m128 e2z = _mm_loadu_ps(&this->e2Z[i]);
+
+    __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+    __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+    __m128 invDet = _mm_div_ps(one, det);
+
+    __m128 tx = _mm_sub_ps(ox, _mm_loadu_ps(&this->v0X[i]));
+    __m128 ty = _mm_sub_ps(oy, _mm_loadu_ps(&this->v0Y[i]));
+    __m128 tz = _mm_sub_ps(oz, _mm_loadu_ps(&this->v0Z[i]));
+
+    __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), invDet);
+
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+
+    __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+    __m128 valid = _mm_cmpgt_ps(_mm_andnot_ps(signMask, det), epsilon);
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(u, zero));
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(v, zero));
+    valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), one));
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(t, zero));
+    valid = _mm_and_ps(valid, _mm_cmplt_ps(t, _mm_set1_ps(distance)));
+
+    int validMask = _mm_movemask_ps(valid);
+    if (validMask == 0) {
+      continue;
+    }
+
+    float distances[4];
+    _mm_storeu_ps(distances, t);
+
+    for (unsigned j = 0; j < 4; j++) {
+      if ((validMask & (1 << j)) && distances[j] < distance) {
+        distance = distances[j];
+        hitIdx = i + j;
+        isHit = true;
+      }
+    }
+  }
+#endif
+
+  for (; i < last; i++) {
+    float v0[3] = { this->v0X[i], this->v0Y[i], this->v0Z[i] };
+    float e1[3] = { this->e1X[i], this->e1Y[i], this->e1Z[i] };
+    float e2[3] = { this->e2X[i], this->e2Y[i], this->e2Z[i] };
+
+    float t;
+    if (intersectTriangle(origin, direction, v0, e1, e2, t) && t < distance) {
+      distance = t;
+      hitIdx = i;
+      isHit = true;
+    }
+  }
+
+  return isHit;
+}
+
+bool TriangleHierarchy::raycast(const Vector& origin, const Vector& direction, float maxDistance, Hit& hit) const {
+  if (this->nodes.empty()) {
+    return false;
+  }
+
+  const float originArray[3] = { origin.x, origin.y, origin.z };
+  const float invDirection[3] = { 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z };
+
+  float distance = maxDistance;
+  uint32_t hitIdx = 0;
+  bool isHit = false;
+
+  StackEntry stack[MAX_DEPTH];
+  unsigned stackSize = 0;
+
+  float rootDistance = intersectBox(this->nodes[0], originArray, invDirection, 0.0f, distance);
+  if (rootDistance != INFINITY) {
+    stack[stackSize++] = { 0, rootDistance };
+  }
+
+  while (stackSize > 0) {
+    StackEntry entry = stack[--stackSize];
+    if (entry.distance > distance) {
+      continue;
+    }
+
+    uint32_t nodeIdx = entry.nodeIdx;
+
+    // Descend toward the nearer child each time, deferring the farther
+    while (true) {
+      const Node& node = this->nodes[nodeIdx];
+
+      if (node.rightChild == 0) {
+        isHit |= this->intersectTriangles(node.firstTriangle, node.triangleCount, origin, direction, distance, hitIdx);
+        break;
+      }
+
+      uint32_t near = nodeIdx + 1;
+      uint32_t far = node.rightChild;
+
+      float nearDistance = intersectBox(this->nodes[near], originArray, invDirection, 0.0f, distance);
+      float farDistance = intersectBox(this->nodes[far], originArray, invDirection, 0.0f, distance);
+
+      if (farDistance < nearDistance) {
+        std::swap(near, far);
+        std::swap(nearDistance, farDistance);
+      }
+
+      if (nearDistance == INFINITY) {
+        break;
+      }
+
+      if (farDistance != INFINITY) {
+        stack[stackSize++] = { far, farDistance };
+      }
+
+      nodeIdx = near;
+    }
+  }
+
+  if (!isHit) {
+    return false;
+  }
+
+  Vector normal = this->getNormal(hitIdx);
+  if (dot3(normal, direction) > 0.0f) {
+    normal = -normal;
+  }
+
+  hit.distance = distance;
+  hit.position = Vector { origin.x + direction.x * distance, origin.y + direction.y * distance, origin.z + direction.z * distance, 1.0f };
+  hit.normal = normal;
+  hit.triangle = this->triangles[hitIdx];
+
+  return true;
+}
+
+static Vector getClosestPointOnSegment(const Vector& p, const Vector& a, const Vector& b) {
+  Vector ab = b - a;
+
+  float lengthSq = dot3(ab, ab);
+  if (lengthSq <= 0.0f) {
+    return a;
+  }
+
+  return a + ab * fminf(fmaxf(dot3(p - a, ab) / lengthSq, 0.0f), 1.0f);
+}
+
+static Vector getClosestPointOnTriangle(const Vector& p, const Vector& a, const Vector& b, const Vector& c) {
+  Vector ab = b - a;
+  Vector ac = c - a;
+
+  // A degenerate triangle is no more than its longest edge, and would leave
+  // the regions below dividing by zero
+  Vector normal = Vector::cross(ab, ac);
+  if (dot3(normal, normal) <= DETERMINANT_EPSILON * DETERMINANT_EPSILON) {
+    Vector bc = c - b;
+
+    float abLengthSq = dot3(ab, ab);
+    float acLengthSq = dot3(ac, ac);
+    float bcLengthSq = dot3(bc, bc);
+
+    if (abLengthSq >= acLengthSq && abLengthSq >= bcLengthSq) {
+      return getClosestPointOnSegment(p, a, b);
+    }
+
+    return acLengthSq >= bcLengthSq ? getClosestPointOnSegment(p, a, c) : getClosestPointOnSegment(p, b, c);
+  }
+
+  // Check the regions beyond each vertex and edge in turn before falling
+  // back to the face
+  Vector ap = p - a;
+  float d1 = dot3(ab, ap);
+  float d2 = dot3(ac, ap);
+  if (d1 <= 0.0f && d2 <= 0.0f) {
+    return a;
+  }
+
+  Vector bp = p - b;
+  float d3 = dot3(ab, bp);
+  float d4 = dot3(ac, bp);
+  if (d3 >= 0.0f && d4 <= d3) {
+    return b;
+  }
+
+  float vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+    return a + ab * (d1 / (d1 - d3));
+  }
+
+  Vector cp = p - c;
+  float d5 = dot3(ab, cp);
+  float d6 = dot3(ac, cp);
+  if (d6 >= 0.0f && d5 <= d6) {
+    return c;
+  }
+
+  float vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+    return a + ac * (d2 / (d2 - d6));
+  }
+
+  float va = d3 * d6 - d5 * d4;
+  if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+    return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+  }
+
+  float denominator = 1.0f / (va + vb + vc);
+
+  return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+// Moving spheres are tested as rays against each feature of a triangle grown
+// by the radius: the face offset along its normal, a cylinder around each
+// edge and a sphere around each vertex
+static bool sweepSphereVertex(const Vector& origin, float radius, const Vector& direction, const Vector& vertex, float& t) {
+  Vector m = origin - vertex;
+
+  float b = dot3(m, direction);
+  float c = dot3(m, m) - radius * radius;
+  if (c > 0.0f && b > 0.0f) {
+    return false;
+  }
+
+  float discriminant = b * b - c;
+  if (discriminant < 0.0f) {
+    return false;
+  }
+
+  t = fmaxf(-b - sqrtf(discriminant), 0.0f);
+
+  return true;
+}
+
+static bool sweepSphereEdge(const Vector& origin, float radius, const Vector& direction, const Vector& start, const Vector& end, float& t, float& s) {
+  Vector edge = end - start;
+  Vector m = origin - start;
+
+  float edgeEdge = dot3(edge, edge);
+  float edgeDirection = dot3(edge, direction);
+  float edgeM = dot3(edge, m);
+
+  float a = edgeEdge - edgeDirection * edgeDirection;
+
+  // Moving along the edge, where only its ends can be touched
+  if (a <= DETERMINANT_EPSILON) {
+    return false;
+  }
+
+  float b = edgeEdge * dot3(m, direction) - edgeM * edgeDirection;
+  float c = edgeEdge * (dot3(m, m) - radius * radius) - edgeM * edgeM;
+
+  float discriminant = b * b - a * c;
+  if (discriminant < 0.0f) {
+    return false;
+  }
+
+  t = (-b - sqrtf(discriminant)) / a;
+  if (t < 0.0f) {
+    return false;
+  }
+
+  s = (edgeM + t * edgeDirection) / edgeEdge;
+
+  return s >= 0.0f && s <= 1.0f;
+}
+
+// Finds whether a moving sphere touches a triangle closer than distance,
+// updating it along with the point touched
+static bool sweepSphereTriangle(const Vector& origin, float radius, const Vector& direction, const Vector& a, const Vector& b, const Vector& c, float& distance, Vector& contact) {
+  Vector normal = Vector::cross(b - a, c - a);
+  float normalLength = sqrtf(dot3(normal, normal));
+
+  // Degenerate triangles have no face to touch, but can still be touched
+  // along their edges and at their vertices
+  float planeDistance = 0.0f;
+
+  if (normalLength > DETERMINANT_EPSILON) {
+    normal = normal * (1.0f / normalLength);
+
+    planeDistance = dot3(origin - a, normal);
+    if (planeDistance < 0.0f) {
+      normal = -normal;
+      planeDistance = -planeDistance;
+    }
+  }
+
+  if (planeDistance <= radius) {
+    Vector closest = getClosestPointOnTriangle(origin, a, b, c);
+    Vector offset = origin - closest;
+
+    if (dot3(offset, offset) <= radius * radius) {
+      distance = 0.0f;
+      contact = closest;
+
+      return true;
+    }
+
+    // Already within reach of the plane, so only an edge or vertex can be
+    // touched first
+  } else {
+    // Spheres clear of the plane and not moving toward it touch nothing
+    float approach = -dot3(direction, normal);
+    if (approach <= 0.0f) {
+      return false;
+    }
+
+    float t = (planeDistance - radius) / approach;
+    if (t >= distance) {
+      return false;
+    }
+
+    Vector point = origin + direction * t - normal * radius;
+
+    float w0 = dot3(Vector::cross(b - a, point - a), normal);
+    float w1 = dot3(Vector::cross(c - b, point - b), normal);
+    float w2 = dot3(Vector::cross(a - c, point - c), normal);
+
+    if ((w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f) || (w0 <= 0.0f && w1 <= 0.0f && w2 <= 0.0f)) {
+      distance = t;
+      contact = Vector { point.x, point.y, point.z, 1.0f };
+
+      return true;
+    }
+  }
+
+  bool isHit = false;
+  const Vector *vertices[3] = { &a, &b, &c };
+
+  for (unsigned i = 0; i < 3; i++) {
+    const Vector& start = *vertices[i];
+    const Vector& end = *vertices[(i + 1) % 3];
+
+    float t;
+    if (sweepSphereVertex(origin, radius, direction, start, t) && t < distance) {
+      distance = t;
+      contact = start;
+      isHit = true;
+    }
+
+    float s;
+    if (sweepSphereEdge(origin, radius, direction, start, end, t, s) && t < distance) {
+      distance = t;
+      contact = start + (end - start) * s;
+      isHit = true;
+    }
+  }
+
+  return isHit;
+}
+
+bool TriangleHierarchy::sweepSphere(const Vector& origin, float radius, const Vector& direction, float maxDistance, Hit& hit) const {
+  if (this->nodes.empty()) {
+    return false;
+  }
+
+  const float originArray[3] = { origin.x, origin.y, origin.z };
+  const float invDirection[3] = { 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z };
+
+  float distance = maxDistance;
+  uint32_t hitIdx = 0;
+  Vector contact;
+  bool isHit = false;
+
+  StackEntry stack[MAX_DEPTH];
+  unsigned stackSize = 0;
+
+  float rootDistance = intersectBox(this->nodes[0], originArray, invDirection, radius, distance);
+  if (rootDistance != INFINITY) {
+    stack[stackSize++] = { 0, rootDistance };
+  }
+
+  while (stackSize > 0) {
+    StackEntry entry = stack[--stackSize];
+    if (entry.distance > distance) {
+      continue;
+    }
+
+    uint32_t nodeIdx = entry.nodeIdx;
+
+    while (true) {
+      const Node& node = this->nodes[nodeIdx];
+
+      if (node.rightChild == 0) {
+        for (uint32_t i = node.firstTriangle; i < node.firstTriangle + node.triangleCount; i++) {
+          Vector a, b, c;
+          this->getVertices(i, a, b, c);
+
+          if (sweepSphereTriangle(origin, radius, direction, a, b, c, distance, contact)) {
+            hitIdx = i;
+            isHit = true;
+          }
+        }
+
+        break;
+      }
+
+      uint32_t near = nodeIdx + 1;
+      uint32_t far = node.rightChild;
+
+      float nearDistance = intersectBox(this->nodes[near], originArray, invDirection, radius, distance);
+      float farDistance = intersectBox(this->nodes[far], originArray, invDirection, radius, distance);
+
+      if (farDistance < nearDistance) {
+        std::swap(near, far);
+        std::swap(nearDistance, farDistance);
+      }
+
+      if (nearDistance == INFINITY) {
+        break;
+      }
+
+      if (farDistance != INFINITY) {
+        stack[stackSize++] = { far, farDistance };
+      }
+
+      nodeIdx = near;
+    }
+  }
+
+  if (!isHit) {
+    return false;
+  }
+
+  Vector center { origin.x + direction.x * distance, origin.y + direction.y * distance, origin.z + direction.z * distance, 1.0f };
+  Vector offset = center - contact;
+  float offsetLength = sqrtf(dot3(offset, offset));
+
+  Vector normal;
+  if (offsetLength > DETERMINANT_EPSILON) {
+    normal = offset * (1.0f / offsetLength);
+  } else {
+    normal = this->getNormal(hitIdx);
+    if (dot3(normal, direction) > 0.0f) {
+      normal = -normal;
+    }
+  }
+
+  hit.distance = distance;
+  hit.position = contact;
+  hit.normal = Vector { normal.x, normal.y, normal.z, 0.0f };
+  hit.triangle = this->triangles[hitIdx];
+
+  return true;
+}
+
+bool TriangleHierarchy::findClosestPoint(const Vector& point, float maxDistance, Hit& hit) const {
+  if (this->nodes.empty()) {
+    return false;
+  }
+
+  const float pointArray[3] = { point.x, point.y, point.z };
+
+  float bestDistanceSq = maxDistance * maxDistance;
+  uint32_t hitIdx = 0;
+  Vector closest;
+  bool isHit = false;
+
+  StackEntry stack[MAX_DEPTH];
+  unsigned stackSize = 0;
+
+  float rootDistanceSq = getDistanceSquared(this->nodes[0], pointArray);
+  if (rootDistanceSq <= bestDistanceSq) {
+    stack[stackSize++] = { 0, rootDistanceSq };
+  }
+
+  while (stackSize > 0) {
+    StackEntry entry = stack[--stackSize];
+    if (entry.distance > bestDistanceSq) {
+      continue;
+    }
+
+    uint32_t nodeIdx = entry.nodeIdx;
+
+    while (true) {
+      const Node& node = this->nodes[nodeIdx];
+
+      if (node.rightChild == 0) {
+        for (uint32_t i = node.firstTriangle; i < node.firstTriangle + node.triangleCount; i++) {
+          Vector a, b, c;
+          this->getVertices(i, a, b, c);
+
+          Vector candidate = getClosestPointOnTriangle(point, a, b, c);
+          Vector offset = point - candidate;
+
+          float distanceSq = dot3(offset, offset);
+          if (distanceSq <= bestDistanceSq) {
+            bestDistanceSq = distanceSq;
+            closest = candidate;
+            hitIdx = i;
+            isHit = true;
+          }
+        }
+
+        break;
+      }
+
+      uint32_t near = nodeIdx + 1;
+      uint32_t far = node.rightChild;
+
+      float nearDistanceSq = getDistanceSquared(this->nodes[near], pointArray);
+      float farDistanceSq = getDistanceSquared(this->nodes[far], pointArray);
+
+      if (farDistanceSq < nearDistanceSq) {
+        std::swap(near, far);
+        std::swap(nearDistanceSq, farDistanceSq);
+      }
+
+      if (nearDistanceSq > bestDistanceSq) {
+        break;
+      }
+
+      if (farDistanceSq <= bestDistanceSq) {
+        stack[stackSize++] = { far, farDistanceSq };
+      }
+
+      nodeIdx = near;
+    }
+  }
+
+  if (!isHit) {
+    return false;
+  }
+
+  float distance = sqrtf(bestDistanceSq);
+
+  Vector normal;
+  if (distance > DETERMINANT_EPSILON) {
+    Vector offset = point - closest;
+    normal = offset * (1.0f / distance);
+  } else {
+    normal = this->getNormal(hitIdx);
+  }
+
+  hit.distance = distance;
+  hit.position = Vector { closest.x, closest.y, closest.z, 1.0f };
+  hit.normal = Vector { normal.x, normal.y, normal.z, 0.0f };
+  hit.triangle = this->triangles[hitIdx];
+
+  return true;
+}
@@ -0,0 +1,110 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MORTAR_MATH_TRIANGLEBVH_H
+#define MORTAR_MATH_TRIANGLEBVH_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "../workers.hpp"
+#include "matrix.hpp"
+#include "sah.hpp"
+
+namespace Mortar::Math {
+  // A bounding volume hierarchy over a fixed set of triangles, for querying
+  // geometry directly rather than through the bounds of whatever it belongs
+  // to. Triangles are stored component-wise in hierarchy order so that
+  // leaves can be tested several at a time.
+  class TriangleHierarchy {
+    public:
+      // Laid out as BoundingVolumeHierarchy::Node, with items being triangles
+      class Node {
+        public:
+          float minima[3];
+          float maxima[3];
+
+          uint32_t firstTriangle;
+          uint32_t triangleCount;
+
+          // Zero for leaves
+          uint32_t rightChild;
+      };
+
+      class Hit {
+        public:
+          // Along the query direction, or from the query point for closest
+          // point queries
+          float distance;
+
+          // Point of contact on the triangle
+          Vector position;
+
+          // Unit length and facing the query, as triangles are double-sided
+          Vector normal;
+
+          // Index of the triangle in the order it was given to build()
+          unsigned triangle;
+      };
+
+      // Triangles are given as three indices each into positions; subtrees
+      // are built in parallel when there are enough triangles to make it
+      // worthwhile
+      void build(const std::vector<Vector>& positions, const std::vector<uint32_t>& indices, WorkerPool& workers);
+
+      bool isEmpty() const;
+      unsigned getTriangleCount() const;
+
+      // Directions must be of unit length, and only hits within maxDistance
+      // of the origin are reported
+      bool raycast(const Vector& origin, const Vector& direction, float maxDistance, Hit& hit) const;
+
+      // Finds where a sphere moving from origin first touches a triangle; a
+      // sphere already touching one hits at zero distance
+      bool sweepSphere(const Vector& origin, float radius, const Vector& direction, float maxDistance, Hit& hit) const;
+
+      bool findClosestPoint(const Vector& point, float maxDistance, Hit& hit) const;
+
+      const std::vector<Node>& getNodes() const;
+
+    private:
+      void getVertices(uint32_t idx, Vector& a, Vector& b, Vector& c) const;
+
+      // Unit length, with the winding of the triangle as given
+      Vector getNormal(uint32_t idx) const;
+
+      // Tests a ray against a run of triangles in hierarchy order, keeping
+      // the nearest hit closer than distance
+      bool intersectTriangles(uint32_t first, uint32_t count, const Vector& origin, const Vector& direction, float& distance, uint32_t& hitIdx) const;
+
+      std::vector<Node> nodes;
+
+      // Triangles in hierarchy order, as a vertex and the two edges leaving
+      // it
+      std::vector<float> v0X;
+      std::vector<float> v0Y;
+      std::vector<float> v0Z;
+      std::vector<float> e1X;
+      std::vector<float> e1Y;
+      std::vector<float> e1Z;
+      std::vector<float> e2X;
+      std::vector<float> e2Y;
+      std::vector<float> e2Z;
+      std::vector<unsigned> triangles;
+  };
+}
+
+#endif
@@ -0,0 +1,113 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <math.h>
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "trig.hpp"
+
+// Angles are reduced into [-pi/4, pi/4] by subtracting the nearest multiple of
+// pi/2, split in three so that the subtraction stays exact
+static const float TWO_OVER_PI = 0.636619772f;
+static const float HALF_PI_1 = 1.5703125f;
+static const float HALF_PI_2 = 4.837512969970703125e-4f;
+static const float HALF_PI_3 = 7.54978995489188216e-8f;
+
+// Minimax polynomials for sine and cosine over the reduced range
+static const float SIN_1 = -1.6666654611e-1f;
+static const float SIN_2 = 8.3321608736e-3f;
+static const float SIN_3 = -1.9515295891e-4f;
+static const float COS_1 = 4.166664568298827e-2f;
+static const float COS_2 = -1.388731625493765e-3f;
+static const float COS_3 = 2.443315711809948e-5f;
+
+inline void sinCosScalar(float angle, float *sine, float *cosine) {
+  float quadrant = nearbyintf(angle * TWO_OVER_PI);
+  float r = ((angle - quadrant * HALF_PI_1) - quadrant * HALF_PI_2) - quadrant * HALF_PI_3;
+  float r2 = r * r;
+
+  float s = r + r * r2 * (SIN_1 + r2 * (SIN_2 + r2 * SIN_3));
+  float c = 1.0f - 0.5f * r2 + r2 * r2 * (COS_1 + r2 * (COS_2 + r2 * COS_3));
+
+  // Each quarter turn rotates (sin, cos) to (cos, -sin)
+  switch ((int32_t)quadrant & 3) {
+    case 0:
+      *sine = s;
+      *cosine = c;
+      break;
+    case 1:
+      *sine = c;
+      *cosine = -s;
+      break;
+    case 2:
+      *sine = -s;
+      *cosine = -c;
+      break;
+    case 3:
+      *sine = -c;
+      *cosine = s;
+      break;
+  }
+}
+
+void Mortar::Math::sinCos(const float *angles, float *sines, float *cosines, size_t count) {
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128 signBit = _mm_set1_ps(-0.0f);
+
+  for (; i + 4 <= count; i += 4) {
+    __m128 angle = _mm_loadu_ps(angles + i);
+
+    __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(TWO_OVER_PI)));
+    __m128 quadrantf = _mm_cvtepi32_ps(quadrant);
+
+    __m128 r = _mm_sub_ps(angle, _mm_mul_ps(quadrantf, _mm_set1_ps(HALF_PI_1)));
+    r = _mm_sub_ps(r, _mm_mul_ps(quadrantf, _mm_set1_ps(HALF_PI_2)));
+    r = _mm_sub_ps(r, _mm_mul_ps(quadrantf, _mm_set1_ps(HALF_PI_3)));
+    __m128 r2 = _mm_mul_ps(r, r);
+
+    __m128 s = _mm_add_ps(_mm_set1_ps(SIN_2), _mm_mul_ps(r2, _mm_set1_ps(SIN_3)));
+    s = _mm_add_ps(_mm_set1_ps(SIN_1), _mm_mul_ps(r2, s));
+    s = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), s));
+
+    __m128 c = _mm_add_ps(_mm_set1_ps(COS_2), _mm_mul_ps(r2, _mm_set1_ps(COS_3)));
+    c = _mm_add_ps(_mm_set1_ps(COS_1), _mm_mul_ps(r2, c));
+    c = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), r2)), _mm_mul_ps(_mm_mul_ps(r2, r2), c));
+
+    // Odd quadrants swap sine and cosine; the sine is negated in quadrants 2
+    // and 3 and the cosine in quadrants 1 and 2
+    __m128 isOdd = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+    __m128 sine = _mm_or_ps(_mm_and_ps(isOdd, c), _mm_andnot_ps(isOdd, s));
+    __m128 cosine = _mm_or_ps(_mm_and_ps(isOdd, s), _mm_andnot_ps(isOdd, c));
+
+    __m128 sineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+    __m128 cosineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+
+    _mm_storeu_ps(sines + i, _mm_xor_ps(sine, _mm_and_ps(sineSign, signBit)));
+    _mm_storeu_ps(cosines + i, _mm_xor_ps(cosine, _mm_and_ps(cosineSign, signBit)));
+  }
+#endif
+
+  for (; i < count; i++) {
+    sinCosScalar(angles[i], sines + i, cosines + i);
+  }
+}
@@ -14,22 +14,16 @@
  * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "instance.hpp"
 
-using namespace Mortar::Resource;
+#ifndef MORTAR_MATH_TRIG_H
+#define MORTAR_MATH_TRIG_H
 
-const std::forward_list<Mesh *> Instance::getMeshes() const {
-  return this->meshes;
-}
-
-void Instance::setMeshes(std::forward_list<Mesh *> meshes) {
-  this->meshes = meshes;
-}
+#include <stddef.h>
 
-const Mortar::Math::Matrix& Instance::getWorldTransform() const {
-  return this->worldTransform;
+namespace Mortar::Math {
+  // Computes the sine and cosine of each angle, four at a time where SSE2 is
+  // available. Accurate to within a few ulp for angles of reasonable size.
+  void sinCos(const float *angles, float *sines, float *cosines, size_t count);
 }
 
-void Instance::setWorldTransform(Math::Matrix& worldTransform) {
-  this->worldTransform = worldTransform;
-}
+#endif
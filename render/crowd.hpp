@@ -14,30 +14,26 @@
  * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#ifndef MORTAR_RESOURCE_INSTANCE_H
-#define MORTAR_RESOURCE_INSTANCE_H
+#ifndef MORTAR_RENDER_CROWD_H
+#define MORTAR_RENDER_CROWD_H
 
-#include <forward_list>
+#include <vector>
 
-#include "../../math/matrix.hpp"
-#include "../resource.hpp"
-#include "mesh.hpp"
+#include "../math/affine.hpp"
+#include "../resource/types/mesh.hpp"
 
-namespace Mortar::Resource {
-  class Instance : public Resource {
+namespace Mortar::Render {
+  // A crowd is a group of actors sharing a character, whose skinned meshes
+  // are drawn for every actor at once with instanced draws. Each actor's skin
+  // palette covers all of the character's joints, and palettes are stored
+  // back to back in actor order.
+  class Crowd {
     public:
-      Instance(ResourceHandle handle)
-        : Resource { handle } {};
+      unsigned jointCount;
+      unsigned actorCount;
 
-      const std::forward_list<Mesh *> getMeshes() const;
-      void setMeshes(std::forward_list<Mesh *> mesh);
-
-      const Math::Matrix& getWorldTransform() const;
-      void setWorldTransform(Math::Matrix& worldTransform);
-
-    private:
-      std::forward_list<Mesh *> meshes;
-      Math::Matrix worldTransform;
+      std::vector<const Resource::Mesh *> meshes;
+      std::vector<Math::AffineTransform> palettes;
   };
 }
 
@@ -0,0 +1,136 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <tsl/sparse_map.h>
+
+#include "drawlist.hpp"
+
+using namespace Mortar::Render;
+
+// Sort keys are laid out so that draws are grouped first by blending, then by
+// shader, then by material and finally by mesh, minimizing state changes
+// when draws are submitted in order
+static inline uint64_t createSortKey(bool isAlphaBlended, Mortar::Resource::ShaderType shaderType, unsigned materialOrdinal, unsigned meshOrdinal) {
+  uint64_t key = 0;
+
+  key |= (uint64_t)isAlphaBlended << 63;
+  key |= ((uint64_t)shaderType & 0x7f) << 56;
+  key |= ((uint64_t)materialOrdinal & 0xffffff) << 32;
+  key |= (uint64_t)meshOrdinal;
+
+  return key;
+}
+
+void DrawList::build(const Resource::Scene *scene) {
+  this->clear();
+
+  unsigned instanceCount = scene->getInstanceCount();
+  this->transforms = scene->getInstanceTransforms();
+
+  tsl::sparse_map<const Resource::Material *, unsigned> materialOrdinals;
+  tsl::sparse_map<const Resource::Mesh *, unsigned> meshOrdinals;
+
+  for (unsigned i = 0; i < instanceCount; i++) {
+    for (auto mesh : scene->getInstanceMeshes(i)) {
+      const Resource::Material *material = mesh->getMaterial();
+
+      if (!materialOrdinals.contains(material)) {
+        unsigned ordinal = materialOrdinals.size();
+        materialOrdinals[material] = ordinal;
+      }
+
+      if (!meshOrdinals.contains(mesh)) {
+        unsigned ordinal = meshOrdinals.size();
+        meshOrdinals[mesh] = ordinal;
+      }
+
+      Draw draw;
+      draw.sortKey = createSortKey(material->isAlphaBlended(), mesh->getShaderType(), materialOrdinals.at(material), meshOrdinals.at(mesh));
+      draw.mesh = mesh;
+      draw.transformIdx = i;
+
+      this->draws.push_back(draw);
+    }
+  }
+
+  std::stable_sort(this->draws.begin(), this->draws.end(), [] (const Draw& a, const Draw& b) {
+    return a.sortKey < b.sortKey;
+  });
+
+  auto firstAlpha = std::find_if(this->draws.begin(), this->draws.end(), [] (const Draw& draw) {
+    return draw.mesh->getMaterial()->isAlphaBlended();
+  });
+
+  this->opaqueCount = firstAlpha - this->draws.begin();
+
+  // Bucket the sorted draws by instance so that visibility determined per
+  // instance can be mapped back to draws
+  this->instanceDrawOffsets.assign(instanceCount + 1, 0);
+  for (auto& draw : this->draws) {
+    this->instanceDrawOffsets[draw.transformIdx + 1]++;
+  }
+
+  for (unsigned i = 0; i < instanceCount; i++) {
+    this->instanceDrawOffsets[i + 1] += this->instanceDrawOffsets[i];
+  }
+
+  this->instanceDraws.resize(this->draws.size());
+
+  std::vector<unsigned> instanceFill (this->instanceDrawOffsets.begin(), this->instanceDrawOffsets.end() - 1);
+  for (unsigned i = 0; i < this->draws.size(); i++) {
+    this->instanceDraws[instanceFill[this->draws[i].transformIdx]++] = i;
+  }
+
+  for (auto& draw : this->draws) {
+    this->bounds.push_back(draw.mesh->getBounds().transform(this->transforms[draw.transformIdx]));
+  }
+}
+
+void DrawList::clear() {
+  this->draws.clear();
+  this->transforms.clear();
+  this->opaqueCount = 0;
+
+  this->bounds.clear();
+
+  this->instanceDrawOffsets.clear();
+  this->instanceDraws.clear();
+}
+
+const std::vector<DrawList::Draw>& DrawList::getDraws() const {
+  return this->draws;
+}
+
+const std::vector<Mortar::Math::AffineTransform>& DrawList::getTransforms() const {
+  return this->transforms;
+}
+
+const std::vector<Mortar::Math::Bounds>& DrawList::getBounds() const {
+  return this->bounds;
+}
+
+size_t DrawList::getOpaqueCount() const {
+  return this->opaqueCount;
+}
+
+const std::vector<unsigned>& DrawList::getInstanceDrawOffsets() const {
+  return this->instanceDrawOffsets;
+}
+
+const std::vector<unsigned>& DrawList::getInstanceDraws() const {
+  return this->instanceDraws;
+}
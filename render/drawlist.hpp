@@ -0,0 +1,78 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MORTAR_RENDER_DRAWLIST_H
+#define MORTAR_RENDER_DRAWLIST_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "../math/affine.hpp"
+#include "../math/bounds.hpp"
+#include "../resource/types/mesh.hpp"
+#include "../resource/types/scene.hpp"
+
+namespace Mortar::Render {
+  // A draw list holds geometry which does not change from frame to frame. It
+  // is compiled once when a scene is set so that per-frame work for static
+  // geometry is limited to deciding which draws are visible and submitting
+  // them.
+  class DrawList {
+    public:
+      class Draw {
+        public:
+          uint64_t sortKey;
+
+          const Resource::Mesh *mesh;
+
+          // Index of the draw's world transform; transforms are shared by
+          // all draws originating from the same instance, so this doubles as
+          // the instance index
+          unsigned transformIdx;
+      };
+
+      void build(const Resource::Scene *scene);
+      void clear();
+
+      const std::vector<Draw>& getDraws() const;
+      const std::vector<Math::AffineTransform>& getTransforms() const;
+
+      // Indexed in the same order as draws
+      const std::vector<Math::Bounds>& getBounds() const;
+
+      // Draws are sorted such that all opaque draws precede alpha-blended ones
+      size_t getOpaqueCount() const;
+
+      // Indices of the draws originating from each instance, in ascending
+      // order; the draws for instance i are those from
+      // getInstanceDrawOffsets()[i] up to getInstanceDrawOffsets()[i + 1]
+      const std::vector<unsigned>& getInstanceDrawOffsets() const;
+      const std::vector<unsigned>& getInstanceDraws() const;
+
+    private:
+      std::vector<Draw> draws;
+      std::vector<Math::AffineTransform> transforms;
+
+      std::vector<Math::Bounds> bounds;
+
+      size_t opaqueCount;
+
+      std::vector<unsigned> instanceDrawOffsets;
+      std::vector<unsigned> instanceDraws;
+  };
+}
+
+#endif
@@ -18,6 +18,7 @@
 
 #include <GL/gl.h>
 #include <SDL2/SDL_video.h>
+#include <algorithm>
 #include <assert.h>
 #include <stdexcept>
 #include <tsl/sparse_map.h>
@@ -113,6 +114,26 @@ void Renderer::initialize() {
 
   this->shaderManager.initialize();
 
+  glGenBuffers(1, &this->instanceBufferId);
+
+  // Textures each keep their own unit, so take the last unit for palettes to
+  // stay out of their way
+  GLint textureUnitCount;
+  glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &textureUnitCount);
+  this->paletteTextureUnit = textureUnitCount - 1;
+
+  glGenBuffers(1, &this->paletteBufferId);
+  glBindBuffer(GL_TEXTURE_BUFFER, this->paletteBufferId);
+
+  glGenTextures(1, &this->paletteTextureId);
+  glActiveTexture(GL_TEXTURE0 + this->paletteTextureUnit);
+  glBindTexture(GL_TEXTURE_BUFFER, this->paletteTextureId);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, this->paletteBufferId);
+
+  const ShaderManager::Uniforms& crowdUniforms = this->shaderManager.getInstancedUniforms(Resource::ShaderType::SKIN);
+  glUseProgram(this->shaderManager.getInstancedShaderProgram(Resource::ShaderType::SKIN));
+  glUniform1i(crowdUniforms.skinPalettes, this->paletteTextureUnit);
+
   this->isInitialized = true;
 }
 
@@ -135,74 +156,97 @@ void Renderer::shutDown() {
   glDeleteVertexArrays(this->vertexArrayIds.size(), vertexArrayIds);
   delete[] vertexArrayIds;
 
-  GLuint *vertexBufferIds = new GLuint[this->vertexBufferIds.size()];
-  GLuint *vertexBufferIdPtr = vertexBufferIds;
-  for (auto vertexBuffer = this->vertexBufferIds.begin(); vertexBuffer != this->vertexBufferIds.end(); vertexBuffer++, vertexBufferIdPtr++) {
-    *vertexBufferIdPtr = vertexBuffer->second;
+  GLuint *instancedVertexArrayIds = new GLuint[this->instancedVertexArrayIds.size()];
+  GLuint *instancedVertexArrayIdPtr = instancedVertexArrayIds;
+  for (auto vertexArray = this->instancedVertexArrayIds.begin(); vertexArray != this->instancedVertexArrayIds.end(); vertexArray++, instancedVertexArrayIdPtr++) {
+    *instancedVertexArrayIdPtr = vertexArray->second;
   }
-  glDeleteBuffers(this->vertexBufferIds.size(), vertexBufferIds);
-  delete[] vertexBufferIds;
+  glDeleteVertexArrays(this->instancedVertexArrayIds.size(), instancedVertexArrayIds);
+  delete[] instancedVertexArrayIds;
 
-  GLuint *elementBufferIds = new GLuint[this->elementBufferIds.size()];
-  GLuint *elementBufferIdPtr = elementBufferIds;
-  for (auto elementBuffer = this->elementBufferIds.begin(); elementBuffer != this->elementBufferIds.end(); elementBuffer++, elementBufferIdPtr++) {
-    *elementBufferIdPtr = elementBuffer->second;
-  }
-  glDeleteBuffers(this->elementBufferIds.size(), elementBufferIds);
-  delete[] elementBufferIds;
+  glDeleteBuffers(1, &this->instanceBufferId);
+
+  glDeleteTextures(1, &this->paletteTextureId);
+  glDeleteBuffers(1, &this->paletteBufferId);
+
+  glDeleteBuffers(this->modelBufferIds.size(), this->modelBufferIds.data());
 }
 
-void Renderer::registerMeshes(const std::vector<const Resource::Mesh *>& meshes) {
-  /* Initialize a vertex array for each mesh. */
-  GLuint *vertexArrayIds = new GLuint[meshes.size()];
-  GLuint *vertexArrayIdPtr = vertexArrayIds;
-  glGenVertexArrays(meshes.size(), vertexArrayIds);
+void Renderer::registerModel(const Resource::Model *model) {
+  const std::vector<uint8_t>& vertexData = model->getVertexData();
+  const std::vector<uint16_t>& indices = model->getIndices();
+
+  GLuint bufferIds[2];
+  glGenBuffers(2, bufferIds);
+  this->modelBufferIds.insert(this->modelBufferIds.end(), bufferIds, bufferIds + 2);
 
-  for (auto mesh = meshes.begin(); mesh != meshes.end(); mesh++, vertexArrayIdPtr++) {
-    GLuint vertexBufferId = this->vertexBufferIds.at((*mesh)->getVertexBuffer()->getHandle());
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferId);
+  /* The element buffer binding is part of vertex array state, so upload the
+   * indices through a target that isn't, leaving whatever array is bound
+   * untouched. */
+  glBindBuffer(GL_ARRAY_BUFFER, bufferIds[1]);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(GLushort) * indices.size(), indices.data(), GL_STATIC_DRAW);
 
-    glBindVertexArray(*vertexArrayIdPtr);
-    this->vertexArrayIds[(*mesh)->getHandle()] = *vertexArrayIdPtr;
+  glBindBuffer(GL_ARRAY_BUFFER, bufferIds[0]);
+  glBufferData(GL_ARRAY_BUFFER, vertexData.size(), vertexData.data(), GL_STATIC_DRAW);
 
-    Resource::ShaderType shaderType = (*mesh)->getShaderType();
+  /* Initialize a vertex array for each mesh, binding the element buffer to
+   * each once it's bound. */
+  for (auto& mesh : model->getMeshes()) {
+    GLuint vertexArrayId;
+    glGenVertexArrays(1, &vertexArrayId);
+    glBindVertexArray(vertexArrayId);
+    this->vertexArrayIds[&mesh] = vertexArrayId;
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferIds[1]);
+
+    Resource::ShaderType shaderType = mesh.getShaderType();
     GLuint shaderProgram = this->shaderManager.getShaderProgram(shaderType);
 
-    const Resource::VertexLayout& vertexLayout = (*mesh)->getVertexLayout();
+    this->setUpVertexAttributes(&mesh, shaderProgram);
 
-    unsigned stride = vertexLayout.getStride();
-    const std::vector<Resource::VertexLayout::VertexProperty>& vertexProperties = vertexLayout.getProperties();
-    for (auto& property : vertexProperties) {
-      const char *attribName = getVertexPropertyParamName(property.getUsage());
-      GLint attr = glGetAttribLocation(shaderProgram, attribName);
-      if (attr == -1) {
-        continue;
-      }
+    // Instanced programs may assign different attribute locations, so meshes
+    // get a separate vertex array for them
+    if (this->shaderManager.hasInstancedVariant(shaderType)) {
+      GLuint instancedVertexArrayId;
+      glGenVertexArrays(1, &instancedVertexArrayId);
+      glBindVertexArray(instancedVertexArrayId);
+      this->instancedVertexArrayIds[&mesh] = instancedVertexArrayId;
 
-      const struct GLVertexPropertyType glType = getVertexPropertyType(property.getDataType());
-      glVertexAttribPointer(attr, glType.size, glType.type, GL_TRUE, stride, (GLvoid *)property.getOffset());
-      glEnableVertexAttribArray(attr);
-    }
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferIds[1]);
 
-    const std::vector<Resource::Surface *>& surfaces = (*mesh)->getSurfaces();
+      this->setUpVertexAttributes(&mesh, this->shaderManager.getInstancedShaderProgram(shaderType));
 
-    GLuint *elementBufferIds = new GLuint[surfaces.size()];
-    GLuint *elementBufferIdPtr = elementBufferIds;
-    glGenBuffers(surfaces.size(), elementBufferIds);
+      // Pointers into the instance buffer are set per batch, as each batch
+      // starts at a different offset
+      GLint instanceTransformAttr = this->shaderManager.getInstanceTransformAttr(shaderType);
+      if (instanceTransformAttr != -1) {
+        for (GLint column = 0; column < 3; column++) {
+          glEnableVertexAttribArray(instanceTransformAttr + column);
+          glVertexAttribDivisor(instanceTransformAttr + column, 1);
+        }
+      }
+    }
+  }
 
-    for (auto surface = surfaces.begin(); surface != surfaces.end(); surface++, elementBufferIdPtr++) {
-      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *elementBufferIdPtr);
-      this->elementBufferIds[(*surface)->getHandle()] = *elementBufferIdPtr;
+  glBindVertexArray(0);
+}
 
-      const Resource::IndexBuffer *indexBuffer = (*surface)->getIndexBuffer();
+void Renderer::setUpVertexAttributes(const Resource::Mesh *mesh, GLuint shaderProgram) {
+  const Resource::VertexLayout& vertexLayout = mesh->getVertexLayout();
 
-      glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * indexBuffer->getCount(), indexBuffer->getData(), GL_STATIC_DRAW);
+  unsigned stride = vertexLayout.getStride();
+  const std::vector<Resource::VertexLayout::VertexProperty>& vertexProperties = vertexLayout.getProperties();
+  for (auto& property : vertexProperties) {
+    const char *attribName = getVertexPropertyParamName(property.getUsage());
+    GLint attr = glGetAttribLocation(shaderProgram, attribName);
+    if (attr == -1) {
+      continue;
     }
 
-    delete[] elementBufferIds;
+    const struct GLVertexPropertyType glType = getVertexPropertyType(property.getDataType());
+    glVertexAttribPointer(attr, glType.size, glType.type, GL_TRUE, stride, (GLvoid *)(mesh->getVertexOffset() + property.getOffset()));
+    glEnableVertexAttribArray(attr);
   }
-
-  delete[] vertexArrayIds;
 }
 
 void Renderer::registerTextures(const std::vector<const Resource::Texture *> &textures) {
@@ -215,6 +259,10 @@ void Renderer::registerTextures(const std::vector<const Resource::Texture *> &te
   for (int i = start; i < start + textures.size(); i++, textureIdPtr++) {
     const Resource::Texture *texture = textures.at(i - start);
 
+    if (i >= this->paletteTextureUnit) {
+      throw std::runtime_error("out of texture units");
+    }
+
     glActiveTexture(GL_TEXTURE0 + i);
     glBindTexture(GL_TEXTURE_2D, *textureIdPtr);
 
@@ -239,154 +287,403 @@ void Renderer::registerTextures(const std::vector<const Resource::Texture *> &te
   delete[] textureIds;
 }
 
-void Renderer::registerVertexBuffers(const std::vector<const Resource::VertexBuffer *> &vertexBuffers) {
-  GLuint *vertexBufferIds = new GLuint[vertexBuffers.size()];
-  GLuint *vertexBufferIdPtr = vertexBufferIds;
-  glGenBuffers(vertexBuffers.size(), vertexBufferIds);
+void Renderer::registerDrawList(const DrawList *drawList) {
+  this->drawList = drawList;
+
+  this->resolvedDraws.clear();
+  this->resolvedSurfaces.clear();
+
+  const std::vector<DrawList::Draw>& draws = drawList->getDraws();
+  this->resolvedDraws.reserve(draws.size());
+
+  for (auto& draw : draws) {
+    const Resource::Mesh *mesh = draw.mesh;
+
+    ResolvedDraw resolved;
+    resolved.program = this->shaderManager.getShaderProgram(mesh->getShaderType());
+    resolved.uniforms = &this->shaderManager.getUniforms(mesh->getShaderType());
+    resolved.vertexArrayId = this->vertexArrayIds.at(mesh);
+    resolved.material = this->resolveMaterial(mesh->getMaterial());
+
+    resolved.isInstanceable = this->shaderManager.hasInstancedVariant(mesh->getShaderType()) && this->shaderManager.getInstanceTransformAttr(mesh->getShaderType()) != -1;
+    if (resolved.isInstanceable) {
+      resolved.instancedProgram = this->shaderManager.getInstancedShaderProgram(mesh->getShaderType());
+      resolved.instancedUniforms = &this->shaderManager.getInstancedUniforms(mesh->getShaderType());
+      resolved.instanceTransformAttr = this->shaderManager.getInstanceTransformAttr(mesh->getShaderType());
+      resolved.instancedVertexArrayId = this->instancedVertexArrayIds.at(mesh);
+    }
+
+    std::span<const Resource::Surface> surfaces = mesh->getSurfaces();
+
+    resolved.firstSurface = this->resolvedSurfaces.size();
+    resolved.surfaceCount = surfaces.size();
+
+    for (auto& surface : surfaces) {
+      ResolvedSurface resolvedSurface;
+      resolvedSurface.primitiveType = getGLPrimitiveType(surface.primitiveType);
+      resolvedSurface.count = surface.indexCount;
+      resolvedSurface.indexOffset = (const GLvoid *)(surface.firstIndex * sizeof(GLushort));
+
+      this->resolvedSurfaces.push_back(resolvedSurface);
+    }
+
+    this->resolvedDraws.push_back(resolved);
+  }
+}
+
+Renderer::ResolvedMaterial Renderer::resolveMaterial(const Resource::Material *material) {
+  ResolvedMaterial resolved;
 
-  /* Initialize all vertex buffers. */
-  for (auto vertexBuffer = vertexBuffers.begin(); vertexBuffer != vertexBuffers.end(); vertexBuffer++, vertexBufferIdPtr++) {
-    glBindBuffer(GL_ARRAY_BUFFER, *vertexBufferIdPtr);
-    this->vertexBufferIds[(*vertexBuffer)->getHandle()] = *vertexBufferIdPtr;
+  memcpy(resolved.color, material->getColor(), 3 * sizeof(float));
 
-    glBufferData(GL_ARRAY_BUFFER, (*vertexBuffer)->getSize(), (*vertexBuffer)->getData(), GL_STATIC_DRAW);
+  /* Ensure that fragment colors come from the right place. */
+  const Resource::Texture *texture = material->getTexture();
+  if (texture) {
+    resolved.sampler = this->textureSamplers.at(texture->getHandle());
+
+    for (int i = 0; i < 3; i++) {
+      resolved.color[i] *= 0.5f;
+    }
+  } else {
+    resolved.sampler = -1;
   }
 
-  delete[] vertexBufferIds;
+  resolved.isAlphaBlended = material->isAlphaBlended();
+
+  return resolved;
 }
 
-void Renderer::renderGeometry(const std::list<const Resource::GeomObject *>& geometry) {
-  if (!this->isInitialized) {
-    DEBUG("renderer not initialized");
+void Renderer::applyMaterial(const ShaderManager::Uniforms& uniforms, const ResolvedMaterial& material) {
+  if (material.sampler != -1) {
+    glUniform1i(uniforms.materialTex, material.sampler);
+    glUniform1i(uniforms.hasTexture, 1);
+  } else {
+    glUniform1i(uniforms.hasTexture, 0);
   }
 
-  glEnable(GL_DEPTH_TEST);
-  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+  // if (renderObject.shaderType == UNLIT) {
+  //   glUniform2fv(alphaAnimUVUnif, 1, renderObject.material.alphaAnimUV);
+  // }
 
-  /* Initialize transformation matrices. */
-  const Math::Matrix& proj = State::getDisplayManager().getPerspectiveTransform();
-  const Math::Matrix& view = State::getCamera().getViewTransform();
+  // float colorMultipliers[2] = {1.0f, 1.0f};
+  // if (renderObject.material.flags & Model::Material::USE_VERTEX_COLOR) {
+  //   colorMultipliers[0] = 1.0f;
+  //   colorMultipliers[1] = 0.0f;
+  // }
 
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  /* Set per-mesh material color. */
+  glUniform3fv(uniforms.materialColor, 1, material.color);
+}
 
-  if (geometry.empty()) {
-    return;
+void Renderer::setAlphaBlendEnabled(bool enabled) {
+  if (enabled) {
+    glEnable(GL_BLEND);
+    // glEnable(GL_ALPHA_TEST);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    // glAlphaFunc(GL_GEQUAL, (float)((renderObject.material.rawFlags >> 0x17 & 0xff) << 1) / 255.0);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+  } else {
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    // glDisable(GL_ALPHA_TEST);
   }
+}
 
-  Math::Matrix projViewMtx = view * d3dTransform * proj;
+void Renderer::renderGeom(const Resource::GeomObject *geom) {
+  const Resource::Mesh *mesh = geom->getMesh();
 
-  for (auto geom : geometry) {
-    const Resource::Mesh *mesh = geom->getMesh();
+  GLuint shaderProgram = this->shaderManager.getShaderProgram(mesh->getShaderType());
+  glUseProgram(shaderProgram);
 
-    GLuint shaderProgram = this->shaderManager.getShaderProgram(mesh->getShaderType());
-    glUseProgram(shaderProgram);
+  const ShaderManager::Uniforms& uniforms = this->shaderManager.getUniforms(mesh->getShaderType());
 
-    // /* Pull out attribute and uniform locations. */
-    GLint tex_unif = glGetUniformLocation(shaderProgram, "materialTex");
-    GLint has_tex_unif = glGetUniformLocation(shaderProgram, "hasTexture");
+  ResolvedMaterial material = this->resolveMaterial(mesh->getMaterial());
+  this->applyMaterial(uniforms, material);
 
-    GLint projViewMtxUnif = glGetUniformLocation(shaderProgram, "projViewMtx");
-    GLint worldTransformUnif = glGetUniformLocation(shaderProgram, "meshTransformMtx");
+  if (material.isAlphaBlended) {
+    this->setAlphaBlendEnabled(true);
+  }
 
-    GLint color_unif = glGetUniformLocation(shaderProgram, "materialColor");
-    GLint multipliers_unif = glGetUniformLocation(shaderProgram, "colorMultipliers");
-    GLint skinMtcesUnif = glGetUniformLocation(shaderProgram, "skinTransformMtces");
+  /* Set per-mesh transformation matrix. */
+  if (uniforms.meshTransformMtx != -1) {
+    glUniformMatrix3x4fv(uniforms.meshTransformMtx, 1, GL_FALSE, &geom->getWorldTransform().rows[0][0]);
+  }
+
+  GLuint vertexArrayId = this->vertexArrayIds.at(mesh);
+  glBindVertexArray(vertexArrayId);
+
+  const std::vector<Math::AffineTransform>& skinTransforms = geom->getSkinTransforms();
+
+  for (auto& surface : mesh->getSurfaces()) {
+    if (uniforms.skinTransformMtces != -1) {
+      const uint16_t *indices = surface.skinTransformIndices;
+      unsigned count = surface.skinTransformCount;
+
+      assert(count <= 16);
+
+      float floats[16 * 12];
+      float *floatPtr = floats;
+      for (int i = 0; i < count; i++, floatPtr += 12) {
+        if (State::printNextFrame && surface.indexCount == 30) {
+          DEBUG("index at %d is %d", i, indices[i]);
+          DEBUG("base 0x%lx, 0x%lx", (unsigned long)floats, (unsigned long)floatPtr);
+        }
+
+        const float *transform = &skinTransforms.at(indices[i]).rows[0][0];
+        memcpy(floatPtr, transform, 12 * sizeof(float));
+      }
 
-    // if (renderObject.shaderType == UNLIT) {
-    //   glUniform2fv(alphaAnimUVUnif, 1, renderObject.material.alphaAnimUV);
-    // }
+      glUniformMatrix3x4fv(uniforms.skinTransformMtces, count, GL_FALSE, floats);
+    }
 
-    glUniformMatrix4fv(projViewMtxUnif, 1, GL_FALSE, projViewMtx.f);
+    GLenum glPrimitiveType = getGLPrimitiveType(surface.primitiveType);
+    glDrawElements(glPrimitiveType, surface.indexCount, GL_UNSIGNED_SHORT, (const GLvoid *)(surface.firstIndex * sizeof(GLushort)));
+  }
 
-    const Resource::Material *material = mesh->getMaterial();
+  if (material.isAlphaBlended) {
+    this->setAlphaBlendEnabled(false);
+  }
+}
 
-    float adjustedColor[3];
-    memcpy(adjustedColor, material->getColor(), 3 * sizeof(float));
+void Renderer::renderStaticDraws(const std::vector<unsigned>& staticDraws, size_t first, size_t last) {
+  if (first == last) {
+    return;
+  }
+
+  const std::vector<DrawList::Draw>& draws = this->drawList->getDraws();
+  const std::vector<Math::AffineTransform>& transforms = this->drawList->getTransforms();
 
-    /* Ensure that fragment colors come from the right place. */
-    const Resource::Texture *texture = material->getTexture();
-    if (texture) {
-      GLuint sampler = this->textureSamplers.at(texture->getHandle());
+  // Draws are sorted by blending, shader and material, so state only needs
+  // to be changed when those change
+  GLuint currentProgram = 0;
+  GLuint currentVertexArrayId = 0;
+  uint64_t currentMaterialKey = UINT64_MAX;
 
-      glUniform1i(tex_unif, sampler);
-      glUniform1i(has_tex_unif, 1);
+  bool isAlphaBlended = this->resolvedDraws[staticDraws[first]].material.isAlphaBlended;
+  if (isAlphaBlended) {
+    this->setAlphaBlendEnabled(true);
+  }
 
-      for (int i = 0; i < 3; i++) {
-        adjustedColor[i] *= 0.5f;
+  size_t position = first;
+  while (position < last) {
+    const DrawList::Draw& draw = draws[staticDraws[position]];
+    const ResolvedDraw& resolved = this->resolvedDraws[staticDraws[position]];
+
+    // Draws with equal sort keys share a mesh and material and sit next to
+    // each other, so each such run can be drawn at once
+    size_t runEnd = position + 1;
+    if (resolved.isInstanceable) {
+      while (runEnd < last && draws[staticDraws[runEnd]].sortKey == draw.sortKey) {
+        runEnd++;
       }
-    } else {
-      glUniform1i(has_tex_unif, 0);
     }
 
-    if (material->isAlphaBlended()) {
-      glEnable(GL_BLEND);
-      // glEnable(GL_ALPHA_TEST);
-      glBlendEquation(GL_FUNC_ADD);
-      glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-      // glAlphaFunc(GL_GEQUAL, (float)((renderObject.material.rawFlags >> 0x17 & 0xff) << 1) / 255.0);
-      glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE);
-      glDepthMask(GL_FALSE);
+    GLsizei instanceCount = runEnd - position;
+    bool isInstanced = instanceCount > 1;
+
+    GLuint program = isInstanced ? resolved.instancedProgram : resolved.program;
+    const ShaderManager::Uniforms& uniforms = isInstanced ? *resolved.instancedUniforms : *resolved.uniforms;
+    GLuint vertexArrayId = isInstanced ? resolved.instancedVertexArrayId : resolved.vertexArrayId;
+
+    if (program != currentProgram) {
+      glUseProgram(program);
+      currentProgram = program;
+      currentMaterialKey = UINT64_MAX;
     }
 
-    // float colorMultipliers[2] = {1.0f, 1.0f};
-    // if (renderObject.material.flags & Model::Material::USE_VERTEX_COLOR) {
-    //   colorMultipliers[0] = 1.0f;
-    //   colorMultipliers[1] = 0.0f;
-    // }
+    uint64_t materialKey = draw.sortKey >> 32;
+    if (materialKey != currentMaterialKey) {
+      this->applyMaterial(uniforms, resolved.material);
+      currentMaterialKey = materialKey;
+    }
 
-    /* Set per-mesh material color and transformation matrix. */
-    glUniform3fv(color_unif, 1, adjustedColor);
+    if (!isInstanced && uniforms.meshTransformMtx != -1) {
+      glUniformMatrix3x4fv(uniforms.meshTransformMtx, 1, GL_FALSE, &transforms[draw.transformIdx].rows[0][0]);
+    }
 
-    if (worldTransformUnif != -1) {
-      glUniformMatrix4fv(worldTransformUnif, 1, GL_FALSE, geom->getWorldTransform().f);
+    if (vertexArrayId != currentVertexArrayId) {
+      glBindVertexArray(vertexArrayId);
+      currentVertexArrayId = vertexArrayId;
     }
 
-    Resource::ResourceHandle meshHandle = mesh->getHandle();
+    if (isInstanced) {
+      // Rows of the stored transform become columns of the shader's matrix,
+      // matching how meshTransformMtx is uploaded
+      glBindBuffer(GL_ARRAY_BUFFER, this->instanceBufferId);
+      for (GLint column = 0; column < 3; column++) {
+        size_t offset = position * sizeof(Math::AffineTransform) + column * 4 * sizeof(float);
+        glVertexAttribPointer(resolved.instanceTransformAttr + column, 4, GL_FLOAT, GL_FALSE, sizeof(Math::AffineTransform), (GLvoid *)offset);
+      }
+    }
 
-    GLuint vertexArrayId = this->vertexArrayIds.at(meshHandle);
-    glBindVertexArray(vertexArrayId);
+    for (size_t i = resolved.firstSurface; i < resolved.firstSurface + resolved.surfaceCount; i++) {
+      const ResolvedSurface& surface = this->resolvedSurfaces[i];
 
-    std::vector<Math::Matrix> skinTransforms = geom->getSkinTransforms();
+      if (isInstanced) {
+        glDrawElementsInstanced(surface.primitiveType, surface.count, GL_UNSIGNED_SHORT, surface.indexOffset, instanceCount);
+      } else {
+        glDrawElements(surface.primitiveType, surface.count, GL_UNSIGNED_SHORT, surface.indexOffset);
+      }
 
-    const std::vector<Resource::Surface *>& surfaces = mesh->getSurfaces();
-    for (auto surface : surfaces) {
-      if (skinMtcesUnif != -1) {
-        const std::vector<ushort>& indices = surface->getSkinTransformIndices();
-        unsigned count = surface->getSkinTransformCount();
+      this->staticDrawCalls++;
+    }
 
-        assert(count <= 16);
+    position = runEnd;
+  }
 
-        float floats[256];
-        float *floatPtr = floats;
-        for (int i = 0; i < count; i++, floatPtr += 16) {
-          if (State::printNextFrame && surface->getIndexBuffer()->getCount() == 30) {
-            DEBUG("index at %d is %d", i, indices.at(i));
-            DEBUG("base 0x%lx, 0x%lx", (unsigned long)floats, (unsigned long)floatPtr);
-          }
+  if (isAlphaBlended) {
+    this->setAlphaBlendEnabled(false);
+  }
+}
+
+void Renderer::renderCrowds(const std::vector<Crowd>& crowds, bool isAlphaPass) {
+  GLint transformIndices[16];
+
+  if (isAlphaPass) {
+    this->setAlphaBlendEnabled(true);
+  }
 
-          const float *transform = skinTransforms.at(indices.at(i)).f;
-          memcpy(floatPtr, transform, 16 * sizeof(float));
+  for (size_t i = 0; i < crowds.size(); i++) {
+    const Crowd& crowd = crowds[i];
+    if (crowd.actorCount == 0) {
+      continue;
+    }
+
+    for (auto mesh : crowd.meshes) {
+      if (mesh->getMaterial()->isAlphaBlended() != isAlphaPass) {
+        continue;
+      }
+
+      Resource::ShaderType shaderType = mesh->getShaderType();
+
+      glUseProgram(this->shaderManager.getInstancedShaderProgram(shaderType));
+      const ShaderManager::Uniforms& uniforms = this->shaderManager.getInstancedUniforms(shaderType);
+
+      this->applyMaterial(uniforms, this->resolveMaterial(mesh->getMaterial()));
+
+      glUniform1i(uniforms.paletteOffset, this->crowdPaletteOffsets[i]);
+      glUniform1i(uniforms.paletteStride, crowd.jointCount);
+
+      glBindVertexArray(this->instancedVertexArrayIds.at(mesh));
+
+      for (auto& surface : mesh->getSurfaces()) {
+        unsigned count = surface.skinTransformCount;
+
+        assert(count <= 16);
+
+        for (unsigned j = 0; j < count; j++) {
+          transformIndices[j] = surface.skinTransformIndices[j];
         }
 
-        glUniformMatrix4fv(skinMtcesUnif, count, GL_TRUE, floats);
+        glUniform1iv(uniforms.skinTransformIndices, count, transformIndices);
+
+        GLenum glPrimitiveType = getGLPrimitiveType(surface.primitiveType);
+        glDrawElementsInstanced(glPrimitiveType, surface.indexCount, GL_UNSIGNED_SHORT, (const GLvoid *)(surface.firstIndex * sizeof(GLushort)), crowd.actorCount);
       }
+    }
+  }
 
-      Resource::ResourceHandle surfaceHandle = surface->getHandle();
+  if (isAlphaPass) {
+    this->setAlphaBlendEnabled(false);
+  }
+}
 
-      GLuint elementBufferId = this->elementBufferIds.at(surfaceHandle);
-      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBufferId);
+void Renderer::renderGeometry(const std::list<const Resource::GeomObject *>& geometry, const std::vector<unsigned>& staticDraws, const std::vector<Crowd>& crowds) {
+  if (!this->isInitialized) {
+    DEBUG("renderer not initialized");
+  }
 
-      GLenum glPrimitiveType = getGLPrimitiveType(surface->getPrimitiveType());
-      glDrawElements(glPrimitiveType, surface->getIndexBuffer()->getCount(), GL_UNSIGNED_SHORT, 0);
+  glEnable(GL_DEPTH_TEST);
+  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  if (geometry.empty() && staticDraws.empty() && crowds.empty()) {
+    return;
+  }
+
+  /* Initialize transformation matrices. */
+  Math::Matrix projViewMtx = this->getProjViewTransform();
+
+  // The view and projection are shared by every draw in a frame, so set them
+  // once per program up front
+  for (unsigned i = 0; i < Resource::getShaderCount(); i++) {
+    Resource::ShaderType shaderType = static_cast<Resource::ShaderType>(i);
+
+    glUseProgram(this->shaderManager.getShaderProgram(shaderType));
+    glUniformMatrix4fv(this->shaderManager.getUniforms(shaderType).projViewMtx, 1, GL_FALSE, projViewMtx.f);
+
+    if (this->shaderManager.hasInstancedVariant(shaderType)) {
+      glUseProgram(this->shaderManager.getInstancedShaderProgram(shaderType));
+      glUniformMatrix4fv(this->shaderManager.getInstancedUniforms(shaderType).projViewMtx, 1, GL_FALSE, projViewMtx.f);
     }
+  }
+
+  // Upload transforms for all visible static draws at once, so that each
+  // instanced batch only needs to point at its slice of the buffer
+  this->staticDrawCalls = 0;
+
+  if (!staticDraws.empty()) {
+    const std::vector<DrawList::Draw>& draws = this->drawList->getDraws();
+    const std::vector<Math::AffineTransform>& transforms = this->drawList->getTransforms();
 
-    if (material->isAlphaBlended()) {
-      glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-      glDepthMask(GL_TRUE);
-      glDisable(GL_BLEND);
-      // glDisable(GL_ALPHA_TEST);
+    this->instanceTransforms.clear();
+    for (auto drawIdx : staticDraws) {
+      this->instanceTransforms.push_back(transforms[draws[drawIdx].transformIdx]);
     }
+
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceBufferId);
+    glBufferData(GL_ARRAY_BUFFER, this->instanceTransforms.size() * sizeof(Math::AffineTransform), this->instanceTransforms.data(), GL_STREAM_DRAW);
+  }
+
+  // Crowd palettes are likewise uploaded together, each crowd reading from
+  // its own offset
+  this->crowdPalettes.clear();
+  this->crowdPaletteOffsets.clear();
+
+  for (auto& crowd : crowds) {
+    this->crowdPaletteOffsets.push_back(this->crowdPalettes.size());
+    this->crowdPalettes.insert(this->crowdPalettes.end(), crowd.palettes.begin(), crowd.palettes.end());
+  }
+
+  if (!this->crowdPalettes.empty()) {
+    glBindBuffer(GL_TEXTURE_BUFFER, this->paletteBufferId);
+    glBufferData(GL_TEXTURE_BUFFER, this->crowdPalettes.size() * sizeof(Math::AffineTransform), this->crowdPalettes.data(), GL_STREAM_DRAW);
+  }
+
+  // Opaque static draws go first, then opaque crowds, then dynamic geometry
+  // (itself ordered opaque before alpha-blended), then alpha-blended crowds,
+  // and finally alpha-blended static draws
+  size_t firstAlphaDraw = staticDraws.size();
+  if (this->drawList) {
+    firstAlphaDraw = std::lower_bound(staticDraws.begin(), staticDraws.end(), this->drawList->getOpaqueCount()) - staticDraws.begin();
+  }
+
+  this->renderStaticDraws(staticDraws, 0, firstAlphaDraw);
+
+  this->renderCrowds(crowds, false);
+
+  for (auto geom : geometry) {
+    this->renderGeom(geom);
+  }
+
+  this->renderCrowds(crowds, true);
+
+  this->renderStaticDraws(staticDraws, firstAlphaDraw, staticDraws.size());
+
+  if (State::printNextFrame) {
+    DEBUG("static geometry: %lu draws submitted in %u draw calls", staticDraws.size(), this->staticDrawCalls);
   }
 
   SDL_GL_SwapWindow(State::getDisplayManager().getWindow());
 }
+
+Mortar::Math::Matrix Renderer::getProjViewTransform() const {
+  const Math::Matrix& proj = State::getDisplayManager().getPerspectiveTransform();
+  const Math::Matrix& view = State::getCamera().getViewTransform();
+
+  return view * d3dTransform * proj;
+}
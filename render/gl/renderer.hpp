@@ -21,6 +21,7 @@
 #include <list>
 #include <tsl/sparse_map.h>
 
+#include "../../math/affine.hpp"
 #include "../../math/matrix.hpp"
 #include "../renderer.hpp"
 #include "shader.hpp"
@@ -29,26 +30,105 @@ namespace Mortar::Render::GL {
   class Renderer : public Mortar::Render::Renderer {
     public:
       Renderer() :
+        drawList { nullptr },
         d3dTransform { Math::Matrix::diagonal(1.0f, 1.0f, -1.0f) } {};
 
       void initialize() override;
       void shutDown() override;
 
-      void registerMeshes(const std::vector<const Resource::Mesh *>& meshes) override;
+      void registerModel(const Resource::Model *model) override;
       void registerTextures(const std::vector<const Resource::Texture *>& textures) override;
-      void registerVertexBuffers(const std::vector<const Resource::VertexBuffer *>& vertexBuffers) override;
 
-      void renderGeometry(const std::list<const Resource::GeomObject *>& geometry) override;
+      void registerDrawList(const DrawList *drawList) override;
+
+      void renderGeometry(const std::list<const Resource::GeomObject *>& geometry, const std::vector<unsigned>& staticDraws, const std::vector<Crowd>& crowds) override;
+
+      Math::Matrix getProjViewTransform() const override;
 
     private:
+      class ResolvedMaterial {
+        public:
+          GLint sampler;
+          float color[3];
+          bool isAlphaBlended;
+      };
+
+      class ResolvedSurface {
+        public:
+          GLenum primitiveType;
+          GLsizei count;
+          const GLvoid *indexOffset;
+      };
+
+      // Draw list entries with all GL state they require looked up ahead of
+      // time
+      class ResolvedDraw {
+        public:
+          GLuint program;
+          const ShaderManager::Uniforms *uniforms;
+          GLuint vertexArrayId;
+
+          // Used when several draws of the same mesh and material are
+          // submitted together; isInstanceable is false when the mesh's
+          // shader has no instanced variant
+          bool isInstanceable;
+          GLuint instancedProgram;
+          const ShaderManager::Uniforms *instancedUniforms;
+          GLuint instancedVertexArrayId;
+          GLint instanceTransformAttr;
+
+          ResolvedMaterial material;
+
+          size_t firstSurface;
+          size_t surfaceCount;
+      };
+
+      ResolvedMaterial resolveMaterial(const Resource::Material *material);
+
+      void applyMaterial(const ShaderManager::Uniforms& uniforms, const ResolvedMaterial& material);
+      void setAlphaBlendEnabled(bool enabled);
+
+      void setUpVertexAttributes(const Resource::Mesh *mesh, GLuint shaderProgram);
+
+      void renderGeom(const Resource::GeomObject *geom);
+
+      // Renders the static draws in the given range of positions in
+      // staticDraws; instance transforms for the whole list must already
+      // have been uploaded
+      void renderStaticDraws(const std::vector<unsigned>& staticDraws, size_t first, size_t last);
+
+      // Renders either the opaque or the alpha-blended meshes of each crowd;
+      // palettes for all crowds must already have been uploaded
+      void renderCrowds(const std::vector<Crowd>& crowds, bool isAlphaPass);
+
       ShaderManager shaderManager;
       bool isInitialized;
 
-      tsl::sparse_map<Resource::ResourceHandle, GLuint> elementBufferIds;
+      const DrawList *drawList;
+      std::vector<ResolvedDraw> resolvedDraws;
+      std::vector<ResolvedSurface> resolvedSurfaces;
+
+      // Holds the world transform of every visible static draw for the
+      // current frame, in submission order
+      GLuint instanceBufferId;
+      std::vector<Math::AffineTransform> instanceTransforms;
+      unsigned staticDrawCalls;
+
+      // Crowd skin palettes are packed into a single buffer texture, bound
+      // to a texture unit reserved for it
+      GLuint paletteBufferId;
+      GLuint paletteTextureId;
+      GLint paletteTextureUnit;
+      std::vector<Math::AffineTransform> crowdPalettes;
+      std::vector<unsigned> crowdPaletteOffsets;
+
+      // Each model's vertex and index tables are uploaded to a buffer apiece
+      std::vector<GLuint> modelBufferIds;
+
       tsl::sparse_map<Resource::ResourceHandle, GLuint> textureIds;
       tsl::sparse_map<Resource::ResourceHandle, GLuint> textureSamplers;
-      tsl::sparse_map<Resource::ResourceHandle, GLuint> vertexArrayIds;
-      tsl::sparse_map<Resource::ResourceHandle, GLuint> vertexBufferIds;
+      tsl::sparse_map<const Resource::Mesh *, GLuint> vertexArrayIds;
+      tsl::sparse_map<const Resource::Mesh *, GLuint> instancedVertexArrayIds;
 
       const Math::Matrix d3dTransform;
   };
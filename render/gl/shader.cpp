@@ -30,7 +30,7 @@ using namespace Mortar::Render::GL;
 
 const char *unlitVertexSource = GLSL(
   uniform mat4 projViewMtx;
-  uniform mat4 meshTransformMtx;
+  uniform mat3x4 meshTransformMtx;
 
   uniform vec3 materialColor;
   uniform vec2 colorMultipliers;
@@ -52,7 +52,7 @@ const char *unlitVertexSource = GLSL(
 
     fragColor = vec4(adjustedVertColor + adjustedMatColor, color.w);
 
-    gl_Position = projViewMtx * meshTransformMtx * vec4(position, 1.0);
+    gl_Position = projViewMtx * vec4(vec4(position, 1.0) * meshTransformMtx, 1.0);
   }
 );
 
@@ -77,7 +77,7 @@ const GLchar *unlitFragmentSource = GLSL(
 
 const GLchar *skinVertexSource = GLSL(
   uniform mat4 projViewMtx;
-	uniform mat4 skinTransformMtces[16];
+	uniform mat3x4 skinTransformMtces[16];
 
   uniform vec3 materialColor;
   uniform vec2 colorMultipliers;
@@ -101,9 +101,9 @@ const GLchar *skinVertexSource = GLSL(
     float weight2 = 1 - blendWeights.x - blendWeights.y;
 
     vec4 normal4 = vec4(normal, 0.0f);
-    vec3 normalBlend0 = (normal4 * skinTransformMtces[intBlendIndices.x] * blendWeights.x).xyz;
-    vec3 normalBlend1 = (normal4 * skinTransformMtces[intBlendIndices.y] * blendWeights.y).xyz;
-    vec3 normalBlend2 = (normal4 * skinTransformMtces[intBlendIndices.z] * weight2).xyz;
+    vec3 normalBlend0 = normal4 * skinTransformMtces[intBlendIndices.x] * blendWeights.x;
+    vec3 normalBlend1 = normal4 * skinTransformMtces[intBlendIndices.y] * blendWeights.y;
+    vec3 normalBlend2 = normal4 * skinTransformMtces[intBlendIndices.z] * weight2;
 
     vec3 transformedNormal = normalBlend0 + normalBlend1 + normalBlend2;
 
@@ -114,9 +114,9 @@ const GLchar *skinVertexSource = GLSL(
     fragColor = vec4(materialColor * (light0Color, light1Color, light2Color + vec3(0.4, 0.4, 0.4)), color.w);
 
     vec4 position4 = vec4(position, 1.0f);
-    vec3 positionBlend0 = (position4 * skinTransformMtces[intBlendIndices.x] * blendWeights.x).xyz;
-    vec3 positionBlend1 = (position4 * skinTransformMtces[intBlendIndices.y] * blendWeights.y).xyz;
-    vec3 positionBlend2 = (position4 * skinTransformMtces[intBlendIndices.z] * weight2).xyz;
+    vec3 positionBlend0 = position4 * skinTransformMtces[intBlendIndices.x] * blendWeights.x;
+    vec3 positionBlend1 = position4 * skinTransformMtces[intBlendIndices.y] * blendWeights.y;
+    vec3 positionBlend2 = position4 * skinTransformMtces[intBlendIndices.z] * weight2;
 
     vec3 transformedPosition = positionBlend0 + positionBlend1 + positionBlend2;
 
@@ -146,7 +146,7 @@ const GLchar *skinFragmentSource = GLSL(
 
 const GLchar *basicVertexSource = GLSL(
   uniform mat4 projViewMtx;
-  uniform mat4 meshTransformMtx;
+  uniform mat3x4 meshTransformMtx;
 
   uniform vec3 materialColor;
   uniform vec2 colorMultipliers;
@@ -163,7 +163,7 @@ const GLchar *basicVertexSource = GLSL(
   {
     fragTexCoord = texCoord;
 
-    vec3 transformedNormal = (meshTransformMtx * vec4(normal, 0.0)).xyz;
+    vec3 transformedNormal = vec4(normal, 0.0) * meshTransformMtx;
 
     vec3 light0Color = max(dot(normalize(vec3(1.0, 0.0, 0.0)), transformedNormal), 0) * vec3(1.0, 1.0, 1.0);
     vec3 light1Color = max(dot(normalize(vec3(0.0, 1.0, 0.0)), transformedNormal), 0) * vec3(1.0, 1.0, 1.0);
@@ -171,7 +171,7 @@ const GLchar *basicVertexSource = GLSL(
 
     fragColor = vec4(materialColor * (light0Color, light1Color, light2Color + vec3(0.4, 0.4, 0.4)), color.w);
 
-    gl_Position = projViewMtx * meshTransformMtx * vec4(position, 1.0);
+    gl_Position = projViewMtx * vec4(vec4(position, 1.0) * meshTransformMtx, 1.0);
   }
 );
 
@@ -195,12 +195,147 @@ const GLchar *basicFragmentSource = GLSL(
   }
 );
 
+// Instanced variants take the mesh transform from a per-instance attribute
+// rather than a uniform, allowing many copies of a mesh in a single draw
+const char *unlitInstancedVertexSource = GLSL(
+  uniform mat4 projViewMtx;
+
+  uniform vec3 materialColor;
+  uniform vec2 colorMultipliers;
+  uniform vec2 alphaAnimUV;
+
+  in vec3 position;
+  in vec4 color;
+  in vec2 texCoord;
+  in mat3x4 instanceTransformMtx;
+
+  out vec2 fragTexCoord;
+  out vec4 fragColor;
+
+  void main()
+  {
+    fragTexCoord = texCoord;
+
+    vec3 adjustedVertColor = colorMultipliers.x * vec3(color.xyz);
+    vec3 adjustedMatColor = colorMultipliers.y * materialColor;
+
+    fragColor = vec4(adjustedVertColor + adjustedMatColor, color.w);
+
+    gl_Position = projViewMtx * vec4(vec4(position, 1.0) * instanceTransformMtx, 1.0);
+  }
+);
+
+const GLchar *basicInstancedVertexSource = GLSL(
+  uniform mat4 projViewMtx;
+
+  uniform vec3 materialColor;
+  uniform vec2 colorMultipliers;
+
+  in vec3 position;
+  in vec3 normal;
+  in vec4 color;
+  in vec2 texCoord;
+  in mat3x4 instanceTransformMtx;
+
+  out vec4 fragColor;
+  out vec2 fragTexCoord;
+
+  void main()
+  {
+    fragTexCoord = texCoord;
+
+    vec3 transformedNormal = vec4(normal, 0.0) * instanceTransformMtx;
+
+    vec3 light0Color = max(dot(normalize(vec3(1.0, 0.0, 0.0)), transformedNormal), 0) * vec3(1.0, 1.0, 1.0);
+    vec3 light1Color = max(dot(normalize(vec3(0.0, 1.0, 0.0)), transformedNormal), 0) * vec3(1.0, 1.0, 1.0);
+    vec3 light2Color = max(dot(normalize(vec3(0.0, 0.0, -1.0)), transformedNormal), 0) * vec3(1.0, 1.0, 1.0);
+
+    fragColor = vec4(materialColor * (light0Color, light1Color, light2Color + vec3(0.4, 0.4, 0.4)), color.w);
+
+    gl_Position = projViewMtx * vec4(vec4(position, 1.0) * instanceTransformMtx, 1.0);
+  }
+);
+
+// Skinned instances fetch their palettes from a buffer texture holding every
+// actor's skin transforms, one stored row per texel; blend indices select
+// from the surface's palette, which maps in turn to the actor's joints
+const GLchar *skinInstancedVertexSource = GLSL(
+  uniform mat4 projViewMtx;
+
+  uniform samplerBuffer skinPalettes;
+  uniform int paletteOffset;
+  uniform int paletteStride;
+  uniform int skinTransformIndices[16];
+
+  uniform vec3 materialColor;
+  uniform vec2 colorMultipliers;
+
+  in vec3 position;
+  in vec2 blendWeights;
+  in vec3 blendIndices;
+  in vec3 normal;
+  in vec4 color;
+  in vec2 texCoord;
+
+  out vec4 fragColor;
+  out vec2 fragTexCoord;
+
+  mat3x4 fetchSkinTransform(int idx)
+  {
+    int base = (paletteOffset + gl_InstanceID * paletteStride + skinTransformIndices[idx]) * 3;
+
+    // Stored rows are columns of the shader's matrix, as in the uniform path
+    return mat3x4(texelFetch(skinPalettes, base), texelFetch(skinPalettes, base + 1), texelFetch(skinPalettes, base + 2));
+  }
+
+  void main()
+  {
+    fragTexCoord = texCoord;
+
+    ivec3 intBlendIndices = ivec3(blendIndices);
+
+    mat3x4 skin0 = fetchSkinTransform(intBlendIndices.x);
+    mat3x4 skin1 = fetchSkinTransform(intBlendIndices.y);
+    mat3x4 skin2 = fetchSkinTransform(intBlendIndices.z);
+
+    float weight2 = 1 - blendWeights.x - blendWeights.y;
+
+    vec4 normal4 = vec4(normal, 0.0f);
+    vec3 normalBlend0 = normal4 * skin0 * blendWeights.x;
+    vec3 normalBlend1 = normal4 * skin1 * blendWeights.y;
+    vec3 normalBlend2 = normal4 * skin2 * weight2;
+
+    vec3 transformedNormal = normalBlend0 + normalBlend1 + normalBlend2;
+
+    vec3 light0Color = max(dot(normalize(vec3(1.0, 0.0, 0.0)), transformedNormal), 0) * vec3(1.0, 1.0, 1.0);
+    vec3 light1Color = max(dot(normalize(vec3(0.0, 1.0, 0.0)), transformedNormal), 0) * vec3(1.0, 1.0, 1.0);
+    vec3 light2Color = max(dot(normalize(vec3(0.0, 0.0, -1.0)), transformedNormal), 0) * vec3(1.0, 1.0, 1.0);
+
+    fragColor = vec4(materialColor * (light0Color, light1Color, light2Color + vec3(0.4, 0.4, 0.4)), color.w);
+
+    vec4 position4 = vec4(position, 1.0f);
+    vec3 positionBlend0 = position4 * skin0 * blendWeights.x;
+    vec3 positionBlend1 = position4 * skin1 * blendWeights.y;
+    vec3 positionBlend2 = position4 * skin2 * weight2;
+
+    vec3 transformedPosition = positionBlend0 + positionBlend1 + positionBlend2;
+
+    gl_Position = projViewMtx * vec4(transformedPosition, 1.0);
+  }
+);
+
 const GLchar *shaderSources[Mortar::Resource::getShaderCount()][2] = {
   { unlitVertexSource, unlitFragmentSource },
   { skinVertexSource, skinFragmentSource },
   { basicVertexSource, basicFragmentSource },
 };
 
+const GLchar *instancedShaderSources[Mortar::Resource::getShaderCount()][2] = {
+  { unlitInstancedVertexSource, unlitFragmentSource },
+  { skinInstancedVertexSource, skinFragmentSource },
+  { basicInstancedVertexSource, basicFragmentSource },
+};
+
 int checkCompileStatus(GLuint shader) {
   int success;
   glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
@@ -262,23 +397,57 @@ void ShaderManager::ShaderProgram::initialize(const GLchar *vertexShaderSrc, con
   }
 
   DEBUG("created program %d, successful link: %d", this->program, success);
+
+  this->uniforms.projViewMtx = glGetUniformLocation(this->program, "projViewMtx");
+  this->uniforms.meshTransformMtx = glGetUniformLocation(this->program, "meshTransformMtx");
+  this->uniforms.skinTransformMtces = glGetUniformLocation(this->program, "skinTransformMtces");
+
+  this->uniforms.materialColor = glGetUniformLocation(this->program, "materialColor");
+  this->uniforms.materialTex = glGetUniformLocation(this->program, "materialTex");
+  this->uniforms.hasTexture = glGetUniformLocation(this->program, "hasTexture");
+
+  this->uniforms.skinPalettes = glGetUniformLocation(this->program, "skinPalettes");
+  this->uniforms.paletteOffset = glGetUniformLocation(this->program, "paletteOffset");
+  this->uniforms.paletteStride = glGetUniformLocation(this->program, "paletteStride");
+  this->uniforms.skinTransformIndices = glGetUniformLocation(this->program, "skinTransformIndices");
+
+  this->instanceTransformAttr = glGetAttribLocation(this->program, "instanceTransformMtx");
 }
 
 GLuint ShaderManager::ShaderProgram::getShaderProgram() {
   return this->program;
 }
 
+const ShaderManager::Uniforms& ShaderManager::ShaderProgram::getUniforms() {
+  return this->uniforms;
+}
+
+GLint ShaderManager::ShaderProgram::getInstanceTransformAttr() {
+  return this->instanceTransformAttr;
+}
+
 ShaderManager::ShaderManager() {
   this->shaderPrograms.resize(Mortar::Resource::getShaderCount());
   for (auto program = this->shaderPrograms.begin(); program != this->shaderPrograms.end(); program++) {
     *program = new ShaderProgram();
   }
+
+  this->instancedShaderPrograms.resize(Mortar::Resource::getShaderCount());
+  for (unsigned i = 0; i < this->instancedShaderPrograms.size(); i++) {
+    this->instancedShaderPrograms[i] = instancedShaderSources[i][0] ? new ShaderProgram() : nullptr;
+  }
 }
 
 void ShaderManager::initialize() {
   for (int i = 0; i < this->shaderPrograms.size(); i++) {
     this->shaderPrograms[i]->initialize(shaderSources[i][0], shaderSources[i][1]);
   }
+
+  for (unsigned i = 0; i < this->instancedShaderPrograms.size(); i++) {
+    if (this->instancedShaderPrograms[i]) {
+      this->instancedShaderPrograms[i]->initialize(instancedShaderSources[i][0], instancedShaderSources[i][1]);
+    }
+  }
 }
 
 void ShaderManager::shutDown() {
@@ -288,6 +457,15 @@ void ShaderManager::shutDown() {
   }
 
   this->shaderPrograms.clear();
+
+  for (auto program : this->instancedShaderPrograms) {
+    if (program) {
+      program->shutDown();
+      delete program;
+    }
+  }
+
+  this->instancedShaderPrograms.clear();
 }
 
 GLuint ShaderManager::getShaderProgram(Resource::ShaderType shaderType) {
@@ -297,3 +475,43 @@ GLuint ShaderManager::getShaderProgram(Resource::ShaderType shaderType) {
 
   return this->shaderPrograms[static_cast<size_t>(shaderType)]->getShaderProgram();
 }
+
+const ShaderManager::Uniforms& ShaderManager::getUniforms(Resource::ShaderType shaderType) {
+  if (shaderType == Resource::ShaderType::INVALID) {
+    throw std::runtime_error("invalid shader type");
+  }
+
+  return this->shaderPrograms[static_cast<size_t>(shaderType)]->getUniforms();
+}
+
+bool ShaderManager::hasInstancedVariant(Resource::ShaderType shaderType) {
+  if (shaderType == Resource::ShaderType::INVALID) {
+    throw std::runtime_error("invalid shader type");
+  }
+
+  return this->instancedShaderPrograms[static_cast<size_t>(shaderType)] != nullptr;
+}
+
+GLuint ShaderManager::getInstancedShaderProgram(Resource::ShaderType shaderType) {
+  if (!this->hasInstancedVariant(shaderType)) {
+    throw std::runtime_error("shader type has no instanced variant");
+  }
+
+  return this->instancedShaderPrograms[static_cast<size_t>(shaderType)]->getShaderProgram();
+}
+
+const ShaderManager::Uniforms& ShaderManager::getInstancedUniforms(Resource::ShaderType shaderType) {
+  if (!this->hasInstancedVariant(shaderType)) {
+    throw std::runtime_error("shader type has no instanced variant");
+  }
+
+  return this->instancedShaderPrograms[static_cast<size_t>(shaderType)]->getUniforms();
+}
+
+GLint ShaderManager::getInstanceTransformAttr(Resource::ShaderType shaderType) {
+  if (!this->hasInstancedVariant(shaderType)) {
+    throw std::runtime_error("shader type has no instanced variant");
+  }
+
+  return this->instancedShaderPrograms[static_cast<size_t>(shaderType)]->getInstanceTransformAttr();
+}
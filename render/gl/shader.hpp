@@ -25,12 +25,41 @@
 namespace Mortar::Render::GL {
   class ShaderManager {
     public:
+      // Uniform locations are looked up once at link time rather than on
+      // every draw
+      class Uniforms {
+        public:
+          GLint projViewMtx;
+          GLint meshTransformMtx;
+          GLint skinTransformMtces;
+
+          GLint materialColor;
+          GLint materialTex;
+          GLint hasTexture;
+
+          // Only present in the instanced skin variant
+          GLint skinPalettes;
+          GLint paletteOffset;
+          GLint paletteStride;
+          GLint skinTransformIndices;
+      };
+
       ShaderManager();
 
       void initialize();
       void shutDown();
 
       GLuint getShaderProgram(Mortar::Resource::ShaderType shaderType);
+      const Uniforms& getUniforms(Mortar::Resource::ShaderType shaderType);
+
+      // Instanced variants of rigid shaders read the mesh transform from a
+      // four-column vertex attribute with a divisor of one in place of
+      // meshTransformMtx, while the skin variant reads palettes from a
+      // buffer texture; getInstanceTransformAttr returns -1 for the latter
+      bool hasInstancedVariant(Mortar::Resource::ShaderType shaderType);
+      GLuint getInstancedShaderProgram(Mortar::Resource::ShaderType shaderType);
+      const Uniforms& getInstancedUniforms(Mortar::Resource::ShaderType shaderType);
+      GLint getInstanceTransformAttr(Mortar::Resource::ShaderType shaderType);
 
     private:
       class ShaderProgram {
@@ -44,14 +73,20 @@ namespace Mortar::Render::GL {
           void shutDown();
 
           GLuint getShaderProgram();
+          const Uniforms& getUniforms();
+          GLint getInstanceTransformAttr();
 
         private:
+          Uniforms uniforms;
+          GLint instanceTransformAttr;
+
           GLint program;
           GLint vertexShader;
           GLint fragmentShader;
       };
 
       std::vector<ShaderProgram *> shaderPrograms;
+      std::vector<ShaderProgram *> instancedShaderPrograms;
 };
 }
 
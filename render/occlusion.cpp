@@ -0,0 +1,511 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <math.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#include "occlusion.hpp"
+
+using namespace Mortar::Render;
+
+// The depth buffer only needs to be fine enough to resolve large occluders,
+// so it is kept far smaller than the display
+static const int BUFFER_WIDTH = 320;
+static const int BUFFER_HEIGHT = 192;
+
+static const int TILE_WIDTH = 64;
+static const int TILE_HEIGHT = 48;
+static const int TILES_X = BUFFER_WIDTH / TILE_WIDTH;
+static const int TILES_Y = BUFFER_HEIGHT / TILE_HEIGHT;
+
+static const int BLOCK_SIZE = 8;
+static const int BLOCKS_X = BUFFER_WIDTH / BLOCK_SIZE;
+static const int BLOCKS_Y = BUFFER_HEIGHT / BLOCK_SIZE;
+
+static const unsigned SETUP_BATCH_SIZE = 1024;
+static const unsigned TEST_BATCH_SIZE = 64;
+
+// Depth of the far plane in normalized device coordinates
+static const float FAR_DEPTH = 1.0f;
+
+static unsigned countTriangles(const Mortar::Resource::Surface& surface) {
+  unsigned count = surface.indexCount;
+
+  switch (surface.primitiveType) {
+    case Mortar::Resource::PrimitiveType::TRIANGLE_LIST:
+      return count / 3;
+    case Mortar::Resource::PrimitiveType::TRIANGLE_STRIP:
+      return count > 2 ? count - 2 : 0;
+    default:
+      return 0;
+  }
+}
+
+static bool isOccluderMesh(const Mortar::Resource::Mesh *mesh) {
+  return mesh->getVertexDataSize() != 0 && !mesh->getMaterial()->isAlphaBlended();
+}
+
+float OcclusionCuller::Stats::getRejectionRate() const {
+  return this->tested ? (float)this->rejected / this->tested : 0.0f;
+}
+
+float OcclusionCuller::getMinOccluderRadius() const {
+  return this->minOccluderRadius;
+}
+
+void OcclusionCuller::setMinOccluderRadius(float radius) {
+  this->minOccluderRadius = radius;
+}
+
+unsigned OcclusionCuller::getMaxOccluderTriangles() const {
+  return this->maxOccluderTriangles;
+}
+
+void OcclusionCuller::setMaxOccluderTriangles(unsigned count) {
+  this->maxOccluderTriangles = count;
+}
+
+void OcclusionCuller::selectOccluders(const Resource::Scene *scene) {
+  const std::vector<Math::Bounds>& instanceBounds = scene->getInstanceBounds();
+  std::vector<unsigned> candidates;
+
+  for (unsigned i = 0; i < scene->getInstanceCount(); i++) {
+    if (!instanceBounds[i].isEmpty() && instanceBounds[i].radius >= this->minOccluderRadius) {
+      candidates.push_back(i);
+    }
+  }
+
+  // Bigger instances are likelier to hide something, so they get first claim
+  // on the triangle budget
+  std::sort(candidates.begin(), candidates.end(), [&] (unsigned a, unsigned b) {
+    return instanceBounds[a].radius > instanceBounds[b].radius;
+  });
+
+  for (auto i : candidates) {
+    unsigned triangleCount = 0;
+
+    for (auto mesh : scene->getInstanceMeshes(i)) {
+      if (!isOccluderMesh(mesh)) {
+        continue;
+      }
+
+      for (auto& surface : mesh->getSurfaces()) {
+        triangleCount += countTriangles(surface);
+      }
+    }
+
+    if (triangleCount == 0 || this->stats.occluderTriangles + triangleCount > this->maxOccluderTriangles) {
+      continue;
+    }
+
+    this->addOccluder(scene, i);
+  }
+}
+
+void OcclusionCuller::addOccluder(const Resource::Scene *scene, unsigned instanceIdx) {
+  const Math::AffineTransform& worldTransform = scene->getInstanceTransforms()[instanceIdx];
+
+  for (auto mesh : scene->getInstanceMeshes(instanceIdx)) {
+    if (isOccluderMesh(mesh)) {
+      this->stats.occluderTriangles += this->addMesh(mesh, worldTransform);
+    }
+  }
+
+  this->triangles.resize(this->occluderVertices.size() / 3);
+}
+
+unsigned OcclusionCuller::addMesh(const Resource::Mesh *mesh, const Math::AffineTransform& worldTransform) {
+  const Resource::VertexLayout& layout = mesh->getVertexLayout();
+  const Resource::VertexLayout::VertexProperty *positionProperty = layout.getProperty(Resource::VertexUsage::POSITION);
+  if (!positionProperty) {
+    return 0;
+  }
+
+  unsigned added = 0;
+
+  // Winding is ignored, as occluders are rasterized double-sided
+  mesh->forEachTriangle([&] (uint16_t a, uint16_t b, uint16_t c) {
+    for (auto index : { a, b, c }) {
+      Math::Vector position = mesh->readVertexProperty(index, *positionProperty);
+      this->occluderVertices.push_back(worldTransform.transformPoint(position));
+    }
+
+    added++;
+  });
+
+  return added;
+}
+
+void OcclusionCuller::clear() {
+  this->occluderVertices.clear();
+  this->triangles.clear();
+  this->tileTriangles.clear();
+  this->depth.clear();
+  this->blockDepth.clear();
+
+  this->stats = Stats();
+}
+
+void OcclusionCuller::render(const Math::Matrix& projView, WorkerPool& workers) {
+  this->projView = projView;
+
+  this->stats.rasterizedTriangles = 0;
+  this->stats.tested = 0;
+  this->stats.rejected = 0;
+
+  this->depth.resize(BUFFER_WIDTH * BUFFER_HEIGHT);
+  this->blockDepth.resize(BLOCKS_X * BLOCKS_Y);
+  this->tileTriangles.resize(TILES_X * TILES_Y);
+
+  // Project and set up triangles in parallel; a triangle which cannot be
+  // rasterized is marked by an empty pixel range
+  unsigned triangleCount = this->triangles.size();
+  unsigned setupBatchCount = (triangleCount + SETUP_BATCH_SIZE - 1) / SETUP_BATCH_SIZE;
+
+  workers.run(setupBatchCount, [&] (unsigned batch) {
+    unsigned end = std::min((batch + 1) * SETUP_BATCH_SIZE, triangleCount);
+
+    for (unsigned i = batch * SETUP_BATCH_SIZE; i < end; i++) {
+      Triangle& triangle = this->triangles[i];
+      triangle.minX = 1;
+      triangle.maxX = 0;
+
+      bool isClipped = false;
+
+      for (unsigned j = 0; j < 3; j++) {
+        Math::Vector clip = this->occluderVertices[i * 3 + j] * projView;
+
+        // Occluders crossing the near plane would hide things GL still
+        // draws, so they are skipped rather than clipped
+        if (clip.w <= 0.0f || clip.z < -clip.w) {
+          isClipped = true;
+          break;
+        }
+
+        float invW = 1.0f / clip.w;
+
+        triangle.x[j] = (clip.x * invW * 0.5f + 0.5f) * BUFFER_WIDTH;
+        triangle.y[j] = (0.5f - clip.y * invW * 0.5f) * BUFFER_HEIGHT;
+        triangle.z[j] = clip.z * invW;
+      }
+
+      if (isClipped) {
+        continue;
+      }
+
+      float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+      if (area == 0.0f) {
+        continue;
+      }
+
+      // Keep a consistent winding so that interior points have positive edge
+      // values
+      if (area < 0.0f) {
+        std::swap(triangle.x[1], triangle.x[2]);
+        std::swap(triangle.y[1], triangle.y[2]);
+        std::swap(triangle.z[1], triangle.z[2]);
+      }
+
+      // Pixels are sampled at their centers, so only those with centers
+      // inside the triangle's extents can be covered
+      float minX = std::min({ triangle.x[0], triangle.x[1], triangle.x[2] });
+      float maxX = std::max({ triangle.x[0], triangle.x[1], triangle.x[2] });
+      float minY = std::min({ triangle.y[0], triangle.y[1], triangle.y[2] });
+      float maxY = std::max({ triangle.y[0], triangle.y[1], triangle.y[2] });
+
+      triangle.minX = std::max((int)ceilf(minX - 0.5f), 0);
+      triangle.maxX = std::min((int)floorf(maxX - 0.5f), BUFFER_WIDTH - 1);
+      triangle.minY = std::max((int)ceilf(minY - 0.5f), 0);
+      triangle.maxY = std::min((int)floorf(maxY - 0.5f), BUFFER_HEIGHT - 1);
+    }
+  });
+
+  // Binning is cheap next to rasterization and keeps tile lists in
+  // submission order, so it is done serially
+  for (auto& bin : this->tileTriangles) {
+    bin.clear();
+  }
+
+  for (unsigned i = 0; i < triangleCount; i++) {
+    const Triangle& triangle = this->triangles[i];
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+      continue;
+    }
+
+    this->stats.rasterizedTriangles++;
+
+    for (int tileY = triangle.minY / TILE_HEIGHT; tileY <= triangle.maxY / TILE_HEIGHT; tileY++) {
+      for (int tileX = triangle.minX / TILE_WIDTH; tileX <= triangle.maxX / TILE_WIDTH; tileX++) {
+        this->tileTriangles[tileY * TILES_X + tileX].push_back(i);
+      }
+    }
+  }
+
+  workers.run(TILES_X * TILES_Y, [this] (unsigned tileIdx) {
+    this->rasterizeTile(tileIdx);
+    this->updateBlockDepths(tileIdx);
+  });
+}
+
+void OcclusionCuller::rasterizeTile(unsigned tileIdx) {
+  int tileX0 = (tileIdx % TILES_X) * TILE_WIDTH;
+  int tileY0 = (tileIdx / TILES_X) * TILE_HEIGHT;
+
+  for (int y = tileY0; y < tileY0 + TILE_HEIGHT; y++) {
+    std::fill_n(&this->depth[y * BUFFER_WIDTH + tileX0], TILE_WIDTH, FAR_DEPTH);
+  }
+
+  for (auto triangleIdx : this->tileTriangles[tileIdx]) {
+    const Triangle& triangle = this->triangles[triangleIdx];
+
+    // Edge functions take the form e = a * x + b * y + c, where edge i lies
+    // opposite vertex i
+    float edgeA[3];
+    float edgeB[3];
+    float edgeC[3];
+
+    for (unsigned i = 0; i < 3; i++) {
+      unsigned from = (i + 1) % 3;
+      unsigned to = (i + 2) % 3;
+
+      edgeA[i] = triangle.y[from] - triangle.y[to];
+      edgeB[i] = triangle.x[to] - triangle.x[from];
+      edgeC[i] = -(edgeA[i] * triangle.x[from] + edgeB[i] * triangle.y[from]);
+    }
+
+    // Depth is interpolated linearly in screen space using the normalized
+    // edge values as barycentric weights
+    float invArea = 1.0f / (edgeA[0] * triangle.x[0] + edgeB[0] * triangle.y[0] + edgeC[0]);
+    float dz1 = (triangle.z[1] - triangle.z[0]) * invArea;
+    float dz2 = (triangle.z[2] - triangle.z[0]) * invArea;
+
+    float depthA = dz1 * edgeA[1] + dz2 * edgeA[2];
+    float depthB = dz1 * edgeB[1] + dz2 * edgeB[2];
+    float depthC = triangle.z[0] + dz1 * edgeC[1] + dz2 * edgeC[2];
+
+    int minX = std::max(triangle.minX, tileX0);
+    int maxX = std::min(triangle.maxX, tileX0 + TILE_WIDTH - 1);
+    int minY = std::max(triangle.minY, tileY0);
+    int maxY = std::min(triangle.maxY, tileY0 + TILE_HEIGHT - 1);
+
+    // Tiles are a multiple of four pixels wide, so aligning down keeps each
+    // group of four within the tile
+    int startX = minX & ~3;
+
+    for (int y = minY; y <= maxY; y++) {
+      float *row = &this->depth[y * BUFFER_WIDTH];
+      float py = y + 0.5f;
+
+      int x = startX;
+
+#if defined(__SSE__)
+      __m128 rowEdge0 = _mm_set1_ps(edgeB[0] * py + edgeC[0]);
+      __m128 rowEdge1 = _mm_set1_ps(edgeB[1] * py + edgeC[1]);
+      __m128 rowEdge2 = _mm_set1_ps(edgeB[2] * py + edgeC[2]);
+      __m128 rowDepth = _mm_set1_ps(depthB * py + depthC);
+
+      for (; x <= maxX; x += 4) {
+        __m128 px = _mm_add_ps(_mm_set1_ps((float)x), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+
+        __m128 edge0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[0]), px), rowEdge0);
+        __m128 edge1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[1]), px), rowEdge1);
+        __m128 edge2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[2]), px), rowEdge2);
+
+        // Sign bits are set only for pixels outside at least one edge
+        __m128 outside = _mm_or_ps(_mm_or_ps(edge0, edge1), edge2);
+        int outsideMask = _mm_movemask_ps(outside);
+        if (outsideMask == 0xf) {
+          continue;
+        }
+
+        __m128 inside = _mm_cmpge_ps(_mm_min_ps(_mm_min_ps(edge0, edge1), edge2), _mm_setzero_ps());
+
+        __m128 pixelDepth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depthA), px), rowDepth);
+        __m128 bufferDepth = _mm_loadu_ps(row + x);
+        __m128 nearest = _mm_min_ps(bufferDepth, pixelDepth);
+
+        _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, bufferDepth)));
+      }
+#endif
+
+      for (; x <= maxX; x++) {
+        float px = x + 0.5f;
+
+        float edge0 = edgeA[0] * px + edgeB[0] * py + edgeC[0];
+        float edge1 = edgeA[1] * px + edgeB[1] * py + edgeC[1];
+        float edge2 = edgeA[2] * px + edgeB[2] * py + edgeC[2];
+
+        if (edge0 < 0.0f || edge1 < 0.0f || edge2 < 0.0f) {
+          continue;
+        }
+
+        float pixelDepth = depthA * px + depthB * py + depthC;
+        row[x] = std::min(row[x], pixelDepth);
+      }
+    }
+  }
+}
+
+void OcclusionCuller::updateBlockDepths(unsigned tileIdx) {
+  int tileBlockX0 = (tileIdx % TILES_X) * TILE_WIDTH / BLOCK_SIZE;
+  int tileBlockY0 = (tileIdx / TILES_X) * TILE_HEIGHT / BLOCK_SIZE;
+
+  for (int blockY = tileBlockY0; blockY < tileBlockY0 + TILE_HEIGHT / BLOCK_SIZE; blockY++) {
+    for (int blockX = tileBlockX0; blockX < tileBlockX0 + TILE_WIDTH / BLOCK_SIZE; blockX++) {
+      float farthest = -INFINITY;
+
+      for (int y = blockY * BLOCK_SIZE; y < (blockY + 1) * BLOCK_SIZE; y++) {
+        const float *row = &this->depth[y * BUFFER_WIDTH + blockX * BLOCK_SIZE];
+
+        for (int x = 0; x < BLOCK_SIZE; x++) {
+          farthest = fmax(farthest, row[x]);
+        }
+      }
+
+      this->blockDepth[blockY * BLOCKS_X + blockX] = farthest;
+    }
+  }
+}
+
+bool OcclusionCuller::testBounds(const Math::Bounds& bounds) const {
+  if (bounds.isEmpty()) {
+    return true;
+  }
+
+  float minX = INFINITY;
+  float maxX = -INFINITY;
+  float minY = INFINITY;
+  float maxY = -INFINITY;
+  float nearestDepth = INFINITY;
+
+  for (unsigned i = 0; i < 8; i++) {
+    Math::Vector corner {
+      i & 1 ? bounds.maxima.x : bounds.minima.x,
+      i & 2 ? bounds.maxima.y : bounds.minima.y,
+      i & 4 ? bounds.maxima.z : bounds.minima.z,
+      1.0f,
+    };
+
+    Math::Vector clip = corner * this->projView;
+
+    // Boxes reaching the near plane surround the camera, and nothing can be
+    // in front of them
+    if (clip.w <= 0.0f || clip.z < -clip.w) {
+      return true;
+    }
+
+    float invW = 1.0f / clip.w;
+    float x = (clip.x * invW * 0.5f + 0.5f) * BUFFER_WIDTH;
+    float y = (0.5f - clip.y * invW * 0.5f) * BUFFER_HEIGHT;
+
+    minX = fmin(minX, x);
+    maxX = fmax(maxX, x);
+    minY = fmin(minY, y);
+    maxY = fmax(maxY, y);
+    nearestDepth = fmin(nearestDepth, clip.z * invW);
+  }
+
+  // Any pixel the box's projection touches could be covered, whether or not
+  // the box reaches that pixel's center
+  int x0 = std::max((int)floorf(minX), 0);
+  int x1 = std::min((int)floorf(maxX), BUFFER_WIDTH - 1);
+  int y0 = std::max((int)floorf(minY), 0);
+  int y1 = std::min((int)floorf(maxY), BUFFER_HEIGHT - 1);
+
+  // Leave boxes entirely off-screen for frustum culling to decide
+  if (x0 > x1 || y0 > y1) {
+    return true;
+  }
+
+  for (int blockY = y0 / BLOCK_SIZE; blockY <= y1 / BLOCK_SIZE; blockY++) {
+    for (int blockX = x0 / BLOCK_SIZE; blockX <= x1 / BLOCK_SIZE; blockX++) {
+      // Nothing in this block can be visible if the box is behind its
+      // farthest pixel
+      if (nearestDepth > this->blockDepth[blockY * BLOCKS_X + blockX]) {
+        continue;
+      }
+
+      int pixelX0 = std::max(x0, blockX * BLOCK_SIZE);
+      int pixelX1 = std::min(x1, (blockX + 1) * BLOCK_SIZE - 1);
+      int pixelY0 = std::max(y0, blockY * BLOCK_SIZE);
+      int pixelY1 = std::min(y1, (blockY + 1) * BLOCK_SIZE - 1);
+
+      for (int y = pixelY0; y <= pixelY1; y++) {
+        const float *row = &this->depth[y * BUFFER_WIDTH];
+
+        for (int x = pixelX0; x <= pixelX1; x++) {
+          if (nearestDepth <= row[x]) {
+            return true;
+          }
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+bool OcclusionCuller::isVisible(const Math::Bounds& bounds) {
+  if (this->triangles.empty()) {
+    return true;
+  }
+
+  bool visible = this->testBounds(bounds);
+
+  this->stats.tested++;
+  if (!visible) {
+    this->stats.rejected++;
+  }
+
+  return visible;
+}
+
+void OcclusionCuller::cull(const std::vector<Math::Bounds>& bounds, std::vector<unsigned>& indices, WorkerPool& workers) {
+  if (this->triangles.empty() || indices.empty()) {
+    return;
+  }
+
+  unsigned count = indices.size();
+  this->visibleFlags.resize(count);
+
+  workers.run((count + TEST_BATCH_SIZE - 1) / TEST_BATCH_SIZE, [&] (unsigned batch) {
+    unsigned end = std::min((batch + 1) * TEST_BATCH_SIZE, count);
+
+    for (unsigned i = batch * TEST_BATCH_SIZE; i < end; i++) {
+      this->visibleFlags[i] = this->testBounds(bounds[indices[i]]);
+    }
+  });
+
+  unsigned visibleCount = 0;
+  for (unsigned i = 0; i < count; i++) {
+    if (this->visibleFlags[i]) {
+      indices[visibleCount++] = indices[i];
+    }
+  }
+
+  indices.resize(visibleCount);
+
+  this->stats.tested += count;
+  this->stats.rejected += count - visibleCount;
+}
+
+const OcclusionCuller::Stats& OcclusionCuller::getStats() const {
+  return this->stats;
+}
@@ -0,0 +1,126 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MORTAR_RENDER_OCCLUSION_H
+#define MORTAR_RENDER_OCCLUSION_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "../math/affine.hpp"
+#include "../math/bounds.hpp"
+#include "../math/matrix.hpp"
+#include "../resource/types/scene.hpp"
+#include "../workers.hpp"
+
+namespace Mortar::Render {
+  // Rejects geometry hidden behind large static occluders by rasterizing the
+  // occluders into a small depth buffer on the CPU and testing bounding boxes
+  // against it. The buffer is split into tiles which are rasterized in
+  // parallel, and each tile's blocks keep their farthest depth so that most
+  // tests need not touch individual pixels.
+  class OcclusionCuller {
+    public:
+      class Stats {
+        public:
+          unsigned occluderTriangles;
+          unsigned rasterizedTriangles;
+
+          unsigned tested;
+          unsigned rejected;
+
+          float getRejectionRate() const;
+      };
+
+      OcclusionCuller()
+        : minOccluderRadius { 2.0f },
+          maxOccluderTriangles { 16384 },
+          stats {} {};
+
+      // Instances with bounds smaller than the minimum radius are never
+      // chosen as occluders, and the largest instances are chosen first until
+      // the triangle budget is spent
+      float getMinOccluderRadius() const;
+      void setMinOccluderRadius(float radius);
+
+      unsigned getMaxOccluderTriangles() const;
+      void setMaxOccluderTriangles(unsigned count);
+
+      // Chooses occluders from the scene's instances, whose bounds must
+      // already have been computed
+      void selectOccluders(const Resource::Scene *scene);
+
+      // Adds every opaque triangle of a scene instance as an occluder,
+      // regardless of its size
+      void addOccluder(const Resource::Scene *scene, unsigned instanceIdx);
+
+      void clear();
+
+      // Rasterizes all occluders from the given point of view; must precede
+      // any tests for the frame
+      void render(const Math::Matrix& projView, WorkerPool& workers);
+
+      bool isVisible(const Math::Bounds& bounds);
+
+      // Removes hidden entries from a list of indices into bounds, preserving
+      // the order of the remainder
+      void cull(const std::vector<Math::Bounds>& bounds, std::vector<unsigned>& indices, WorkerPool& workers);
+
+      const Stats& getStats() const;
+
+    private:
+      class Triangle {
+        public:
+          // Screen space vertices, with depth in normalized device
+          // coordinates
+          float x[3];
+          float y[3];
+          float z[3];
+
+          int minX;
+          int minY;
+          int maxX;
+          int maxY;
+      };
+
+      unsigned addMesh(const Resource::Mesh *mesh, const Math::AffineTransform& worldTransform);
+
+      bool testBounds(const Math::Bounds& bounds) const;
+
+      void rasterizeTile(unsigned tileIdx);
+      void updateBlockDepths(unsigned tileIdx);
+
+      float minOccluderRadius;
+      unsigned maxOccluderTriangles;
+
+      // World space occluder positions, three vertices to a triangle
+      std::vector<Math::Vector> occluderVertices;
+
+      std::vector<Triangle> triangles;
+      std::vector<std::vector<unsigned>> tileTriangles;
+
+      std::vector<float> depth;
+      std::vector<float> blockDepth;
+
+      Math::Matrix projView;
+
+      Stats stats;
+
+      std::vector<uint8_t> visibleFlags;
+  };
+}
+
+#endif
@@ -0,0 +1,525 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <math.h>
+#include <numeric>
+#include <stdint.h>
+#include <tsl/sparse_map.h>
+
+#include "../math/matrix.hpp"
+#include "optimize.hpp"
+
+using namespace Mortar::Render;
+
+// Size of the FIFO cache used to measure miss ratios
+static const unsigned ANALYSIS_CACHE_SIZE = 16;
+
+// Size of the LRU cache modeled when reordering, and the weights used to
+// score vertices, following Forsyth's linear-speed vertex cache optimization
+static const unsigned FORSYTH_CACHE_SIZE = 32;
+static const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+static const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+static const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+static const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+static const uint32_t UNASSIGNED = UINT32_MAX;
+
+static inline bool isDegenerate(uint16_t a, uint16_t b, uint16_t c) {
+  return a == b || b == c || a == c;
+}
+
+// Counts the vertices transformed for an index stream, with vertices staying
+// in the cache until enough others have been transformed after them
+static unsigned countCacheMisses(const std::vector<uint16_t>& indices, unsigned vertexCount) {
+  std::vector<uint32_t> insertedAt (vertexCount, UNASSIGNED);
+  unsigned misses = 0;
+
+  for (auto index : indices) {
+    if (insertedAt[index] == UNASSIGNED || misses - insertedAt[index] >= ANALYSIS_CACHE_SIZE) {
+      insertedAt[index] = misses;
+      misses++;
+    }
+  }
+
+  return misses;
+}
+
+static std::vector<uint16_t> convertStrip(const std::vector<uint16_t>& strip) {
+  std::vector<uint16_t> list;
+  list.reserve(strip.size() > 2 ? (strip.size() - 2) * 3 : 0);
+
+  for (size_t i = 0; i + 2 < strip.size(); i++) {
+    uint16_t a = strip[i];
+    uint16_t b = strip[i + 1];
+    uint16_t c = strip[i + 2];
+
+    // Degenerate triangles only serve to join strips
+    if (isDegenerate(a, b, c)) {
+      continue;
+    }
+
+    // Every other triangle in a strip has its winding reversed
+    if (i & 1) {
+      std::swap(a, b);
+    }
+
+    list.insert(list.end(), { a, b, c });
+  }
+
+  return list;
+}
+
+static float getForsythScore(int cachePosition, unsigned remainingTriangles) {
+  if (remainingTriangles == 0) {
+    return -1.0f;
+  }
+
+  float score = 0.0f;
+
+  // The last triangle's vertices get a fixed score, so that the next
+  // triangle isn't chosen just for sharing an edge with it
+  if (cachePosition >= 0 && cachePosition < 3) {
+    score = FORSYTH_LAST_TRIANGLE_SCORE;
+  } else if (cachePosition >= 3) {
+    score = powf(1.0f - (float)(cachePosition - 3) / (FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+  }
+
+  // Vertices with few triangles left are favored so that they can be done
+  // with and leave the cache
+  return score + FORSYTH_VALENCE_BOOST_SCALE * powf((float)remainingTriangles, -FORSYTH_VALENCE_BOOST_POWER);
+}
+
+// Greedily emits the remaining triangle whose vertices score highest, given
+// where they are in a simulated cache; degenerate triangles are dropped
+static void optimizeVertexCache(std::vector<uint16_t>& indices, unsigned vertexCount) {
+  std::vector<uint16_t> triangles;
+  triangles.reserve(indices.size());
+
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    if (!isDegenerate(indices[i], indices[i + 1], indices[i + 2])) {
+      triangles.insert(triangles.end(), { indices[i], indices[i + 1], indices[i + 2] });
+    }
+  }
+
+  uint32_t triangleCount = triangles.size() / 3;
+
+  // Each vertex's remaining triangles are kept in its own range of a single
+  // table, and removed by swapping with the last as they're emitted
+  std::vector<uint32_t> adjacencyOffsets (vertexCount + 1, 0);
+  for (auto index : triangles) {
+    adjacencyOffsets[index + 1]++;
+  }
+
+  std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+  std::vector<uint32_t> adjacency (triangles.size());
+  std::vector<uint32_t> remaining (vertexCount, 0);
+
+  for (uint32_t t = 0; t < triangleCount; t++) {
+    for (unsigned k = 0; k < 3; k++) {
+      uint16_t vertex = triangles[t * 3 + k];
+      adjacency[adjacencyOffsets[vertex] + remaining[vertex]++] = t;
+    }
+  }
+
+  std::vector<int> cachePositions (vertexCount, -1);
+  std::vector<float> vertexScores (vertexCount);
+
+  for (unsigned v = 0; v < vertexCount; v++) {
+    vertexScores[v] = getForsythScore(-1, remaining[v]);
+  }
+
+  std::vector<float> triangleScores (triangleCount);
+  std::vector<bool> isEmitted (triangleCount, false);
+
+  std::vector<uint16_t> output;
+  output.reserve(triangles.size());
+
+  std::vector<uint16_t> cache;
+  std::vector<uint16_t> nextCache;
+
+  uint32_t bestTriangle = UNASSIGNED;
+  uint32_t nextUnemitted = 0;
+
+  for (uint32_t emitted = 0; emitted < triangleCount; emitted++) {
+    // When nothing in the cache has triangles left, start afresh from the
+    // first triangle not yet emitted
+    if (bestTriangle == UNASSIGNED) {
+      while (isEmitted[nextUnemitted]) {
+        nextUnemitted++;
+      }
+
+      bestTriangle = nextUnemitted;
+    }
+
+    const uint16_t *triangle = &triangles[bestTriangle * 3];
+
+    output.insert(output.end(), triangle, triangle + 3);
+    isEmitted[bestTriangle] = true;
+
+    for (unsigned k = 0; k < 3; k++) {
+      uint16_t vertex = triangle[k];
+      uint32_t *vertexTriangles = &adjacency[adjacencyOffsets[vertex]];
+
+      for (uint32_t j = 0; j < remaining[vertex]; j++) {
+        if (vertexTriangles[j] == bestTriangle) {
+          vertexTriangles[j] = vertexTriangles[remaining[vertex] - 1];
+          break;
+        }
+      }
+
+      remaining[vertex]--;
+    }
+
+    nextCache.assign(triangle, triangle + 3);
+    for (auto vertex : cache) {
+      if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+        nextCache.push_back(vertex);
+      }
+    }
+
+    // Vertices pushed out of the cache are rescored along with the rest, so
+    // that their triangles' scores stay current
+    for (unsigned i = 0; i < nextCache.size(); i++) {
+      uint16_t vertex = nextCache[i];
+
+      cachePositions[vertex] = i < FORSYTH_CACHE_SIZE ? i : -1;
+      vertexScores[vertex] = getForsythScore(cachePositions[vertex], remaining[vertex]);
+    }
+
+    bestTriangle = UNASSIGNED;
+    float bestScore = -1.0f;
+
+    for (auto vertex : nextCache) {
+      for (uint32_t j = 0; j < remaining[vertex]; j++) {
+        uint32_t t = adjacency[adjacencyOffsets[vertex] + j];
+        const uint16_t *candidate = &triangles[t * 3];
+
+        triangleScores[t] = vertexScores[candidate[0]] + vertexScores[candidate[1]] + vertexScores[candidate[2]];
+
+        if (triangleScores[t] > bestScore) {
+          bestScore = triangleScores[t];
+          bestTriangle = t;
+        }
+      }
+    }
+
+    if (nextCache.size() > FORSYTH_CACHE_SIZE) {
+      nextCache.resize(FORSYTH_CACHE_SIZE);
+    }
+
+    std::swap(cache, nextCache);
+  }
+
+  indices = std::move(output);
+}
+
+static inline float dot3(const Mortar::Math::Vector& a, const Mortar::Math::Vector& b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// Splits a cache-ordered list into clusters wherever a triangle misses the
+// cache on every vertex, which costs nothing to reorder at, and sorts them
+// so that clusters facing away from the mesh's center are drawn first and
+// are likelier to hide those behind them
+static void optimizeOverdraw(std::vector<uint16_t>& indices, const std::vector<Mortar::Math::Vector>& positions, float threshold) {
+  unsigned vertexCount = positions.size();
+  uint32_t triangleCount = indices.size() / 3;
+
+  std::vector<uint32_t> clusterStarts;
+  std::vector<uint32_t> insertedAt (vertexCount, UNASSIGNED);
+  unsigned misses = 0;
+
+  for (uint32_t t = 0; t < triangleCount; t++) {
+    unsigned triangleMisses = 0;
+
+    for (unsigned k = 0; k < 3; k++) {
+      uint16_t index = indices[t * 3 + k];
+
+      if (insertedAt[index] == UNASSIGNED || misses - insertedAt[index] >= ANALYSIS_CACHE_SIZE) {
+        insertedAt[index] = misses;
+        misses++;
+        triangleMisses++;
+      }
+    }
+
+    if (t == 0 || triangleMisses == 3) {
+      clusterStarts.push_back(t);
+    }
+  }
+
+  if (clusterStarts.size() < 2) {
+    return;
+  }
+
+  clusterStarts.push_back(triangleCount);
+  unsigned clusterCount = clusterStarts.size() - 1;
+
+  // Centroids are weighted by area, and normals are summed unnormalized,
+  // which weights them likewise
+  std::vector<Mortar::Math::Vector> clusterCentroids (clusterCount);
+  std::vector<Mortar::Math::Vector> clusterNormals (clusterCount);
+  std::vector<float> clusterAreas (clusterCount, 0.0f);
+
+  Mortar::Math::Vector meshCentroid;
+  float meshArea = 0.0f;
+
+  for (unsigned c = 0; c < clusterCount; c++) {
+    for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+      const Mortar::Math::Vector& p0 = positions[indices[t * 3]];
+      const Mortar::Math::Vector& p1 = positions[indices[t * 3 + 1]];
+      const Mortar::Math::Vector& p2 = positions[indices[t * 3 + 2]];
+
+      Mortar::Math::Vector normal = Mortar::Math::Vector::cross(p1 - p0, p2 - p0);
+      float area = sqrtf(dot3(normal, normal)) * 0.5f;
+
+      Mortar::Math::Vector centroid = (p0 + p1 + p2) * (1.0f / 3.0f);
+
+      clusterCentroids[c] = clusterCentroids[c] + centroid * area;
+      clusterNormals[c] = clusterNormals[c] + normal;
+      clusterAreas[c] += area;
+    }
+
+    meshCentroid = meshCentroid + clusterCentroids[c];
+    meshArea += clusterAreas[c];
+  }
+
+  if (meshArea <= 0.0f) {
+    return;
+  }
+
+  meshCentroid = meshCentroid * (1.0f / meshArea);
+
+  std::vector<float> sortKeys (clusterCount, 0.0f);
+  for (unsigned c = 0; c < clusterCount; c++) {
+    float normalLength = sqrtf(dot3(clusterNormals[c], clusterNormals[c]));
+    if (clusterAreas[c] <= 0.0f || normalLength <= 0.0f) {
+      continue;
+    }
+
+    Mortar::Math::Vector offset = clusterCentroids[c] * (1.0f / clusterAreas[c]) - meshCentroid;
+    sortKeys[c] = dot3(offset, clusterNormals[c]) / normalLength;
+  }
+
+  std::vector<unsigned> order (clusterCount);
+  std::iota(order.begin(), order.end(), 0);
+
+  std::stable_sort(order.begin(), order.end(), [&] (unsigned a, unsigned b) {
+    return sortKeys[a] > sortKeys[b];
+  });
+
+  std::vector<uint16_t> sorted;
+  sorted.reserve(indices.size());
+
+  for (auto c : order) {
+    sorted.insert(sorted.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+  }
+
+  // Clusters no longer begin with a cold cache once reordered, so the
+  // result may be a little worse for it
+  if (countCacheMisses(sorted, vertexCount) <= misses * threshold) {
+    indices = std::move(sorted);
+  }
+}
+
+// Orders the vertices of meshes which share them by their first use across
+// all of the meshes' surfaces; vertices which are never used go last
+static void remapVertices(Mortar::Resource::Model *model, const std::vector<unsigned>& meshIndices, std::vector<std::vector<uint16_t>>& surfaceIndices) {
+  const Mortar::Resource::Mesh *firstMesh = model->getMesh(meshIndices[0]);
+
+  unsigned stride = firstMesh->getVertexLayout().getStride();
+  if (stride == 0) {
+    return;
+  }
+
+  unsigned vertexCount = firstMesh->getVertexCount();
+  const Mortar::Resource::Surface *surfaces = model->getSurfaces().data();
+
+  std::vector<uint32_t> remap (vertexCount, UNASSIGNED);
+  uint32_t nextVertex = 0;
+
+  for (auto meshIdx : meshIndices) {
+    const Mortar::Resource::Mesh *mesh = model->getMesh(meshIdx);
+
+    // Meshes may read the same vertices with different layouts, in which
+    // case no order suits all of them
+    if (mesh->getVertexLayout().getStride() != stride || mesh->getVertexDataSize() != firstMesh->getVertexDataSize()) {
+      return;
+    }
+
+    uint32_t firstSurface = mesh->getSurfaces().data() - surfaces;
+
+    for (uint32_t s = firstSurface; s < firstSurface + mesh->getSurfaces().size(); s++) {
+      for (auto index : surfaceIndices[s]) {
+        if (index >= vertexCount) {
+          return;
+        }
+
+        if (remap[index] == UNASSIGNED) {
+          remap[index] = nextVertex++;
+        }
+      }
+    }
+  }
+
+  for (auto& vertex : remap) {
+    if (vertex == UNASSIGNED) {
+      vertex = nextVertex++;
+    }
+  }
+
+  uint8_t *vertexData = model->getVertexData().data() + firstMesh->getVertexOffset();
+  std::vector<uint8_t> original (vertexData, vertexData + vertexCount * stride);
+
+  for (unsigned v = 0; v < vertexCount; v++) {
+    std::copy_n(original.data() + v * stride, stride, vertexData + remap[v] * stride);
+  }
+
+  for (auto meshIdx : meshIndices) {
+    const Mortar::Resource::Mesh *mesh = model->getMesh(meshIdx);
+    uint32_t firstSurface = mesh->getSurfaces().data() - surfaces;
+
+    for (uint32_t s = firstSurface; s < firstSurface + mesh->getSurfaces().size(); s++) {
+      for (auto& index : surfaceIndices[s]) {
+        index = remap[index];
+      }
+    }
+  }
+}
+
+std::vector<MeshOptimizationReport> Mortar::Render::optimizeModel(Mortar::Resource::Model *model, const MeshOptimizationSettings& settings) {
+  const std::vector<Resource::Surface>& surfaces = model->getSurfaces();
+  const std::vector<uint16_t>& modelIndices = model->getIndices();
+
+  // Surfaces are rewritten separately and packed back into a single index
+  // table once all are done
+  std::vector<std::vector<uint16_t>> surfaceIndices (surfaces.size());
+  for (unsigned s = 0; s < surfaces.size(); s++) {
+    auto first = modelIndices.begin() + surfaces[s].firstIndex;
+    surfaceIndices[s].assign(first, first + surfaces[s].indexCount);
+  }
+
+  std::vector<MeshOptimizationReport> reports;
+
+  for (unsigned meshIdx = 0; meshIdx < model->getMeshes().size(); meshIdx++) {
+    const Resource::Mesh *mesh = model->getMesh(meshIdx);
+    unsigned vertexCount = mesh->getVertexCount();
+
+    const Resource::VertexLayout::VertexProperty *positionProperty = mesh->getVertexLayout().getProperty(Resource::VertexUsage::POSITION);
+
+    // Positions are only read as overdraw optimization needs them
+    std::vector<Math::Vector> positions;
+
+    MeshOptimizationReport report {};
+    report.meshIdx = meshIdx;
+
+    unsigned originalMisses = 0;
+    unsigned optimizedMisses = 0;
+
+    uint32_t firstSurface = mesh->getSurfaces().data() - surfaces.data();
+
+    for (uint32_t s = firstSurface; s < firstSurface + mesh->getSurfaces().size(); s++) {
+      Resource::Surface *surface = model->getSurface(s);
+      std::vector<uint16_t>& indices = surfaceIndices[s];
+
+      if (surface->primitiveType == Resource::PrimitiveType::LINE_LIST) {
+        continue;
+      }
+
+      bool isInRange = std::all_of(indices.begin(), indices.end(), [&] (uint16_t index) {
+        return index < vertexCount;
+      });
+
+      if (!isInRange) {
+        continue;
+      }
+
+      // The surface's indices in the model are only replaced once every
+      // mesh is done, so still match those being optimized
+      mesh->forEachTriangle(*surface, [&] (uint16_t, uint16_t, uint16_t) {
+        report.triangleCount++;
+      });
+      originalMisses += countCacheMisses(indices, vertexCount);
+
+      if (settings.convertStrips && surface->primitiveType == Resource::PrimitiveType::TRIANGLE_STRIP) {
+        indices = convertStrip(indices);
+        surface->primitiveType = Resource::PrimitiveType::TRIANGLE_LIST;
+
+        report.convertedStrips++;
+      }
+
+      if (surface->primitiveType == Resource::PrimitiveType::TRIANGLE_LIST) {
+        if (settings.optimizeVertexCache) {
+          optimizeVertexCache(indices, vertexCount);
+        }
+
+        if (settings.optimizeOverdraw && positionProperty) {
+          if (positions.empty()) {
+            positions.resize(vertexCount);
+
+            for (unsigned v = 0; v < vertexCount; v++) {
+              positions[v] = mesh->readVertexProperty(v, *positionProperty);
+            }
+          }
+
+          optimizeOverdraw(indices, positions, settings.overdrawThreshold);
+        }
+      }
+
+      optimizedMisses += countCacheMisses(indices, vertexCount);
+    }
+
+    if (report.triangleCount > 0) {
+      report.originalAcmr = (float)originalMisses / report.triangleCount;
+      report.optimizedAcmr = (float)optimizedMisses / report.triangleCount;
+
+      reports.push_back(report);
+    }
+  }
+
+  if (settings.remapVertices) {
+    tsl::sparse_map<size_t, std::vector<unsigned>> blockMeshes;
+
+    for (unsigned meshIdx = 0; meshIdx < model->getMeshes().size(); meshIdx++) {
+      const Resource::Mesh *mesh = model->getMesh(meshIdx);
+
+      if (mesh->getVertexDataSize() != 0) {
+        blockMeshes[mesh->getVertexOffset()].push_back(meshIdx);
+      }
+    }
+
+    for (auto& block : blockMeshes) {
+      remapVertices(model, block.second, surfaceIndices);
+    }
+  }
+
+  std::vector<uint16_t> indices;
+  indices.reserve(modelIndices.size());
+
+  for (unsigned s = 0; s < surfaceIndices.size(); s++) {
+    Resource::Surface *surface = model->getSurface(s);
+
+    surface->firstIndex = indices.size();
+    surface->indexCount = surfaceIndices[s].size();
+
+    indices.insert(indices.end(), surfaceIndices[s].begin(), surfaceIndices[s].end());
+  }
+
+  model->setIndices(indices);
+
+  return reports;
+}
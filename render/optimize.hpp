@@ -0,0 +1,72 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MORTAR_RENDER_OPTIMIZE_H
+#define MORTAR_RENDER_OPTIMIZE_H
+
+#include <vector>
+
+#include "../resource/types/model.hpp"
+
+namespace Mortar::Render {
+  class MeshOptimizationSettings {
+    public:
+      MeshOptimizationSettings()
+        : convertStrips { true },
+          optimizeVertexCache { true },
+          optimizeOverdraw { true },
+          overdrawThreshold { 1.05f },
+          remapVertices { true } {};
+
+      // Rewrites triangle strips as lists, which the remaining steps need in
+      // order to reorder triangles
+      bool convertStrips;
+
+      // Orders each surface's triangles so that vertices are reused while
+      // they're still in the post-transform cache
+      bool optimizeVertexCache;
+
+      // Reorders clusters of triangles so that those facing outward from
+      // the mesh are drawn first, as long as the cache miss ratio grows by no
+      // more than the threshold
+      bool optimizeOverdraw;
+      float overdrawThreshold;
+
+      // Orders vertices by first use; vertices shared between meshes are
+      // ordered by their use across all of them
+      bool remapVertices;
+  };
+
+  class MeshOptimizationReport {
+    public:
+      unsigned meshIdx;
+
+      unsigned triangleCount;
+      unsigned convertedStrips;
+
+      // Vertices transformed per triangle, as simulated with a 16-entry FIFO
+      // cache
+      float originalAcmr;
+      float optimizedAcmr;
+  };
+
+  // Optimizes the index and vertex tables of a model in place, reporting on
+  // each of its meshes with triangles; must be done before the model is
+  // registered with a renderer
+  std::vector<MeshOptimizationReport> optimizeModel(Mortar::Resource::Model *model, const MeshOptimizationSettings& settings = MeshOptimizationSettings());
+}
+
+#endif
@@ -20,10 +20,13 @@
 #include <list>
 #include <vector>
 
+#include "../math/matrix.hpp"
 #include "../resource/types/geom.hpp"
 #include "../resource/types/mesh.hpp"
+#include "../resource/types/model.hpp"
 #include "../resource/types/texture.hpp"
-#include "../resource/types/vertex.hpp"
+#include "crowd.hpp"
+#include "drawlist.hpp"
 
 namespace Mortar::Render {
   class Renderer {
@@ -31,11 +34,22 @@ namespace Mortar::Render {
       virtual void initialize() = 0;
       virtual void shutDown() = 0;
 
-      virtual void registerMeshes(const std::vector<const Resource::Mesh *>& meshes) = 0;
+      // Uploads the model's vertex and index tables and prepares each of its
+      // meshes for drawing
+      virtual void registerModel(const Resource::Model *model) = 0;
       virtual void registerTextures(const std::vector<const Resource::Texture *>& textures) = 0;
-      virtual void registerVertexBuffers(const std::vector<const Resource::VertexBuffer *>& vertexBuffers) = 0;
 
-      virtual void renderGeometry(const std::list<const Resource::GeomObject *>& geometry) = 0;
+      // Must not be called until after registering the meshes the draw list
+      // references
+      virtual void registerDrawList(const DrawList *drawList) = 0;
+
+      // Renders dynamic geometry and crowds along with the given draws from
+      // the registered draw list; draw indices must be in ascending order
+      virtual void renderGeometry(const std::list<const Resource::GeomObject *>& geometry, const std::vector<unsigned>& staticDraws, const std::vector<Crowd>& crowds) = 0;
+
+      // Returns the combined view and projection transform geometry will be
+      // rendered with, for use in visibility tests
+      virtual Math::Matrix getProjViewTransform() const = 0;
   };
 }
 
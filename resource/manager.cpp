@@ -14,12 +14,33 @@
  * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+
 #include "manager.hpp"
 
 using namespace Mortar::Resource;
 
 void ResourceManager::initialize() {}
 
+void ResourceManager::destroyResource(Resource *resource) {
+  std::erase(this->sharedSkeletons, resource);
+
+  this->resources.erase(resource->getHandle());
+  delete resource;
+}
+
+const Skeleton *ResourceManager::shareSkeleton(Skeleton *skeleton) {
+  for (auto shared : this->sharedSkeletons) {
+    if (shared->isEquivalent(*skeleton)) {
+      this->destroyResource(skeleton);
+      return shared;
+    }
+  }
+
+  this->sharedSkeletons.push_back(skeleton);
+  return skeleton;
+}
+
 void ResourceManager::shutDown() {
   for (auto resource : this->resources) {
     delete resource.second;
@@ -28,4 +49,9 @@ void ResourceManager::shutDown() {
   for (auto pool : this->resourcePools) {
     delete pool;
   }
+
+  this->resources.clear();
+  this->namedResources.clear();
+  this->resourcePools.clear();
+  this->sharedSkeletons.clear();
 }
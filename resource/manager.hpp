@@ -25,6 +25,7 @@
 
 #include "pool.hpp"
 #include "resource.hpp"
+#include "types/skeleton.hpp"
 
 namespace Mortar::Resource {
   class ResourceManager {
@@ -38,6 +39,15 @@ namespace Mortar::Resource {
       template <ResourceType T>
       T *createResource();
 
+      // Frees a resource which nothing refers to, such as one found to
+      // duplicate another while loading
+      void destroyResource(Resource *resource);
+
+      // Returns an equivalent skeleton already in use in place of a new one,
+      // which is then destroyed, so that characters built on the same
+      // skeleton share it and with it their poses
+      const Skeleton *shareSkeleton(Skeleton *skeleton);
+
       template <ResourceType T>
       ResourcePool<T> *createResourcePool(size_t size);
 
@@ -49,6 +59,8 @@ namespace Mortar::Resource {
       tsl::sparse_map<std::type_index, ResourceLoader<>> loaders;
       tsl::sparse_map<std::string, Resource *> namedResources;
 
+      std::vector<const Skeleton *> sharedSkeletons;
+
       std::vector<ResourcePool<> *> resourcePools;
   };
 
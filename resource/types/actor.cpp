@@ -27,11 +27,11 @@ void Actor::setCharacter(const Character *character) {
   this->character = character;
 }
 
-const Mortar::Math::Matrix& Actor::getWorldTransform() const {
+const Mortar::Math::AffineTransform& Actor::getWorldTransform() const {
   return this->worldTransform;
 }
 
-void Actor::setWorldTransform(Math::Matrix &worldTransform) {
+void Actor::setWorldTransform(Math::AffineTransform &worldTransform) {
   this->worldTransform = worldTransform;
 }
 
@@ -17,7 +17,7 @@
 #ifndef MORTAR_RESOURCE_ACTOR_H
 #define MORTAR_RESOURCE_ACTOR_H
 
-#include "../../math/matrix.hpp"
+#include "../../math/affine.hpp"
 #include "../resource.hpp"
 #include "character.hpp"
 
@@ -27,8 +27,8 @@ namespace Mortar::Resource {
       const Character *getCharacter() const;
       void setCharacter(const Character *character);
 
-      const Math::Matrix& getWorldTransform() const;
-      void setWorldTransform(Math::Matrix& worldTransform);
+      const Math::AffineTransform& getWorldTransform() const;
+      void setWorldTransform(Math::AffineTransform& worldTransform);
 
       Character::AnimationType getAnimation() const;
       void setAnimation(Character::AnimationType animType);
@@ -52,7 +52,7 @@ namespace Mortar::Resource {
 
       AnimState animState;
       const Character *character;
-      Math::Matrix worldTransform;
+      Math::AffineTransform worldTransform;
   };
 }
 
@@ -14,13 +14,25 @@
  * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <assert.h>
+#include <bit>
 #include <stdexcept>
 
 #include "anim.hpp"
 
 using namespace Mortar::Resource;
 
+// Copies a channel's range of a table onto the end of another, returning its
+// new offset
+template <typename T>
+static uint32_t appendRange(std::vector<T>& to, const std::vector<T>& from, uint32_t offset, size_t count) {
+  uint32_t newOffset = to.size();
+  to.insert(to.end(), from.begin() + offset, from.begin() + offset + count);
+
+  return newOffset;
+}
+
 float Animation::getLength() const {
   return this->length;
 }
@@ -37,8 +49,26 @@ void Animation::setIntervalCount(unsigned int count) {
   this->intervalCount = count;
 }
 
-void Animation::addElement(Element *element) {
-  this->elements.push_back(element);
+void Animation::setLayout(unsigned elementCount, unsigned channelsPerElement) {
+  this->channelsPerElement = channelsPerElement;
+
+  this->elements.assign(elementCount, Element());
+  this->channels.assign(elementCount * channelsPerElement, Channel());
+
+  for (unsigned i = 0; i < elementCount; i++) {
+    this->elements[i].animation = this;
+    this->elements[i].firstChannel = i * channelsPerElement;
+  }
+
+  for (auto& channel : this->channels) {
+    channel.animation = this;
+  }
+
+  this->keyframeMasks.clear();
+  this->segmentBases.clear();
+  this->records.clear();
+  this->cubicCoefficients.clear();
+  this->quantizedKeys.clear();
 }
 
 Animation::KeyframeType Animation::Channel::getKeyframeType() const {
@@ -53,33 +83,174 @@ void Animation::Channel::setKeyframeType(KeyframeType type) {
   }
 }
 
-void Animation::Channel::addKeyframeMask(uint8_t byte0, uint8_t byte1, uint8_t byte2, uint8_t byte3) {
-  struct KeyframeMask mask;
+uint32_t Animation::Channel::getKeyframeMask(unsigned interval) const {
+  assert(this->keyframeIndexOffset != NO_OFFSET && interval < this->animation->intervalCount);
+
+  return this->animation->keyframeMasks[this->keyframeIndexOffset + interval];
+}
+
+unsigned Animation::Channel::getIntervalOffset(unsigned interval) const {
+  assert(this->keyframeIndexOffset != NO_OFFSET && interval < this->animation->intervalCount);
+
+  // The first subinterval's base is the interval offset less one
+  return (uint16_t)(this->animation->segmentBases[(this->keyframeIndexOffset + interval) * 4] + 1);
+}
+
+void Animation::Channel::setKeyframeIndex(const uint32_t *masks, const uint16_t *intervalOffsets) {
+  Animation *animation = this->animation;
+  unsigned intervalCount = animation->intervalCount;
+
+  // A channel's index is the same size whatever its keys, so one being
+  // replaced is overwritten in place
+  if (this->keyframeIndexOffset == NO_OFFSET) {
+    this->keyframeIndexOffset = animation->keyframeMasks.size();
+
+    animation->keyframeMasks.resize(animation->keyframeMasks.size() + intervalCount);
+    animation->segmentBases.resize(animation->segmentBases.size() + intervalCount * 4);
+  }
+
+  uint32_t offset = this->keyframeIndexOffset;
+  std::copy_n(masks, intervalCount, &animation->keyframeMasks[offset]);
+
+  for (unsigned interval = 0; interval < intervalCount; interval++) {
+    // Segments are indexed from the keyframe at or before the current frame,
+    // hence one less than the running count. Offsets are 16-bit, so bases
+    // are too, wrapping for intervals beginning without a keyframe and back
+    // again once the keyframes before the current frame are added.
+    uint16_t base = intervalOffsets[interval] - 1;
+    for (unsigned subinterval = 0; subinterval < 4; subinterval++) {
+      animation->segmentBases[(offset + interval) * 4 + subinterval] = base;
+      base += std::popcount((uint8_t)(masks[interval] >> (subinterval * 8)));
+    }
+  }
+}
+
+void Animation::Channel::clearKeyframeIndex() {
+  this->keyframeIndexOffset = NO_OFFSET;
+}
 
-  mask.subintervalMasks[0] = byte0;
-  mask.subintervalMasks[1] = byte1;
-  mask.subintervalMasks[2] = byte2;
-  mask.subintervalMasks[3] = byte3;
+unsigned Animation::Channel::getSegmentIndex(unsigned slot, uint8_t frameMask) const {
+  const Animation *animation = this->animation;
+  uint8_t subintervalMask = animation->keyframeMasks[this->keyframeIndexOffset + slot / 4] >> (slot % 4 * 8);
 
-  this->keyframeMasks.push_back(mask);
+  return (uint16_t)(animation->segmentBases[this->keyframeIndexOffset * 4 + slot] + std::popcount((uint8_t)(subintervalMask & frameMask)));
 }
 
-const uint8_t *Animation::Channel::getKeyframeMask(unsigned interval) const {
-  return this->keyframeMasks.at(interval).subintervalMasks;
+void Animation::Channel::buildCubicCoefficients() {
+  if (this->keyframeType != KeyframeType::FLOAT) {
+    throw std::runtime_error("only FLOAT channels have cubic coefficients");
+  }
+
+  // Data holds one (t, invDur, p, v) record per keyframe plus a terminating
+  // record, so each pair of consecutive records forms a segment
+  size_t segmentCount = this->getSegmentCount();
+  std::vector<float>& cubicCoefficients = this->animation->cubicCoefficients;
+
+  this->cubicOffset = cubicCoefficients.size() / 5;
+  cubicCoefficients.resize(cubicCoefficients.size() + segmentCount * 5);
+
+  for (size_t i = 0; i < segmentCount; i++) {
+    float start[4];
+    float end[4];
+
+    this->getRecord(i, start);
+    this->getRecord(i + 1, end);
+
+    calculateCubicCoefficients(start, end, &cubicCoefficients[(this->cubicOffset + i) * 5]);
+  }
 }
 
-void Animation::Channel::addIntervalOffset(size_t offset) {
-  this->intervalOffsets.push_back(offset);
+void Animation::Channel::calculateCubicCoefficients(const float *start, const float *end, float *coefficients) {
+  float invDuration = start[1];
+  float duration = end[0] - start[0];
+
+  // Hermite basis expanded in u = (t - tStart) * invDur, then rescaled to be
+  // in t - tStart directly
+  float p0 = start[2];
+  float p1 = end[2];
+  float m0 = duration * start[3];
+  float m1 = duration * end[3];
+
+  float cubic = 2 * p0 - 2 * p1 + m0 + m1;
+  float quadratic = -3 * p0 + 3 * p1 - 2 * m0 - m1;
+  float linear = m0;
+
+  coefficients[0] = start[0];
+  coefficients[1] = cubic * invDuration * invDuration * invDuration;
+  coefficients[2] = quadratic * invDuration * invDuration;
+  coefficients[3] = linear * invDuration;
+  coefficients[4] = p0;
 }
 
-size_t Animation::Channel::getIntervalOffset(unsigned interval) const {
-  return this->intervalOffsets.at(interval);
+size_t Animation::Channel::getSegmentCount() const {
+  if (this->keyframeType != KeyframeType::FLOAT || this->recordCount == 0) {
+    return 0;
+  }
+
+  return this->recordCount - 1;
 }
 
-const void *Animation::Channel::getData() const {
-  assert(this->dataType == DataType::POINTER);
+void Animation::Channel::getRecord(size_t i, float *record) const {
+  if (this->dataType == DataType::RECORDS) {
+    std::copy_n(&this->animation->records[(this->recordOffset + i) * 4], 4, record);
 
-  return this->data;
+    return;
+  }
+
+  assert(this->dataType == DataType::QUANTIZED);
+
+  const QuantizedKey *keys = &this->animation->quantizedKeys[this->recordOffset];
+
+  // Only segment starts' inverse durations are ever used, so the terminating
+  // record's is left as zero
+  record[0] = keys[i].time;
+  record[1] = i + 1 < this->recordCount ? 1.0f / (keys[i + 1].time - keys[i].time) : 0.0f;
+  record[2] = this->valueMin + keys[i].value * this->valueStep;
+  record[3] = this->rateMin + keys[i].rate * this->rateStep;
+}
+
+void Animation::Channel::setRecords(const float *records, size_t recordCount) {
+  // NONE keyframes should use the float overload of setData
+  assert(this->keyframeType != KeyframeType::NONE);
+  // BOOLEAN keyframes have no data associated with them
+  assert(this->keyframeType != KeyframeType::BOOLEAN);
+
+  std::vector<float>& table = this->animation->records;
+
+  this->dataType = DataType::RECORDS;
+  this->recordOffset = table.size() / 4;
+  this->recordCount = recordCount;
+  this->cubicOffset = NO_OFFSET;
+
+  table.insert(table.end(), records, records + recordCount * 4);
+}
+
+void Animation::Channel::setQuantizedKeys(const QuantizedKeys& keys) {
+  assert(this->keyframeType == KeyframeType::FLOAT);
+
+  std::vector<QuantizedKey>& table = this->animation->quantizedKeys;
+
+  this->dataType = DataType::QUANTIZED;
+  this->recordOffset = table.size();
+  this->recordCount = keys.times.size();
+  this->cubicOffset = NO_OFFSET;
+
+  this->valueMin = keys.valueMin;
+  this->valueStep = keys.valueStep;
+  this->rateMin = keys.rateMin;
+  this->rateStep = keys.rateStep;
+
+  for (size_t i = 0; i < keys.times.size(); i++) {
+    table.push_back({ keys.times[i], keys.values[i], keys.rates[i] });
+  }
+}
+
+bool Animation::Channel::getIsQuantized() const {
+  return this->dataType == DataType::QUANTIZED;
+}
+
+const float *Animation::Channel::getCubicCoefficients() const {
+  return this->cubicOffset == NO_OFFSET ? nullptr : &this->animation->cubicCoefficients[this->cubicOffset * 5];
 }
 
 float Animation::Channel::getFloatData() const {
@@ -88,47 +259,121 @@ float Animation::Channel::getFloatData() const {
   return this->floatData;
 }
 
-size_t Animation::Channel::getDataSize() const {
-  return this->dataSize;
-}
-
 void Animation::Channel::setData(float data) {
   assert(this->keyframeType == KeyframeType::NONE);
 
   this->dataType = DataType::FLOAT;
   this->floatData = data;
-  this->dataSize = sizeof(float);
+  this->recordOffset = NO_OFFSET;
+  this->recordCount = 0;
+  this->cubicOffset = NO_OFFSET;
 }
 
-void Animation::Channel::setData(void *data, size_t size) {
-  // NONE keyframes should use the float overload
-  assert(this->keyframeType != KeyframeType::NONE);
-  // BOOLEAN keyframes have no data associated with them
-  assert(this->keyframeType != KeyframeType::BOOLEAN);
-
-  this->dataType = DataType::POINTER;
-  this->data = data;
-  this->dataSize = size;
+Animation::Element *Animation::getElement(unsigned i) {
+  return &this->elements.at(i);
 }
 
 const Animation::Element *Animation::getElement(unsigned i) const {
-  return this->elements.at(i);
+  return &this->elements.at(i);
 }
 
 unsigned Animation::getElementCount() const {
   return this->elements.size();
 }
 
-void Animation::Element::addChannel(Channel *channel) {
-  this->channels.push_back(channel);
+const Animation::BakedTracks *Animation::getBakedTracks() const {
+  return this->bakedTracks.sampleCount ? &this->bakedTracks : nullptr;
+}
+
+void Animation::setBakedTracks(BakedTracks&& tracks) {
+  this->bakedTracks = std::move(tracks);
+}
+
+size_t Animation::getMemoryUsage() const {
+  size_t size = 0;
+
+  size += this->elements.size() * sizeof(Element);
+  size += this->channels.size() * sizeof(Channel);
+  size += this->keyframeMasks.size() * sizeof(uint32_t);
+  size += this->segmentBases.size() * sizeof(uint16_t);
+  size += this->records.size() * sizeof(float);
+  size += this->cubicCoefficients.size() * sizeof(float);
+  size += this->quantizedKeys.size() * sizeof(QuantizedKey);
+
+  return size;
+}
+
+bool Animation::hasQuantizedChannels() const {
+  for (auto& channel : this->channels) {
+    if (channel.getIsQuantized()) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void Animation::compact() {
+  std::vector<uint32_t> keyframeMasks;
+  std::vector<uint16_t> segmentBases;
+  std::vector<float> records;
+  std::vector<float> cubicCoefficients;
+  std::vector<QuantizedKey> quantizedKeys;
+
+  for (auto& channel : this->channels) {
+    if (channel.keyframeIndexOffset != Channel::NO_OFFSET) {
+      uint32_t offset = channel.keyframeIndexOffset;
+
+      channel.keyframeIndexOffset = appendRange(keyframeMasks, this->keyframeMasks, offset, this->intervalCount);
+      appendRange(segmentBases, this->segmentBases, offset * 4, this->intervalCount * 4);
+    }
+
+    if (channel.dataType == Channel::DataType::RECORDS) {
+      channel.recordOffset = appendRange(records, this->records, channel.recordOffset * 4, channel.recordCount * 4) / 4;
+    } else if (channel.dataType == Channel::DataType::QUANTIZED) {
+      channel.recordOffset = appendRange(quantizedKeys, this->quantizedKeys, channel.recordOffset, channel.recordCount);
+    }
+
+    if (channel.cubicOffset != Channel::NO_OFFSET) {
+      channel.cubicOffset = appendRange(cubicCoefficients, this->cubicCoefficients, channel.cubicOffset * 5, channel.getSegmentCount() * 5) / 5;
+    }
+  }
+
+  this->keyframeMasks = std::move(keyframeMasks);
+  this->segmentBases = std::move(segmentBases);
+  this->records = std::move(records);
+  this->cubicCoefficients = std::move(cubicCoefficients);
+  this->quantizedKeys = std::move(quantizedKeys);
+
+  this->keyframeMasks.shrink_to_fit();
+  this->segmentBases.shrink_to_fit();
+  this->records.shrink_to_fit();
+  this->cubicCoefficients.shrink_to_fit();
+  this->quantizedKeys.shrink_to_fit();
+}
+
+size_t Animation::BakedTracks::getMemoryUsage() const {
+  return sizeof(BakedTracks) + this->elementOffsets.size() * sizeof(unsigned) + this->samples.size() * sizeof(float);
+}
+
+Animation::Channel *Animation::Element::getChannel(unsigned i) {
+  if (i >= this->animation->channelsPerElement) {
+    throw std::out_of_range("channel index out of range");
+  }
+
+  return &this->animation->channels[this->firstChannel + i];
 }
 
 const Animation::Channel *Animation::Element::getChannel(unsigned i) const {
-  return this->channels.at(i);
+  if (i >= this->animation->channelsPerElement) {
+    throw std::out_of_range("channel index out of range");
+  }
+
+  return &this->animation->channels[this->firstChannel + i];
 }
 
 unsigned Animation::Element::getChannelCount() const {
-  return this->channels.size();
+  return this->animation->channelsPerElement;
 }
 
 void Animation::Element::setFlag(Animation::Element::Flags flag, bool value) {
@@ -29,63 +29,147 @@ namespace Mortar::Resource {
   // later games at some point
   class Animation : public Resource {
     public:
-      enum class KeyframeType {
+      enum class KeyframeType : uint8_t {
         NONE,
         BOOLEAN,
         FLOAT,
       };
 
-      class Channel : public Resource {
+      // A channel describes where its data lies in the tables of the
+      // animation that holds it, rather than owning any storage itself
+      class Channel {
         public:
-          Channel(ResourceHandle handle)
-            : Resource { handle },
-              data { nullptr } {};
+          // Compressed form of a FLOAT channel's keyframe records. Times are
+          // kept exact, while values and rates are stored as 16-bit steps
+          // across their range within the channel.
+          class QuantizedKeys {
+            public:
+              float valueMin;
+              float valueStep;
+              float rateMin;
+              float rateStep;
+
+              std::vector<float> times;
+              std::vector<uint16_t> values;
+              std::vector<uint16_t> rates;
+          };
+
+          Channel()
+            : animation { nullptr },
+              keyframeType { KeyframeType::NONE },
+              dataType { DataType::NONE },
+              keyframeIndexOffset { NO_OFFSET },
+              recordOffset { NO_OFFSET },
+              recordCount { 0 },
+              cubicOffset { NO_OFFSET },
+              floatData { 0.0f } {};
 
           KeyframeType getKeyframeType() const;
           void setKeyframeType(KeyframeType type);
 
-          void addKeyframeMask(uint8_t byte0, uint8_t byte1, uint8_t byte2, uint8_t byte3);
-          const uint8_t *getKeyframeMask(unsigned interval) const;
+          // Each interval's mask holds one byte per subinterval, the first in
+          // the lowest bits, so bit n marks a keyframe on the interval's nth
+          // frame
+          uint32_t getKeyframeMask(unsigned interval) const;
+          unsigned getIntervalOffset(unsigned interval) const;
+
+          // Sets the keyframe mask of every interval, and precomputes from the
+          // interval offsets the index of the segment preceding each
+          // subinterval's first keyframe; offsets aren't kept separately, as
+          // each is one more than its interval's first such index
+          void setKeyframeIndex(const uint32_t *masks, const uint16_t *intervalOffsets);
+
+          // Drops the keyframe index, as when a channel is made constant
+          void clearKeyframeIndex();
+
+          // Returns the index of the keyframe segment containing a frame,
+          // given its subinterval slot (interval * 4 + subinterval) and a
+          // mask of the frames up to and including it within the subinterval.
+          // Indices are 16-bit like the offsets they're built from, so a frame
+          // before the channel's first keyframe gives 0xffff.
+          unsigned getSegmentIndex(unsigned slot, uint8_t frameMask) const;
+
+          // Converts each segment of a FLOAT channel's Hermite data into a
+          // cubic in the time since the segment's start, stored as (tStart,
+          // a, b, c, d) such that the value is ((a * dt + b) * dt + c) * dt
+          // + d; the original data is kept
+          void buildCubicCoefficients();
+
+          // Converts a single segment, given its start and end records
+          static void calculateCubicCoefficients(const float *start, const float *end, float *coefficients);
+
+          // Null unless coefficients have been built
+          const float *getCubicCoefficients() const;
+
+          // Number of keyframe segments in a FLOAT channel's data
+          size_t getSegmentCount() const;
+
+          // Decodes a FLOAT channel's (t, invDur, p, v) keyframe record,
+          // whether stored as floats or quantized
+          void getRecord(size_t i, float *record) const;
+
+          // Replaces a FLOAT channel's data with a (t, invDur, p, v) record
+          // per keyframe plus a terminating record, dropping any cubic
+          // coefficients
+          void setRecords(const float *records, size_t recordCount);
 
-          void addIntervalOffset(size_t offset);
-          size_t getIntervalOffset(unsigned interval) const;
+          // Replaces a FLOAT channel's records with quantized keys, dropping
+          // any cubic coefficients
+          void setQuantizedKeys(const QuantizedKeys& keys);
+
+          bool getIsQuantized() const;
 
-          const void *getData() const;
           float getFloatData() const;
-          size_t getDataSize() const;
           void setData(float data);
-          void setData(void *data, size_t size);
 
         private:
-          struct KeyframeMask {
-            uint8_t subintervalMasks[4];
-          };
+          friend class Animation;
 
-          enum class DataType {
+          enum class DataType : uint8_t {
             NONE,
             FLOAT,
-            POINTER,
+            RECORDS,
+            QUANTIZED,
           };
 
-          KeyframeType keyframeType;
-          std::vector<KeyframeMask> keyframeMasks;
-          std::vector<size_t> intervalOffsets;
+          // Marks a channel as having no data in one of the tables
+          static const uint32_t NO_OFFSET = UINT32_MAX;
 
+          Animation *animation;
+
+          KeyframeType keyframeType;
           DataType dataType;
-          void *data;
+
+          // Index of the channel's first interval in the keyframe tables
+          uint32_t keyframeIndexOffset;
+
+          // Index of the channel's first record in the record or quantized
+          // key table, depending on its data type
+          uint32_t recordOffset;
+          uint32_t recordCount;
+
+          uint32_t cubicOffset;
+
+          // The value of a NONE channel
           float floatData;
-          size_t dataSize;
+
+          // Ranges of a quantized channel's values and rates
+          float valueMin;
+          float valueStep;
+          float rateMin;
+          float rateStep;
       };
 
       // The meaning of this is dependent on the animation type; for example, if
       // this is a skeletal animation, an element corresponds to a joint
-      class Element : public Resource {
+      class Element {
         public:
-          Element(ResourceHandle handle)
-            : Resource { handle },
+          Element()
+            : animation { nullptr },
+              firstChannel { 0 },
               flags { 0 } {};
 
-          void addChannel(Channel *channel);
+          Channel *getChannel(unsigned i);
           const Channel *getChannel(unsigned i) const;
           unsigned getChannelCount() const;
 
@@ -99,6 +183,8 @@ namespace Mortar::Resource {
           void setIsRelativeToJoint(bool isRelativeToJoint);
 
         private:
+          friend class Animation;
+
           enum Flags {
             HAS_ROTATION = 1 << 0,
             HAS_SCALE = 1 << 1,
@@ -107,27 +193,104 @@ namespace Mortar::Resource {
 
           void setFlag(Flags flag, bool value);
 
-          std::vector<Channel *> channels;
+          Animation *animation;
+          uint32_t firstChannel;
           unsigned char flags;
       };
 
+      // Translation, rotation and scale of every element sampled at a fixed
+      // rate, as a cheaper alternative to evaluating the curves. Each sample
+      // holds, per element, a translation, then a rotation quaternion if the
+      // element has rotation and a scale if it has scale.
+      class BakedTracks {
+        public:
+          BakedTracks()
+            : sampleRate { 0.0f },
+              frameStep { 0.0f },
+              sampleCount { 0 },
+              sampleStride { 0 } {};
+
+          size_t getMemoryUsage() const;
+
+          // Samples per second
+          float sampleRate;
+
+          // Animation frames between consecutive samples
+          float frameStep;
+
+          unsigned sampleCount;
+
+          // Floats per sample
+          unsigned sampleStride;
+
+          // Offset of each element's values within a sample
+          std::vector<unsigned> elementOffsets;
+
+          std::vector<float> samples;
+      };
+
       Animation(ResourceHandle handle)
-        : Resource { handle } {};
+        : Resource { handle },
+          length { 0.0f },
+          intervalCount { 0 },
+          channelsPerElement { 0 } {};
 
       float getLength() const;
       void setLength(float length);
 
+      // Must be set before any keyframe index is
       unsigned getIntervalCount() const;
       void setIntervalCount(unsigned count);
 
-      void addElement(Element *element);
+      // Creates every element along with its channels, replacing any that
+      // existed before; pointers to elements and channels are only valid
+      // until this is next called
+      void setLayout(unsigned elementCount, unsigned channelsPerElement);
+
+      Element *getElement(unsigned i);
       const Element *getElement(unsigned i) const;
       unsigned getElementCount() const;
 
+      // Null unless tracks have been baked
+      const BakedTracks *getBakedTracks() const;
+      void setBakedTracks(BakedTracks&& tracks);
+
+      // Bytes used by the curve representation of all channels
+      size_t getMemoryUsage() const;
+
+      bool hasQuantizedChannels() const;
+
+      // Rebuilds the tables to hold only what channels refer to, in channel
+      // order; data replaced in a channel is otherwise kept until this is
+      // called
+      void compact();
+
     private:
+      struct QuantizedKey {
+        float time;
+        uint16_t value;
+        uint16_t rate;
+      };
+
       float length;
       unsigned intervalCount;
-      std::vector<Element *> elements;
+      unsigned channelsPerElement;
+
+      std::vector<Element> elements;
+
+      // Every element's channels in turn
+      std::vector<Channel> channels;
+
+      // Per interval, except segment bases which are per subinterval
+      std::vector<uint32_t> keyframeMasks;
+      std::vector<uint16_t> segmentBases;
+
+      // Four floats per record, five per cubic segment
+      std::vector<float> records;
+      std::vector<float> cubicCoefficients;
+      std::vector<QuantizedKey> quantizedKeys;
+
+      BakedTracks bakedTracks;
   };
 }
 
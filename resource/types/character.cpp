@@ -21,6 +21,10 @@
 
 using namespace Mortar::Resource;
 
+Mortar::Resource::Model *Character::getModel() {
+  return this->model;
+}
+
 const Mortar::Resource::Model *Character::getModel() const {
   return this->model;
 }
@@ -29,32 +33,101 @@ void Character::setModel(Mortar::Resource::Model *model) {
   this->model = model;
 }
 
-void Character::addJoint(Joint *joint) {
-  this->joints.push_back(joint);
+const Mortar::Resource::Skeleton *Character::getSkeleton() const {
+  return this->skeleton;
 }
 
-const Mortar::Resource::Joint *Character::getJoint(unsigned i) const {
-  return this->joints.at(i);
+void Character::setSkeleton(const Skeleton *skeleton) {
+  this->skeleton = skeleton;
 }
 
-const std::vector<Mortar::Resource::Joint *>& Character::getJoints() const {
-  return this->joints;
+const Mortar::Math::Bounds& Character::getJointBounds(unsigned i) const {
+  return this->jointBounds.at(i);
 }
 
-const std::vector<Mortar::Math::Matrix>& Character::getRestPose() const {
-  return this->restPose;
-}
+void Character::calculateJointBounds() {
+  unsigned jointCount = this->skeleton->getJointCount();
+  const std::vector<Math::AffineTransform>& skinTransforms = this->skeleton->getSkinTransforms();
 
-void Character::setRestPose(std::vector<Math::Matrix>& restPose) {
-  this->restPose = restPose;
-}
+  std::vector<std::vector<Math::Vector>> jointPoints (jointCount);
 
-void Character::addSkinTransform(Math::Matrix& skinTransform) {
-  this->skinTransforms.push_back(skinTransform);
-}
+  for (auto layer : this->layers) {
+    for (auto meshes : { &layer->getSkinMeshes(), &layer->getDeformableSkinMeshes() }) {
+      for (auto meshIdx : *meshes) {
+        const Mesh *mesh = this->model->getMesh(meshIdx);
+        const VertexLayout& vertexLayout = mesh->getVertexLayout();
+
+        const VertexLayout::VertexProperty *positionProperty = vertexLayout.getProperty(VertexUsage::POSITION);
+        const VertexLayout::VertexProperty *weightsProperty = vertexLayout.getProperty(VertexUsage::BLEND_WEIGHTS);
+        const VertexLayout::VertexProperty *indicesProperty = vertexLayout.getProperty(VertexUsage::BLEND_INDICES);
+
+        if (!positionProperty) {
+          continue;
+        }
+
+        // Without blend data, vertices follow the first transform of their
+        // surface's palette, as in the skin shader
+        bool hasBlendData = weightsProperty && indicesProperty;
+
+        for (auto& surface : mesh->getSurfaces()) {
+          const uint16_t *palette = surface.skinTransformIndices;
+          unsigned paletteCount = surface.skinTransformCount;
+
+          const uint16_t *indices = mesh->getIndices(surface);
+
+          std::vector<bool> isVisited (mesh->getVertexCount());
 
-const Mortar::Math::Matrix& Character::getSkinTransform(unsigned i) const {
-  return this->skinTransforms.at(i);
+          for (unsigned i = 0; i < surface.indexCount; i++) {
+            uint16_t index = indices[i];
+            if (index >= isVisited.size() || isVisited[index]) {
+              continue;
+            }
+
+            isVisited[index] = true;
+
+            Math::Vector position = mesh->readVertexProperty(index, *positionProperty);
+            position.w = 1.0f;
+
+            float weights[3] = { 1.0f, 0.0f, 0.0f };
+            float slots[3] = { 0.0f, 0.0f, 0.0f };
+
+            if (hasBlendData) {
+              Math::Vector blendWeights = mesh->readVertexProperty(index, *weightsProperty);
+              Math::Vector blendIndices = mesh->readVertexProperty(index, *indicesProperty);
+
+              // Mirrors the skin shader, which derives the third weight
+              weights[0] = blendWeights.x;
+              weights[1] = blendWeights.y;
+              weights[2] = 1.0f - blendWeights.x - blendWeights.y;
+
+              slots[0] = blendIndices.x;
+              slots[1] = blendIndices.y;
+              slots[2] = blendIndices.z;
+            }
+
+            for (int j = 0; j < 3; j++) {
+              unsigned slot = (unsigned)slots[j];
+              if (weights[j] <= 0.0f || slot >= paletteCount) {
+                continue;
+              }
+
+              unsigned jointIdx = palette[slot];
+              if (jointIdx >= jointCount) {
+                continue;
+              }
+
+              jointPoints[jointIdx].push_back(skinTransforms.at(jointIdx).transformPoint(position));
+            }
+          }
+        }
+      }
+    }
+  }
+
+  this->jointBounds.clear();
+  for (auto& points : jointPoints) {
+    this->jointBounds.push_back(Math::Bounds::fromPoints(points));
+  }
 }
 
 void Character::addLayer(Layer *layer) {
@@ -21,12 +21,14 @@
 #include <tsl/sparse_map.h>
 #include <vector>
 
+#include "../../math/affine.hpp"
+#include "../../math/bounds.hpp"
 #include "../../math/matrix.hpp"
 #include "../resource.hpp"
 #include "anim.hpp"
 #include "layer.hpp"
-#include "joint.hpp"
 #include "model.hpp"
+#include "skeleton.hpp"
 
 namespace Mortar::Resource {
   class Character : public Resource {
@@ -55,18 +57,19 @@ namespace Mortar::Resource {
       Character(ResourceHandle& handle)
         : Resource { handle } {};
 
+      Mortar::Resource::Model *getModel();
       const Model *getModel() const;
       void setModel(Mortar::Resource::Model *model);
 
-      void addJoint(Joint *joint);
-      const Joint *getJoint(unsigned i) const;
-      const std::vector<Joint *>& getJoints() const;
+      // May be shared with other characters
+      const Skeleton *getSkeleton() const;
+      void setSkeleton(const Skeleton *skeleton);
 
-      void addSkinTransform(Math::Matrix& skinTransform);
-      const Math::Matrix& getSkinTransform(unsigned i) const;
-
-      const std::vector<Math::Matrix>& getRestPose() const;
-      void setRestPose(std::vector<Math::Matrix>& restPose);
+      // Bounds of the skinned vertices each joint influences, in that joint's
+      // space; must not be called until after the skeleton and layers have
+      // been set
+      const Math::Bounds& getJointBounds(unsigned i) const;
+      void calculateJointBounds();
 
       void addLayer(Layer *layer);
       const Layer *getLayer(unsigned i) const;
@@ -83,9 +86,8 @@ namespace Mortar::Resource {
 
     private:
       Mortar::Resource::Model *model;
-      std::vector<Joint *> joints;
-      std::vector<Math::Matrix> restPose;
-      std::vector<Math::Matrix> skinTransforms;
+      const Skeleton *skeleton;
+      std::vector<Math::Bounds> jointBounds;
       std::vector<Layer *> layers;
       std::vector<Locator *> locators;
       tsl::sparse_map<unsigned char, unsigned char> externalLocatorMap;
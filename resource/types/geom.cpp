@@ -21,7 +21,7 @@ using namespace Mortar::Resource;
 void GeomObject::reset() {
   this->mesh = nullptr;
   this->skinTransforms.clear();
-  this->worldTransform = Math::Matrix();
+  this->worldTransform = Math::AffineTransform();
 }
 
 const Mesh *GeomObject::getMesh() const {
@@ -32,18 +32,18 @@ void GeomObject::setMesh(const Mortar::Resource::Mesh *mesh) {
   this->mesh = mesh;
 }
 
-const Mortar::Math::Matrix& GeomObject::getWorldTransform() const {
+const Mortar::Math::AffineTransform& GeomObject::getWorldTransform() const {
   return this->worldTransform;
 }
 
-void GeomObject::setWorldTransform(Math::Matrix worldTransform) {
+void GeomObject::setWorldTransform(Math::AffineTransform worldTransform) {
   this->worldTransform = worldTransform;
 }
 
-const std::vector<Mortar::Math::Matrix>& GeomObject::getSkinTransforms() const {
+const std::vector<Mortar::Math::AffineTransform>& GeomObject::getSkinTransforms() const {
   return this->skinTransforms;
 }
 
-void GeomObject::setSkinTransforms(std::vector<Math::Matrix> skinTransforms) {
+void GeomObject::setSkinTransforms(std::vector<Math::AffineTransform> skinTransforms) {
   this->skinTransforms = skinTransforms;
 }
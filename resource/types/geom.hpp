@@ -19,7 +19,7 @@
 
 #include <vector>
 
-#include "../../math/matrix.hpp"
+#include "../../math/affine.hpp"
 #include "../resource.hpp"
 #include "material.hpp"
 #include "mesh.hpp"
@@ -32,11 +32,11 @@ namespace Mortar::Resource {
       const Mesh *getMesh() const;
       void setMesh(const Mesh *mesh);
 
-      const Math::Matrix& getWorldTransform() const;
-      void setWorldTransform(Math::Matrix worldTransform);
+      const Math::AffineTransform& getWorldTransform() const;
+      void setWorldTransform(Math::AffineTransform worldTransform);
 
-      const std::vector<Math::Matrix>& getSkinTransforms() const;
-      void setSkinTransforms(std::vector<Math::Matrix> skinTransforms);
+      const std::vector<Math::AffineTransform>& getSkinTransforms() const;
+      void setSkinTransforms(std::vector<Math::AffineTransform> skinTransforms);
 
       friend class ResourceManager;
 
@@ -46,9 +46,9 @@ namespace Mortar::Resource {
 
     private:
       const Mesh *mesh;
-      Math::Matrix worldTransform;
+      Math::AffineTransform worldTransform;
 
-      std::vector<Math::Matrix> skinTransforms;
+      std::vector<Math::AffineTransform> skinTransforms;
   };
 }
 
@@ -18,26 +18,26 @@
 
 using namespace Mortar::Resource;
 
-void Layer::addDeformableSkinMesh(Mesh *mesh) {
-  this->deformableSkinMeshes.push_back(mesh);
+void Layer::addDeformableSkinMesh(unsigned meshIdx) {
+  this->deformableSkinMeshes.push_back(meshIdx);
 }
 
-void Layer::addKinematicMesh(KinematicMesh *mesh) {
+void Layer::addKinematicMesh(const KinematicMesh& mesh) {
   this->kinematicMeshes.push_back(mesh);
 }
 
-void Layer::addSkinMesh(Mesh *mesh) {
-  this->skinMeshes.push_back(mesh);
+void Layer::addSkinMesh(unsigned meshIdx) {
+  this->skinMeshes.push_back(meshIdx);
 }
 
-const std::vector<Mortar::Resource::Mesh *>& Layer::getDeformableSkinMeshes() const {
+const std::vector<unsigned>& Layer::getDeformableSkinMeshes() const {
   return this->deformableSkinMeshes;
 }
 
-const std::vector<Mortar::Resource::KinematicMesh *>& Layer::getKinematicMeshes() const {
+const std::vector<Mortar::Resource::KinematicMesh>& Layer::getKinematicMeshes() const {
   return this->kinematicMeshes;
 }
 
-const std::vector<Mortar::Resource::Mesh *>& Layer::getSkinMeshes() const {
+const std::vector<unsigned>& Layer::getSkinMeshes() const {
   return this->skinMeshes;
 }
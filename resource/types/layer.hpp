@@ -21,23 +21,24 @@
 #include "mesh.hpp"
 
 namespace Mortar::Resource {
+  // Meshes are given by their index in the character's model
   class Layer : public Resource {
     public:
       Layer(ResourceHandle handle)
         : Resource { handle } {};
 
-      void addDeformableSkinMesh(Mesh *mesh);
-      void addKinematicMesh(KinematicMesh *mesh);
-      void addSkinMesh(Mesh *mesh);
+      void addDeformableSkinMesh(unsigned meshIdx);
+      void addKinematicMesh(const KinematicMesh& mesh);
+      void addSkinMesh(unsigned meshIdx);
 
-      const std::vector<Mesh *>& getDeformableSkinMeshes() const;
-      const std::vector<KinematicMesh *>& getKinematicMeshes() const;
-      const std::vector<Mesh *>& getSkinMeshes() const;
+      const std::vector<unsigned>& getDeformableSkinMeshes() const;
+      const std::vector<KinematicMesh>& getKinematicMeshes() const;
+      const std::vector<unsigned>& getSkinMeshes() const;
 
     private:
-      std::vector<Mesh *> deformableSkinMeshes;
-      std::vector<KinematicMesh *> kinematicMeshes;
-      std::vector<Mesh *> skinMeshes;
+      std::vector<unsigned> deformableSkinMeshes;
+      std::vector<KinematicMesh> kinematicMeshes;
+      std::vector<unsigned> skinMeshes;
   };
 }
 
@@ -14,96 +14,110 @@
  * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <vector>
+
 #include "mesh.hpp"
+#include "model.hpp"
 #include "shader.hpp"
 #include "vertex.hpp"
 
 using namespace Mortar::Resource;
 
-PrimitiveType Surface::getPrimitiveType() const {
-  return this->primitiveType;
+const Model *Mesh::getModel() const {
+  return this->model;
 }
 
-void Surface::setPrimitiveType(PrimitiveType primitiveType) {
-  this->primitiveType = primitiveType;
+std::span<const Surface> Mesh::getSurfaces() const {
+  return std::span<const Surface>(this->model->getSurfaces().data() + this->firstSurface, this->surfaceCount);
 }
 
-const IndexBuffer *Surface::getIndexBuffer() const {
-  return this->indexBuffer;
+void Mesh::setSurfaces(uint32_t firstSurface, uint32_t surfaceCount) {
+  this->firstSurface = firstSurface;
+  this->surfaceCount = surfaceCount;
 }
 
-void Surface::setIndexBuffer(IndexBuffer *indexBuffer) {
-  this->indexBuffer = indexBuffer;
+const uint16_t *Mesh::getIndices(const Surface& surface) const {
+  return this->model->getIndices().data() + surface.firstIndex;
 }
 
-unsigned Surface::getSkinTransformCount() const {
-  return this->skinTransformCount;
+const Material *Mesh::getMaterial() const {
+  return this->material;
 }
 
-void Surface::setSkinTransformCount(unsigned count) {
-  this->skinTransformCount = count;
+void Mesh::setMaterial(Material *material) {
+  this->material = material;
 }
 
-const std::vector<ushort>& Surface::getSkinTransformIndices() const {
-  return this->skinTransformIndices;
+ShaderType Mesh::getShaderType() const {
+  return this->shaderType;
 }
 
-void Surface::setSkinTransformIndices(std::vector<ushort>& indices) {
-  this->skinTransformIndices = indices;
+void Mesh::setShaderType(ShaderType shaderType) {
+  this->shaderType = shaderType;
 }
 
-void Mesh::addSurface(Surface *surface) {
-  this->surfaces.push_back(surface);
+const VertexLayout& Mesh::getVertexLayout() const {
+  return *this->vertexLayout;
 }
 
-const std::vector<Surface *>& Mesh::getSurfaces() const {
-  return this->surfaces;
+void Mesh::setVertexLayout(const VertexLayout &vertexLayout) {
+  this->vertexLayout = &vertexLayout;
 }
 
-const Material *Mesh::getMaterial() const {
-  return this->material;
+size_t Mesh::getVertexOffset() const {
+  return this->vertexOffset;
 }
 
-void Mesh::setMaterial(Material *material) {
-  this->material = material;
+size_t Mesh::getVertexDataSize() const {
+  return this->vertexDataSize;
 }
 
-const VertexBuffer *Mesh::getVertexBuffer() const {
-  return this->vertexBuffer;
+void Mesh::setVertexData(size_t offset, size_t size) {
+  this->vertexOffset = offset;
+  this->vertexDataSize = size;
 }
 
-void Mesh::setVertexBuffer(VertexBuffer *vertexBuffer) {
-  this->vertexBuffer = vertexBuffer;
+unsigned Mesh::getVertexCount() const {
+  return this->vertexLayout->getVertexCount(this->vertexDataSize);
 }
 
-ShaderType Mesh::getShaderType() const {
-  return this->shaderType;
+Mortar::Math::Vector Mesh::readVertexProperty(unsigned vertexIdx, const VertexLayout::VertexProperty& property) const {
+  return this->vertexLayout->readProperty(this->model->getVertexData().data() + this->vertexOffset, this->vertexDataSize, vertexIdx, property);
 }
 
-void Mesh::setShaderType(ShaderType shaderType) {
-  this->shaderType = shaderType;
+const Mortar::Math::Bounds& Mesh::getBounds() const {
+  return this->bounds;
 }
 
-const VertexLayout& Mesh::getVertexLayout() const {
-  return this->vertexLayout;
-}
+void Mesh::calculateBounds() {
+  const VertexLayout::VertexProperty *positionProperty = this->vertexLayout->getProperty(VertexUsage::POSITION);
+  if (!positionProperty || this->vertexDataSize == 0) {
+    this->bounds = Math::Bounds();
+    return;
+  }
 
-void Mesh::setVertexLayout(const VertexLayout &vertexLayout) {
-  this->vertexLayout = vertexLayout;
-}
+  // Vertex data is shared between meshes, so only gather the vertices this
+  // mesh's surfaces actually reference
+  std::vector<bool> isReferenced (this->getVertexCount());
+  std::vector<Math::Vector> positions;
 
-const Mesh *KinematicMesh::getMesh() const {
-  return this->mesh;
-}
+  for (auto& surface : this->getSurfaces()) {
+    const uint16_t *indices = this->getIndices(surface);
 
-void KinematicMesh::setMesh(Mesh *mesh) {
-  this->mesh = mesh;
-}
+    for (unsigned i = 0; i < surface.indexCount; i++) {
+      uint16_t index = indices[i];
+      if (index >= isReferenced.size() || isReferenced[index]) {
+        continue;
+      }
 
-unsigned KinematicMesh::getJointIdx() const {
-  return this->jointIdx;
-}
+      isReferenced[index] = true;
+
+      Math::Vector position = this->readVertexProperty(index, *positionProperty);
+      position.w = 1.0f;
+
+      positions.push_back(position);
+    }
+  }
 
-void KinematicMesh::setJointIdx(unsigned jointIdx) {
-  this->jointIdx = jointIdx;
+  this->bounds = Math::Bounds::fromPoints(positions);
 }
@@ -17,94 +17,154 @@
 #ifndef MORTAR_MESH_H
 #define MORTAR_MESH_H
 
+#include <span>
 #include <stdint.h>
 #include <vector>
 
-#include "../resource.hpp"
-#include "joint.hpp"
+#include "../../math/bounds.hpp"
 #include "material.hpp"
 #include "shader.hpp"
 #include "vertex.hpp"
 
 namespace Mortar::Resource {
+  class Model;
+
   enum class PrimitiveType {
     LINE_LIST,
     TRIANGLE_LIST,
     TRIANGLE_STRIP,
   };
 
-  class Surface : public Resource {
+  // A run of a model's indices drawn with a single palette of skin transforms
+  class Surface {
     public:
-      Surface(ResourceHandle handle)
-        : Resource { handle } {};
-
-      PrimitiveType getPrimitiveType() const;
-      void setPrimitiveType(PrimitiveType primitiveType);
-
-      const IndexBuffer *getIndexBuffer() const;
-      void setIndexBuffer(IndexBuffer *indexBuffer);
-
-      unsigned getSkinTransformCount() const;
-      void setSkinTransformCount(unsigned count);
-
-      const std::vector<ushort>& getSkinTransformIndices() const;
-      void setSkinTransformIndices(std::vector<ushort>& indices);
+      static const unsigned MAX_SKIN_TRANSFORMS = 16;
 
-    private:
       PrimitiveType primitiveType;
 
-      IndexBuffer *indexBuffer;
+      // Range of the model's index data
+      uint32_t firstIndex;
+      uint32_t indexCount;
 
+      // Skin transforms the surface's blend indices select from, given by
+      // joint index
       unsigned skinTransformCount;
-      std::vector<ushort> skinTransformIndices;
+      uint16_t skinTransformIndices[MAX_SKIN_TRANSFORMS];
   };
 
-  class Mesh : public Resource {
+  // Meshes are records in their model's mesh table, and refer to their
+  // surfaces and vertices by their position in the model's other tables
+  class Mesh {
     public:
-      Mesh(ResourceHandle handle)
-        : Resource { handle },
+      Mesh(const Model *model)
+        : model { model },
+          firstSurface { 0 },
+          surfaceCount { 0 },
+          vertexOffset { 0 },
+          vertexDataSize { 0 },
+          material { nullptr },
           shaderType { ShaderType::INVALID },
-          vertexLayout { VertexLayout::EMPTY } {};
-
-      void addSurface(Surface *surface);
-      const std::vector<Surface *>& getSurfaces() const;
+          vertexLayout { &VertexLayout::EMPTY } {};
+
+      const Model *getModel() const;
+
+      std::span<const Surface> getSurfaces() const;
+      void setSurfaces(uint32_t firstSurface, uint32_t surfaceCount);
+
+      // Indices of one of the mesh's surfaces into its vertices
+      const uint16_t *getIndices(const Surface& surface) const;
+
+      // Calls visit(a, b, c) with the vertex indices of each triangle of a
+      // surface, lists and strips alike. Degenerate triangles, as used to
+      // join strips, and those referring past the mesh's vertices are
+      // skipped; the alternating winding of strips is left as stored.
+      template <typename Visitor>
+      void forEachTriangle(const Surface& surface, Visitor&& visit) const {
+        const uint16_t *indices = this->getIndices(surface);
+        unsigned vertexCount = this->getVertexCount();
+
+        auto visitTriangle = [&] (uint16_t a, uint16_t b, uint16_t c) {
+          if (a == b || b == c || a == c || a >= vertexCount || b >= vertexCount || c >= vertexCount) {
+            return;
+          }
+
+          visit(a, b, c);
+        };
+
+        switch (surface.primitiveType) {
+          case PrimitiveType::TRIANGLE_LIST:
+            for (unsigned i = 0; i + 2 < surface.indexCount; i += 3) {
+              visitTriangle(indices[i], indices[i + 1], indices[i + 2]);
+            }
+            break;
+          case PrimitiveType::TRIANGLE_STRIP:
+            for (unsigned i = 0; i + 2 < surface.indexCount; i++) {
+              visitTriangle(indices[i], indices[i + 1], indices[i + 2]);
+            }
+            break;
+          default:
+            break;
+        }
+      }
+
+      // As above, for every surface of the mesh
+      template <typename Visitor>
+      void forEachTriangle(Visitor&& visit) const {
+        for (auto& surface : this->getSurfaces()) {
+          this->forEachTriangle(surface, visit);
+        }
+      }
 
       const Material *getMaterial() const;
       void setMaterial(Material *material);
 
-      const VertexBuffer *getVertexBuffer() const;
-      void setVertexBuffer(VertexBuffer *vertexBuffer);
-
       ShaderType getShaderType() const;
       void setShaderType(ShaderType shaderType);
 
+      // Layouts aren't copied, so must outlive the mesh
       const VertexLayout& getVertexLayout() const;
       void setVertexLayout(const VertexLayout& vertexLayout);
 
+      // The mesh's vertices, as a range of bytes in the model's vertex data;
+      // meshes may share vertices
+      size_t getVertexOffset() const;
+      size_t getVertexDataSize() const;
+      void setVertexData(size_t offset, size_t size);
+
+      unsigned getVertexCount() const;
+
+      // Reads a single property of a vertex into the first components of a
+      // vector; unused components are zero
+      Math::Vector readVertexProperty(unsigned vertexIdx, const VertexLayout::VertexProperty& property) const;
+
+      // Bounds are in the mesh's own vertex space and only cover vertices
+      // referenced by its surfaces
+      const Math::Bounds& getBounds() const;
+      void calculateBounds();
+
     private:
-      std::vector<Surface *> surfaces;
+      const Model *model;
+
+      uint32_t firstSurface;
+      uint32_t surfaceCount;
+
+      size_t vertexOffset;
+      size_t vertexDataSize;
+
+      Math::Bounds bounds;
 
       Material *material;
-      VertexBuffer *vertexBuffer;
 
       ShaderType shaderType;
-      VertexLayout vertexLayout;
+      const VertexLayout *vertexLayout;
   };
 
-  class KinematicMesh : public Resource {
+  // A mesh which moves rigidly with a single joint, given by its index in
+  // the character's model
+  class KinematicMesh {
     public:
-      KinematicMesh(ResourceHandle handle)
-        : Resource { handle } {};
-
-      const Mesh *getMesh() const;
-      void setMesh(Mesh *);
-
-      unsigned getJointIdx() const;
-      void setJointIdx(unsigned jointIdx);
-
-    private:
+      unsigned meshIdx;
       unsigned jointIdx;
-      const Mesh *mesh;
   };
 }
 
@@ -14,6 +14,7 @@
  * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <stdlib.h>
 #include <vector>
 
@@ -22,26 +23,75 @@
 
 using namespace Mortar::Resource;
 
-void Model::addMesh(const Mesh *mesh) {
-  this->meshes.push_back(mesh);
+unsigned Model::addMesh() {
+  this->meshes.emplace_back(this);
+
+  return this->meshes.size() - 1;
+}
+
+Mesh *Model::getMesh(unsigned i) {
+  return &this->meshes.at(i);
+}
+
+const Mesh *Model::getMesh(unsigned i) const {
+  return &this->meshes.at(i);
 }
 
-const std::vector<const Mesh *>& Model::getMeshes() const {
+const std::vector<Mesh>& Model::getMeshes() const {
   return this->meshes;
 }
 
-void Model::addTexture(const Texture *texture) {
-  this->textures.push_back(texture);
+uint32_t Model::addSurface(const Surface& surface) {
+  this->surfaces.push_back(surface);
+
+  return this->surfaces.size() - 1;
 }
 
-const std::vector<const Texture *>& Model::getTextures() const {
-  return this->textures;
+Surface *Model::getSurface(uint32_t i) {
+  return &this->surfaces.at(i);
+}
+
+const std::vector<Surface>& Model::getSurfaces() const {
+  return this->surfaces;
 }
 
-void Model::addVertexBuffer(const VertexBuffer *vertexBuffer) {
-  this->vertexBuffers.push_back(vertexBuffer);
+uint32_t Model::addIndices(const uint16_t *indices, size_t count) {
+  uint32_t first = this->indices.size();
+  this->indices.insert(this->indices.end(), indices, indices + count);
+
+  return first;
+}
+
+const std::vector<uint16_t>& Model::getIndices() const {
+  return this->indices;
 }
 
-const std::vector<const VertexBuffer *>& Model::getVertexBuffers() const {
-  return this->vertexBuffers;
+void Model::setIndices(const std::vector<uint16_t>& indices) {
+  this->indices = indices;
+}
+
+size_t Model::addVertexData(const uint8_t *data, size_t size) {
+  // Blocks are kept four byte aligned, as vertex attributes must be
+  size_t offset = (this->vertexData.size() + 3) & ~(size_t)3;
+
+  this->vertexData.resize(offset + size);
+  std::copy_n(data, size, this->vertexData.data() + offset);
+
+  return offset;
+}
+
+std::vector<uint8_t>& Model::getVertexData() {
+  return this->vertexData;
+}
+
+const std::vector<uint8_t>& Model::getVertexData() const {
+  return this->vertexData;
+}
+
+void Model::addTexture(const Texture *texture) {
+  this->textures.push_back(texture);
+}
+
+const std::vector<const Texture *>& Model::getTextures() const {
+  return this->textures;
 }
@@ -27,24 +27,47 @@
 #include "vertex.hpp"
 
 namespace Mortar::Resource {
+  // Holds the meshes of a scene or character along with all of their
+  // surfaces, indices and vertices, each in a single table
   class Model : public Resource {
     public:
       Model(ResourceHandle handle)
         : Resource { handle } {};
 
-      void addMesh(const Mesh *mesh);
-      const std::vector<const Mesh *>& getMeshes() const;
+      // Returns the new mesh's index; pointers to meshes are only stable once
+      // every mesh has been added
+      unsigned addMesh();
+      Mesh *getMesh(unsigned i);
+      const Mesh *getMesh(unsigned i) const;
+      const std::vector<Mesh>& getMeshes() const;
+
+      // Returns the new surface's index
+      uint32_t addSurface(const Surface& surface);
+      Surface *getSurface(uint32_t i);
+      const std::vector<Surface>& getSurfaces() const;
+
+      // Returns the position of the first index added
+      uint32_t addIndices(const uint16_t *indices, size_t count);
+      const std::vector<uint16_t>& getIndices() const;
+
+      // Replaces the whole index table, as when surfaces have been rewritten
+      void setIndices(const std::vector<uint16_t>& indices);
+
+      // Returns the offset in bytes of the vertices added
+      size_t addVertexData(const uint8_t *data, size_t size);
+      std::vector<uint8_t>& getVertexData();
+      const std::vector<uint8_t>& getVertexData() const;
 
       void addTexture(const Texture *texture);
       const std::vector<const Texture *>& getTextures() const;
 
-      void addVertexBuffer(const VertexBuffer *vertexBuffer);
-      const std::vector<const VertexBuffer *>& getVertexBuffers() const;
-
     private:
-      std::vector<const Mesh *> meshes;
+      std::vector<Mesh> meshes;
+      std::vector<Surface> surfaces;
+      std::vector<uint16_t> indices;
+      std::vector<uint8_t> vertexData;
+
       std::vector<const Texture *> textures;
-      std::vector<const VertexBuffer *> vertexBuffers;
   };
 }
 
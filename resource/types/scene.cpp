@@ -14,6 +14,7 @@
  * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdexcept>
 #include <vector>
 
 #include "character.hpp"
@@ -21,6 +22,10 @@
 
 using namespace Mortar::Resource;
 
+Model *Scene::getModel() {
+  return this->model;
+}
+
 const Model *Scene::getModel() const {
   return this->model;
 }
@@ -29,12 +34,64 @@ void Scene::setModel(Model *model) {
   this->model = model;
 }
 
-void Scene::addInstance(Instance *instance) {
-  this->instances.push_back(instance);
+unsigned Scene::addMeshBlock(std::span<const Mesh * const> meshes) {
+  MeshBlock block;
+  block.firstMesh = this->blockMeshes.size();
+  block.meshCount = meshes.size();
+
+  this->blockMeshes.insert(this->blockMeshes.end(), meshes.begin(), meshes.end());
+  this->meshBlocks.push_back(block);
+
+  return this->meshBlocks.size() - 1;
+}
+
+std::span<const Mesh * const> Scene::getMeshBlock(unsigned blockIdx) const {
+  const MeshBlock& block = this->meshBlocks.at(blockIdx);
+
+  return std::span<const Mesh * const>(this->blockMeshes.data() + block.firstMesh, block.meshCount);
+}
+
+void Scene::addInstance(unsigned meshBlockIdx, const Math::AffineTransform& worldTransform) {
+  if (meshBlockIdx >= this->meshBlocks.size()) {
+    throw std::runtime_error("instance mesh block out of range");
+  }
+
+  Math::Bounds bounds;
+  for (auto mesh : this->getMeshBlock(meshBlockIdx)) {
+    bounds.merge(mesh->getBounds().transform(worldTransform));
+  }
+
+  this->instanceTransforms.push_back(worldTransform);
+  this->instanceMeshBlocks.push_back(meshBlockIdx);
+  this->instanceBounds.push_back(bounds);
+}
+
+unsigned Scene::getInstanceCount() const {
+  return this->instanceTransforms.size();
+}
+
+const std::vector<Mortar::Math::AffineTransform>& Scene::getInstanceTransforms() const {
+  return this->instanceTransforms;
+}
+
+const std::vector<uint32_t>& Scene::getInstanceMeshBlocks() const {
+  return this->instanceMeshBlocks;
+}
+
+std::span<const Mesh * const> Scene::getInstanceMeshes(unsigned instanceIdx) const {
+  return this->getMeshBlock(this->instanceMeshBlocks[instanceIdx]);
+}
+
+void Scene::buildInstanceHierarchy() {
+  this->instanceHierarchy.build(this->instanceBounds);
+}
+
+const std::vector<Mortar::Math::Bounds>& Scene::getInstanceBounds() const {
+  return this->instanceBounds;
 }
 
-const std::vector<Instance *>& Scene::getInstances() const {
-  return this->instances;
+const Mortar::Math::BoundingVolumeHierarchy& Scene::getInstanceHierarchy() const {
+  return this->instanceHierarchy;
 }
 
 void Scene::addSpline(const std::string name, const Spline *spline) {
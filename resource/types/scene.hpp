@@ -17,13 +17,17 @@
 #ifndef MORTAR_RESOURCE_SCENE_H
 #define MORTAR_RESOURCE_SCENE_H
 
+#include <span>
+#include <stdint.h>
 #include <tsl/sparse_map.h>
 #include <vector>
 
+#include "../../math/affine.hpp"
+#include "../../math/bounds.hpp"
+#include "../../math/bvh.hpp"
 #include "../../math/matrix.hpp"
 #include "../resource.hpp"
 #include "character.hpp"
-#include "instance.hpp"
 #include "mesh.hpp"
 #include "model.hpp"
 #include "spline.hpp"
@@ -31,11 +35,29 @@
 namespace Mortar::Resource {
   class Scene : public Resource {
     public:
+      Model *getModel();
       const Model *getModel() const;
       void setModel(Model *model);
 
-      void addInstance(Instance *instance);
-      const std::vector<Instance *>& getInstances() const;
+      // A mesh block is a set of meshes placed together by instances; the
+      // meshes of every block are kept in a single table
+      unsigned addMeshBlock(std::span<const Mesh * const> meshes);
+      std::span<const Mesh * const> getMeshBlock(unsigned blockIdx) const;
+
+      // Instances are stored as parallel tables, each indexed by instance.
+      // World bounds are computed from the bounds of the block's meshes as
+      // each instance is added, so they must already have been calculated
+      void addInstance(unsigned meshBlockIdx, const Math::AffineTransform& worldTransform);
+      unsigned getInstanceCount() const;
+      const std::vector<Math::AffineTransform>& getInstanceTransforms() const;
+      const std::vector<uint32_t>& getInstanceMeshBlocks() const;
+      std::span<const Mesh * const> getInstanceMeshes(unsigned instanceIdx) const;
+
+      // Builds a hierarchy over the instances' world bounds; must be called
+      // once all instances have been added
+      void buildInstanceHierarchy();
+      const std::vector<Math::Bounds>& getInstanceBounds() const;
+      const Math::BoundingVolumeHierarchy& getInstanceHierarchy() const;
 
       void addSpline(const std::string name, const Spline *spline);
       const Spline *getSplineByName(const std::string name) const;
@@ -50,9 +72,21 @@ namespace Mortar::Resource {
         : Resource { handle } {};
 
     private:
+      class MeshBlock {
+        public:
+          uint32_t firstMesh;
+          uint32_t meshCount;
+      };
+
       Model *model;
 
-      std::vector<Instance *> instances;
+      std::vector<const Mesh *> blockMeshes;
+      std::vector<MeshBlock> meshBlocks;
+
+      std::vector<Math::AffineTransform> instanceTransforms;
+      std::vector<uint32_t> instanceMeshBlocks;
+      std::vector<Math::Bounds> instanceBounds;
+      Math::BoundingVolumeHierarchy instanceHierarchy;
 
       std::vector<Math::Matrix> startTransforms;
 
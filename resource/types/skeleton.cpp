@@ -0,0 +1,131 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include <string.h>
+
+#include "skeleton.hpp"
+
+using namespace Mortar::Resource;
+
+unsigned Skeleton::getJointCount() const {
+  return this->parentIndices.size();
+}
+
+void Skeleton::addJoint(const char *name, int parentIdx, const Mortar::Math::Matrix& transform, const Mortar::Math::Vector& attachmentPoint, bool isRelativeToAttachment) {
+  if (parentIdx < -1 || parentIdx >= (int)this->getJointCount()) {
+    throw std::runtime_error("joint precedes its parent");
+  }
+
+  if (parentIdx != -1) {
+    this->isLeaf[parentIdx] = false;
+  }
+
+  this->names.push_back(name);
+  this->parentIndices.push_back(parentIdx);
+  this->isLeaf.push_back(true);
+
+  unsigned char flags = isRelativeToAttachment ? IS_RELATIVE_TO_ATTACHMENT : 0;
+
+  // Animated rotations are applied before the joint transform, so only a
+  // uniform scale can be carried through them
+  Math::Transform decomposed;
+  if (Math::Transform::canDecompose(transform, true)) {
+    decomposed = Math::Transform::fromMatrix(transform);
+    flags |= IS_TRANSFORM_DECOMPOSABLE;
+  } else {
+    this->isDecomposable = false;
+  }
+
+  this->jointTransforms.push_back(transform);
+  this->decomposedTransforms.push_back(decomposed);
+  this->attachmentPoints.push_back(attachmentPoint);
+  this->jointFlags.push_back(flags);
+}
+
+const char *Skeleton::getJointName(unsigned i) const {
+  return this->names.at(i);
+}
+
+const std::vector<int>& Skeleton::getParentIndices() const {
+  return this->parentIndices;
+}
+
+const std::vector<bool>& Skeleton::getLeafJoints() const {
+  return this->isLeaf;
+}
+
+const std::vector<Mortar::Math::Matrix>& Skeleton::getJointTransforms() const {
+  return this->jointTransforms;
+}
+
+const std::vector<Mortar::Math::Transform>& Skeleton::getDecomposedTransforms() const {
+  return this->decomposedTransforms;
+}
+
+const std::vector<Mortar::Math::Vector>& Skeleton::getAttachmentPoints() const {
+  return this->attachmentPoints;
+}
+
+const std::vector<unsigned char>& Skeleton::getJointFlags() const {
+  return this->jointFlags;
+}
+
+bool Skeleton::hasJointFlag(unsigned i, JointFlags flag) const {
+  return this->jointFlags[i] & flag;
+}
+
+bool Skeleton::getIsDecomposable() const {
+  return this->isDecomposable;
+}
+
+const std::vector<Mortar::Math::Matrix>& Skeleton::getRestPose() const {
+  return this->restPose;
+}
+
+void Skeleton::setRestPose(const std::vector<Math::Matrix>& restPose) {
+  this->restPose = restPose;
+}
+
+const std::vector<Mortar::Math::AffineTransform>& Skeleton::getSkinTransforms() const {
+  return this->skinTransforms;
+}
+
+void Skeleton::setSkinTransforms(const std::vector<Math::AffineTransform>& skinTransforms) {
+  this->skinTransforms = skinTransforms;
+}
+
+template <typename T>
+static bool isBitwiseEqual(const std::vector<T>& a, const std::vector<T>& b) {
+  return a.size() == b.size() && !memcmp(a.data(), b.data(), a.size() * sizeof(T));
+}
+
+bool Skeleton::isEquivalent(const Skeleton& other) const {
+  if (this->parentIndices != other.parentIndices || this->jointFlags != other.jointFlags) {
+    return false;
+  }
+
+  for (unsigned i = 0; i < this->names.size(); i++) {
+    if (strcmp(this->names[i], other.names[i])) {
+      return false;
+    }
+  }
+
+  return isBitwiseEqual(this->jointTransforms, other.jointTransforms)
+    && isBitwiseEqual(this->attachmentPoints, other.attachmentPoints)
+    && isBitwiseEqual(this->restPose, other.restPose)
+    && isBitwiseEqual(this->skinTransforms, other.skinTransforms);
+}
@@ -0,0 +1,104 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MORTAR_RESOURCE_SKELETON_H
+#define MORTAR_RESOURCE_SKELETON_H
+
+#include <vector>
+
+#include "../../math/affine.hpp"
+#include "../../math/matrix.hpp"
+#include "../../math/transform.hpp"
+#include "../resource.hpp"
+
+namespace Mortar::Resource {
+  // A character's joints, held as parallel arrays indexed by joint. Every
+  // joint follows its parent, so poses can be composed in a single pass over
+  // the arrays. Characters built on identical skeletons share a single one.
+  class Skeleton : public Resource {
+    public:
+      enum JointFlags {
+        IS_RELATIVE_TO_ATTACHMENT = 1 << 0,
+
+        // The joint transform is rotation, translation and uniform scale
+        IS_TRANSFORM_DECOMPOSABLE = 1 << 1,
+      };
+
+      unsigned getJointCount() const;
+
+      // Joints must be added after their parents, or an exception is thrown
+      void addJoint(const char *name, int parentIdx, const Math::Matrix& transform, const Math::Vector& attachmentPoint, bool isRelativeToAttachment);
+
+      const char *getJointName(unsigned i) const;
+
+      // -1 for roots
+      const std::vector<int>& getParentIndices() const;
+
+      // Whether each joint has no children
+      const std::vector<bool>& getLeafJoints() const;
+
+      // The transforms animated elements may be relative to, along with
+      // their decompositions, valid only for joints with
+      // IS_TRANSFORM_DECOMPOSABLE
+      const std::vector<Math::Matrix>& getJointTransforms() const;
+      const std::vector<Math::Transform>& getDecomposedTransforms() const;
+
+      const std::vector<Math::Vector>& getAttachmentPoints() const;
+
+      const std::vector<unsigned char>& getJointFlags() const;
+      bool hasJointFlag(unsigned i, JointFlags flag) const;
+
+      // Whether every joint transform decomposes, which building local
+      // transforms requires
+      bool getIsDecomposable() const;
+
+      // Local bind transforms, posed when a character isn't animated
+      const std::vector<Math::Matrix>& getRestPose() const;
+      void setRestPose(const std::vector<Math::Matrix>& restPose);
+
+      // Inverse bind transforms, taking model space into each joint's space
+      const std::vector<Math::AffineTransform>& getSkinTransforms() const;
+      void setSkinTransforms(const std::vector<Math::AffineTransform>& skinTransforms);
+
+      // Whether another skeleton has the same joints, poses and skinning, and
+      // so can stand in for this one
+      bool isEquivalent(const Skeleton& other) const;
+
+      friend class ResourceManager;
+
+    protected:
+      Skeleton(ResourceHandle& handle)
+        : Resource { handle },
+          isDecomposable { true } {};
+
+    private:
+      std::vector<const char *> names;
+      std::vector<int> parentIndices;
+      std::vector<bool> isLeaf;
+
+      std::vector<Math::Matrix> jointTransforms;
+      std::vector<Math::Transform> decomposedTransforms;
+      std::vector<Math::Vector> attachmentPoints;
+      std::vector<unsigned char> jointFlags;
+
+      std::vector<Math::Matrix> restPose;
+      std::vector<Math::AffineTransform> skinTransforms;
+
+      bool isDecomposable;
+  };
+}
+
+#endif
@@ -14,6 +14,8 @@
  * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdexcept>
+#include <string.h>
 #include <vector>
 
 #include "vertex.hpp"
@@ -30,6 +32,16 @@ size_t VertexLayout::getStride() const {
   return this->stride;
 }
 
+const VertexLayout::VertexProperty *VertexLayout::getProperty(VertexUsage usage) const {
+  for (auto& property : this->properties) {
+    if (property.getUsage() == usage) {
+      return &property;
+    }
+  }
+
+  return nullptr;
+}
+
 size_t VertexLayout::VertexProperty::getOffset() const {
   return this->offset;
 }
@@ -42,42 +54,46 @@ VertexDataType VertexLayout::VertexProperty::getDataType() const {
   return this->type;
 }
 
-IndexBuffer::~IndexBuffer() {
-  delete this->data;
-}
-
-unsigned IndexBuffer::getCount() const {
-  return this->count;
-}
-
-void IndexBuffer::setCount(unsigned count) {
-  this->count = count;
-}
-
-const uint16_t *IndexBuffer::getData() const {
-  return this->data;
-}
-
-void IndexBuffer::setData(uint16_t *data) {
-  this->data = data;
-}
-
-VertexBuffer::~VertexBuffer() {
-  delete this->data;
-}
-
-size_t VertexBuffer::getSize() const {
-  return this->size;
-}
-
-void VertexBuffer::setSize(size_t size) {
-  this->size = size;
-}
+unsigned VertexLayout::getVertexCount(size_t size) const {
+  if (this->stride == 0) {
+    return 0;
+  }
 
-const uint8_t *VertexBuffer::getData() const {
-  return this->data;
+  return size / this->stride;
 }
 
-void VertexBuffer::setData(uint8_t *data) {
-  this->data = data;
+Mortar::Math::Vector VertexLayout::readProperty(const uint8_t *data, size_t size, unsigned vertexIdx, const VertexProperty& property) const {
+  size_t offset = vertexIdx * this->stride + property.getOffset();
+
+  float components[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+  switch (property.getDataType()) {
+    case VertexDataType::VEC3:
+      if (offset + 3 * sizeof(float) > size) {
+        throw std::out_of_range("vertex index out of range");
+      }
+
+      memcpy(components, data + offset, 3 * sizeof(float));
+      break;
+    case VertexDataType::VEC2:
+      if (offset + 2 * sizeof(float) > size) {
+        throw std::out_of_range("vertex index out of range");
+      }
+
+      memcpy(components, data + offset, 2 * sizeof(float));
+      break;
+    case VertexDataType::D3DCOLOR:
+      if (offset + 4 > size) {
+        throw std::out_of_range("vertex index out of range");
+      }
+
+      // D3DCOLOR is stored as BGRA
+      components[0] = data[offset + 2] / 255.0f;
+      components[1] = data[offset + 1] / 255.0f;
+      components[2] = data[offset] / 255.0f;
+      components[3] = data[offset + 3] / 255.0f;
+      break;
+  }
+
+  return Math::Vector { components[0], components[1], components[2], components[3] };
 }
@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <vector>
 
+#include "../../math/matrix.hpp"
 #include "../resource.hpp"
 
 namespace Mortar::Resource {
@@ -62,47 +63,21 @@ namespace Mortar::Resource {
       size_t getStride() const;
       const std::vector<VertexProperty>& getProperties() const;
 
-      static VertexLayout EMPTY;
-
-    private:
-      unsigned stride;
-      std::vector<VertexProperty> properties;
-  };
-
-  class IndexBuffer : public Resource {
-    public:
-      IndexBuffer(ResourceHandle handle)
-        : Resource { handle } {};
+      // Returns the property with the given usage, or nullptr if the layout
+      // has no such property
+      const VertexProperty *getProperty(VertexUsage usage) const;
 
-      ~IndexBuffer();
+      unsigned getVertexCount(size_t size) const;
 
-      unsigned getCount() const;
-      void setCount(unsigned count);
+      // Reads a single property of a vertex from data in this layout into the
+      // first components of a vector; unused components are zero
+      Math::Vector readProperty(const uint8_t *data, size_t size, unsigned vertexIdx, const VertexProperty& property) const;
 
-      const uint16_t *getData() const;
-      void setData(uint16_t *data);
-
-    private:
-      unsigned count;
-      uint16_t *data;
-  };
-
-  class VertexBuffer : public Resource {
-    public:
-      VertexBuffer(ResourceHandle handle)
-        : Resource { handle } {};
-
-      ~VertexBuffer();
-
-      size_t getSize() const;
-      void setSize(size_t size);
-
-      const uint8_t *getData() const;
-      void setData(uint8_t *data);
+      static VertexLayout EMPTY;
 
     private:
-      size_t size;
-      uint8_t *data;
+      unsigned stride;
+      std::vector<VertexProperty> properties;
   };
 }
 
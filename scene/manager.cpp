@@ -14,25 +14,46 @@
  * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cmath>
-#include <forward_list>
 #include <list>
+#include <numeric>
+#include <SDL2/SDL_timer.h>
 #include <stdexcept>
+#include <tsl/sparse_map.h>
+#include <tsl/sparse_set.h>
 #include <vector>
 
 #include "../anim/anim.hpp"
+#include "../anim/baked.hpp"
+#include "../anim/pose.hpp"
 #include "../log.hpp"
+#include "../math/frustum.hpp"
 #include "../state.hpp"
 #include "manager.hpp"
 
 using namespace Mortar::Scene;
 
+// Fewest actors sharing a character for them to be drawn as a crowd
+static const unsigned MIN_CROWD_SIZE = 2;
+
+// Radius of the sphere swept from the look-at point to keep the camera from
+// ending up behind level geometry
+static const float CAMERA_COLLISION_RADIUS = 0.1f;
+
 void SceneManager::initialize(Render::Renderer *renderer) {
   this->renderer = renderer;
 
   renderer->initialize();
 
   this->geomPool = State::getResourceManager().createResourcePool<Resource::GeomObject>(4096);
+
+  // Sample at 15 Hz and drop scale below a quarter of the screen, then at
+  // 7.5 Hz with leaves frozen below a tenth
+  this->animationLods = {
+    { 0.25f, 2.0f, Animation::SKIP_SCALE },
+    { 0.1f, 4.0f, Animation::SKIP_SCALE | Animation::FREEZE_LEAVES },
+  };
 }
 
 void SceneManager::shutDown() {
@@ -65,7 +86,7 @@ float getValue(const Mortar::Math::Vector& lookAt, const Mortar::Math::Vector& a
   return fabs((lookAt.x - b.x) * cos(-angle) + (lookAt.z - b.z) * sin(-angle));
 }
 
-Mortar::Resource::Actor *SceneManager::addActor(const Resource::Character *character, Math::Matrix worldTransform) {
+Mortar::Resource::Actor *SceneManager::addActor(const Resource::Character *character, Math::AffineTransform worldTransform) {
   static unsigned actorCount = 0;
 
   Mortar::Resource::Actor *actor = State::getResourceManager().createResource<Mortar::Resource::Actor>();
@@ -78,10 +99,7 @@ Mortar::Resource::Actor *SceneManager::addActor(const Resource::Character *chara
   const Resource::Model *model = character->getModel();
 
   this->renderer->registerTextures(model->getTextures());
-  this->renderer->registerVertexBuffers(model->getVertexBuffers());
-
-  // Must not be called until after registering vertex buffers
-  this->renderer->registerMeshes(model->getMeshes());
+  this->renderer->registerModel(model);
 
   actorCount++;
 
@@ -94,14 +112,23 @@ void SceneManager::setScene(const Resource::Scene *scene) {
   const Resource::Model *model = scene->getModel();
 
   this->renderer->registerTextures(model->getTextures());
-  this->renderer->registerVertexBuffers(model->getVertexBuffers());
+  this->renderer->registerModel(model);
 
-  // Must not be called until after registering vertex buffers
-  this->renderer->registerMeshes(model->getMeshes());
+  // Scene instances never move, so compile them once up front rather than
+  // rebuilding their geometry every frame
+  this->staticDrawList.build(scene);
+  this->renderer->registerDrawList(&this->staticDrawList);
+
+  this->occlusionCuller.clear();
+  this->occlusionCuller.selectOccluders(scene);
+
+  DEBUG("selected %u occluder triangles", this->occlusionCuller.getStats().occluderTriangles);
+
+  this->buildLevelGeometry();
 
   Math::Vector player1Pos;
 
-  std::vector<Math::Matrix> pcStartingTransforms;
+  std::vector<Math::AffineTransform> pcStartingTransforms;
 
   const Resource::Spline *startSpline = scene->getSplineByName("start");
   if (startSpline != nullptr) {
@@ -111,7 +138,7 @@ void SceneManager::setScene(const Resource::Scene *scene) {
 
       float angleFromZ = lookAt.getAngleFrom(-Math::Vector::zAxis);
 
-      Math::Matrix transform = Math::Matrix::rotationY(angleFromZ);
+      Math::AffineTransform transform = Math::AffineTransform::fromMatrix(Math::Matrix::rotationY(angleFromZ));
       transform.setTranslation(position);
 
       pcStartingTransforms.push_back(transform);
@@ -208,6 +235,23 @@ void SceneManager::setScene(const Resource::Scene *scene) {
   // XXX: Pulled the height value out of a text file, need to read it in
   lookAt.y = 0.42f * 0.5f;
 
+  // Pull the camera in front of any geometry between it and the player. A
+  // sphere already touching geometry at the look-at point can't be placed
+  // better, so leave the camera where the socks put it.
+  Math::Vector toCamera = camPos - lookAt;
+  toCamera.w = 0.0f;
+
+  float cameraDistance = toCamera.getMagnitude();
+  if (cameraDistance > CAMERA_COLLISION_RADIUS) {
+    Math::Vector direction = toCamera * (1.0f / cameraDistance);
+
+    Math::TriangleHierarchy::Hit hit;
+    if (this->levelGeometry.sweepSphere(lookAt, CAMERA_COLLISION_RADIUS, direction, cameraDistance, hit) && hit.distance > 0.0f) {
+      DEBUG("camera pulled in from %.2f to %.2f by level geometry", cameraDistance, hit.distance);
+      camPos = lookAt + direction * hit.distance;
+    }
+  }
+
   State::getCamera().setLookAt(lookAt);
   State::getCamera().setPosition(camPos);
 
@@ -221,19 +265,282 @@ void SceneManager::setScene(const Resource::Scene *scene) {
   }
 }
 
-const std::vector<Mortar::Math::Matrix> calculatePose(const Mortar::Resource::Actor *actor) {
-  const Mortar::Resource::Character *character = actor->getCharacter();
+// Pose cache variants hold PoseReduction flags in their low bits
+static const unsigned POSE_REDUCTION_MASK = 0xff;
+static const unsigned POSE_INTERPOLATED = 1 << 8;
+static const unsigned POSE_BAKED = 1 << 9;
+
+// Blended poses are told apart by the level they were blended for, as levels
+// may sample at different intervals
+static const unsigned POSE_BLEND_LEVEL_SHIFT = 16;
+
+unsigned SceneManager::selectAnimationLod(unsigned actorIdx, const Math::Matrix& projView) const {
+  if (!State::animLodEnabled || actorIdx >= this->actorBounds.size() || this->actorBounds[actorIdx].isEmpty()) {
+    return 0;
+  }
+
+  const Math::Bounds& bounds = this->actorBounds[actorIdx];
+
+  // Perspective divides by w, and the projection scales y by its _22 into a
+  // range two units high
+  float w = (bounds.center * projView).w;
+  if (w <= bounds.radius) {
+    return 0;
+  }
+
+  float screenSize = bounds.radius * State::getDisplayManager().getPerspectiveTransform()._22 / w;
+
+  unsigned level = 0;
+  for (unsigned i = 0; i < this->animationLods.size(); i++) {
+    if (screenSize < this->animationLods[i].maxScreenSize) {
+      level = i + 1;
+    }
+  }
+
+  return level;
+}
+
+std::vector<Mortar::Math::AffineTransform> *SceneManager::requestPose(const Resource::Character *character, const Resource::Animation *anim, float position, unsigned variant) {
+  const Resource::Skeleton *skeleton = character->getSkeleton();
+  unsigned reductions = variant & POSE_REDUCTION_MASK;
+
+  bool isCached;
+  std::vector<Math::AffineTransform> *pose = this->poseCache.acquire({ anim, skeleton, position, variant }, isCached);
+  if (isCached) {
+    return pose;
+  }
+
+  unsigned jointsPosed = skeleton->getJointCount();
+  if (reductions & Animation::FREEZE_LEAVES) {
+    const std::vector<bool>& isLeaf = skeleton->getLeafJoints();
+    jointsPosed -= std::count(isLeaf.begin(), isLeaf.end(), true);
+  }
+
+  this->animationLodStats.jointsPosed += jointsPosed;
+
+  if (!(variant & POSE_BAKED)) {
+    this->pendingPoses[anim].push_back({ character, position, reductions, pose });
+    return pose;
+  }
+
+  // Baked tracks drop scale as they're interpolated, and leaves are frozen
+  // once the pose is built, as for sampled channels
+  if (skeleton->getIsDecomposable()) {
+    std::vector<Math::Transform> locals;
+
+    Animation::buildBakedLocalTransforms(anim, *skeleton, position, locals, reductions);
+    Animation::calculateModelTransforms(*skeleton, locals, *pose);
+  } else {
+    Animation::calculateModelTransforms(*skeleton, Animation::runBakedAnimation(anim, *skeleton, position, reductions), *pose);
+  }
+
+  if (reductions & Animation::FREEZE_LEAVES) {
+    Animation::freezeLeafJoints(*skeleton, *pose);
+  }
+
+  return pose;
+}
+
+void SceneManager::calculateModelTransforms(const Math::Matrix& projView, std::vector<const std::vector<Math::AffineTransform> *>& models) {
+  uint64_t startCounts = SDL_GetPerformanceCounter();
+
+  models.resize(this->actors.size());
+
+  this->poseCache.beginFrame();
+
+  AnimationLodStats& lodStats = this->animationLodStats;
+  lodStats.actorCounts.assign(this->animationLods.size() + 1, 0);
+  lodStats.jointsPosed = 0;
+  lodStats.fullDetailJoints = 0;
+
+  // Poses that full detail would have needed, to measure what was saved
+  tsl::sparse_set<Animation::PoseCache::Key, Animation::PoseCache::KeyHash> fullDetailPoses;
+
+  unsigned baseVariant = State::interpolate != State::InterpolateType::NONE ? POSE_INTERPOLATED : 0;
+
+  // Positions are only snapped for clips that more than one actor plays on
+  // the same skeleton, as an actor on its own has nothing to share
+  tsl::sparse_map<Animation::PoseCache::Key, unsigned, Animation::PoseCache::KeyHash> clipActorCounts;
+
+  for (auto actor : this->actors) {
+    if (actor->getAnimation() == Resource::Character::Character::AnimationType::NONE) {
+      continue;
+    }
+
+    const Resource::Character *character = actor->getCharacter();
+    const Resource::Animation *anim = character->getSkeletalAnimation(actor->getAnimation());
+    if (anim) {
+      clipActorCounts[{ anim, character->getSkeleton(), 0.0f, 0 }]++;
+    }
+  }
+
+  for (unsigned i = 0; i < this->actors.size(); i++) {
+    const Resource::Actor *actor = this->actors[i];
+    const Resource::Character *character = actor->getCharacter();
+    const Resource::Skeleton *skeleton = character->getSkeleton();
+
+    if (actor->getAnimation() == Resource::Character::Character::AnimationType::NONE) {
+      bool isCached;
+      std::vector<Math::AffineTransform> *pose = this->poseCache.acquire({ nullptr, skeleton, 0.0f, 0 }, isCached);
+      if (!isCached) {
+        Animation::calculateModelTransforms(*skeleton, skeleton->getRestPose(), *pose);
+      }
+
+      models[i] = pose;
+      continue;
+    }
+
+    const Resource::Animation *anim = character->getSkeletalAnimation(actor->getAnimation());
+    if (!anim) {
+      throw std::runtime_error("character doesn't have that animation");
+    }
+
+    // Baked poses are the same whatever the interpolation setting
+    unsigned variant = baseVariant;
+    if (State::bakedAnimEnabled && anim->getBakedTracks()) {
+      variant = POSE_BAKED;
+    }
+
+    float position = actor->getAnimationPosition();
+    if (clipActorCounts.at({ anim, skeleton, 0.0f, 0 }) > 1) {
+      position = this->poseCache.quantize(position);
+    }
+
+    if (fullDetailPoses.insert({ anim, skeleton, position, variant }).second) {
+      lodStats.fullDetailJoints += skeleton->getJointCount();
+    }
+
+    unsigned level = this->selectAnimationLod(i, projView);
+    lodStats.actorCounts[level]++;
+
+    if (level == 0) {
+      models[i] = this->requestPose(character, anim, position, variant);
+      continue;
+    }
+
+    const AnimationLod& lod = this->animationLods[level - 1];
+    variant |= lod.reductions;
+
+    if (lod.sampleInterval <= 0.0f) {
+      models[i] = this->requestPose(character, anim, position, variant);
+      continue;
+    }
+
+    bool isCached;
+    std::vector<Math::AffineTransform> *pose = this->poseCache.acquire({ anim, skeleton, position, variant | level << POSE_BLEND_LEVEL_SHIFT }, isCached);
+    models[i] = pose;
 
-  if (actor->getAnimation() == Mortar::Resource::Character::Character::AnimationType::NONE) {
-    return character->getRestPose();
+    if (isCached) {
+      continue;
+    }
+
+    // Sample on a coarser grid shared by every actor at this level, so that
+    // each sampled pose is computed once and reused until passed
+    float from = floorf(position / lod.sampleInterval) * lod.sampleInterval;
+    float t = (position - from) / lod.sampleInterval;
+
+    const std::vector<Math::AffineTransform> *fromPose = this->requestPose(character, anim, from, variant);
+    // Actors loop their clips, so blend toward the start again rather than
+    // the clamped last frame when the next sample falls past the end
+    float to = fmodf(from + lod.sampleInterval, anim->getLength());
+
+    const std::vector<Math::AffineTransform> *toPose = this->requestPose(character, anim, to, variant);
+
+    this->pendingBlends.push_back({ fromPose, toPose, t, pose });
   }
 
-  const Mortar::Resource::Animation *anim = character->getSkeletalAnimation(actor->getAnimation());
-  if (!anim) {
-    throw std::runtime_error("character doesn't have that animation");
+  std::vector<float> positions;
+  std::vector<float> values;
+
+  std::vector<Math::Transform> locals;
+
+  for (auto& entry : this->pendingPoses) {
+    const Resource::Animation *anim = entry.first;
+    const std::vector<PendingPose>& pending = entry.second;
+
+    if (pending.empty()) {
+      continue;
+    }
+
+    auto batchIt = this->channelBatches.find(anim);
+    if (batchIt == this->channelBatches.end()) {
+      // Batches keep a full precision copy of every curve, which would undo
+      // compression, so quantized animations are sampled directly instead
+      std::unique_ptr<Animation::ChannelBatch> batch;
+      if (!anim->hasQuantizedChannels()) {
+        batch = std::make_unique<Animation::ChannelBatch>(anim);
+      }
+
+      batchIt = this->channelBatches.emplace(anim, std::move(batch)).first;
+    }
+
+    const Animation::ChannelBatch *batch = batchIt->second.get();
+
+    // Samplers resolve interpolation when they're made, so they're remade
+    // whenever it's toggled
+    bool interpolate = State::interpolate != State::InterpolateType::NONE;
+
+    std::unique_ptr<Animation::ClipSampler>& sampler = this->clipSamplers[anim];
+    if (!sampler || sampler->getInterpolate() != interpolate) {
+      sampler = std::make_unique<Animation::ClipSampler>(anim, interpolate);
+    }
+
+    unsigned channelCount = anim->getElementCount() * Animation::POSE_CHANNEL_COUNT;
+
+    positions.clear();
+    for (auto& pendingPose : pending) {
+      positions.push_back(pendingPose.position);
+    }
+
+    values.resize(positions.size() * channelCount);
+
+    if (batch) {
+      batch->evaluate(positions.data(), positions.size(), values.data());
+    } else {
+      for (unsigned i = 0; i < positions.size(); i++) {
+        sampler->sample(positions[i], &values[i * channelCount]);
+      }
+    }
+
+    for (unsigned i = 0; i < pending.size(); i++) {
+      const Resource::Character *character = pending[i].character;
+      const Resource::Skeleton *skeleton = character->getSkeleton();
+      const float *poseValues = &values[i * channelCount];
+
+      if (skeleton->getIsDecomposable()) {
+        Animation::buildLocalTransforms(anim, *skeleton, poseValues, locals, pending[i].reductions);
+        Animation::calculateModelTransforms(*skeleton, locals, *pending[i].pose);
+      } else {
+        Animation::calculateModelTransforms(*skeleton, Animation::buildPose(anim, *skeleton, poseValues), *pending[i].pose);
+      }
+
+      if (pending[i].reductions & Animation::FREEZE_LEAVES) {
+        Animation::freezeLeafJoints(*skeleton, *pending[i].pose);
+      }
+    }
+
+    // Keep the storage for the next frame
+    entry.second.clear();
+  }
+
+  for (auto& blend : this->pendingBlends) {
+    Animation::blendModelTransforms(*blend.from, *blend.to, blend.t, *blend.pose);
   }
 
-  return Mortar::Animation::runSkeletalAnimation(anim, character->getJoints(), actor->getAnimationPosition());
+  this->pendingBlends.clear();
+
+  lodStats.poseTime = (float)(SDL_GetPerformanceCounter() - startCounts) / SDL_GetPerformanceFrequency();
+
+  if (State::printNextFrame) {
+    const Animation::PoseCache::Stats& stats = this->poseCache.getStats();
+    DEBUG("poses: %u held, %u retained from last frame, %u lookups, %u hits (%.1f%%)", this->poseCache.getPoseCount(), stats.retained, stats.lookups, stats.hits, stats.getHitRate() * 100.0f);
+
+    for (unsigned i = 0; i < lodStats.actorCounts.size(); i++) {
+      DEBUG("animation lod %u: %u actors", i, lodStats.actorCounts[i]);
+    }
+
+    DEBUG("animation lod: %u of %u joints posed in %.3f ms, est. %.3f ms saved", lodStats.jointsPosed, lodStats.fullDetailJoints, lodStats.poseTime * 1000.0f, lodStats.getEstimatedTimeSaved() * 1000.0f);
+  }
 }
 
 void SceneManager::render() {
@@ -245,6 +552,57 @@ void SceneManager::render() {
 
   float timeDelta = State::getClock().getTimeDelta() * State::animRate;
 
+  Math::Matrix projView = this->renderer->getProjViewTransform();
+  Math::Frustum frustum (projView);
+
+  this->cullingStats.visible = 0;
+  this->cullingStats.culled = 0;
+  this->cullingStats.occluded = 0;
+
+  // Occluders must be rasterized before anything can be tested against them
+  bool isOcclusionEnabled = State::cullingEnabled && State::occlusionCullingEnabled;
+  if (isOcclusionEnabled) {
+    this->occlusionCuller.render(projView, State::getWorkerPool());
+  }
+
+  // Actors sharing a character are drawn as a crowd with instanced draws once
+  // there are enough of them for it to pay off
+  tsl::sparse_map<const Resource::Character *, unsigned> characterActorCounts;
+  for (auto actor : this->actors) {
+    characterActorCounts[actor->getCharacter()]++;
+  }
+
+  this->crowds.clear();
+  tsl::sparse_map<const Resource::Character *, unsigned> crowdIndices;
+
+  for (auto& entry : characterActorCounts) {
+    if (entry.second < MIN_CROWD_SIZE) {
+      continue;
+    }
+
+    const Resource::Character *character = entry.first;
+
+    Render::Crowd crowd;
+    crowd.jointCount = character->getSkeleton()->getJointCount();
+    crowd.actorCount = 0;
+    crowd.palettes.reserve(entry.second * crowd.jointCount);
+
+    const Resource::Model *model = character->getModel();
+
+    for (auto enabledLayer : enabledLayers) {
+      const Resource::Layer *layer = character->getLayer(enabledLayer);
+
+      for (auto meshes : { &layer->getDeformableSkinMeshes(), &layer->getSkinMeshes() }) {
+        for (auto meshIdx : *meshes) {
+          crowd.meshes.push_back(model->getMesh(meshIdx));
+        }
+      }
+    }
+
+    crowdIndices[character] = this->crowds.size();
+    this->crowds.push_back(std::move(crowd));
+  }
+
   for (auto actor : this->actors) {
     if (State::animEnabled && actor->getAnimation() != Resource::Character::Character::AnimationType::IDLE) {
       actor->setAnimation(Resource::Character::Character::AnimationType::IDLE);
@@ -252,68 +610,142 @@ void SceneManager::render() {
       actor->setAnimation(Resource::Character::Character::AnimationType::NONE);
     }
 
-    const Resource::Character *character = actor->getCharacter();
-
     actor->advanceAnimation(timeDelta);
+  }
 
-    const std::vector<Math::Matrix> pose = calculatePose(actor);
+  std::vector<const std::vector<Math::AffineTransform> *> modelTransforms;
+  this->calculateModelTransforms(projView, modelTransforms);
 
-    const std::vector<Resource::Joint *> joints = character->getJoints();
+  this->actorBounds.resize(this->actors.size());
 
-    std::vector<Math::Matrix> boneTransforms (joints.size());
-    for (int i = 0; i < joints.size(); i++) {
-      const Resource::Joint *joint = joints.at(i);
-      const int parentIdx = joint->getParentIdx();
+  // Poses are built in our handedness; the game's is restored by the skin
+  // transforms, and here by flipping before the world transform
+  Math::AffineTransform flip = Math::AffineTransform::fromMatrix(Math::Matrix::diagonal(1.0f, 1.0f, -1.0f));
 
-      if (State::printNextFrame) {
-        Math::Matrix poseMtx = pose.at(i);
-        DEBUG("transforming %d, parent %d\npose:\n%s", i, parentIdx, poseMtx.toString().c_str());
-      }
+  for (unsigned actorIdx = 0; actorIdx < this->actors.size(); actorIdx++) {
+    Resource::Actor *actor = this->actors[actorIdx];
+    const Resource::Character *character = actor->getCharacter();
 
-      if (parentIdx != -1) {
-        if (State::printNextFrame) {
-          DEBUG("parent\n%s", boneTransforms[parentIdx].toString().c_str());
-        }
-        boneTransforms[i] = pose.at(i) * boneTransforms[parentIdx];
-      } else {
-        boneTransforms[i] = pose.at(i) * actor->getWorldTransform();
-      }
+    const std::vector<Math::AffineTransform>& models = *modelTransforms[actorIdx];
+
+    const Resource::Model *model = character->getModel();
+    const Resource::Skeleton *skeleton = character->getSkeleton();
+    unsigned jointCount = skeleton->getJointCount();
+
+    Math::AffineTransform worldTransform = flip * actor->getWorldTransform();
+
+    std::vector<Math::AffineTransform> boneTransforms (jointCount);
+    Math::multiplyArray(models.data(), worldTransform, jointCount, boneTransforms.data());
 
-      if (State::printNextFrame) {
-        DEBUG("result:\n%s", boneTransforms[i].toString().c_str());
+    if (State::printNextFrame) {
+      for (int i = 0; i < jointCount; i++) {
+        DEBUG("joint %d, parent %d\nmodel:\n%s\nresult:\n%s", i, skeleton->getParentIndices()[i], models.at(i).toString().c_str(), boneTransforms[i].toString().c_str());
       }
     }
 
-    std::vector<Math::Matrix> skinTransforms (joints.size());
-    for (int i = 0; i < joints.size(); i++) {
-      skinTransforms[i] = character->getSkinTransform(i) * boneTransforms[i];
+    // Skinned meshes are culled together using the bounds of every joint
+    // posed into world space
+    Math::Bounds skinBounds;
+    for (int i = 0; i < jointCount; i++) {
+      skinBounds.merge(character->getJointBounds(i).transform(boneTransforms[i]));
+    }
+
+    this->actorBounds[actorIdx] = skinBounds;
+
+    bool isSkinVisible = !State::cullingEnabled || frustum.intersects(skinBounds);
+    bool isSkinOccluded = isSkinVisible && isOcclusionEnabled && !this->occlusionCuller.isVisible(skinBounds);
+
+    std::vector<Math::AffineTransform> skinTransforms (jointCount);
+    Math::multiplyArrays(skeleton->getSkinTransforms().data(), boneTransforms.data(), jointCount, skinTransforms.data());
+
+    // Crowd members contribute their palette in place of skinned geometry
+    bool isInCrowd = crowdIndices.contains(character);
+    if (isInCrowd && isSkinVisible && !isSkinOccluded) {
+      Render::Crowd& crowd = this->crowds[crowdIndices.at(character)];
+
+      crowd.palettes.insert(crowd.palettes.end(), skinTransforms.begin(), skinTransforms.end());
+      crowd.actorCount++;
     }
 
     for (auto enabledLayer = enabledLayers.begin(); enabledLayer != enabledLayers.end(); enabledLayer++) {
       const Resource::Layer *layer = character->getLayer(*enabledLayer);
 
-      const std::vector<Resource::Mesh *>& deformableSkinMeshes = layer->getDeformableSkinMeshes();
-      for (auto mesh : deformableSkinMeshes) {
-        Resource::GeomObject *geom = this->geomPool->getResource();
-        geom->reset();
+      const std::vector<unsigned>& deformableSkinMeshes = layer->getDeformableSkinMeshes();
+      const std::vector<unsigned>& skinMeshes = layer->getSkinMeshes();
 
-        geom->setMesh(mesh);
-        geom->setSkinTransforms(skinTransforms);
+      if (!isSkinVisible || isSkinOccluded) {
+        this->cullingStats.culled += deformableSkinMeshes.size() + skinMeshes.size();
 
-        if (mesh->getMaterial()->isAlphaBlended()) {
-          alphaGeoms.push_back(geom);
-        } else {
-          geoms.push_back(geom);
+        if (isSkinOccluded) {
+          this->cullingStats.occluded += deformableSkinMeshes.size() + skinMeshes.size();
+        }
+      } else if (isInCrowd) {
+        this->cullingStats.visible += deformableSkinMeshes.size() + skinMeshes.size();
+      } else {
+        this->cullingStats.visible += deformableSkinMeshes.size() + skinMeshes.size();
+
+        for (auto meshIdx : deformableSkinMeshes) {
+          const Resource::Mesh *mesh = model->getMesh(meshIdx);
+
+          Resource::GeomObject *geom = this->geomPool->getResource();
+          geom->reset();
+
+          geom->setMesh(mesh);
+          geom->setSkinTransforms(skinTransforms);
+
+          if (mesh->getMaterial()->isAlphaBlended()) {
+            alphaGeoms.push_back(geom);
+          } else {
+            geoms.push_back(geom);
+          }
+        }
+
+        for (auto meshIdx : skinMeshes) {
+          const Resource::Mesh *mesh = model->getMesh(meshIdx);
+
+          Resource::GeomObject *geom = this->geomPool->getResource();
+          geom->reset();
+
+          geom->setMesh(mesh);
+          geom->setSkinTransforms(skinTransforms);
+
+          if (mesh->getMaterial()->isAlphaBlended()) {
+            alphaGeoms.push_back(geom);
+          } else {
+            geoms.push_back(geom);
+          }
         }
       }
 
-      const std::vector<Resource::Mesh *>& skinMeshes = layer->getSkinMeshes();
-      for (auto mesh : skinMeshes) {
+      const std::vector<Resource::KinematicMesh>& kinematicMeshes = layer->getKinematicMeshes();
+      for (auto& kinematic : kinematicMeshes) {
+        const Resource::Mesh *mesh = model->getMesh(kinematic.meshIdx);
+        // Kinematic meshes are in the game's handedness, with no skin
+        // transform to restore it
+        Math::AffineTransform boneTransform = flip * boneTransforms.at(kinematic.jointIdx);
+
+        if (State::cullingEnabled) {
+          Math::Bounds worldBounds = mesh->getBounds().transform(boneTransform);
+
+          if (!frustum.intersects(worldBounds)) {
+            this->cullingStats.culled++;
+            continue;
+          }
+
+          if (isOcclusionEnabled && !this->occlusionCuller.isVisible(worldBounds)) {
+            this->cullingStats.culled++;
+            this->cullingStats.occluded++;
+            continue;
+          }
+        }
+
+        this->cullingStats.visible++;
+
         Resource::GeomObject *geom = this->geomPool->getResource();
         geom->reset();
 
         geom->setMesh(mesh);
-        geom->setSkinTransforms(skinTransforms);
+        geom->setWorldTransform(boneTransform);
 
         if (mesh->getMaterial()->isAlphaBlended()) {
           alphaGeoms.push_back(geom);
@@ -321,49 +753,151 @@ void SceneManager::render() {
           geoms.push_back(geom);
         }
       }
+    }
+  }
 
-      const std::vector<Resource::KinematicMesh *>& kinematicMeshes = layer->getKinematicMeshes();
-      for (auto kinematic : kinematicMeshes) {
-        Resource::GeomObject *geom = this->geomPool->getResource();
-        geom->reset();
+  const std::vector<Render::DrawList::Draw>& staticDraws = this->staticDrawList.getDraws();
+  const std::vector<Math::Bounds>& staticBounds = this->staticDrawList.getBounds();
 
-        const Resource::Mesh *mesh = kinematic->getMesh();
+  this->visibleStaticDraws.clear();
 
-        geom->setMesh(mesh);
-        geom->setWorldTransform(boneTransforms.at(kinematic->getJointIdx()));
+  if (State::cullingEnabled && !staticDraws.empty()) {
+    // Find visible instances through the scene's hierarchy, then refine the
+    // draws of each against their own bounds
+    const std::vector<unsigned>& instanceDrawOffsets = this->staticDrawList.getInstanceDrawOffsets();
+    const std::vector<unsigned>& instanceDraws = this->staticDrawList.getInstanceDraws();
 
-        if (mesh->getMaterial()->isAlphaBlended()) {
-          alphaGeoms.push_back(geom);
-        } else {
-          geoms.push_back(geom);
+    this->visibleInstances.clear();
+    this->scene->getInstanceHierarchy().queryFrustum(frustum, this->visibleInstances);
+
+    for (auto instance : this->visibleInstances) {
+      for (unsigned i = instanceDrawOffsets[instance]; i < instanceDrawOffsets[instance + 1]; i++) {
+        unsigned drawIdx = instanceDraws[i];
+
+        if (frustum.intersectsBox(staticBounds[drawIdx].minima, staticBounds[drawIdx].maxima)) {
+          this->visibleStaticDraws.push_back(drawIdx);
         }
       }
     }
+
+    // The renderer expects draws in sorted order
+    std::sort(this->visibleStaticDraws.begin(), this->visibleStaticDraws.end());
+
+    if (isOcclusionEnabled) {
+      size_t unoccludedCount = this->visibleStaticDraws.size();
+      this->occlusionCuller.cull(staticBounds, this->visibleStaticDraws, State::getWorkerPool());
+
+      this->cullingStats.occluded += unoccludedCount - this->visibleStaticDraws.size();
+    }
+  } else {
+    this->visibleStaticDraws.resize(staticDraws.size());
+    std::iota(this->visibleStaticDraws.begin(), this->visibleStaticDraws.end(), 0);
   }
 
-  const std::vector<Resource::Instance *>& instances = this->scene->getInstances();
-  for (auto instance : instances) {
-    std::forward_list<Resource::Mesh *> meshes = instance->getMeshes();
-    for (auto mesh : meshes) {
-      Resource::GeomObject *geom = this->geomPool->getResource();
-      geom->reset();
+  this->cullingStats.visible += this->visibleStaticDraws.size();
+  this->cullingStats.culled += staticDraws.size() - this->visibleStaticDraws.size();
 
-      geom->setMesh(mesh);
-      geom->setWorldTransform(instance->getWorldTransform());
+  if (State::printNextFrame) {
+    DEBUG("culling: %u visible, %u culled, %u of which occluded", this->cullingStats.visible, this->cullingStats.culled, this->cullingStats.occluded);
 
-      if (mesh->getMaterial()->isAlphaBlended()) {
-        alphaGeoms.push_back(geom);
-      } else {
-        geoms.push_back(geom);
-      }
+    if (isOcclusionEnabled) {
+      const Render::OcclusionCuller::Stats& occlusionStats = this->occlusionCuller.getStats();
+      DEBUG("occlusion: %u of %u occluder triangles rasterized, %u of %u tests rejected (%.1f%%)", occlusionStats.rasterizedTriangles, occlusionStats.occluderTriangles, occlusionStats.rejected, occlusionStats.tested, occlusionStats.getRejectionRate() * 100.0f);
     }
   }
 
   geoms.splice(geoms.end(), alphaGeoms);
 
-  this->renderer->renderGeometry(geoms);
+  if (State::printNextFrame) {
+    for (auto& crowd : this->crowds) {
+      DEBUG("crowd of %u visible actors, %lu meshes each", crowd.actorCount, crowd.meshes.size());
+    }
+  }
+
+  this->renderer->renderGeometry(geoms, this->visibleStaticDraws, this->crowds);
 
   this->geomPool->reset();
 
   State::printNextFrame = false;
 }
+
+const SceneManager::CullingStats& SceneManager::getCullingStats() const {
+  return this->cullingStats;
+}
+
+const Mortar::Render::OcclusionCuller::Stats& SceneManager::getOcclusionStats() const {
+  return this->occlusionCuller.getStats();
+}
+
+Mortar::Animation::PoseCache& SceneManager::getPoseCache() {
+  return this->poseCache;
+}
+
+const std::vector<SceneManager::AnimationLod>& SceneManager::getAnimationLods() const {
+  return this->animationLods;
+}
+
+void SceneManager::setAnimationLods(const std::vector<AnimationLod>& lods) {
+  this->animationLods = lods;
+}
+
+const SceneManager::AnimationLodStats& SceneManager::getAnimationLodStats() const {
+  return this->animationLodStats;
+}
+
+float SceneManager::AnimationLodStats::getEstimatedTimeSaved() const {
+  if (this->jointsPosed == 0 || this->fullDetailJoints <= this->jointsPosed) {
+    return 0.0f;
+  }
+
+  return this->poseTime / this->jointsPosed * (this->fullDetailJoints - this->jointsPosed);
+}
+
+void SceneManager::buildLevelGeometry() {
+  std::vector<Math::Vector> positions;
+  std::vector<uint32_t> indices;
+
+  for (unsigned i = 0; i < this->scene->getInstanceCount(); i++) {
+    const Math::AffineTransform& worldTransform = this->scene->getInstanceTransforms()[i];
+
+    for (auto mesh : this->scene->getInstanceMeshes(i)) {
+      const Resource::VertexLayout::VertexProperty *positionProperty = mesh->getVertexLayout().getProperty(Resource::VertexUsage::POSITION);
+      if (!positionProperty || mesh->getVertexDataSize() == 0) {
+        continue;
+      }
+
+      // Each vertex is transformed once and shared by every triangle using
+      // it, as meshes are mostly strips
+      uint32_t firstVertex = positions.size();
+      unsigned vertexCount = mesh->getVertexCount();
+
+      for (unsigned j = 0; j < vertexCount; j++) {
+        positions.push_back(worldTransform.transformPoint(mesh->readVertexProperty(j, *positionProperty)));
+      }
+
+      mesh->forEachTriangle([&] (uint16_t a, uint16_t b, uint16_t c) {
+        indices.push_back(firstVertex + a);
+        indices.push_back(firstVertex + b);
+        indices.push_back(firstVertex + c);
+      });
+    }
+  }
+
+  uint64_t startCounts = SDL_GetPerformanceCounter();
+  this->levelGeometry.build(positions, indices, State::getWorkerPool());
+  float buildTime = (float)(SDL_GetPerformanceCounter() - startCounts) / SDL_GetPerformanceFrequency();
+
+  DEBUG("built level geometry from %u triangles in %.1fms", this->levelGeometry.getTriangleCount(), buildTime * 1000.0f);
+}
+
+const Mortar::Math::TriangleHierarchy& SceneManager::getLevelGeometry() const {
+  return this->levelGeometry;
+}
+
+void SceneManager::queryInstancesInSphere(const Math::Vector& center, float radius, std::vector<unsigned>& instances) const {
+  if (this->scene == nullptr) {
+    return;
+  }
+
+  this->scene->getInstanceHierarchy().querySphere(center, radius, instances);
+}
@@ -17,30 +17,161 @@
 #ifndef MORTAR_SCENE_MANAGER_H
 #define MORTAR_SCENE_MANAGER_H
 
+#include <memory>
 #include <vector>
 
+#include <tsl/sparse_map.h>
+
+#include "../anim/batch.hpp"
+#include "../anim/posecache.hpp"
+#include "../anim/sampler.hpp"
+#include "../math/affine.hpp"
+#include "../math/bounds.hpp"
+#include "../math/trianglebvh.hpp"
 #include "../resource/pool.hpp"
 #include "../resource/types/actor.hpp"
 #include "../resource/types/character.hpp"
 #include "../resource/types/scene.hpp"
+#include "../render/drawlist.hpp"
+#include "../render/occlusion.hpp"
 #include "../render/renderer.hpp"
 
 namespace Mortar::Scene {
   class SceneManager {
     public:
+      class CullingStats {
+        public:
+          unsigned visible;
+          unsigned culled;
+
+          // Of those culled, the number rejected by occlusion culling rather
+          // than by the view frustum
+          unsigned occluded;
+      };
+
+      // Animation detail is reduced for actors that cover little of the
+      // screen. An actor takes the last level whose size it falls below, or
+      // full detail if none.
+      class AnimationLod {
+        public:
+          // Projected size as a fraction of the screen's height
+          float maxScreenSize;
+
+          // Frames between sampled poses, which are blended in between; zero
+          // samples every frame
+          float sampleInterval;
+
+          // Combination of Animation::PoseReduction flags
+          unsigned reductions;
+      };
+
+      class AnimationLodStats {
+        public:
+          // Indexed by level plus one, with full detail first
+          std::vector<unsigned> actorCounts;
+
+          // Joints posed in the most recent frame, against the number that
+          // would have been at full detail
+          unsigned jointsPosed;
+          unsigned fullDetailJoints;
+
+          // Seconds spent posing actors
+          float poseTime;
+
+          // Estimated from the average time spent per joint posed
+          float getEstimatedTimeSaved() const;
+      };
+
       void initialize(Render::Renderer *renderer);
       void shutDown();
 
-      Resource::Actor *addActor(const Resource::Character *character, Math::Matrix worldTransform);
+      Resource::Actor *addActor(const Resource::Character *character, Math::AffineTransform worldTransform);
       void setScene(const Resource::Scene *scene);
 
       void render();
 
+      // Counts of meshes submitted and rejected in the most recent frame
+      const CullingStats& getCullingStats() const;
+      const Render::OcclusionCuller::Stats& getOcclusionStats() const;
+
+      // Poses shared between actors this frame, along with their hit rate
+      Animation::PoseCache& getPoseCache();
+
+      // Levels are ordered from largest to smallest screen size
+      const std::vector<AnimationLod>& getAnimationLods() const;
+      void setAnimationLods(const std::vector<AnimationLod>& lods);
+
+      const AnimationLodStats& getAnimationLodStats() const;
+
+      // Appends the indices of scene instances whose bounds may overlap the
+      // given sphere
+      void queryInstancesInSphere(const Math::Vector& center, float radius, std::vector<unsigned>& instances) const;
+
+      // Every triangle of the scene's instances in world space, for ray,
+      // sphere sweep and closest point queries against the level itself
+      const Math::TriangleHierarchy& getLevelGeometry() const;
+
     private:
+      class PendingPose {
+        public:
+          const Resource::Character *character;
+          float position;
+          unsigned reductions;
+          std::vector<Math::AffineTransform> *pose;
+      };
+
+      class PendingBlend {
+        public:
+          const std::vector<Math::AffineTransform> *from;
+          const std::vector<Math::AffineTransform> *to;
+          float t;
+          std::vector<Math::AffineTransform> *pose;
+      };
+
+      // Poses every actor's joints in model space, sharing poses through the
+      // pose cache and batching the channel evaluation of those left to
+      // compute for each animation; the poses are owned by the cache
+      void calculateModelTransforms(const Math::Matrix& projView, std::vector<const std::vector<Math::AffineTransform> *>& models);
+
+      // Returns a pose from the cache, computing it if it's baked or queueing
+      // it to be batched with others of its animation if not
+      std::vector<Math::AffineTransform> *requestPose(const Resource::Character *character, const Resource::Animation *anim, float position, unsigned variant);
+
+      // Chooses a level of detail from the actor's bounds in the previous
+      // frame, returning zero for full detail or the level plus one
+      unsigned selectAnimationLod(unsigned actorIdx, const Math::Matrix& projView) const;
+
+      void buildLevelGeometry();
+
       Render::Renderer *renderer;
       std::vector<Resource::Actor *> actors;
       const Resource::Scene *scene;
       Resource::ResourcePool<Resource::GeomObject> *geomPool;
+
+      Render::DrawList staticDrawList;
+      std::vector<unsigned> visibleStaticDraws;
+      std::vector<unsigned> visibleInstances;
+
+      Render::OcclusionCuller occlusionCuller;
+
+      Math::TriangleHierarchy levelGeometry;
+
+      std::vector<Render::Crowd> crowds;
+
+      tsl::sparse_map<const Resource::Animation *, std::unique_ptr<Animation::ChannelBatch>> channelBatches;
+      tsl::sparse_map<const Resource::Animation *, std::unique_ptr<Animation::ClipSampler>> clipSamplers;
+      Animation::PoseCache poseCache;
+
+      tsl::sparse_map<const Resource::Animation *, std::vector<PendingPose>> pendingPoses;
+      std::vector<PendingBlend> pendingBlends;
+
+      std::vector<AnimationLod> animationLods;
+      AnimationLodStats animationLodStats;
+
+      // Each actor's skinned bounds as of the previous frame
+      std::vector<Math::Bounds> actorBounds;
+
+      CullingStats cullingStats;
   };
 }
 
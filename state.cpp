@@ -21,6 +21,7 @@
 #include "state.hpp"
 #include "resource/manager.hpp"
 #include "scene/manager.hpp"
+#include "workers.hpp"
 
 using namespace Mortar;
 
@@ -29,9 +30,17 @@ Clock State::clock = Clock();
 DisplayManager State::displayManager = DisplayManager();
 Resource::ResourceManager State::resourceManager = Resource::ResourceManager();
 Scene::SceneManager State::sceneManager = Scene::SceneManager();
+WorkerPool State::workerPool = WorkerPool();
 
 float State::animRate = 1.0f;
 bool State::animEnabled = true;
+float State::animBakeRate = 0.0f;
+bool State::bakedAnimEnabled = true;
+bool State::animCompressionEnabled = false;
+bool State::animLodEnabled = true;
+bool State::meshOptimizationEnabled = false;
+bool State::cullingEnabled = true;
+bool State::occlusionCullingEnabled = true;
 bool State::printNextFrame = false;
 State::InterpolateType State::interpolate = InterpolateType::HERMITE;
 
@@ -54,3 +63,7 @@ Resource::ResourceManager& State::getResourceManager() {
 Scene::SceneManager& State::getSceneManager() {
   return State::sceneManager;
 }
+
+WorkerPool& State::getWorkerPool() {
+  return State::workerPool;
+}
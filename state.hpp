@@ -22,6 +22,7 @@
 #include "display.hpp"
 #include "resource/manager.hpp"
 #include "scene/manager.hpp"
+#include "workers.hpp"
 
 namespace Mortar {
   class State {
@@ -31,6 +32,7 @@ namespace Mortar {
       static DisplayManager& getDisplayManager();
       static Resource::ResourceManager& getResourceManager();
       static Scene::SceneManager& getSceneManager();
+      static WorkerPool& getWorkerPool();
 
       enum class InterpolateType {
         NONE,
@@ -39,6 +41,24 @@ namespace Mortar {
 
       static float animRate;
       static bool animEnabled;
+
+      // Rate at which animations are baked into sampled tracks on load, or
+      // zero to keep only curves; baked tracks are played back when enabled
+      static float animBakeRate;
+      static bool bakedAnimEnabled;
+
+      // Whether animations are compressed as they're loaded
+      static bool animCompressionEnabled;
+
+      // Whether distant actors are animated at reduced detail
+      static bool animLodEnabled;
+
+      // Whether meshes are reordered for vertex cache efficiency and overdraw
+      // as they're loaded
+      static bool meshOptimizationEnabled;
+
+      static bool cullingEnabled;
+      static bool occlusionCullingEnabled;
       static bool printNextFrame;
       static InterpolateType interpolate;
 
@@ -48,6 +68,7 @@ namespace Mortar {
       static DisplayManager displayManager;
       static Resource::ResourceManager resourceManager;
       static Scene::SceneManager sceneManager;
+      static WorkerPool workerPool;
   };
 }
 
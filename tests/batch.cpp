@@ -0,0 +1,187 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <bit>
+#include <math.h>
+#include <random>
+#include <vector>
+
+#include "../anim/anim.hpp"
+#include "../anim/batch.hpp"
+#include "../anim/sampler.hpp"
+#include "../resource/types/anim.hpp"
+#include "../state.hpp"
+#include "check.hpp"
+
+using namespace Mortar;
+
+// Checks batched channel evaluation against sampling each channel with a
+// ClipSampler, with and without interpolation, over a clip built from random
+// keyframes covering every kind of channel the batch folds together
+
+static const unsigned INTERVAL_COUNT = 5;
+static const unsigned ELEMENT_COUNT = 23;
+
+// Batches evaluate cubics where samplers may evaluate Hermite records, so
+// the two only agree to within rounding
+static const float TOLERANCE = 1e-4f;
+
+static void buildAnimation(Resource::Animation& animation, std::mt19937& rng) {
+  std::uniform_int_distribution<uint32_t> maskBits;
+  std::uniform_real_distribution<float> value (-4.0f, 4.0f);
+
+  animation.setLength(INTERVAL_COUNT * 32 - 5.5f);
+  animation.setIntervalCount(INTERVAL_COUNT);
+  animation.setLayout(ELEMENT_COUNT, Animation::POSE_CHANNEL_COUNT);
+
+  std::vector<uint32_t> masks (INTERVAL_COUNT);
+  std::vector<uint16_t> intervalOffsets (INTERVAL_COUNT);
+  std::vector<float> records;
+
+  for (unsigned i = 0; i < ELEMENT_COUNT; i++) {
+    Resource::Animation::Element *element = animation.getElement(i);
+
+    element->setHasRotation(i % 2 == 0);
+    element->setHasScale(i % 3 == 0);
+
+    for (unsigned j = 0; j < Animation::POSE_CHANNEL_COUNT; j++) {
+      Resource::Animation::Channel *channel = element->getChannel(j);
+
+      if ((i + j) % 4 == 0) {
+        channel->setKeyframeType(Resource::Animation::KeyframeType::NONE);
+        channel->setData(value(rng));
+
+        continue;
+      }
+
+      channel->setKeyframeType(Resource::Animation::KeyframeType::FLOAT);
+
+      // Sparse channels hold a keyframe or two, dense ones most frames
+      unsigned density = (i * Animation::POSE_CHANNEL_COUNT + j) % 3;
+
+      std::vector<float> times;
+      unsigned keyframeCount = 0;
+
+      for (unsigned interval = 0; interval < INTERVAL_COUNT; interval++) {
+        uint32_t mask = maskBits(rng);
+        if (density == 0) {
+          mask &= maskBits(rng) & maskBits(rng) & maskBits(rng);
+        } else if (density == 2) {
+          mask |= maskBits(rng);
+        }
+
+        // Every channel has a keyframe on the first frame
+        if (interval == 0) {
+          mask |= 1;
+        }
+
+        masks[interval] = mask;
+        intervalOffsets[interval] = keyframeCount;
+        keyframeCount += std::popcount(mask);
+
+        for (unsigned frame = 0; frame < 32; frame++) {
+          if (mask & (1u << frame)) {
+            times.push_back(interval * 32 + frame + 1);
+          }
+        }
+      }
+
+      times.push_back(INTERVAL_COUNT * 32 + 1);
+
+      channel->setKeyframeIndex(masks.data(), intervalOffsets.data());
+
+      // Offsets are recovered from the segment bases rather than stored
+      for (unsigned interval = 0; interval < INTERVAL_COUNT; interval++) {
+        CHECK(channel->getIntervalOffset(interval) == intervalOffsets[interval], "interval %u offset %u, expected %u", interval, channel->getIntervalOffset(interval), intervalOffsets[interval]);
+      }
+
+      records.resize(times.size() * 4);
+      for (unsigned k = 0; k < times.size(); k++) {
+        records[k * 4] = times[k];
+        records[k * 4 + 1] = k + 1 < times.size() ? 1.0f / (times[k + 1] - times[k]) : 1.0f;
+        records[k * 4 + 2] = value(rng);
+        records[k * 4 + 3] = value(rng) * 0.25f;
+      }
+
+      channel->setRecords(records.data(), times.size());
+
+      // Batches fold in cubics whether or not they've been built
+      if (j % 2) {
+        channel->buildCubicCoefficients();
+      }
+    }
+  }
+
+  animation.compact();
+}
+
+int main() {
+  std::mt19937 rng (0x62617463);
+
+  Resource::Animation *animation = State::getResourceManager().createResource<Resource::Animation>();
+  buildAnimation(*animation, rng);
+
+  Animation::ChannelBatch batch (animation);
+  unsigned channelCount = batch.getChannelCount();
+
+  CHECK(channelCount == ELEMENT_COUNT * Animation::POSE_CHANNEL_COUNT, "batch has %u channels", channelCount);
+
+  // Before the start, on and between every frame, and past the end
+  std::vector<float> positions;
+  for (float position = -1.0f; position < animation->getLength() + 2.0f; position += 0.125f) {
+    positions.push_back(position);
+  }
+
+  std::uniform_real_distribution<float> randomPosition (0.0f, animation->getLength());
+  for (unsigned n = 0; n < 500; n++) {
+    positions.push_back(randomPosition(rng));
+  }
+
+  std::vector<float> values (positions.size() * channelCount);
+  std::vector<float> sampled (channelCount);
+
+  for (bool interpolate : { true, false }) {
+    State::interpolate = interpolate ? State::InterpolateType::HERMITE : State::InterpolateType::NONE;
+
+    Animation::ClipSampler sampler (animation, interpolate);
+    batch.evaluate(positions.data(), positions.size(), values.data());
+
+    float maxError = 0.0f;
+
+    for (unsigned i = 0; i < positions.size(); i++) {
+      sampler.sample(positions[i], sampled.data());
+
+      for (unsigned j = 0; j < channelCount; j++) {
+        // Channels an element doesn't use are left to the caller
+        unsigned element = j / Animation::POSE_CHANNEL_COUNT;
+        unsigned channel = j % Animation::POSE_CHANNEL_COUNT;
+
+        if ((channel >= 3 && channel < 6 && element % 2) || (channel >= 6 && element % 3)) {
+          continue;
+        }
+
+        float error = fabsf(values[i * channelCount + j] - sampled[j]) / fmaxf(1.0f, fabsf(sampled[j]));
+        maxError = fmaxf(maxError, error);
+
+        CHECK(error <= TOLERANCE, "%s channel %u at %g: batched %g, sampled %g", interpolate ? "interpolated" : "stepped", j, positions[i], values[i * channelCount + j], sampled[j]);
+      }
+    }
+
+    printf("%s: max relative error %g over %zu positions\n", interpolate ? "interpolated" : "stepped", maxError, positions.size());
+  }
+
+  return Tests::finish("batch");
+}
@@ -0,0 +1,102 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <random>
+#include <vector>
+
+#include "../math/affine.hpp"
+#include "../math/bounds.hpp"
+#include "check.hpp"
+
+using namespace Mortar::Math;
+
+// Checks that transformed bounds still enclose the points they were built
+// from, under rotations, non-uniform scales and both combined as bone chains
+// and world transforms produce them
+
+static float getDistance(const Vector& a, const Vector& b) {
+  float dx = a.x - b.x;
+  float dy = a.y - b.y;
+  float dz = a.z - b.z;
+
+  return sqrtf(dx * dx + dy * dy + dz * dz);
+}
+
+static void checkEncloses(const Bounds& bounds, const std::vector<Vector>& points, const char *kind, unsigned n) {
+  float tolerance = 1e-4f * (1.0f + bounds.radius);
+
+  for (auto& point : points) {
+    CHECK(getDistance(point, bounds.center) <= bounds.radius + tolerance, "%s %u: point %f outside sphere of radius %f", kind, n, getDistance(point, bounds.center), bounds.radius);
+
+    CHECK(point.x >= bounds.minima.x - tolerance && point.y >= bounds.minima.y - tolerance && point.z >= bounds.minima.z - tolerance
+      && point.x <= bounds.maxima.x + tolerance && point.y <= bounds.maxima.y + tolerance && point.z <= bounds.maxima.z + tolerance,
+      "%s %u: point outside box", kind, n);
+  }
+}
+
+int main() {
+  std::mt19937 rng (0x6d6f7274);
+  std::uniform_real_distribution<float> unit (-1.0f, 1.0f);
+  std::uniform_real_distribution<float> exponent (-1.0f, 1.0f);
+
+  for (unsigned n = 0; n < 2000; n++) {
+    std::vector<Vector> points;
+    for (unsigned i = 0; i < 8; i++) {
+      points.push_back(Vector { unit(rng) * 3.0f, unit(rng), unit(rng) * 2.0f, 1.0f });
+    }
+
+    Bounds bounds = Bounds::fromPoints(points);
+
+    Matrix rotation = Matrix::rotationZYX(unit(rng) * 3.0f, unit(rng) * 3.0f, unit(rng) * 3.0f);
+    Matrix scale = Matrix::diagonal(powf(10.0f, exponent(rng)), powf(10.0f, exponent(rng)), powf(10.0f, exponent(rng)));
+
+    // Rotating after scaling keeps the axes of the scale, but scaling after
+    // rotating shears spheres along axes no row of the result lines up with
+    for (const Matrix& linear : { rotation * scale, scale * rotation, rotation * scale * Matrix::rotationY(unit(rng) * 3.0f) }) {
+      Matrix M = linear;
+      M.m[3][0] = unit(rng) * 10.0f;
+      M.m[3][1] = unit(rng) * 10.0f;
+      M.m[3][2] = unit(rng) * 10.0f;
+
+      std::vector<Vector> transformed;
+      for (auto& point : points) {
+        transformed.push_back(point * M);
+      }
+
+      checkEncloses(bounds.transform(M), transformed, "matrix", n);
+
+      AffineTransform A = AffineTransform::fromMatrix(M);
+
+      transformed.clear();
+      for (auto& point : points) {
+        transformed.push_back(A.transformPoint(point));
+      }
+
+      checkEncloses(bounds.transform(A), transformed, "affine", n);
+    }
+
+    // Rigid transforms with uniform scale should leave the sphere no larger
+    // than it needs to be
+    float uniformScale = powf(10.0f, exponent(rng));
+    Matrix M = rotation * Matrix::diagonal(uniformScale, uniformScale, uniformScale);
+
+    float radius = bounds.transform(M).radius;
+    CHECK(fabsf(radius - bounds.radius * uniformScale) <= 1e-4f * radius, "uniform %u: radius %f, expected %f", n, radius, bounds.radius * uniformScale);
+  }
+
+  return Mortar::Tests::finish("bounds");
+}
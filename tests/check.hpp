@@ -0,0 +1,48 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MORTAR_TESTS_CHECK_H
+#define MORTAR_TESTS_CHECK_H
+
+#include <stdio.h>
+
+// Each test is an executable run by CTest, which fails if main() returns
+// nonzero; failed checks are reported as they happen and counted
+namespace Mortar::Tests {
+  inline unsigned failures = 0;
+
+  inline int finish(const char *name) {
+    if (failures) {
+      fprintf(stderr, "%s: %u checks failed\n", name, failures);
+      return 1;
+    }
+
+    printf("%s: passed\n", name);
+    return 0;
+  }
+}
+
+#define CHECK(condition, ...) \
+  do { \
+    if (!(condition)) { \
+      Mortar::Tests::failures++; \
+      fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+      fprintf(stderr, __VA_ARGS__); \
+      fputc('\n', stderr); \
+    } \
+  } while (0)
+
+#endif
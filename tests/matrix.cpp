@@ -0,0 +1,355 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <random>
+#include <vector>
+
+#include "../math/matrix.hpp"
+#include "check.hpp"
+
+using namespace Mortar::Math;
+
+// Checks the vectorized Matrix and Vector kernels against the scalar forms
+// they replace, and both against double precision, over random inputs and
+// ones chosen to be badly conditioned
+
+typedef std::array<std::array<double, 4>, 4> Matrix64;
+
+static Matrix64 widen(const Matrix& M) {
+  Matrix64 out;
+
+  for (unsigned i = 0; i < 4; i++) {
+    for (unsigned j = 0; j < 4; j++) {
+      out[i][j] = M.m[i][j];
+    }
+  }
+
+  return out;
+}
+
+static Matrix scalarMultiply(const Matrix& A, const Matrix& B) {
+  Matrix out;
+
+  for (unsigned i = 0; i < 4; i++) {
+    for (unsigned j = 0; j < 4; j++) {
+      out.m[i][j] = A.m[i][0] * B.m[0][j] + A.m[i][1] * B.m[1][j] + A.m[i][2] * B.m[2][j] + A.m[i][3] * B.m[3][j];
+    }
+  }
+
+  return out;
+}
+
+static Vector scalarTransform(const Vector& v, const Matrix& M) {
+  Vector out;
+
+  out.x = v.x * M._11 + v.y * M._21 + v.z * M._31 + v.w * M._41;
+  out.y = v.x * M._12 + v.y * M._22 + v.z * M._32 + v.w * M._42;
+  out.z = v.x * M._13 + v.y * M._23 + v.z * M._33 + v.w * M._43;
+  out.w = v.x * M._14 + v.y * M._24 + v.z * M._34 + v.w * M._44;
+
+  return out;
+}
+
+// The scalar inverse by cofactors, as built where SSE2 isn't available
+static Matrix scalarInverse(const Matrix& M) {
+  Matrix out;
+
+  float s0 = M._11 * M._22 - M._21 * M._12;
+  float s1 = M._11 * M._23 - M._21 * M._13;
+  float s2 = M._11 * M._24 - M._21 * M._14;
+  float s3 = M._12 * M._23 - M._22 * M._13;
+  float s4 = M._12 * M._24 - M._22 * M._14;
+  float s5 = M._13 * M._24 - M._23 * M._14;
+
+  float c5 = M._33 * M._44 - M._43 * M._34;
+  float c4 = M._32 * M._44 - M._42 * M._34;
+  float c3 = M._32 * M._43 - M._42 * M._33;
+  float c2 = M._31 * M._44 - M._41 * M._34;
+  float c1 = M._31 * M._43 - M._41 * M._33;
+  float c0 = M._31 * M._42 - M._41 * M._32;
+
+  float invDet = 1.0f / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+
+  out._11 = (M._22 * c5 - M._23 * c4 + M._24 * c3) * invDet;
+  out._12 = (-M._12 * c5 + M._13 * c4 - M._14 * c3) * invDet;
+  out._13 = (M._42 * s5 - M._43 * s4 + M._44 * s3) * invDet;
+  out._14 = (-M._32 * s5 + M._33 * s4 - M._34 * s3) * invDet;
+
+  out._21 = (-M._21 * c5 + M._23 * c2 - M._24 * c1) * invDet;
+  out._22 = (M._11 * c5 - M._13 * c2 + M._14 * c1) * invDet;
+  out._23 = (-M._41 * s5 + M._43 * s2 - M._44 * s1) * invDet;
+  out._24 = (M._31 * s5 - M._33 * s2 + M._34 * s1) * invDet;
+
+  out._31 = (M._21 * c4 - M._22 * c2 + M._24 * c0) * invDet;
+  out._32 = (-M._11 * c4 + M._12 * c2 - M._14 * c0) * invDet;
+  out._33 = (M._41 * s4 - M._42 * s2 + M._44 * s0) * invDet;
+  out._34 = (-M._31 * s4 + M._32 * s2 - M._34 * s0) * invDet;
+
+  out._41 = (-M._21 * c3 + M._22 * c1 - M._23 * c0) * invDet;
+  out._42 = (M._11 * c3 - M._12 * c1 + M._13 * c0) * invDet;
+  out._43 = (-M._41 * s3 + M._42 * s1 - M._43 * s0) * invDet;
+  out._44 = (M._31 * s3 - M._32 * s1 + M._33 * s0) * invDet;
+
+  return out;
+}
+
+// Gauss-Jordan elimination with partial pivoting; returns false if the
+// matrix is singular to double precision
+static bool referenceInverse(Matrix64 M, Matrix64& out) {
+  for (unsigned i = 0; i < 4; i++) {
+    for (unsigned j = 0; j < 4; j++) {
+      out[i][j] = i == j ? 1.0 : 0.0;
+    }
+  }
+
+  for (unsigned col = 0; col < 4; col++) {
+    unsigned pivot = col;
+    for (unsigned row = col + 1; row < 4; row++) {
+      if (fabs(M[row][col]) > fabs(M[pivot][col])) {
+        pivot = row;
+      }
+    }
+
+    if (M[pivot][col] == 0.0) {
+      return false;
+    }
+
+    std::swap(M[col], M[pivot]);
+    std::swap(out[col], out[pivot]);
+
+    double invPivot = 1.0 / M[col][col];
+    for (unsigned j = 0; j < 4; j++) {
+      M[col][j] *= invPivot;
+      out[col][j] *= invPivot;
+    }
+
+    for (unsigned row = 0; row < 4; row++) {
+      if (row == col) {
+        continue;
+      }
+
+      double factor = M[row][col];
+      for (unsigned j = 0; j < 4; j++) {
+        M[row][j] -= factor * M[col][j];
+        out[row][j] -= factor * out[col][j];
+      }
+    }
+  }
+
+  return true;
+}
+
+static double infinityNorm(const Matrix64& M) {
+  double norm = 0.0;
+
+  for (unsigned i = 0; i < 4; i++) {
+    norm = fmax(norm, fabs(M[i][0]) + fabs(M[i][1]) + fabs(M[i][2]) + fabs(M[i][3]));
+  }
+
+  return norm;
+}
+
+static double maxDifference(const Matrix& M, const Matrix64& reference) {
+  double difference = 0.0;
+
+  for (unsigned i = 0; i < 4; i++) {
+    for (unsigned j = 0; j < 4; j++) {
+      difference = fmax(difference, fabs(M.m[i][j] - reference[i][j]));
+    }
+  }
+
+  return difference;
+}
+
+static double maxMagnitude(const Matrix64& M) {
+  double magnitude = 0.0;
+
+  for (auto& row : M) {
+    for (auto value : row) {
+      magnitude = fmax(magnitude, fabs(value));
+    }
+  }
+
+  return magnitude;
+}
+
+static void checkMultiply(const Matrix& A, const Matrix& B) {
+  Matrix product = A * B;
+  Matrix scalarProduct = scalarMultiply(A, B);
+
+  for (unsigned i = 0; i < 4; i++) {
+    for (unsigned j = 0; j < 4; j++) {
+      double exact = 0.0;
+      double magnitude = 0.0;
+
+      for (unsigned k = 0; k < 4; k++) {
+        exact += (double)A.m[i][k] * B.m[k][j];
+        magnitude += fabs((double)A.m[i][k] * B.m[k][j]);
+      }
+
+      // Four products summed in float lose at most a few units in the last
+      // place of the largest of them, in whichever order they're summed
+      double tolerance = 4.0 * FLT_EPSILON * magnitude;
+
+      CHECK(fabs(product.m[i][j] - exact) <= tolerance, "multiply [%u][%u]: %g, expected %g", i, j, product.m[i][j], exact);
+      CHECK(fabs(product.m[i][j] - scalarProduct.m[i][j]) <= 2.0 * tolerance, "multiply [%u][%u]: %g, scalar %g", i, j, product.m[i][j], scalarProduct.m[i][j]);
+    }
+  }
+}
+
+static void checkTransform(const Vector& v, const Matrix& M) {
+  Vector transformed = v * M;
+  Vector scalarTransformed = scalarTransform(v, M);
+
+  const float components[4] = { v.x, v.y, v.z, v.w };
+  const float results[4] = { transformed.x, transformed.y, transformed.z, transformed.w };
+  const float scalarResults[4] = { scalarTransformed.x, scalarTransformed.y, scalarTransformed.z, scalarTransformed.w };
+
+  for (unsigned j = 0; j < 4; j++) {
+    double exact = 0.0;
+    double magnitude = 0.0;
+
+    for (unsigned k = 0; k < 4; k++) {
+      exact += (double)components[k] * M.m[k][j];
+      magnitude += fabs((double)components[k] * M.m[k][j]);
+    }
+
+    double tolerance = 4.0 * FLT_EPSILON * magnitude;
+
+    CHECK(fabs(results[j] - exact) <= tolerance, "transform [%u]: %g, expected %g", j, results[j], exact);
+    CHECK(fabs(results[j] - scalarResults[j]) <= 2.0 * tolerance, "transform [%u]: %g, scalar %g", j, results[j], scalarResults[j]);
+  }
+}
+
+static void checkTranspose(const Matrix& M) {
+  Matrix transposed = M;
+  transposed.transpose();
+
+  for (unsigned i = 0; i < 4; i++) {
+    for (unsigned j = 0; j < 4; j++) {
+      CHECK(transposed.m[i][j] == M.m[j][i], "transpose [%u][%u]: %g, expected %g", i, j, transposed.m[i][j], M.m[j][i]);
+    }
+  }
+}
+
+// Inverses can only be as accurate as the matrix's condition number allows,
+// so the error allowed grows with it
+static void checkInverse(const Matrix& M) {
+  Matrix64 reference;
+  if (!referenceInverse(widen(M), reference)) {
+    return;
+  }
+
+  double condition = infinityNorm(widen(M)) * infinityNorm(reference);
+  if (condition * FLT_EPSILON > 1e-2) {
+    return;
+  }
+
+  double tolerance = 64.0 * FLT_EPSILON * condition * maxMagnitude(reference);
+
+  double error = maxDifference(M.inverse(), reference);
+  double scalarError = maxDifference(scalarInverse(M), reference);
+
+  CHECK(error <= tolerance, "inverse error %g exceeds %g at condition %g", error, tolerance, condition);
+  CHECK(scalarError <= tolerance, "scalar inverse error %g exceeds %g at condition %g", scalarError, tolerance, condition);
+}
+
+int main() {
+  std::mt19937 rng (0x6d6f7274);
+  std::uniform_real_distribution<float> unit (-1.0f, 1.0f);
+  std::uniform_real_distribution<float> exponent (-3.0f, 3.0f);
+
+  auto randomMatrix = [&] () {
+    Matrix M;
+    for (auto& value : M.f) {
+      value = unit(rng);
+    }
+
+    return M;
+  };
+
+  std::vector<Matrix> matrices;
+
+  for (unsigned n = 0; n < 2000; n++) {
+    matrices.push_back(randomMatrix());
+  }
+
+  // Rows and columns scaled across several orders of magnitude
+  for (unsigned n = 0; n < 1000; n++) {
+    Matrix M = randomMatrix();
+
+    for (unsigned i = 0; i < 4; i++) {
+      float rowScale = powf(10.0f, exponent(rng));
+      float columnScale = powf(10.0f, exponent(rng));
+
+      for (unsigned j = 0; j < 4; j++) {
+        M.m[i][j] *= rowScale;
+        M.m[j][i] *= columnScale;
+      }
+    }
+
+    matrices.push_back(M);
+  }
+
+  // World transforms, with large translations and tiny or large scales
+  for (unsigned n = 0; n < 1000; n++) {
+    Matrix M = Matrix::rotationZYX(unit(rng) * 3.0f, unit(rng) * 3.0f, unit(rng) * 3.0f);
+
+    float scale = powf(10.0f, exponent(rng));
+    M.scale(scale, scale * (1.0f + unit(rng) * 0.5f), scale);
+    M.translate(unit(rng) * 1e4f, unit(rng) * 1e4f, unit(rng) * 1e4f);
+
+    matrices.push_back(M);
+  }
+
+  // View and projection transforms as the renderer builds them
+  for (unsigned n = 0; n < 500; n++) {
+    Vector eye (unit(rng) * 500.0f, unit(rng) * 500.0f, unit(rng) * 500.0f, 1.0f);
+    Vector at (unit(rng) * 500.0f, unit(rng) * 500.0f, unit(rng) * 500.0f, 1.0f);
+
+    Matrix view = Matrix::lookAt(eye, at, Vector(0.0f, 1.0f, 0.0f, 0.0f));
+    Matrix projection = Matrix::perspectiveRH(0.5f + (unit(rng) + 1.0f), 4.0f / 3.0f, 0.1f, 1000.0f);
+
+    matrices.push_back(view);
+    matrices.push_back(view * projection);
+  }
+
+  // Nearly singular, as a rank-deficient matrix plus a small perturbation
+  for (unsigned n = 0; n < 1000; n++) {
+    Matrix M = randomMatrix();
+    float epsilon = powf(10.0f, -2.0f - (unit(rng) + 1.0f));
+
+    for (unsigned j = 0; j < 4; j++) {
+      M.m[3][j] = M.m[0][j] * 0.5f + M.m[1][j] * 0.25f + unit(rng) * epsilon;
+    }
+
+    matrices.push_back(M);
+  }
+
+  for (unsigned n = 0; n < matrices.size(); n++) {
+    const Matrix& M = matrices[n];
+
+    checkMultiply(M, matrices[(n * 7919 + 1) % matrices.size()]);
+    checkTransform(Vector(unit(rng) * 100.0f, unit(rng) * 100.0f, unit(rng) * 100.0f, n & 1 ? 1.0f : 0.0f), M);
+    checkTranspose(M);
+    checkInverse(M);
+  }
+
+  return Mortar::Tests::finish("matrix");
+}
@@ -0,0 +1,438 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <random>
+#include <vector>
+
+#include "../math/bvh.hpp"
+#include "../math/trianglebvh.hpp"
+#include "../workers.hpp"
+#include "check.hpp"
+
+using namespace Mortar;
+using namespace Mortar::Math;
+
+// Checks triangle hierarchy queries against a scan over every triangle in
+// double precision, for hierarchies built on one thread and on several. The
+// instance hierarchy shares the same builder, so its sphere query is checked
+// against a scan too.
+
+class Point64 {
+  public:
+    double x, y, z;
+
+    Point64 operator-(const Point64& b) const { return { x - b.x, y - b.y, z - b.z }; }
+    Point64 operator+(const Point64& b) const { return { x + b.x, y + b.y, z + b.z }; }
+    Point64 operator*(double s) const { return { x * s, y * s, z * s }; }
+};
+
+static Point64 widen(const Vector& v) {
+  return { v.x, v.y, v.z };
+}
+
+static double dot(const Point64& a, const Point64& b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static Point64 cross(const Point64& a, const Point64& b) {
+  return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+static double getSegmentDistance(const Point64& p, const Point64& a, const Point64& b) {
+  Point64 ab = b - a;
+
+  double lengthSq = dot(ab, ab);
+  double s = lengthSq > 0.0 ? fmin(fmax(dot(p - a, ab) / lengthSq, 0.0), 1.0) : 0.0;
+
+  Point64 offset = p - (a + ab * s);
+
+  return sqrt(dot(offset, offset));
+}
+
+// Projects onto the plane when that lands inside the triangle, and otherwise
+// takes the nearest edge, rather than walking Voronoi regions as the
+// hierarchy does
+static double getTriangleDistance(const Point64& p, const Point64& a, const Point64& b, const Point64& c) {
+  double distance = fmin(fmin(getSegmentDistance(p, a, b), getSegmentDistance(p, b, c)), getSegmentDistance(p, c, a));
+
+  Point64 normal = cross(b - a, c - a);
+  double normalLengthSq = dot(normal, normal);
+  if (normalLengthSq == 0.0) {
+    return distance;
+  }
+
+  double height = dot(p - a, normal) / normalLengthSq;
+  Point64 projected = p - normal * height;
+
+  bool inside = dot(cross(b - a, projected - a), normal) >= 0.0
+    && dot(cross(c - b, projected - b), normal) >= 0.0
+    && dot(cross(a - c, projected - c), normal) >= 0.0;
+
+  return inside ? fabs(height) * sqrt(normalLengthSq) : distance;
+}
+
+class TriangleSoup {
+  public:
+    Point64 getVertex(unsigned triangle, unsigned corner) const {
+      return widen(this->positions[this->indices[triangle * 3 + corner]]);
+    }
+
+    unsigned getTriangleCount() const {
+      return this->indices.size() / 3;
+    }
+
+    double getDistance(const Point64& p, unsigned triangle) const {
+      return getTriangleDistance(p, this->getVertex(triangle, 0), this->getVertex(triangle, 1), this->getVertex(triangle, 2));
+    }
+
+    double getDistance(const Point64& p) const {
+      double distance = INFINITY;
+
+      for (unsigned i = 0; i < this->getTriangleCount(); i++) {
+        distance = fmin(distance, this->getDistance(p, i));
+      }
+
+      return distance;
+    }
+
+    // Moller-Trumbore with no tolerance for rays parallel to a triangle
+    double raycast(const Point64& origin, const Point64& direction, unsigned triangle) const {
+      Point64 a = this->getVertex(triangle, 0);
+      Point64 e1 = this->getVertex(triangle, 1) - a;
+      Point64 e2 = this->getVertex(triangle, 2) - a;
+
+      Point64 p = cross(direction, e2);
+      double det = dot(e1, p);
+      if (det == 0.0) {
+        return INFINITY;
+      }
+
+      Point64 t = origin - a;
+      double u = dot(t, p) / det;
+      if (u < 0.0 || u > 1.0) {
+        return INFINITY;
+      }
+
+      Point64 q = cross(t, e1);
+      double v = dot(direction, q) / det;
+      if (v < 0.0 || u + v > 1.0) {
+        return INFINITY;
+      }
+
+      double distance = dot(e2, q) / det;
+
+      return distance >= 0.0 ? distance : INFINITY;
+    }
+
+    double raycast(const Point64& origin, const Point64& direction) const {
+      double distance = INFINITY;
+
+      for (unsigned i = 0; i < this->getTriangleCount(); i++) {
+        distance = fmin(distance, this->raycast(origin, direction, i));
+      }
+
+      return distance;
+    }
+
+    // Advances the sphere by its distance from the nearest triangle until it
+    // touches one; since that distance changes no faster than the sphere
+    // moves, no step can pass through a triangle. Returns INFINITY if nothing
+    // is touched within maxDistance, or NAN if the sphere creeps along a
+    // near miss for too long to tell.
+    double sweepSphere(const Point64& origin, double radius, const Point64& direction, double maxDistance) const {
+      double distance = 0.0;
+
+      for (unsigned step = 0; step < 10000; step++) {
+        double clearance = this->getDistance(origin + direction * distance) - radius;
+        if (clearance <= 1e-7) {
+          return distance;
+        }
+
+        distance += clearance;
+        if (distance >= maxDistance) {
+          return INFINITY;
+        }
+      }
+
+      return NAN;
+    }
+
+    std::vector<Vector> positions;
+    std::vector<uint32_t> indices;
+};
+
+static void checkStructure(const TriangleHierarchy& hierarchy, const TriangleSoup& soup) {
+  const std::vector<TriangleHierarchy::Node>& nodes = hierarchy.getNodes();
+
+  CHECK(hierarchy.getTriangleCount() == soup.getTriangleCount(), "%u triangles in hierarchy, %u given", hierarchy.getTriangleCount(), soup.getTriangleCount());
+
+  // Leaves are visited in order, so should cover every triangle exactly once
+  // and in sequence
+  uint32_t nextTriangle = 0;
+
+  for (uint32_t i = 0; i < nodes.size(); i++) {
+    const TriangleHierarchy::Node& node = nodes[i];
+
+    if (node.rightChild == 0) {
+      CHECK(node.firstTriangle == nextTriangle, "leaf %u starts at %u, expected %u", i, node.firstTriangle, nextTriangle);
+      nextTriangle = node.firstTriangle + node.triangleCount;
+      continue;
+    }
+
+    const TriangleHierarchy::Node& left = nodes[i + 1];
+    const TriangleHierarchy::Node& right = nodes[node.rightChild];
+
+    CHECK(left.firstTriangle == node.firstTriangle && right.firstTriangle == left.firstTriangle + left.triangleCount && left.triangleCount + right.triangleCount == node.triangleCount, "children of node %u don't split its triangles", i);
+
+    for (unsigned axis = 0; axis < 3; axis++) {
+      CHECK(left.minima[axis] >= node.minima[axis] && left.maxima[axis] <= node.maxima[axis], "left child of node %u outside it", i);
+      CHECK(right.minima[axis] >= node.minima[axis] && right.maxima[axis] <= node.maxima[axis], "right child of node %u outside it", i);
+    }
+  }
+
+  CHECK(nextTriangle == soup.getTriangleCount(), "leaves cover %u of %u triangles", nextTriangle, soup.getTriangleCount());
+}
+
+static void checkQueries(const TriangleHierarchy& hierarchy, const TriangleSoup& soup, std::mt19937& rng, unsigned queryCount) {
+  std::uniform_real_distribution<float> unit (-1.0f, 1.0f);
+
+  auto randomPoint = [&] () {
+    return Vector { unit(rng) * 12.0f, unit(rng) * 4.0f, unit(rng) * 12.0f, 1.0f };
+  };
+
+  auto randomDirection = [&] () {
+    Vector direction;
+    do {
+      direction = Vector { unit(rng), unit(rng), unit(rng), 0.0f };
+    } while (direction.getMagnitude() < 0.1f);
+
+    return Vector::normalize(direction);
+  };
+
+  const float maxDistance = 20.0f;
+
+  for (unsigned n = 0; n < queryCount; n++) {
+    Vector origin = randomPoint();
+    Vector direction = randomDirection();
+
+    Point64 origin64 = widen(origin);
+    Point64 direction64 = widen(direction);
+
+    TriangleHierarchy::Hit hit;
+
+    double expected = soup.raycast(origin64, direction64);
+    bool isHit = hierarchy.raycast(origin, direction, maxDistance, hit);
+
+    if (expected < maxDistance - 1e-3) {
+      CHECK(isHit, "ray %u missed, expected hit at %f", n, expected);
+    } else if (expected > maxDistance + 1e-3) {
+      CHECK(!isHit, "ray %u hit at %f, expected none", n, hit.distance);
+    }
+
+    if (isHit) {
+      CHECK(fabs(hit.distance - expected) <= 1e-4 * (1.0 + expected), "ray %u hit at %f, expected %f", n, hit.distance, expected);
+      CHECK(fabs(soup.raycast(origin64, direction64, hit.triangle) - hit.distance) <= 1e-4 * (1.0 + expected), "ray %u reported triangle %u, which it doesn't hit there", n, hit.triangle);
+      CHECK(fabs(Vector::dot(hit.normal, direction)) <= 1.0f + 1e-5f && Vector::dot(hit.normal, direction) <= 0.0f, "ray %u normal faces away", n);
+    }
+
+    expected = soup.getDistance(origin64);
+    isHit = hierarchy.findClosestPoint(origin, maxDistance, hit);
+
+    CHECK(isHit == (expected <= maxDistance), "closest point %u found %d, expected at %f", n, isHit, expected);
+
+    if (isHit) {
+      CHECK(fabs(hit.distance - expected) <= 1e-4 * (1.0 + expected), "closest point %u at %f, expected %f", n, hit.distance, expected);
+      CHECK(soup.getDistance(widen(hit.position), hit.triangle) <= 1e-4, "closest point %u not on triangle %u", n, hit.triangle);
+      CHECK(fabs(sqrt(dot(widen(hit.position) - origin64, widen(hit.position) - origin64)) - hit.distance) <= 1e-4 * (1.0 + expected), "closest point %u position doesn't match its distance", n);
+    }
+
+    float radius = 0.05f + (unit(rng) + 1.0f) * 0.5f;
+
+    expected = soup.sweepSphere(origin64, radius, direction64, maxDistance);
+    isHit = hierarchy.sweepSphere(origin, radius, direction, maxDistance, hit);
+
+    if (isnan(expected)) {
+      continue;
+    }
+
+    if (expected < maxDistance - 1e-3) {
+      CHECK(isHit, "sweep %u missed, expected hit at %f", n, expected);
+    } else if (expected > maxDistance + 1e-3) {
+      CHECK(!isHit, "sweep %u hit at %f, expected none", n, hit.distance);
+    }
+
+    if (isHit) {
+      // Grazing contacts are poorly conditioned in distance along the sweep
+      // but not in clearance, so check both loosely and the latter tightly
+      double clearance = soup.getDistance(origin64 + direction64 * hit.distance) - radius;
+
+      CHECK(fabs(hit.distance - expected) <= 1e-2 * (1.0 + expected), "sweep %u hit at %f, expected %f", n, hit.distance, expected);
+      CHECK(hit.distance == 0.0f ? clearance <= 1e-4 : fabs(clearance) <= 1e-4, "sweep %u stopped %f clear of the nearest triangle", n, clearance);
+      CHECK(fabs(soup.getDistance(widen(hit.position), hit.triangle)) <= 1e-4, "sweep %u contact not on triangle %u", n, hit.triangle);
+    }
+  }
+}
+
+static void checkInstanceHierarchy(std::mt19937& rng) {
+  std::uniform_real_distribution<float> unit (-1.0f, 1.0f);
+
+  std::vector<Bounds> itemBounds;
+
+  for (unsigned n = 0; n < 2000; n++) {
+    // Leave some empty, which the hierarchy should skip
+    if (n % 97 == 0) {
+      itemBounds.emplace_back();
+      continue;
+    }
+
+    Vector center { unit(rng) * 50.0f, unit(rng) * 5.0f, unit(rng) * 50.0f, 1.0f };
+
+    std::vector<Vector> points;
+    for (unsigned i = 0; i < 4; i++) {
+      points.push_back(Vector { center.x + unit(rng), center.y + unit(rng), center.z + unit(rng), 1.0f });
+    }
+
+    itemBounds.push_back(Bounds::fromPoints(points));
+  }
+
+  // Items stacked in one place leave the heuristic nothing to split on, so
+  // must still be split to keep leaves small
+  std::vector<Vector> stackedPoints { Vector { 0.0f, 0.0f, 0.0f, 1.0f }, Vector { 1.0f, 1.0f, 1.0f, 1.0f } };
+
+  for (unsigned n = 0; n < 100; n++) {
+    itemBounds.push_back(Bounds::fromPoints(stackedPoints));
+  }
+
+  BoundingVolumeHierarchy hierarchy;
+  hierarchy.build(itemBounds);
+
+  for (auto& node : hierarchy.getNodes()) {
+    CHECK(node.rightChild != 0 || node.itemCount <= 16, "leaf of %u items is larger than queries allow for", node.itemCount);
+  }
+
+  for (unsigned n = 0; n < 500; n++) {
+    Vector center { unit(rng) * 55.0f, unit(rng) * 6.0f, unit(rng) * 55.0f, 1.0f };
+    float radius = (unit(rng) + 1.0f) * 4.0f;
+
+    std::vector<unsigned> items;
+    hierarchy.querySphere(center, radius, items);
+
+    std::vector<uint8_t> found (itemBounds.size());
+    for (auto item : items) {
+      CHECK(found[item] == 0, "sphere %u found item %u twice", n, item);
+      found[item] = 1;
+    }
+
+    for (unsigned i = 0; i < itemBounds.size(); i++) {
+      const Bounds& bounds = itemBounds[i];
+
+      bool overlaps = !bounds.isEmpty()
+        && fmax(fmax(bounds.minima.x - center.x, center.x - bounds.maxima.x), 0.0f) * fmax(fmax(bounds.minima.x - center.x, center.x - bounds.maxima.x), 0.0f)
+          + fmax(fmax(bounds.minima.y - center.y, center.y - bounds.maxima.y), 0.0f) * fmax(fmax(bounds.minima.y - center.y, center.y - bounds.maxima.y), 0.0f)
+          + fmax(fmax(bounds.minima.z - center.z, center.z - bounds.maxima.z), 0.0f) * fmax(fmax(bounds.minima.z - center.z, center.z - bounds.maxima.z), 0.0f)
+          <= radius * radius;
+
+      CHECK(found[i] == overlaps, "sphere %u %s item %u", n, overlaps ? "missed" : "wrongly found", i);
+    }
+  }
+}
+
+int main() {
+  std::mt19937 rng (0x6d6f7274);
+  std::uniform_real_distribution<float> unit (-1.0f, 1.0f);
+
+  TriangleSoup soup;
+
+  // Rolling ground as an indexed grid, sharing vertices between triangles
+  // as level meshes do, and enough of it for subtrees to be built in
+  // parallel
+  const unsigned gridSize = 65;
+
+  for (unsigned i = 0; i < gridSize; i++) {
+    for (unsigned j = 0; j < gridSize; j++) {
+      float x = (i / (float)(gridSize - 1) - 0.5f) * 24.0f;
+      float z = (j / (float)(gridSize - 1) - 0.5f) * 24.0f;
+
+      soup.positions.push_back(Vector { x, -2.0f + 0.5f * sinf(x * 0.7f) * cosf(z * 0.4f), z, 1.0f });
+    }
+  }
+
+  for (uint32_t i = 0; i + 1 < gridSize; i++) {
+    for (uint32_t j = 0; j + 1 < gridSize; j++) {
+      uint32_t corner = i * gridSize + j;
+
+      soup.indices.insert(soup.indices.end(), { corner, corner + 1, corner + gridSize });
+      soup.indices.insert(soup.indices.end(), { corner + 1, corner + gridSize + 1, corner + gridSize });
+    }
+  }
+
+  // Scattered clutter of all sizes and orientations
+  for (unsigned n = 0; n < 2000; n++) {
+    Vector center { unit(rng) * 12.0f, unit(rng) * 4.0f, unit(rng) * 12.0f, 1.0f };
+    float size = powf(10.0f, unit(rng)) * 0.5f;
+
+    for (unsigned i = 0; i < 3; i++) {
+      soup.indices.push_back(soup.positions.size());
+      soup.positions.push_back(Vector { center.x + unit(rng) * size, center.y + unit(rng) * size, center.z + unit(rng) * size, 1.0f });
+    }
+  }
+
+  // Degenerate triangles, which can be touched at their edges and vertices
+  // but never hit by rays through their faces
+  for (unsigned n = 0; n < 50; n++) {
+    Vector a { unit(rng) * 12.0f, unit(rng) * 4.0f, unit(rng) * 12.0f, 1.0f };
+    Vector b { a.x + unit(rng), a.y + unit(rng), a.z + unit(rng), 1.0f };
+
+    uint32_t first = soup.positions.size();
+
+    soup.positions.push_back(a);
+    soup.positions.push_back(b);
+    soup.positions.push_back((a + b) * 0.5f);
+
+    if (n % 2) {
+      soup.indices.insert(soup.indices.end(), { first, first + 1, first + 2 });
+    } else {
+      soup.indices.insert(soup.indices.end(), { first, first, first + 1 });
+    }
+  }
+
+  // A pool which is never started runs everything on the calling thread
+  WorkerPool serialWorkers;
+
+  WorkerPool parallelWorkers;
+  parallelWorkers.initialize(3);
+
+  for (WorkerPool *workers : { &serialWorkers, &parallelWorkers }) {
+    TriangleHierarchy hierarchy;
+    hierarchy.build(soup.positions, soup.indices, *workers);
+
+    checkStructure(hierarchy, soup);
+    checkQueries(hierarchy, soup, rng, 300);
+  }
+
+  parallelWorkers.shutDown();
+
+  TriangleHierarchy empty;
+  empty.build({}, {}, serialWorkers);
+
+  TriangleHierarchy::Hit hit;
+  CHECK(empty.isEmpty() && !empty.raycast(Vector { 0.0f, 0.0f, 0.0f, 1.0f }, Vector::yAxis, 10.0f, hit), "empty hierarchy reported a hit");
+
+  checkInstanceHierarchy(rng);
+
+  return Tests::finish("trianglebvh");
+}
@@ -0,0 +1,128 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "workers.hpp"
+
+using namespace Mortar;
+
+void WorkerPool::initialize(unsigned threadCount) {
+  if (threadCount == 0) {
+    // Leave the calling thread's core out of the count, since it also runs
+    // tasks
+    unsigned hardwareThreads = std::thread::hardware_concurrency();
+    threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+  }
+
+  this->task = nullptr;
+  this->taskCount = 0;
+  this->nextTask = 0;
+  this->activeWorkers = 0;
+  this->batchId = 0;
+  this->shouldExit = false;
+
+  for (unsigned i = 0; i < threadCount; i++) {
+    this->threads.emplace_back(&WorkerPool::workerMain, this);
+  }
+}
+
+void WorkerPool::shutDown() {
+  {
+    std::lock_guard<std::mutex> lock (this->mutex);
+    this->shouldExit = true;
+  }
+
+  this->batchReady.notify_all();
+
+  for (auto& thread : this->threads) {
+    thread.join();
+  }
+
+  this->threads.clear();
+}
+
+void WorkerPool::run(unsigned taskCount, const std::function<void(unsigned)>& task) {
+  if (taskCount == 0) {
+    return;
+  }
+
+  // Not worth waking anyone for a single task
+  if (this->threads.empty() || taskCount == 1) {
+    for (unsigned i = 0; i < taskCount; i++) {
+      task(i);
+    }
+
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock (this->mutex);
+
+    this->task = &task;
+    this->taskCount = taskCount;
+    this->nextTask = 0;
+    this->activeWorkers = this->threads.size();
+    this->batchId++;
+  }
+
+  this->batchReady.notify_all();
+
+  this->runTasks();
+
+  std::unique_lock<std::mutex> lock (this->mutex);
+  this->batchDone.wait(lock, [this] { return this->activeWorkers == 0; });
+
+  this->task = nullptr;
+}
+
+unsigned WorkerPool::getConcurrency() const {
+  return this->threads.size() + 1;
+}
+
+void WorkerPool::workerMain() {
+  uint64_t lastBatchId = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock (this->mutex);
+      this->batchReady.wait(lock, [&] { return this->shouldExit || this->batchId != lastBatchId; });
+
+      if (this->shouldExit) {
+        return;
+      }
+
+      lastBatchId = this->batchId;
+    }
+
+    this->runTasks();
+
+    bool isLast;
+    {
+      std::lock_guard<std::mutex> lock (this->mutex);
+      isLast = --this->activeWorkers == 0;
+    }
+
+    if (isLast) {
+      this->batchDone.notify_one();
+    }
+  }
+}
+
+void WorkerPool::runTasks() {
+  unsigned taskIdx;
+  while ((taskIdx = this->nextTask.fetch_add(1)) < this->taskCount) {
+    (*this->task)(taskIdx);
+  }
+}
@@ -0,0 +1,64 @@
+/* This file is part of mortar.
+ *
+ * mortar is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mortar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mortar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MORTAR_WORKERS_H
+#define MORTAR_WORKERS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace Mortar {
+  // A fixed set of threads for splitting per-frame work into independent
+  // tasks. Only one batch of tasks runs at a time, and the thread submitting
+  // it takes part in the work rather than sitting idle.
+  class WorkerPool {
+    public:
+      void initialize(unsigned threadCount = 0);
+      void shutDown();
+
+      // Runs task for every index in [0, taskCount), returning once all have
+      // completed; tasks may run in any order and on any thread
+      void run(unsigned taskCount, const std::function<void(unsigned)>& task);
+
+      // Total number of threads tasks may run on, including the caller
+      unsigned getConcurrency() const;
+
+    private:
+      void workerMain();
+      void runTasks();
+
+      std::vector<std::thread> threads;
+
+      std::mutex mutex;
+      std::condition_variable batchReady;
+      std::condition_variable batchDone;
+
+      const std::function<void(unsigned)> *task;
+      unsigned taskCount;
+      std::atomic<unsigned> nextTask;
+      unsigned activeWorkers;
+
+      uint64_t batchId;
+      bool shouldExit;
+  };
+}
+
+#endif